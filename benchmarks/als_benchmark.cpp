@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <Eigen/Dense>
+#include <boost/config/warning_disable.hpp>
+#include <boost/spirit/include/qi.hpp>
+#include <boost/spirit/include/phoenix_core.hpp>
+#include <boost/spirit/include/phoenix_operator.hpp>
+#include <boost/spirit/include/phoenix_stl.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include "graph_benchmark.hpp"
+// the serializers specialize graphlab templates, so they must be
+// outside of the namespace below
+#include "../toolkits/collaborative_filtering/eigen_serialization.hpp"
+#include "../toolkits/collaborative_filtering/eigen_wrapper.hpp"
+
+// See pagerank_benchmark.cpp
+namespace {
+#define main als_toolkit_main
+#include "../toolkits/collaborative_filtering/als.cpp"
+#undef main
+} // end of anonymous namespace
+
+
+namespace {
+/// The factors start from a deterministic function of the vertex id
+void init_factor(graph_type::vertex_type& vertex) {
+  vertex_data& vdata = vertex.data();
+  for (int i = 0; i < vdata.factor.size(); ++i) {
+    vdata.factor[i] =
+      0.1 + (hash_vid(vertex.id() * vdata.factor.size() + i) % 1000) * 1.0E-3;
+  }
+}
+
+/// The ratings are a deterministic function of the end points in [1, 5]
+void init_rating(graph_type::edge_type& edge) {
+  edge.data() = edge_data(1 + hash_vid(edge.source().id() +
+                                       edge.target().id() * 31) % 5);
+}
+} // end of anonymous namespace
+
+
+/*
+ * Runs the ALS vertex program of the toolkit on the graph viewed as a
+ * rating matrix, with every edge a training rating.  Like the toolkit
+ * the vertices with out edges are signaled first, and every vertex is
+ * updated at most --als_iterations times.  The result is the training
+ * RMSE.
+ */
+benchmark_result run_als(graphlab::distributed_control& dc,
+                         const graphlab::command_line_options& clopts,
+                         const std::string& engine_type) {
+  benchmark_result result;
+  result.algorithm = "als";
+  result.engine = engine_type;
+  vertex_data::NLATENT = BENCH.als_dim;
+  als_vertex_program::LAMBDA = BENCH.als_lambda;
+  als_vertex_program::MAX_UPDATES = BENCH.als_iterations;
+  graph_type graph(dc, clopts);
+  build_graph(dc, graph, result);
+  graph.transform_vertices(init_factor);
+  graph.transform_edges(init_rating);
+  graphlab::omni_engine<als_vertex_program>
+    engine(dc, graph, engine_type, engine_options(clopts, engine_type));
+  engine.map_reduce_vertices<graphlab::empty>
+    (als_vertex_program::signal_left);
+  timed_start(dc, engine, graph, result);
+  result.result_name = "training_rmse";
+  result.result = std::sqrt(graph.map_reduce_edges<double>(extract_l2_error)
+                            / graph.num_edges());
+  return result;
+} // end of run_als
@@ -0,0 +1,228 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+/**
+ * \file graph_benchmark.cpp
+ *
+ * A reproducible benchmark of the engines on deterministic synthetic
+ * graphs.  Every selected toolkit is run under every selected engine
+ * on a freshly generated graph, and machine 0 writes one JSON object
+ * per run (JSON lines) with:
+ *
+ * \li the graph: vertices, edges and replication factor,
+ * \li the load (generation) and finalize times in seconds,
+ * \li the engine runtime, the number of updates and, for the
+ *     synchronous engine, the time of every iteration,
+ * \li the edges traversed (gathered plus scattered) and the traversed
+ *     edges per second (TEPS).  The synchronous engine counts the edges
+ *     exactly; for the asynchronous engine they are estimated as
+ *     updates times the mean degree and \c teps_estimated is set,
+ * \li \c process_peak_rss: the largest peak resident set size of the
+ *     processes in bytes.  This is the high water mark since the start
+ *     of the process, so it also covers the earlier runs,
+ * \li \c rss_growth: the largest growth of the resident set size of a
+ *     process from before the graph of the run is generated to the end
+ *     of the run in bytes.  Memory which the allocator keeps after an
+ *     earlier run makes it an underestimate,
+ * \li an algorithm specific result (e.g. the number of triangles) which
+ *     must not change between runs with the same options.
+ *
+ * The algorithms are the vertex programs of the toolkits: pagerank,
+ * sssp, connected_component (cc), undirected_triangle_count
+ * (triangles), kcore and the collaborative filtering als.  Each
+ * toolkit is compiled into its own file, e.g. pagerank_benchmark.cpp.
+ * Triangle counting only runs on the synchronous engine, as in the
+ * toolkit.
+ *
+ * The graph is generated with \c --seed by either
+ * distributed_graph::load_synthetic_powerlaw (\c --generator=powerlaw,
+ * the default), in which case runs with the same options and the same
+ * number of processes generate the same graph, or by
+ * distributed_graph::load_synthetic_rmat (\c --generator=rmat with
+ * \c --scale and \c --edge_factor), which generates the same graph for
+ * any number of processes.
+ *
+ * Example:
+ * \verbatim
+ * mpiexec -n 4 ./graph_benchmark --vertices=1000000 --ncpus=8 \
+ *     --algorithms=pagerank,cc --engines=synchronous \
+ *     --results=results.json
+ * \endverbatim
+ */
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "graph_benchmark.hpp"
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/macros_def.hpp>
+
+
+benchmark_options BENCH;
+
+
+/**
+ * \brief Returns the current resident set size of this process in
+ * bytes, or 0 if it is not known.
+ */
+size_t current_rss() {
+  std::ifstream fin("/proc/self/statm");
+  size_t total_pages = 0, resident_pages = 0;
+  if (!(fin >> total_pages >> resident_pages)) return 0;
+  return resident_pages * size_t(sysconf(_SC_PAGESIZE));
+}
+
+
+/**
+ * \brief Returns the largest value of all processes.
+ */
+size_t max_over_procs(graphlab::distributed_control& dc, size_t value) {
+  std::vector<size_t> all_values(dc.numprocs());
+  all_values[dc.procid()] = value;
+  dc.all_gather(all_values);
+  return *std::max_element(all_values.begin(), all_values.end());
+}
+
+
+/**
+ * \brief Returns the peak resident set size of this process since it
+ * started in bytes.
+ */
+size_t process_peak_rss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in kilobytes on Linux
+  return size_t(usage.ru_maxrss) * 1024;
+}
+
+
+int main(int argc, char** argv) {
+  // Initialize control plain using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_WARNING);
+
+  // Parse command line options -----------------------------------------------
+  graphlab::command_line_options
+    clopts("Benchmarks the engines on synthetic graphs.");
+  std::string algorithms = "pagerank,sssp,cc,triangles,kcore,als";
+  std::string engines = "synchronous,asynchronous";
+  std::string results_file;
+  clopts.attach_option("algorithms", algorithms,
+                       "Comma separated algorithms to run: pagerank, sssp, "
+                       "cc, triangles, kcore and als");
+  clopts.attach_option("engines", engines,
+                       "Comma separated engines: synchronous, asynchronous");
+  clopts.attach_option("generator", BENCH.generator,
+                       "The graph generator: powerlaw or rmat");
+  clopts.attach_option("vertices", BENCH.vertices,
+                       "The number of vertices of the powerlaw graph");
+  clopts.attach_option("alpha", BENCH.alpha,
+                       "The power law exponent of the out-degrees");
+  clopts.attach_option("scale", BENCH.scale,
+                       "The log2 of the number of vertices of the rmat "
+                       "graph");
+  clopts.attach_option("edge_factor", BENCH.edge_factor,
+                       "The edges per vertex generated for the rmat graph");
+  clopts.attach_option("seed", BENCH.seed,
+                       "The seed of the graph generator");
+  clopts.attach_option("tol", BENCH.tolerance,
+                       "The convergence tolerance of pagerank");
+  clopts.attach_option("kcore_k", BENCH.kcore_k,
+                       "The k of the k-core benchmark");
+  clopts.attach_option("als_dim", BENCH.als_dim,
+                       "The number of latent factors of the als benchmark");
+  clopts.attach_option("als_iterations", BENCH.als_iterations,
+                       "The updates of every vertex in the als benchmark");
+  clopts.attach_option("lambda", BENCH.als_lambda,
+                       "The regularization of the als benchmark");
+  clopts.attach_option("max_iterations", BENCH.max_iterations,
+                       "If positive, the maximum iterations of the "
+                       "synchronous engine");
+  clopts.attach_option("timeout", BENCH.timeout,
+                       "If positive, the time limit of each engine run "
+                       "in seconds");
+  clopts.attach_option("results", results_file,
+                       "Append the results to this file instead of "
+                       "printing them");
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (BENCH.generator != "powerlaw" && BENCH.generator != "rmat") {
+    dc.cout() << "Unknown generator " << BENCH.generator << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream fout;
+  if (dc.procid() == 0 && !results_file.empty()) {
+    fout.open(results_file.c_str(), std::ios::app);
+    if (!fout.good()) {
+      logstream(LOG_FATAL) << "Unable to open " << results_file << std::endl;
+    }
+  }
+  std::ostream& out = results_file.empty() ? std::cout : fout;
+
+  foreach(const std::string& algorithm, graphlab::strsplit(algorithms, ",", true)) {
+    foreach(const std::string& engine_type, graphlab::strsplit(engines, ",", true)) {
+      if (engine_type != "synchronous" && engine_type != "asynchronous") {
+        logstream(LOG_FATAL) << "Unknown engine: " << engine_type << std::endl;
+      }
+      if (algorithm == "triangles" && engine_type != "synchronous") {
+        dc.cout() << "Skipping triangles on the " << engine_type
+                  << " engine" << std::endl;
+        continue;
+      }
+      const size_t rss_before = current_rss();
+      benchmark_result result;
+      if (algorithm == "pagerank") {
+        result = run_pagerank(dc, clopts, engine_type);
+      } else if (algorithm == "sssp") {
+        result = run_sssp(dc, clopts, engine_type);
+      } else if (algorithm == "cc") {
+        result = run_cc(dc, clopts, engine_type);
+      } else if (algorithm == "triangles") {
+        result = run_triangles(dc, clopts, engine_type);
+      } else if (algorithm == "kcore") {
+        result = run_kcore(dc, clopts, engine_type);
+      } else if (algorithm == "als") {
+        result = run_als(dc, clopts, engine_type);
+      } else {
+        logstream(LOG_FATAL) << "Unknown algorithm: " << algorithm 
+                             << std::endl;
+      }
+      const size_t rss_after = current_rss();
+      result.rss_growth =
+        max_over_procs(dc, rss_after > rss_before ? rss_after - rss_before : 0);
+      result.process_peak_rss = max_over_procs(dc, process_peak_rss());
+      if (dc.procid() == 0) {
+        out << result.json(dc.numprocs(), clopts.get_ncpus()) << std::endl;
+      }
+    }
+  }
+
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+} // end of main
@@ -0,0 +1,266 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_BENCHMARKS_GRAPH_BENCHMARK_HPP
+#define GRAPHLAB_BENCHMARKS_GRAPH_BENCHMARK_HPP
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <graphlab.hpp>
+#include <graphlab/engine/superstep_profile.hpp>
+
+/*
+ * The parts of graph_benchmark shared by the translation units which
+ * run the toolkits.  Each toolkit is compiled into its own
+ * translation unit (e.g. pagerank_benchmark.cpp) so that the
+ * benchmark runs the toolkit's own vertex program, and the global
+ * names of the different toolkits do not clash.
+ */
+
+
+/**
+ * \brief The benchmark options shared by all algorithms.
+ */
+struct benchmark_options {
+  std::string generator;
+  size_t vertices;
+  double alpha;
+  size_t scale;
+  size_t edge_factor;
+  size_t seed;
+  float tolerance;
+  size_t kcore_k;
+  size_t als_dim;
+  size_t als_iterations;
+  double als_lambda;
+  size_t max_iterations;
+  double timeout;
+  benchmark_options() : generator("powerlaw"), vertices(100000), alpha(2.1),
+                        scale(17), edge_factor(16), seed(1),
+                        tolerance(1.0E-2), kcore_k(6), als_dim(20),
+                        als_iterations(5), als_lambda(0.065),
+                        max_iterations(0), timeout(0) { }
+};
+
+/// The options of this run, defined in graph_benchmark.cpp
+extern benchmark_options BENCH;
+
+
+/**
+ * \brief The measurements of one algorithm run under one engine.
+ */
+struct benchmark_result {
+  std::string algorithm;
+  std::string engine;
+  size_t num_vertices;
+  size_t num_edges;
+  double replication_factor;
+  double load_time;
+  double finalize_time;
+  double runtime;
+  size_t iterations;
+  std::vector<double> iteration_times;
+  size_t updates;
+  size_t edges_traversed;
+  bool edges_estimated;
+  size_t process_peak_rss;
+  size_t rss_growth;
+  std::string result_name;
+  double result;
+  benchmark_result() : num_vertices(0), num_edges(0), replication_factor(0),
+                       load_time(0), finalize_time(0), runtime(0),
+                       iterations(0), updates(0), edges_traversed(0),
+                       edges_estimated(false), process_peak_rss(0),
+                       rss_growth(0), result(0) { }
+
+  /// Renders the result as a single line JSON object
+  std::string json(size_t nprocs, size_t ncpus) const {
+    std::stringstream strm;
+    // print the counts exactly
+    strm.precision(15);
+    strm << "{\"algorithm\": \"" << algorithm << "\""
+         << ", \"engine\": \"" << engine << "\""
+         << ", \"nprocs\": " << nprocs
+         << ", \"ncpus\": " << ncpus
+         << ", \"generator\": \"" << BENCH.generator << "\"";
+    if (BENCH.generator == "rmat") {
+      strm << ", \"scale\": " << BENCH.scale
+           << ", \"edge_factor\": " << BENCH.edge_factor;
+    } else {
+      strm << ", \"alpha\": " << BENCH.alpha;
+    }
+    strm << ", \"seed\": " << BENCH.seed
+         << ", \"vertices\": " << num_vertices
+         << ", \"edges\": " << num_edges
+         << ", \"replication_factor\": " << replication_factor
+         << ", \"load_time\": " << load_time
+         << ", \"finalize_time\": " << finalize_time
+         << ", \"runtime\": " << runtime
+         << ", \"iterations\": " << iterations
+         << ", \"iteration_times\": [";
+    for (size_t i = 0; i < iteration_times.size(); ++i) {
+      strm << (i == 0 ? "" : ", ") << iteration_times[i];
+    }
+    strm << "]"
+         << ", \"updates\": " << updates
+         << ", \"edges_traversed\": " << edges_traversed
+         << ", \"teps\": " << (runtime > 0 ? edges_traversed / runtime : 0)
+         << ", \"teps_estimated\": " << (edges_estimated ? "true" : "false")
+         << ", \"process_peak_rss\": " << process_peak_rss
+         << ", \"rss_growth\": " << rss_growth
+         << ", \"" << result_name << "\": " << result << "}";
+    return strm.str();
+  }
+}; // end of benchmark_result
+
+
+/**
+ * \brief Generates and finalizes the synthetic graph, recording the
+ * load and finalize times and the graph statistics.
+ */
+template<typename Graph>
+void build_graph(graphlab::distributed_control& dc, Graph& graph,
+                 benchmark_result& result) {
+  // seed the generator of this thread only so that the graph does not
+  // depend on the other threads which used random numbers before
+  graphlab::random::get_source().seed(BENCH.seed + dc.procid());
+  graphlab::timer ti;
+  if (BENCH.generator == "rmat") {
+    graph.load_synthetic_rmat(BENCH.scale, BENCH.edge_factor, BENCH.seed);
+  } else {
+    graph.load_synthetic_powerlaw(BENCH.vertices, false, BENCH.alpha,
+                                  100000000);
+  }
+  result.load_time = ti.current_time();
+  ti.start();
+  graph.finalize();
+  result.finalize_time = ti.current_time();
+  result.num_vertices = graph.num_vertices();
+  result.num_edges = graph.num_edges();
+  result.replication_factor =
+    double(graph.num_replicas()) / graph.num_vertices();
+} // end of build_graph
+
+
+/**
+ * \brief Returns the engine options of a benchmark run.  The
+ * synchronous engine is profiled to obtain the iteration times and
+ * traversed edges.
+ */
+inline graphlab::command_line_options
+engine_options(const graphlab::command_line_options& clopts,
+               const std::string& engine_type) {
+  graphlab::command_line_options opts = clopts;
+  if (engine_type == "synchronous") {
+    opts.get_engine_args().set_option("profile", true);
+    if (BENCH.max_iterations > 0) {
+      opts.get_engine_args().set_option("max_iterations",
+                                        BENCH.max_iterations);
+    }
+  }
+  if (BENCH.timeout > 0) {
+    opts.get_engine_args().set_option("timeout", BENCH.timeout);
+  }
+  return opts;
+} // end of engine_options
+
+
+/**
+ * \brief Runs the engine and adds its runtime, updates, iterations and
+ * traversed edges to the result.
+ */
+template<typename Engine, typename Graph>
+void timed_start(graphlab::distributed_control& dc, Engine& engine,
+                 const Graph& graph, benchmark_result& result) {
+  graphlab::timer ti;
+  engine.start();
+  result.runtime += ti.current_time();
+  const size_t updates = engine.num_updates();
+  result.updates += updates;
+  if (result.engine == "synchronous") {
+    result.iterations += engine.iteration();
+    if (dc.procid() == 0) {
+      graphlab::engine_profile_log& profile_log =
+        graphlab::get_engine_profile_log();
+      const std::vector<double> times = profile_log.superstep_times();
+      result.iteration_times.insert(result.iteration_times.end(),
+                                    times.begin(), times.end());
+      result.edges_traversed += profile_log.edges_traversed();
+    }
+  } else {
+    const double mean_degree =
+      2.0 * graph.num_edges() / std::max<size_t>(graph.num_vertices(), 1);
+    result.edges_traversed += size_t(updates * mean_degree);
+    result.edges_estimated = true;
+  }
+} // end of timed_start
+
+
+/// Deterministic pseudo random values derived from the vertex ids
+inline size_t hash_vid(size_t v) {
+  return (v * 2654435761UL) ^ (v >> 7);
+}
+
+
+/*
+ * The runs of the toolkits.  Each builds the graph, runs the toolkit
+ * under the given engine and fills in everything but the memory use.
+ */
+
+/// pagerank toolkit: dynamic PageRank
+benchmark_result run_pagerank(graphlab::distributed_control& dc,
+                              const graphlab::command_line_options& clopts,
+                              const std::string& engine_type);
+
+/// sssp toolkit: undirected unit weight shortest paths from vertex 0
+benchmark_result run_sssp(graphlab::distributed_control& dc,
+                          const graphlab::command_line_options& clopts,
+                          const std::string& engine_type);
+
+/// connected_component toolkit: label propagation
+benchmark_result run_cc(graphlab::distributed_control& dc,
+                        const graphlab::command_line_options& clopts,
+                        const std::string& engine_type);
+
+/// undirected_triangle_count toolkit: synchronous engine only
+benchmark_result run_triangles(graphlab::distributed_control& dc,
+                               const graphlab::command_line_options& clopts,
+                               const std::string& engine_type);
+
+/// kcore toolkit: the coreness of every vertex in a single run
+benchmark_result run_kcore(graphlab::distributed_control& dc,
+                           const graphlab::command_line_options& clopts,
+                           const std::string& engine_type);
+
+/// collaborative filtering als toolkit on the graph as a rating matrix
+benchmark_result run_als(graphlab::distributed_control& dc,
+                         const graphlab::command_line_options& clopts,
+                         const std::string& engine_type);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <boost/unordered_set.hpp>
+#include "graph_benchmark.hpp"
+
+// See pagerank_benchmark.cpp
+namespace {
+#define main kcore_toolkit_main
+#include "../toolkits/graph_analytics/kcore.cpp"
+#undef main
+} // end of anonymous namespace
+
+
+/*
+ * Runs the default mode of the toolkit, which computes the coreness
+ * of every vertex in a single run.  The result is the size of the
+ * K-core for K = --kcore_k.
+ */
+benchmark_result run_kcore(graphlab::distributed_control& dc,
+                           const graphlab::command_line_options& clopts,
+                           const std::string& engine_type) {
+  benchmark_result result;
+  result.algorithm = "kcore";
+  result.engine = engine_type;
+  graph_type graph(dc, clopts);
+  build_graph(dc, graph, result);
+  graph.transform_vertices(initialize_vertex_values);
+  graphlab::omni_engine<coreness> engine(dc, graph, engine_type,
+                                         engine_options(clopts, engine_type));
+  engine.signal_all();
+  timed_start(dc, engine, graph, result);
+  const std::vector<size_t> numv_at_least =
+    at_least(graph.map_reduce_vertices<core_histogram>(vertex_coreness));
+  // vertices without edges are never in a K-core
+  const size_t k = std::max<size_t>(BENCH.kcore_k, 1);
+  result.result_name = "kcore_vertices";
+  result.result = k < numv_at_least.size() ? numv_at_least[k] : 0;
+  return result;
+} // end of run_kcore
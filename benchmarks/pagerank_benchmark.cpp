@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include "graph_benchmark.hpp"
+
+// The toolkit is compiled in an anonymous namespace with its main
+// renamed, so that its globals stay local to this file.  Every header
+// it includes must already have been included above.
+namespace {
+#define main pagerank_toolkit_main
+#include "../toolkits/graph_analytics/pagerank.cpp"
+#undef main
+} // end of anonymous namespace
+
+
+namespace {
+double rank_value(const graph_type::vertex_type& vertex) {
+  return vertex.data();
+}
+} // end of anonymous namespace
+
+
+benchmark_result run_pagerank(graphlab::distributed_control& dc,
+                              const graphlab::command_line_options& clopts,
+                              const std::string& engine_type) {
+  benchmark_result result;
+  result.algorithm = "pagerank";
+  result.engine = engine_type;
+  TOLERANCE = BENCH.tolerance;
+  graph_type graph(dc, clopts);
+  build_graph(dc, graph, result);
+  graph.transform_vertices(init_vertex);
+  graphlab::omni_engine<pagerank> engine(dc, graph, engine_type,
+                                         engine_options(clopts, engine_type));
+  engine.signal_all();
+  timed_start(dc, engine, graph, result);
+  result.result_name = "rank_sum";
+  result.result = graph.map_reduce_vertices<double>(rank_value);
+  return result;
+} // end of run_pagerank
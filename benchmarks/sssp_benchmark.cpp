@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <boost/spirit/include/qi.hpp>
+#include <boost/spirit/include/phoenix_core.hpp>
+#include <boost/spirit/include/phoenix_operator.hpp>
+#include <boost/spirit/include/phoenix_stl.hpp>
+#include <boost/unordered_set.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include "graph_benchmark.hpp"
+
+// See pagerank_benchmark.cpp
+namespace {
+#define main sssp_toolkit_main
+#include "../toolkits/graph_analytics/sssp.cpp"
+#undef main
+} // end of anonymous namespace
+
+
+namespace {
+size_t is_reached(const graph_type::vertex_type& vertex) {
+  return vertex.data().dist < std::numeric_limits<distance_type>::max();
+}
+} // end of anonymous namespace
+
+
+benchmark_result run_sssp(graphlab::distributed_control& dc,
+                          const graphlab::command_line_options& clopts,
+                          const std::string& engine_type) {
+  benchmark_result result;
+  result.algorithm = "sssp";
+  result.engine = engine_type;
+  graph_type graph(dc, clopts);
+  build_graph(dc, graph, result);
+  graphlab::omni_engine<sssp> engine(dc, graph, engine_type,
+                                     engine_options(clopts, engine_type));
+  engine.signal(0, min_distance_type(0));
+  timed_start(dc, engine, graph, result);
+  result.result_name = "reached_vertices";
+  result.result = graph.map_reduce_vertices<size_t>(is_reached);
+  return result;
+} // end of run_sssp
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <boost/unordered_set.hpp>
+#include <graphlab/ui/metrics_server.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/sorted_set_intersection.hpp>
+#include "graph_benchmark.hpp"
+
+// See pagerank_benchmark.cpp
+namespace {
+#define main triangle_toolkit_main
+#include "../toolkits/graph_analytics/undirected_triangle_count.cpp"
+#undef main
+} // end of anonymous namespace
+
+
+/*
+ * The toolkit counts every triangle once, on the edge where the
+ * neighbor sets of its end points intersect, so the result is the sum
+ * of the edge counts.  Like the toolkit it assumes that every
+ * undirected edge appears once.  The scatter of the toolkit reads the
+ * neighbor sets stored by the apply of both end points, so it only
+ * runs on the synchronous engine.  The runtime includes the collection
+ * of the neighbor sets before the engine starts.
+ */
+benchmark_result run_triangles(graphlab::distributed_control& dc,
+                               const graphlab::command_line_options& clopts,
+                               const std::string& engine_type) {
+  ASSERT_EQ(engine_type, std::string("synchronous"));
+  benchmark_result result;
+  result.algorithm = "triangles";
+  result.engine = engine_type;
+  graph_type graph(dc, clopts);
+  build_graph(dc, graph, result);
+  graphlab::timer ti;
+  build_neighbor_sets(graph);
+  result.runtime += ti.current_time();
+  graphlab::synchronous_engine<triangle_count>
+    engine(dc, graph, engine_options(clopts, engine_type));
+  engine.signal_all();
+  timed_start(dc, engine, graph, result);
+  result.result_name = "triangles";
+  result.result = graph.map_reduce_edges<size_t>(get_edge_data);
+  return result;
+} // end of run_triangles
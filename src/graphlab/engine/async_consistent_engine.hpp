@@ -41,6 +41,8 @@
 #include <graphlab/engine/distributed_chandy_misra.hpp>
 
 #include <graphlab/util/tracepoint.hpp>
+#include <graphlab/util/event_trace.hpp>
+#include <graphlab/util/stl_util.hpp>
 #include <graphlab/util/memory_info.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
 #include <graphlab/rpc/async_consensus.hpp>
@@ -203,6 +205,11 @@ namespace graphlab {
    * vertex program must either clear (\ref icontext::clear_gather_cache) 
    * or update (\ref icontext::post_delta) the cache values of 
    * neighboring vertices during the scatter phase.
+   * \li \b trace: (default: empty) If set to a file prefix, every
+   * machine records the scheduler pops, the distributed lock
+   * acquisitions, the barriers and the RPC sends and receives of all
+   * its threads while the engine runs and writes them as a Chrome
+   * trace to <code>prefix.procid.json</code>.  See \ref event_trace.
    */
   template<typename VertexProgram>
   class async_consistent_engine: public iengine<VertexProgram> {
@@ -615,6 +622,8 @@ namespace graphlab {
     bool factorized_consistency;
     /// If True adds tracking for the task retire time
     bool track_task_retire_time;
+    /// If not empty, the run is traced to trace_prefix.procid.json
+    std::string trace_prefix;
 
     std::vector<double> task_start_time;
 
@@ -763,6 +772,11 @@ namespace graphlab {
           if (rmi.procid() == 0) 
             logstream(LOG_EMPH) << "Engine Option: track_task_time = " 
               << track_task_retire_time << std::endl;
+        } else if (opt == "trace") {
+          opts.get_engine_args().get_option("trace", trace_prefix);
+          if (rmi.procid() == 0) 
+            logstream(LOG_EMPH) << "Engine Option: trace = " 
+              << trace_prefix << std::endl;
         } else {
           logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
         }
@@ -881,6 +895,10 @@ namespace graphlab {
       }
     }
 
+    void internal_vertex_data_unchanged(const vertex_type& vertex) {
+      // not supported: the vertex data is always synchronized
+    }
+
 
 
     /**
@@ -1126,7 +1144,7 @@ namespace graphlab {
       vstate[sched_lvid].lock();
       if (vstate[sched_lvid].state == NONE) {
         vstate[sched_lvid].state = LOCKING;
-        cmlocks->make_philosopher_hungry_per_replica(sched_lvid);
+        request_locks(sched_lvid);
         //add_internal_task(sched_lvid);
       }
       else if (vstate[sched_lvid].state == MIRROR_SCATTERING) {
@@ -1136,6 +1154,18 @@ namespace graphlab {
     }
 
 
+    /**
+     * \internal
+     * Requests the distributed locks of a replica. On the master the
+     * time until lock_ready() is traced.
+     */
+    void request_locks(lvid_type lvid) {
+      if (graph.l_is_master(lvid)) {
+        TRACE_ASYNC_BEGIN("lock_acquisition", lvid);
+      }
+      cmlocks->make_philosopher_hungry_per_replica(lvid);
+    }
+
     /**
      * \internal
      * When all distributed locks are acquired, this function is called
@@ -1144,6 +1174,7 @@ namespace graphlab {
      * of the task and switch the vertex to a gathering state
      */
     void lock_ready(lvid_type lvid) {
+      TRACE_ASYNC_END("lock_acquisition", lvid);
 #ifdef ASYNC_ENGINE_FACTORIZED_AVOID_SCHEDULER_GATHER
       if (!factorized_consistency) {
 #endif
@@ -1546,7 +1577,7 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
         ASSERT_MSG(false, "Empty Internal Task");
       case LOCKING: {
           BEGIN_TRACEPOINT(disteng_chandy_misra);
-          cmlocks->make_philosopher_hungry_per_replica(lvid);
+          request_locks(lvid);
           END_TRACEPOINT(disteng_chandy_misra);
           break;
       }
@@ -1616,7 +1647,7 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
           vstate[lvid].state = LOCKING;
 //          ASSERT_FALSE(vstate[lvid].hasnext);          
           cmlocks->philosopher_stops_eating_per_replica(lvid);
-          cmlocks->make_philosopher_hungry_per_replica(lvid);
+          request_locks(lvid);
           break;
         }
       case MIRROR_SCATTERING_AND_NEXT_GATHERING: {
@@ -1669,9 +1700,16 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
       if (pending_updates.value > max_pending) {
         return;
       }
+      // only successful pops are traced so that idle polling does not
+      // flood the trace
+      const unsigned long long pop_start = 
+        event_trace::is_enabled() ? rdtsc() : 0;
       sched_status::status_enum stat =
         scheduler_ptr->get_next(threadid, sched_lvid, msg);
       has_sched_msg = stat != sched_status::EMPTY;
+      if (pop_start != 0 && has_sched_msg) {
+        event_trace::record_span("scheduler_pop", pop_start);
+      }
     } // end of get a task
 
 
@@ -1890,7 +1928,7 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
         END_TRACEPOINT(disteng_eval_sched_task);
         if (acquirelock) {
           BEGIN_TRACEPOINT(disteng_chandy_misra);
-          cmlocks->make_philosopher_hungry_per_replica(sched_lvid);
+          request_locks(sched_lvid);
           END_TRACEPOINT(disteng_chandy_misra);
           master_broadcast_locking(sched_lvid);
         }
@@ -1906,6 +1944,7 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
      * Per thread main loop
      */
     void thread_start(size_t threadid) {
+      event_trace::set_thread_name("engine worker");
       rmi.dc().stop_handler_threads(threadid, ncpus);
       bool has_internal_task = false;
       bool has_sched_msg = false;
@@ -2085,6 +2124,10 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
       launch_timer.start();
 
       termination_reason = execution_status::RUNNING;
+      if (!trace_prefix.empty()) {
+        event_trace::clear();
+        event_trace::enable();
+      }
 
       // if (perform_init_vertex_program) {
       //   logstream(LOG_INFO) << "Initialize Vertex Programs: " 
@@ -2103,6 +2146,18 @@ EVAL_INTERNAL_TASK_RE_EVAL_STATE:
       }
       thrgroup.join();
       aggregator.stop();
+      if (!trace_prefix.empty()) {
+        event_trace::disable();
+        const std::string fname = 
+          trace_prefix + "." + tostr(rmi.procid()) + ".json";
+        if (event_trace::write_chrome_trace(fname, rmi.procid())) {
+          logstream(LOG_INFO) << "Event trace written to " << fname 
+                              << std::endl;
+        } else {
+          logstream(LOG_ERROR) << "Unable to write the event trace to " 
+                               << fname << std::endl;
+        }
+      }
       // if termination reason was not changed, then it must be depletion
       if (termination_reason == execution_status::RUNNING) {
         termination_reason = execution_status::TASK_DEPLETION;
@@ -0,0 +1,472 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include <graphlab/engine/superstep_profile.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/ui/metrics_server.hpp>
+#include <graphlab/macros_def.hpp>
+
+namespace graphlab {
+
+  void phase_profile::clear(size_t nthreads) {
+    wall_time = 0;
+    machine_barrier_time = 0;
+    thread_busy_time.assign(nthreads, 0);
+    thread_barrier_time.assign(nthreads, 0);
+  }
+
+  double phase_profile::busy_time() const {
+    double ret = 0;
+    for (size_t i = 0; i < thread_busy_time.size(); ++i) {
+      ret += thread_busy_time[i];
+    }
+    return ret;
+  }
+
+  double phase_profile::idle_time() const {
+    return thread_busy_time.size() * wall_time - busy_time();
+  }
+
+  double phase_profile::barrier_wait_time() const {
+    double ret = machine_barrier_time;
+    for (size_t i = 0; i < thread_barrier_time.size(); ++i) {
+      ret += thread_barrier_time[i];
+    }
+    return ret;
+  }
+
+  void phase_profile::accumulate(const phase_profile& other) {
+    wall_time += other.wall_time;
+    machine_barrier_time += other.machine_barrier_time;
+    if (thread_busy_time.size() < other.thread_busy_time.size()) {
+      thread_busy_time.resize(other.thread_busy_time.size(), 0);
+      thread_barrier_time.resize(other.thread_busy_time.size(), 0);
+    }
+    for (size_t i = 0; i < other.thread_busy_time.size(); ++i) {
+      thread_busy_time[i] += other.thread_busy_time[i];
+      thread_barrier_time[i] += other.thread_barrier_time[i];
+    }
+  }
+
+  void phase_profile::save(oarchive& oarc) const {
+    oarc << wall_time << thread_busy_time << thread_barrier_time
+         << machine_barrier_time;
+  }
+
+  void phase_profile::load(iarchive& iarc) {
+    iarc >> wall_time >> thread_busy_time >> thread_barrier_time
+         >> machine_barrier_time;
+  }
+
+
+  void superstep_profile::accumulate(const superstep_profile& other) {
+    iteration = other.iteration;
+    wall_time += other.wall_time;
+    active_vertices += other.active_vertices;
+    gather_edges += other.gather_edges;
+    scatter_edges += other.scatter_edges;
+    pulled_scatter_edges += other.pulled_scatter_edges;
+    if (phases.size() < other.phases.size()) {
+      phases.resize(other.phases.size());
+    }
+    for (size_t i = 0; i < other.phases.size(); ++i) {
+      phases[i].accumulate(other.phases[i]);
+    }
+    if (bytes_sent.size() < other.bytes_sent.size()) {
+      bytes_sent.resize(other.bytes_sent.size());
+    }
+    for (size_t i = 0; i < other.bytes_sent.size(); ++i) {
+      if (bytes_sent[i].size() < other.bytes_sent[i].size()) {
+        bytes_sent[i].resize(other.bytes_sent[i].size(), 0);
+      }
+      for (size_t j = 0; j < other.bytes_sent[i].size(); ++j) {
+        bytes_sent[i][j] += other.bytes_sent[i][j];
+      }
+    }
+  }
+
+  void superstep_profile::save(oarchive& oarc) const {
+    oarc << iteration << wall_time << active_vertices
+         << gather_edges << scatter_edges << pulled_scatter_edges
+         << phases << bytes_sent;
+  }
+
+  void superstep_profile::load(iarchive& iarc) {
+    iarc >> iteration >> wall_time >> active_vertices
+         >> gather_edges >> scatter_edges >> pulled_scatter_edges
+         >> phases >> bytes_sent;
+  }
+
+
+
+  static size_t get_size_var(std::map<std::string, std::string>& vars,
+                             const std::string& name, size_t default_value) {
+    if (vars.count(name) == 0) return default_value;
+    return strtoul(vars[name].c_str(), NULL, 10);
+  }
+
+  static std::pair<std::string, std::string>
+  engine_profile_json(std::map<std::string, std::string>& vars) {
+    const size_t first = get_size_var(vars, "first", 0);
+    const size_t last = get_size_var(vars, "last", size_t(-1));
+    return std::make_pair(std::string("text/plain"),
+                          get_engine_profile_log().json(first, last));
+  }
+
+  static std::pair<std::string, std::string>
+  engine_profile_prometheus(std::map<std::string, std::string>& vars) {
+    return std::make_pair(std::string("text/plain; version=0.0.4"),
+                          get_engine_profile_log().prometheus());
+  }
+
+
+  void engine_profile_log::begin_run(const std::string& engine_name,
+                                     const std::vector<std::string>& phase_names,
+                                     const std::vector<std::string>& exchange_names,
+                                     size_t nprocs) {
+    static bool pages_registered = false;
+    lock.lock();
+    if (!pages_registered) {
+      add_metric_server_callback("engine_profile.json", engine_profile_json);
+      add_metric_server_callback("metrics", engine_profile_prometheus);
+      pages_registered = true;
+    }
+    this->engine_name = engine_name;
+    this->phase_names = phase_names;
+    this->exchange_names = exchange_names;
+    this->nprocs = nprocs;
+    num_supersteps = 0;
+    supersteps.clear();
+    totals.clear();
+    totals.resize(nprocs);
+    lock.unlock();
+  }
+
+
+  void engine_profile_log::
+  add_superstep(const std::vector<superstep_profile>& by_machine) {
+    ASSERT_EQ(by_machine.size(), nprocs);
+    lock.lock();
+    for (size_t p = 0; p < nprocs; ++p) totals[p].accumulate(by_machine[p]);
+    supersteps.push_back(by_machine);
+    if (supersteps.size() > MAX_SUPERSTEPS) supersteps.pop_front();
+    ++num_supersteps;
+    lock.unlock();
+  }
+
+
+  size_t engine_profile_log::
+  bytes_received(const std::vector<superstep_profile>& by_machine,
+                 size_t exchange, size_t p) const {
+    size_t ret = 0;
+    for (size_t src = 0; src < by_machine.size(); ++src) {
+      if (exchange < by_machine[src].bytes_sent.size() &&
+          p < by_machine[src].bytes_sent[exchange].size()) {
+        ret += by_machine[src].bytes_sent[exchange][p];
+      }
+    }
+    return ret;
+  }
+
+
+  std::vector<double> engine_profile_log::superstep_times() const {
+    std::vector<double> ret;
+    lock.lock();
+    for (size_t i = 0; i < supersteps.size(); ++i) {
+      double wall_time = 0;
+      foreach(const superstep_profile& prof, supersteps[i]) {
+        wall_time = std::max(wall_time, prof.wall_time);
+      }
+      ret.push_back(wall_time);
+    }
+    lock.unlock();
+    return ret;
+  }
+
+
+  size_t engine_profile_log::edges_traversed() const {
+    size_t ret = 0;
+    lock.lock();
+    foreach(const superstep_profile& total, totals) {
+      ret += total.gather_edges + total.scatter_edges;
+    }
+    lock.unlock();
+    return ret;
+  }
+
+
+  std::string engine_profile_log::summary() const {
+    std::stringstream strm;
+    lock.lock();
+    std::vector<double> wall(phase_names.size(), 0);
+    std::vector<double> busy(phase_names.size(), 0);
+    foreach(const superstep_profile& total, totals) {
+      for (size_t i = 0; i < total.phases.size(); ++i) {
+        wall[i] = std::max(wall[i], total.phases[i].wall_time);
+        busy[i] += total.phases[i].busy_time();
+      }
+    }
+    strm << num_supersteps << " supersteps:";
+    for (size_t i = 0; i < phase_names.size(); ++i) {
+      if (wall[i] == 0) continue;
+      strm << " " << phase_names[i] << " " << wall[i] << "s (busy "
+           << busy[i] << "s)";
+    }
+    lock.unlock();
+    return strm.str();
+  }
+
+
+  std::string engine_profile_log::json(size_t first_iteration,
+                                       size_t max_supersteps) const {
+    std::stringstream strm;
+    char *pname = getenv("_");
+    std::string progname;
+    if (pname != NULL) progname = pname;
+
+    lock.lock();
+    // select the super-steps to output
+    size_t begin = 0;
+    while (begin < supersteps.size() &&
+           supersteps[begin][0].iteration < first_iteration) ++begin;
+    if (supersteps.size() - begin > max_supersteps) {
+      begin = supersteps.size() - max_supersteps;
+    }
+    strm << "{\n"
+         << "  \"program_name\": \"" << progname << "\",\n"
+         << "  \"engine\": \"" << engine_name << "\",\n"
+         << "  \"num_machines\": " << nprocs << ",\n"
+         << "  \"num_supersteps\": " << num_supersteps << ",\n"
+         << "  \"supersteps\": [\n";
+    for (size_t s = begin; s < supersteps.size(); ++s) {
+      const std::vector<superstep_profile>& by_machine = supersteps[s];
+      double wall_time = 0;
+      size_t active_vertices = 0, gather_edges = 0, scatter_edges = 0;
+      size_t pulled_scatter_edges = 0;
+      foreach(const superstep_profile& prof, by_machine) {
+        wall_time = std::max(wall_time, prof.wall_time);
+        active_vertices += prof.active_vertices;
+        gather_edges += prof.gather_edges;
+        scatter_edges += prof.scatter_edges;
+        pulled_scatter_edges += prof.pulled_scatter_edges;
+      }
+      strm << "    {\n"
+           << "      \"iteration\": " << by_machine[0].iteration << ",\n"
+           << "      \"wall_time\": " << wall_time << ",\n"
+           << "      \"active_vertices\": " << active_vertices << ",\n"
+           << "      \"gather_edges\": " << gather_edges << ",\n"
+           << "      \"scatter_edges\": " << scatter_edges << ",\n"
+           << "      \"pulled_scatter_edges\": " << pulled_scatter_edges 
+           << ",\n"
+           << "      \"phases\": [";
+      bool first_phase = true;
+      for (size_t i = 0; i < phase_names.size(); ++i) {
+        double phase_wall = 0, busy = 0, idle = 0, barrier = 0;
+        foreach(const superstep_profile& prof, by_machine) {
+          const phase_profile& phase = prof.phases[i];
+          phase_wall = std::max(phase_wall, phase.wall_time);
+          busy += phase.busy_time();
+          idle += phase.idle_time();
+          barrier += phase.barrier_wait_time();
+        }
+        // skip the phases which did not run
+        if (phase_wall == 0) continue;
+        strm << (first_phase ? "\n" : ",\n")
+             << "        {\n"
+             << "          \"name\": \"" << phase_names[i] << "\",\n"
+             << "          \"wall_time\": " << phase_wall << ",\n"
+             << "          \"busy_time\": " << busy << ",\n"
+             << "          \"idle_time\": " << idle << ",\n"
+             << "          \"barrier_wait_time\": " << barrier << ",\n"
+             << "          \"machines\": [";
+        first_phase = false;
+        for (size_t p = 0; p < by_machine.size(); ++p) {
+          const phase_profile& phase = by_machine[p].phases[i];
+          strm << (p == 0 ? "\n" : ",\n")
+               << "            {\"wall_time\": " << phase.wall_time
+               << ", \"machine_barrier_time\": "
+               << phase.machine_barrier_time
+               << ", \"thread_busy_time\": [";
+          for (size_t t = 0; t < phase.thread_busy_time.size(); ++t) {
+            strm << (t == 0 ? "" : ", ") << phase.thread_busy_time[t];
+          }
+          strm << "], \"thread_idle_time\": [";
+          for (size_t t = 0; t < phase.thread_busy_time.size(); ++t) {
+            strm << (t == 0 ? "" : ", ")
+                 << phase.wall_time - phase.thread_busy_time[t];
+          }
+          strm << "], \"thread_barrier_time\": [";
+          for (size_t t = 0; t < phase.thread_barrier_time.size(); ++t) {
+            strm << (t == 0 ? "" : ", ") << phase.thread_barrier_time[t];
+          }
+          strm << "]}";
+        }
+        strm << "\n          ]\n"
+             << "        }";
+      }
+      strm << "\n      ],\n"
+           << "      \"exchanges\": [";
+      for (size_t e = 0; e < exchange_names.size(); ++e) {
+        size_t total_sent = 0;
+        std::stringstream machines;
+        for (size_t p = 0; p < by_machine.size(); ++p) {
+          size_t sent = 0;
+          if (e < by_machine[p].bytes_sent.size()) {
+            foreach(size_t bytes, by_machine[p].bytes_sent[e]) sent += bytes;
+          }
+          total_sent += sent;
+          machines << (p == 0 ? "" : ", ")
+                   << "{\"bytes_sent\": " << sent
+                   << ", \"bytes_received\": "
+                   << bytes_received(by_machine, e, p) << "}";
+        }
+        strm << (e == 0 ? "\n" : ",\n")
+             << "        {\"name\": \"" << exchange_names[e] << "\""
+             << ", \"bytes_sent\": " << total_sent
+             << ", \"machines\": [" << machines.str() << "]}";
+      }
+      strm << "\n      ]\n"
+           << "    }" << (s + 1 < supersteps.size() ? ",\n" : "\n");
+    }
+    strm << "  ]\n"
+         << "}\n";
+    lock.unlock();
+    return strm.str();
+  }
+
+
+  std::string engine_profile_log::prometheus() const {
+    std::stringstream strm;
+    lock.lock();
+    strm << "# HELP graphlab_engine_supersteps_total "
+         << "Super-steps completed by the engine.\n"
+         << "# TYPE graphlab_engine_supersteps_total counter\n"
+         << "graphlab_engine_supersteps_total " << num_supersteps << "\n";
+    if (!supersteps.empty()) {
+      const std::vector<superstep_profile>& last = supersteps.back();
+      double wall_time = 0;
+      size_t active_vertices = 0;
+      foreach(const superstep_profile& prof, last) {
+        wall_time = std::max(wall_time, prof.wall_time);
+        active_vertices += prof.active_vertices;
+      }
+      strm << "# HELP graphlab_engine_last_superstep_seconds "
+           << "Wall time of the last super-step.\n"
+           << "# TYPE graphlab_engine_last_superstep_seconds gauge\n"
+           << "graphlab_engine_last_superstep_seconds " << wall_time << "\n"
+           << "# HELP graphlab_engine_last_superstep_active_vertices "
+           << "Vertices which ran apply in the last super-step.\n"
+           << "# TYPE graphlab_engine_last_superstep_active_vertices gauge\n"
+           << "graphlab_engine_last_superstep_active_vertices "
+           << active_vertices << "\n";
+    }
+
+    // the per machine counters of the run
+    const char* machine_names[] = {
+      "graphlab_engine_active_vertices_total",
+      "Vertices which ran apply.",
+      "graphlab_engine_gather_edges_total", "Edges gathered.",
+      "graphlab_engine_scatter_edges_total", "Edges scattered."
+    };
+    for (size_t m = 0; m < 3; ++m) {
+      strm << "# HELP " << machine_names[2 * m] << " "
+           << machine_names[2 * m + 1] << "\n"
+           << "# TYPE " << machine_names[2 * m] << " counter\n";
+      for (size_t p = 0; p < totals.size(); ++p) {
+        const size_t value = m == 0 ? totals[p].active_vertices :
+          m == 1 ? totals[p].gather_edges : totals[p].scatter_edges;
+        strm << machine_names[2 * m] << "{machine=\"" << p << "\"} "
+             << value << "\n";
+      }
+    }
+
+    // the per phase times
+    const char* phase_metrics[] = {
+      "graphlab_engine_phase_seconds_total",
+      "Wall time spent in each engine phase.",
+      "graphlab_engine_phase_busy_seconds_total",
+      "Thread time spent working in each engine phase.",
+      "graphlab_engine_phase_idle_seconds_total",
+      "Thread time not spent working in each engine phase.",
+      "graphlab_engine_phase_barrier_seconds_total",
+      "Thread and machine time spent waiting at barriers."
+    };
+    for (size_t m = 0; m < 4; ++m) {
+      strm << "# HELP " << phase_metrics[2 * m] << " "
+           << phase_metrics[2 * m + 1] << "\n"
+           << "# TYPE " << phase_metrics[2 * m] << " counter\n";
+      for (size_t i = 0; i < phase_names.size(); ++i) {
+        for (size_t p = 0; p < totals.size(); ++p) {
+          if (i >= totals[p].phases.size()) continue;
+          const phase_profile& phase = totals[p].phases[i];
+          const double value = m == 0 ? phase.wall_time :
+            m == 1 ? phase.busy_time() :
+            m == 2 ? phase.idle_time() : phase.barrier_wait_time();
+          strm << phase_metrics[2 * m] << "{phase=\"" << phase_names[i]
+               << "\",machine=\"" << p << "\"} " << value << "\n";
+        }
+      }
+    }
+
+    // the exchange volumes
+    strm << "# HELP graphlab_engine_exchange_sent_bytes_total "
+         << "Bytes sent over each exchange.\n"
+         << "# TYPE graphlab_engine_exchange_sent_bytes_total counter\n";
+    for (size_t e = 0; e < exchange_names.size(); ++e) {
+      for (size_t p = 0; p < totals.size(); ++p) {
+        size_t sent = 0;
+        if (e < totals[p].bytes_sent.size()) {
+          foreach(size_t bytes, totals[p].bytes_sent[e]) sent += bytes;
+        }
+        strm << "graphlab_engine_exchange_sent_bytes_total{exchange=\""
+             << exchange_names[e] << "\",machine=\"" << p << "\"} "
+             << sent << "\n";
+      }
+    }
+    strm << "# HELP graphlab_engine_exchange_received_bytes_total "
+         << "Bytes received over each exchange.\n"
+         << "# TYPE graphlab_engine_exchange_received_bytes_total counter\n";
+    for (size_t e = 0; e < exchange_names.size(); ++e) {
+      for (size_t p = 0; p < totals.size(); ++p) {
+        strm << "graphlab_engine_exchange_received_bytes_total{exchange=\""
+             << exchange_names[e] << "\",machine=\"" << p << "\"} "
+             << bytes_received(totals, e, p) << "\n";
+      }
+    }
+    lock.unlock();
+    return strm.str();
+  }
+
+
+  engine_profile_log& get_engine_profile_log() {
+    static engine_profile_log profile_log;
+    return profile_log;
+  }
+
+} // end of namespace graphlab
+
+#include <graphlab/macros_undef.hpp>
@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_SUPERSTEP_PROFILE_HPP
+#define GRAPHLAB_SUPERSTEP_PROFILE_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup engine
+   * \brief The time one machine spent in one phase of a super-step.
+   *
+   * The busy time of a thread is the time it spent in the phase less
+   * the time it waited at the thread barriers of the phase.  The wall
+   * time includes the machine barrier which ends the phase.
+   */
+  struct phase_profile {
+    /// The wall clock time of the phase in seconds
+    double wall_time;
+    /// The time each engine thread worked in the phase
+    std::vector<double> thread_busy_time;
+    /// The time each engine thread waited at thread barriers
+    std::vector<double> thread_barrier_time;
+    /// The time spent in the machine barrier which ends the phase
+    double machine_barrier_time;
+
+    phase_profile() : wall_time(0), machine_barrier_time(0) { }
+
+    /// Clears the times of a phase run by nthreads threads
+    void clear(size_t nthreads);
+
+    /// The busy time summed over the threads
+    double busy_time() const;
+
+    /// The thread time not spent working: nthreads * wall time - busy time
+    double idle_time() const;
+
+    /// The barrier time summed over the threads and the machine barrier
+    double barrier_wait_time() const;
+
+    /// Adds the times of other to this profile
+    void accumulate(const phase_profile& other);
+
+    void save(oarchive& oarc) const;
+    void load(iarchive& iarc);
+  }; // end of phase_profile
+
+
+  /**
+   * \ingroup engine
+   * \brief The profile of one super-step on one machine.
+   */
+  struct superstep_profile {
+    /// The iteration of the super-step
+    size_t iteration;
+    /// The wall clock time of the super-step in seconds
+    double wall_time;
+    /// The number of local masters which ran apply
+    size_t active_vertices;
+    /// The number of local edges gathered
+    size_t gather_edges;
+    /// The number of local edges scattered
+    size_t scatter_edges;
+    /// The number of those edges scattered by a pulled scatter
+    size_t pulled_scatter_edges;
+    /// The time spent in each phase, indexed like the phase names
+    std::vector<phase_profile> phases;
+    /**
+     * The bytes sent over each exchange, indexed like the exchange
+     * names, to each machine.  Values sent to the local machine are
+     * not serialized and do not count.
+     */
+    std::vector<std::vector<size_t> > bytes_sent;
+
+    superstep_profile() : iteration(0), wall_time(0), active_vertices(0),
+                          gather_edges(0), scatter_edges(0),
+                          pulled_scatter_edges(0) { }
+
+    /// Adds the counters and times of other to this profile
+    void accumulate(const superstep_profile& other);
+
+    void save(oarchive& oarc) const;
+    void load(iarchive& iarc);
+  }; // end of superstep_profile
+
+
+  /**
+   * \ingroup engine
+   * \brief Collects the super-step profiles of all machines on machine
+   * 0 and serves them through the metrics server.
+   *
+   * An engine with profiling enabled calls begin_run() when it starts
+   * and add_superstep() on machine 0 with the profiles of all machines
+   * after every super-step.  The following pages are registered with
+   * \ref add_metric_server_callback:
+   *
+   * \li <b>engine_profile.json</b>: the recent super-steps with the
+   * per machine, per phase and per thread times, the active vertices
+   * and edges and the bytes sent and received over each exchange.
+   * The optional \c last variable limits the output to the given
+   * number of most recent super-steps and \c first to the super-steps
+   * from the given iteration on.
+   * \li <b>metrics</b>: the totals of the run in the Prometheus text
+   * exposition format.
+   */
+  class engine_profile_log {
+  public:
+    /// The number of most recent super-steps which are kept
+    static const size_t MAX_SUPERSTEPS = 1000;
+
+    engine_profile_log() : nprocs(0), num_supersteps(0) { }
+
+    /**
+     * Clears the profile and starts a new run.  The phase and exchange
+     * names define the indices of superstep_profile::phases and
+     * superstep_profile::bytes_sent.
+     */
+    void begin_run(const std::string& engine_name,
+                   const std::vector<std::string>& phase_names,
+                   const std::vector<std::string>& exchange_names,
+                   size_t nprocs);
+
+    /// Records a super-step given the profiles of all machines
+    void add_superstep(const std::vector<superstep_profile>& by_machine);
+
+    /**
+     * Returns the wall time of each recorded super-step, the maximum
+     * over the machines
+     */
+    std::vector<double> superstep_times() const;
+
+    /// Returns the edges gathered and scattered by all machines in this run
+    size_t edges_traversed() const;
+
+    /// Returns a one line summary of the time spent in each phase
+    std::string summary() const;
+
+    /// Renders the engine_profile.json page
+    std::string json(size_t first_iteration, size_t max_supersteps) const;
+
+    /// Renders the Prometheus metrics page
+    std::string prometheus() const;
+
+  private:
+    mutable mutex lock;
+    std::string engine_name;
+    std::vector<std::string> phase_names;
+    std::vector<std::string> exchange_names;
+    size_t nprocs;
+    /// The number of super-steps recorded in this run
+    size_t num_supersteps;
+    /// The most recent super-steps, each with the profile of every machine
+    std::deque<std::vector<superstep_profile> > supersteps;
+    /// The totals of this run for each machine
+    std::vector<superstep_profile> totals;
+
+    /// The bytes received by machine p in a super-step
+    size_t bytes_received(const std::vector<superstep_profile>& by_machine,
+                          size_t exchange, size_t p) const;
+  }; // end of engine_profile_log
+
+
+  /// Returns the engine profile log of this process
+  engine_profile_log& get_engine_profile_log();
+
+} // end of namespace graphlab
+
+#endif
@@ -26,7 +26,9 @@
 #define GRAPHLAB_SYNCHRONOUS_ENGINE_HPP
 
 #include <deque>
+#include <algorithm>
 #include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <graphlab/engine/iengine.hpp>
 
@@ -35,19 +37,30 @@
 #include <graphlab/vertex_program/context.hpp>
 
 #include <graphlab/engine/execution_status.hpp>
+#include <graphlab/engine/superstep_profile.hpp>
 #include <graphlab/options/graphlab_options.hpp>
 
+#include <graphlab/graph/communication_plan.hpp>
+
 
 
 
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic_add_vector.hpp>
+#include <graphlab/parallel/atomic_ops.hpp>
+#include <graphlab/parallel/cache_line_pad.hpp>
 #include <graphlab/util/tracepoint.hpp>
+#include <graphlab/util/event_trace.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/util/adaptive_bitset.hpp>
+#include <graphlab/util/first_touch.hpp>
 #include <graphlab/util/memory_info.hpp>
+#include <graphlab/util/char_counting_sink.hpp>
 
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/rpc/plan_exchange.hpp>
 
 
 
@@ -188,6 +201,95 @@ namespace graphlab {
    * or update (\ref icontext::post_delta) the cache values of 
    * neighboring vertices during the scatter phase.
    *
+   * \li <b>lockfree_messages</b>: (default: false) If set to true,
+   * messages are combined with an atomic compare-and-swap instead of
+   * taking the vertex lock on every signal.  This requires the message
+   * type to be trivially copyable and 1, 2, 4 or 8 bytes wide. Any
+   * commutative and associative <code>operator+=</code> may be used
+   * (a sum as well as a minimum over distances): the first message
+   * sent to a vertex is stored as is and the later ones are combined
+   * into it.  The option is ignored with a warning if the message type
+   * is not supported.
+   *
+   * \li <b>frontier_alpha</b>: (default: 0) The active sets keep a
+   * compact list of the active vertices while fewer than 1/32 of the
+   * local vertices are active, in which case the apply, gather and
+   * scatter phases iterate the sorted list instead of scanning the
+   * active bitset over all local vertices.  If set to a positive value
+   * the engine also counts the local edges of the vertices activated
+   * for each minor-step and switches direction like the BFS of Beamer
+   * et al.  While the active edges times frontier_alpha is smaller
+   * than the number of local edges, the active vertices are iterated
+   * from the list and the scatter is pushed: each active vertex runs
+   * scatter over its own edges.  Otherwise the bitset is scanned and
+   * the scatter is pulled: every local vertex walks its own edges and
+   * runs the scatter of the active vertex at the other end, so the
+   * signals to a vertex are sent in sequence by a single thread.  The
+   * scatter calls are the same in both directions.  14 is a good
+   * starting value for BFS-like programs such as SSSP and connected
+   * components.
+   *
+   * \li <b>numa_aware</b>: (default: false) If set to true, engine
+   * thread i owns the i-th contiguous range of local vertices.  The
+   * per-vertex engine arrays of trivial types (such as the messages,
+   * gather accumulators and gather cache of the toolkits) are
+   * first-touched by the owning thread so that their pages are placed
+   * on its NUMA node, and each thread processes the active vertices of
+   * its own range before helping with the ranges of other threads.
+   * Arrays of other types, including the vertex programs, are left
+   * where they were allocated.  Best combined with pin_threads.
+   *
+   * \li <b>pin_threads</b>: (default: false) If set to true, engine
+   * thread i is bound to the i-th processor the process may run on
+   * while it runs a phase and its previous affinity is restored
+   * afterwards.  Intended for one process per machine with ncpus no
+   * larger than the number of processors.
+   *
+   * \li <b>skip_unchanged_vdata</b>: (default: false) If set to true,
+   * the vertex data of a vertex is not sent to its mirrors after an
+   * apply which did not change it.  The data is compared bytewise if
+   * the vertex data type is a POD.  In addition the vertex program
+   * may call \ref icontext::vertex_data_unchanged from apply, for
+   * instance when the change is below a tolerance.  The number of
+   * skipped mirror updates is logged each iteration, together with
+   * the bytes saved if the vertex data type is a POD or profile is
+   * set.  Measuring the serialized size of other vertex data costs a
+   * serialization per skipped apply, so it is only done when
+   * profiling.
+   *
+   * \li <b>pipelined_apply</b>: (default: false) If set to true, the
+   * gather and apply phases run as a single phase.  Each active master
+   * counts the partial gathers of its mirrors which are still in
+   * flight, and as soon as a machine has completed its local gathers
+   * it applies the masters whose partial gathers have all arrived
+   * while the remaining partial gathers are still being exchanged.
+   * The vertex data and vertex program of each applied master are
+   * streamed to its mirrors as records (position, value) which are
+   * sent whenever a buffer fills, so the synchronization overlaps the
+   * remaining gathers and applies.  Mirrors only take the records
+   * once the local gathers of their machine are done.  Gathers still
+   * observe
+   * the vertex data of the previous super-step and all applies have
+   * completed and been synchronized before the scatter phase, so the
+   * results are the same as without pipelining.  Mirrors which have
+   * no partial gather send a short notice to their master instead.
+   *
+   * \li <b>profile</b>: (default: false) If set to true, the engine
+   * records for every super-step and phase the wall time, the busy
+   * and barrier time of each thread, the active vertices and edges
+   * and the bytes sent and received over each exchange.  The profiles
+   * of all machines are collected on machine 0 after each super-step
+   * and served by the metrics server (see \ref launch_metric_server)
+   * as JSON on <code>engine_profile.json</code> and in the Prometheus
+   * text format on <code>metrics</code>.  See \ref engine_profile_log.
+   *
+   * \li <b>trace</b>: (default: empty) If set to a file prefix, every
+   * machine records the phases, barriers, exchange flushes and RPC
+   * sends and receives of all its threads while the engine runs and
+   * writes them as a Chrome trace to <code>prefix.procid.json</code>,
+   * to be opened in chrome://tracing or the Perfetto UI.  See
+   * \ref event_trace.
+   *
    * \li \b snapshot_interval If set to a positive value, a snapshot
    * is taken every this number of iterations. If set to 0, a snapshot
    * is taken before the first iteration. If set to a negative value,
@@ -393,6 +495,20 @@ namespace graphlab {
      */
     bool force_abort;
 
+    /**
+     * \brief Combine messages with an atomic compare-and-swap rather
+     * than under the vertex lock.  Only set if the message type
+     * supports it (see \ref lockfree_messages_supported).
+     */
+    bool lockfree_messages;
+
+    /**
+     * \brief True if the message type is trivially copyable and fits in
+     * a single compare-and-swap.
+     */
+    typedef atomic_combine_supported<message_type> 
+      lockfree_messages_supported;
+
     /**
      * \brief The vertex locks protect access to vertex specific
      * data-structures including 
@@ -428,6 +544,13 @@ namespace graphlab {
      * \brief Bit indicating whether a message is present for each vertex.
      */
     dense_bitset has_message;
+
+    /**
+     * \brief Bit indicating whether the first message of a vertex has
+     * been stored.  Only used with lockfree_messages, in which case the
+     * has_message bit only claims the right to store the first message.
+     */
+    dense_bitset message_ready;
  
 
     /**
@@ -438,6 +561,9 @@ namespace graphlab {
      * The gather accumulator can be accessed by multiple threads at
      * once and therefore must be guarded by a vertex locks in 
      * \ref graphlab::synchronous_engine::vlocks
+     *
+     * Outside of the pipelined phase the accumulator of a mirror holds
+     * its partial gather until it is sent to the master.
      */
     std::vector<gather_type>  gather_accum;
     
@@ -472,8 +598,12 @@ namespace graphlab {
     /**
      * \brief A bit (for master vertices) indicating if that vertex is active
      * (received a message on this iteration).
+     *
+     * The adaptive bitset also lists the active vertices while there are
+     * few of them so that clearing and iterating the set is proportional
+     * to the number of active vertices.
      */
-    dense_bitset active_superstep;
+    adaptive_bitset active_superstep;
 
     /**
      * \brief  The number of local vertices (masters) that are active on this
@@ -485,7 +615,179 @@ namespace graphlab {
      * \brief A bit indicating (for all vertices) whether to
      * participate in the current minor-step (gather or scatter).
      */
-    dense_bitset active_minorstep;      
+    adaptive_bitset active_minorstep;      
+
+    /**
+     * \brief The Beamer alpha used to decide between iterating the
+     * list of minor-step active vertices and scanning the bitset.  If
+     * zero the choice is made by active_minorstep based on the number
+     * of active vertices alone.
+     */
+    double frontier_alpha;
+
+    /**
+     * \brief The number of local edges adjacent to the vertices in
+     * active_minorstep. Only tracked if frontier_alpha is positive.
+     */
+    atomic<size_t> minorstep_frontier_edges;
+
+    /**
+     * \brief True if the current minor-step may iterate the list of
+     * active vertices rather than scanning the bitset.
+     */
+    bool sparse_minorstep;
+
+    /**
+     * \brief True if the scatter of the current super-step is pulled
+     * over the edges of every local vertex rather than pushed from
+     * each active vertex.
+     */
+    bool pull_scatter;
+
+    /**
+     * \brief The active vertices which scatter on their in (resp. out)
+     * edges in a pulled scatter.
+     */
+    dense_bitset scatter_in_edges, scatter_out_edges;
+
+    /**
+     * \brief If true threads prefer the vertices in their own range of
+     * thread_lvid_begin and first-touch the engine data of that range.
+     */
+    bool numa_aware;
+
+    /**
+     * \brief If true engine thread i is bound to the i-th processor
+     * while it runs a phase.
+     */
+    bool pin_threads;
+
+    /**
+     * \brief The first lvid of the range owned by each thread followed
+     * by the number of local vertices.  The range boundaries are word
+     * aligned.  Only allocated if numa_aware is set.
+     */
+    std::vector<size_t> thread_lvid_begin;
+
+    /**
+     * \brief The per-thread counterpart of shared_lvid_counter used to
+     * claim blocks from each range of thread_lvid_begin.
+     */
+    std::vector<cache_line_pad<atomic<size_t> > > thread_lvid_counter;
+
+    /**
+     * \brief If true the vertex data is not synchronized with the
+     * mirrors after an apply which did not change it.
+     */
+    bool skip_unchanged_vdata;
+
+    /**
+     * \brief The bit for each vertex whose apply declared the vertex
+     * data unchanged.  Only allocated if skip_unchanged_vdata is set.
+     */
+    dense_bitset vdata_unchanged;
+
+    /**
+     * \brief The number of mirror updates skipped and the bytes they
+     * would have sent in the current iteration.  The bytes are only
+     * counted if vdata_bytes_known().
+     */
+    atomic<size_t> skipped_vdata_syncs;
+    atomic<size_t> skipped_vdata_bytes;
+
+    /**
+     * \brief The number of mirror updates skipped and the bytes saved
+     * over all iterations on all machines.
+     */
+    size_t total_skipped_vdata_syncs;
+    size_t total_skipped_vdata_bytes;
+
+    /**
+     * \brief If true the gather and apply phases are run as the single
+     * phase execute_gathers_and_applys.
+     */
+    bool pipelined_apply;
+
+    /**
+     * \brief The number of partial gathers each active master is still
+     * waiting for from its mirrors in the pipelined phase, or
+     * uint32_t(-1) once its apply has been claimed by a thread.  Only
+     * allocated if pipelined_apply is set.
+     */
+    std::vector<atomic<uint32_t> > pending_gathers;
+
+    /**
+     * \brief Set by thread 0 in the pipelined phase once all partial
+     * gathers have been delivered to this machine.
+     */
+    volatile bool gathers_flushed;
+
+    /**
+     * \brief If true each super-step is profiled and recorded in the
+     * engine profile log.
+     */
+    bool profile;
+
+    /**
+     * \brief If not empty, the events of the run are traced and
+     * written to trace_prefix.procid.json.
+     */
+    std::string trace_prefix;
+
+    /**
+     * \brief The phases of a super-step, indexing the phases of the
+     * super-step profile.
+     */
+    enum phase_enum { EXCHANGE_MESSAGES_PHASE, RECEIVE_MESSAGES_PHASE, 
+                      GATHER_PHASE, APPLY_PHASE, GATHER_APPLY_PHASE, 
+                      SCATTER_PHASE, NUM_PHASES };
+
+    /**
+     * \brief Returns the name of a phase in profiles and traces.
+     */
+    static const char* phase_name(size_t phase) {
+      static const char* names[NUM_PHASES + 1] = 
+        { "exchange_messages", "receive_messages", "gather", "apply",
+          "gather_apply", "scatter", "initialize" };
+      return names[phase < NUM_PHASES ? phase : size_t(NUM_PHASES)];
+    }
+
+    /**
+     * \brief The exchanges of the engine, indexing the bytes sent of
+     * the super-step profile.
+     */
+    enum exchange_enum { MESSAGE_EXCHANGE, VPROG_EXCHANGE, 
+                         GATHER_EXCHANGE, EMPTY_GATHER_EXCHANGE, 
+                         VDATA_EXCHANGE, NUM_EXCHANGES };
+
+    /**
+     * \brief The phase run by run_synchronous, or NUM_PHASES if the
+     * function is not profiled.
+     */
+    size_t current_phase;
+
+    /**
+     * \brief The profile of the current super-step on this machine.
+     */
+    superstep_profile current_profile;
+
+    /**
+     * \brief The bytes sent over each exchange to each machine at the
+     * start of the current super-step.
+     */
+    std::vector<std::vector<size_t> > superstep_start_bytes;
+
+    /**
+     * \brief The number of edges gathered and scattered by each thread
+     * in the current super-step.  Only counted if profile is set.
+     */
+    std::vector<cache_line_pad<size_t> > thread_gather_edges;
+    std::vector<cache_line_pad<size_t> > thread_scatter_edges;
+
+    /**
+     * \brief Times the current super-step.
+     */
+    timer superstep_timer;
 
     /**
      * \brief A counter measuring the number of applys that have been completed
@@ -501,14 +803,21 @@ namespace graphlab {
 
 
     /**
-     * \brief The pair type used to synchronize vertex programs across machines.
+     * \brief The plans addressing the vertices shared with each other
+     * machine by position.
+     */
+    communication_plan comm_plan;
+
+    /**
+     * \brief The position of a vertex in the communication plan
+     * shared by the sender and the receiver of a record.
      */
-    typedef std::pair<vertex_id_type, vertex_program_type> vid_prog_pair_type;
+    typedef communication_plan::position_type plan_position_type;
 
     /**
      * \brief The type of the exchange used to synchronize vertex programs
      */
-    typedef buffered_exchange<vid_prog_pair_type> vprog_exchange_type;
+    typedef plan_exchange<vertex_program_type> vprog_exchange_type;
    
     /**
      * \brief The distributed exchange used to synchronize changes to
@@ -516,15 +825,10 @@ namespace graphlab {
      */
     vprog_exchange_type vprog_exchange;
 
-    /**
-     * \brief The pair type used to synchronize vertex across across machines.
-     */
-    typedef std::pair<vertex_id_type, vertex_data_type> vid_vdata_pair_type;
-
     /**
      * \brief The type of the exchange used to synchronize vertex data
      */
-    typedef buffered_exchange<vid_vdata_pair_type> vdata_exchange_type;
+    typedef plan_exchange<vertex_data_type> vdata_exchange_type;
 
     /**
      * \brief The distributed exchange used to synchronize changes to
@@ -532,16 +836,11 @@ namespace graphlab {
      */
     vdata_exchange_type vdata_exchange;
 
-    /**
-     * \brief The pair type used to synchronize the results of the gather phase
-     */
-    typedef std::pair<vertex_id_type, gather_type> vid_gather_pair_type;
-
     /**
      * \brief The type of the exchange used to synchronize gather
      * accumulators
      */
-    typedef buffered_exchange<vid_gather_pair_type> gather_exchange_type;
+    typedef plan_exchange<gather_type> gather_exchange_type;
    
     /**
      * \brief The distributed exchange used to synchronize gather
@@ -550,20 +849,147 @@ namespace graphlab {
     gather_exchange_type gather_exchange;
 
     /**
-     * \brief The pair type used to synchronize messages
+     * \brief The pair type used to stream the results of the gather
+     * phase in the pipelined phase
      */
-    typedef std::pair<vertex_id_type, message_type> vid_message_pair_type;
+    typedef std::pair<plan_position_type, gather_type> pos_gather_pair_type;
+
+    /**
+     * \brief The type of the exchange used to stream gather
+     * accumulators in the pipelined phase
+     */
+    typedef buffered_exchange<pos_gather_pair_type> 
+    pipelined_gather_exchange_type;
    
+    /**
+     * \brief The distributed exchange used to stream gather
+     * accumulators to the masters as soon as they are computed, so
+     * that the masters can be applied before the gather phase ends.
+     */
+    pipelined_gather_exchange_type pipelined_gather_exchange;
+
+    /**
+     * \brief The type of the exchange used by mirrors without a
+     * partial gather to notify their master in the pipelined phase
+     */
+    typedef buffered_exchange<plan_position_type> empty_gather_exchange_type;
+
+    /**
+     * \brief The distributed exchange used to notify masters of
+     * mirrors without a partial gather.
+     */
+    empty_gather_exchange_type empty_gather_exchange;
+
+    /**
+     * \brief The pair type used to stream the vertex programs of the
+     * applied masters in the pipelined phase
+     */
+    typedef std::pair<plan_position_type, vertex_program_type> 
+    pos_vprog_pair_type;
+
+    /**
+     * \brief The type of the exchange used to stream vertex programs
+     * in the pipelined phase
+     */
+    typedef buffered_exchange<pos_vprog_pair_type> 
+    pipelined_vprog_exchange_type;
+
+    /**
+     * \brief The distributed exchange used to stream the vertex
+     * programs of the masters to their mirrors as soon as they are
+     * applied in the pipelined phase.
+     */
+    pipelined_vprog_exchange_type pipelined_vprog_exchange;
+
+    /**
+     * \brief The pair type used to stream the vertex data of the
+     * applied masters in the pipelined phase
+     */
+    typedef std::pair<plan_position_type, vertex_data_type> 
+    pos_vdata_pair_type;
+
+    /**
+     * \brief The type of the exchange used to stream vertex data in
+     * the pipelined phase
+     */
+    typedef buffered_exchange<pos_vdata_pair_type> 
+    pipelined_vdata_exchange_type;
+
+    /**
+     * \brief The distributed exchange used to stream the vertex data
+     * of the masters to their mirrors as soon as they are applied in
+     * the pipelined phase.
+     */
+    pipelined_vdata_exchange_type pipelined_vdata_exchange;
+
     /**
      * \brief The type of the exchange used to synchronize messages
      */
-    typedef buffered_exchange<vid_message_pair_type> message_exchange_type;
+    typedef plan_exchange<message_type> message_exchange_type;
 
     /**
      * \brief The distributed exchange used to synchronize messages
      */
     message_exchange_type message_exchange;
 
+    /**
+     * \brief Reads the vertex program at a position of the plan
+     * exchanges when they are sent.
+     */
+    struct vprog_getter {
+      synchronous_engine& engine;
+      vprog_getter(synchronous_engine& engine) : engine(engine) { }
+      const vertex_program_type& operator()(procid_t proc, 
+                                            plan_position_type pos) {
+        return engine.vertex_programs[engine.comm_plan.lvid(proc, pos)];
+      }
+    };
+
+    /**
+     * \brief Reads the vertex data at a position of the plan exchanges
+     * when they are sent.
+     */
+    struct vdata_getter {
+      synchronous_engine& engine;
+      vdata_getter(synchronous_engine& engine) : engine(engine) { }
+      const vertex_data_type& operator()(procid_t proc, 
+                                         plan_position_type pos) {
+        const lvid_type lvid = engine.comm_plan.lvid(proc, pos);
+        return engine.graph.l_vertex(lvid).data();
+      }
+    };
+
+    /**
+     * \brief Reads and clears the partial gather of a mirror at a
+     * position of the plan exchanges when they are sent.
+     */
+    struct gather_getter {
+      synchronous_engine& engine;
+      gather_getter(synchronous_engine& engine) : engine(engine) { }
+      gather_type operator()(procid_t proc, plan_position_type pos) {
+        const lvid_type lvid = engine.comm_plan.lvid(proc, pos);
+        gather_type accum = engine.gather_accum[lvid];
+        engine.gather_accum[lvid] = gather_type();
+        return accum;
+      }
+    };
+
+    /**
+     * \brief Reads and clears the message of a mirror at a position of
+     * the plan exchanges when they are sent.
+     */
+    struct message_getter {
+      synchronous_engine& engine;
+      message_getter(synchronous_engine& engine) : engine(engine) { }
+      message_type operator()(procid_t proc, plan_position_type pos) {
+        const lvid_type lvid = engine.comm_plan.lvid(proc, pos);
+        message_type message = engine.messages[lvid];
+        // clear the message to save memory
+        engine.messages[lvid] = message_type();
+        return message;
+      }
+    };
+
 
     /**
      * \brief The distributed aggregator used to manage background
@@ -696,6 +1122,25 @@ namespace graphlab {
     void internal_signal(const vertex_type& vertex,
                          const message_type& message = message_type()); 
 
+    /**
+     * \brief Add a message to the pending message of a local vertex.
+     *
+     * Takes the vertex lock, or uses an atomic compare-and-swap if
+     * lock free message combining is enabled.
+     *
+     * @param [in] lvid the local vertex receiving the message
+     * @param [in] message the message to combine
+     */
+    void combine_message(lvid_type lvid, const message_type& message);
+
+    /// \internal Locked message combine, valid for any message type.
+    void combine_message(lvid_type lvid, const message_type& message,
+                         boost::false_type);
+
+    /// \internal Compare-and-swap message combine for small POD messages.
+    void combine_message(lvid_type lvid, const message_type& message,
+                         boost::true_type);
+
     /**
      * \brief Called by the context to signal an arbitrary vertex.
      * This must be done by finding the owner of that vertex. 
@@ -735,13 +1180,114 @@ namespace graphlab {
      */
     void internal_clear_gather_cache(const vertex_type& vertex);
 
+    /**
+     * \brief Record that the apply on the vertex did not change its
+     * data so that the data is not sent to its mirrors.
+     *
+     * This function is called by the \ref graphlab::context.
+     *
+     * @param [in] vertex the vertex being applied
+     */
+    void internal_vertex_data_unchanged(const vertex_type& vertex);
+
+
+    // Frontier Management ====================================================
+
+    /**
+     * \brief Mark a vertex as active in the current minor-step,
+     * counting its edges if frontier_alpha is set.
+     *
+     * @param [in] lvid the vertex to activate
+     */
+    void activate_minorstep(lvid_type lvid);
+
+    /**
+     * \brief Clear the minor-step active set and its edge count.
+     */
+    void clear_minorstep();
+
+    /**
+     * \brief Choose between the frontier list and the bitset for the
+     * next minor-step based on the number of active edges.  Must be
+     * called between minor-steps by a single thread.
+     */
+    void choose_minorstep_direction();
+
+    /**
+     * \brief Choose the direction of the minor-step as above and
+     * whether the scatter is pushed or pulled.
+     */
+    void choose_scatter_direction();
+
+    /**
+     * \brief Claim the next block of vertices that are active in the
+     * current minor-step.
+     *
+     * Threads call this repeatedly to partition the active vertices
+     * among themselves. Depending on the direction chosen by 
+     * choose_minorstep_direction() the block is taken either from the
+     * list of active vertices or from the next word of the bitset.
+     *
+     * @param [in] thread_id the calling thread
+     * @param [out] lvids the vertices in the claimed block
+     * @return false once all active vertices have been claimed
+     */
+    bool next_minorstep_block(size_t thread_id, 
+                              std::vector<lvid_type>& lvids);
+
+    /**
+     * \brief Claim the next block of vertices in the active set.
+     *
+     * If the list of active vertices may be used (allow_sparse) and is
+     * available it is split among all threads.  Otherwise the bitset is
+     * scanned a word at a time: with numa_aware set, a thread first
+     * claims words from its own range of thread_lvid_begin and then
+     * from the ranges of the other threads.
+     *
+     * @param [in] active_set the set to iterate
+     * @param [in] allow_sparse whether the list of active vertices may
+     *             be used
+     * @param [in] thread_id the calling thread
+     * @param [out] lvids the vertices in the claimed block
+     * @return false once all active vertices have been claimed
+     */
+    bool next_active_block(adaptive_bitset& active_set, bool allow_sparse,
+                           size_t thread_id, std::vector<lvid_type>& lvids);
+
+    /**
+     * \brief Claim the first lvid of the next word of local vertices,
+     * preferring the range of the calling thread if numa_aware is set.
+     *
+     * @param [in] thread_id the calling thread
+     * @param [out] lvid_block_start the first vertex of the word
+     * @return false once all local vertices have been claimed
+     */
+    bool next_lvid_word(size_t thread_id, lvid_type& lvid_block_start);
+
+    /**
+     * \brief Initialize the per-vertex engine data in the range of
+     * this thread so that its pages are placed on the NUMA node of
+     * the thread.
+     */
+    void first_touch(size_t thread_id);
+
 
     // Program Steps ==========================================================
    
 
-    void thread_launch_wrapped_event_counter(boost::function<void(void)> fn) {
+    void thread_launch_wrapped_event_counter(boost::function<void(void)> fn,
+                                             size_t thread_id,
+                                             size_t phase) {
+      // pool threads pick up tasks in any order so bind the thread to
+      // the processor of this task until the task completes
+      boost::scoped_ptr<scoped_cpu_affinity> pinned;
+      if (pin_threads) pinned.reset(new scoped_cpu_affinity(thread_id));
       INCREMENT_EVENT(EVENT_ACTIVE_CPUS, 1);
+      event_trace::set_thread_name("engine worker");
+      TRACE_SCOPE(phase_name(phase));
+      timer ti;
       fn();
+      if (profile) profile_thread_time(thread_id, ti.current_time());
       DECREMENT_EVENT(EVENT_ACTIVE_CPUS, 1);
     }
 
@@ -762,13 +1308,21 @@ namespace graphlab {
      *
      * @tparam the type of the member function.  
      * @param [in] member_fun the function to call.
+     * @param [in] phase the super-step phase to record the time in if
+     * profiling is enabled.
      */
     template<typename MemberFunction>       
-    void run_synchronous(MemberFunction member_fun) {
-      shared_lvid_counter = 0;
+    void run_synchronous(MemberFunction member_fun, 
+                         size_t phase = NUM_PHASES) {
+      timer ti;
+      current_phase = profile ? phase : size_t(NUM_PHASES);
+      reset_lvid_counters();
       if (threads.size() <= 1) {
         INCREMENT_EVENT(EVENT_ACTIVE_CPUS, 1);
+        TRACE_SCOPE(phase_name(phase));
+        timer thread_ti;
         ( (this)->*(member_fun))(0);
+        if (profile) profile_thread_time(0, thread_ti.current_time());
         DECREMENT_EVENT(EVENT_ACTIVE_CPUS, 1);
       }
       else {
@@ -778,14 +1332,76 @@ namespace graphlab {
           threads.launch(boost::bind(
                 &synchronous_engine::thread_launch_wrapped_event_counter, 
                 this,
-                invoke));
+                invoke, i, phase));
         }
       }
       // Wait for all threads to finish
       threads.join();
+      const double barrier_start = ti.current_time();
       rmi.barrier();
+      if (current_phase != NUM_PHASES) {
+        phase_profile& phase_prof = current_profile.phases[current_phase];
+        phase_prof.wall_time += ti.current_time();
+        phase_prof.machine_barrier_time += ti.current_time() - barrier_start;
+      }
+      current_phase = NUM_PHASES;
     } // end of run_synchronous
 
+    /**
+     * \brief Waits for the other threads of the phase at the thread
+     * barrier, recording the time waited if profiling is enabled.
+     */
+    void wait_for_threads(size_t thread_id) {
+      TRACE_SCOPE("thread_barrier");
+      if (current_phase == NUM_PHASES) {
+        thread_barrier.wait();
+        return;
+      }
+      timer ti;
+      thread_barrier.wait();
+      const double waited = ti.current_time();
+      phase_profile& phase_prof = current_profile.phases[current_phase];
+      phase_prof.thread_barrier_time[thread_id] += waited;
+      phase_prof.thread_busy_time[thread_id] -= waited;
+    } // end of wait_for_threads
+
+    /**
+     * \brief Records the time a thread spent in the current phase.  The
+     * barrier time recorded by wait_for_threads was already deducted.
+     */
+    void profile_thread_time(size_t thread_id, double seconds) {
+      if (current_phase == NUM_PHASES) return;
+      current_profile.phases[current_phase].thread_busy_time[thread_id] += 
+        seconds;
+    } // end of profile_thread_time
+
+    /**
+     * \brief Reads the bytes sent over each exchange to each machine.
+     */
+    void read_exchange_bytes(std::vector<std::vector<size_t> >& bytes) const;
+
+    /**
+     * \brief Starts profiling a super-step.
+     */
+    void begin_superstep_profile();
+
+    /**
+     * \brief Completes the profile of the super-step and records the
+     * profiles of all machines in the engine profile log of machine 0.
+     */
+    void end_superstep_profile();
+
+    /**
+     * \brief Resets the counters used by the threads to claim blocks
+     * of vertices.
+     */
+    void reset_lvid_counters() {
+      shared_lvid_counter = 0;
+      for (size_t i = 0; i < thread_lvid_counter.size(); ++i) {
+        thread_lvid_counter[i].value = 0;
+      }
+    } // end of reset_lvid_counters
+
     // /** 
     //  * \brief Initialize all vertex programs by invoking 
     //  * \ref graphlab::ivertex_program::init on all vertices.
@@ -836,6 +1452,51 @@ namespace graphlab {
      */
     void execute_applys(size_t thread_id);
 
+    /** 
+     * \brief Execute the gather and apply phases as one pipelined
+     * phase (see the pipelined_apply option).
+     *
+     * The local gathers complete first.  The masters whose partial
+     * gathers have all arrived are then applied while thread 0 flushes
+     * the gather exchanges, and the remaining masters are applied by
+     * the thread receiving their last partial gather.  The vertex data
+     * and vertex programs of the applied masters are streamed to their
+     * mirrors meanwhile, and the records of the other machines are
+     * received into the local mirrors between applys.
+     *
+     * @param thread_id the thread to run this as which determines
+     * which vertices to process.
+     */
+    void execute_gathers_and_applys(size_t thread_id);
+
+    /**
+     * \brief Compute the local gather of a minor-step active vertex and
+     * send it to the master.
+     */
+    void gather_vertex(context_type& context, lvid_type lvid, 
+                       size_t thread_id);
+
+    /**
+     * \brief Run the apply of an active master and synchronize the
+     * result with its mirrors.
+     *
+     * @param [in] old_vdata scratch space for the vertex data before
+     * the apply
+     */
+    void apply_vertex(context_type& context, lvid_type lvid, 
+                      size_t thread_id, vertex_data_type& old_vdata);
+
+    /**
+     * \brief Receive the available partial gathers in the pipelined
+     * phase and apply the masters whose gathers are complete.
+     *
+     * @return true if a master was applied
+     */
+    bool apply_completed_gathers(context_type& context, size_t thread_id,
+                                 std::vector<lvid_type>& completed,
+                                 vertex_data_type& old_vdata,
+                                 const bool try_to_recv);
+
     /** 
      * \brief Execute the \ref graphlab::ivertex_program::scatter function on all 
      * vertices that received messages for the edges specified by the 
@@ -846,16 +1507,34 @@ namespace graphlab {
      */
     void execute_scatters(size_t thread_id);
 
+    /**
+     * \brief Executes the scatters of the minor-step active vertices
+     * by walking the edges of all local vertices. Called by 
+     * execute_scatters if pull_scatter is set.
+     *
+     * @param thread_id the thread to run this as which determines
+     * which vertices to process.
+     */
+    void pull_scatters(size_t thread_id);
+
     // Data Synchronization ===================================================
     /**
      * \brief Send the vertex program for the local vertex id to all
-     * of its mirrors. 
+     * of its mirrors.  The vertex program is read when the vertex
+     * program exchange is sent at the end of the phase.
      *
      * @param [in] lvid the vertex to sync.  This muster must be the
      * master of that vertex.
      */
     void sync_vertex_program(lvid_type lvid, size_t thread_id);
 
+    /**
+     * \brief Send the vertex program of an applied master to all of
+     * its mirrors at once.  Used instead of sync_vertex_program by the
+     * applys of the pipelined phase.
+     */
+    void stream_vertex_program(lvid_type lvid, size_t thread_id);
+
     /**
      * \brief Receive all incoming vertex programs and update the
      * local mirrors.
@@ -868,25 +1547,57 @@ namespace graphlab {
 
     /**
      * \brief Send the vertex data for the local vertex id to all of
-     * its mirrors.
+     * its mirrors.  The vertex data is read when the vertex data
+     * exchange is sent at the end of the phase.
      *
      * @param [in] lvid the vertex to sync.  This machine must be the master
      * of that vertex.
      */
     void sync_vertex_data(lvid_type lvid, size_t thread_id);
-    
+
     /**
-     * \brief Receive all incoming vertex data and update the local
-     * mirrors.
-     *
-     * This function returns when there are no more incoming vertex
-     * data and should be called after a flush of the vertex data
+     * \brief Send the vertex data of an applied master to all of its
+     * mirrors at once.  Used instead of sync_vertex_data by the applys
+     * of the pipelined phase.
+     */
+    void stream_vertex_data(lvid_type lvid, size_t thread_id);
+
+    /**
+     * \brief Count the mirror updates of a vertex whose data was not
+     * synchronized because it did not change.
+     */
+    void count_skipped_vertex_data(lvid_type lvid);
+
+    /**
+     * \brief True if count_skipped_vertex_data counts the bytes of the
+     * skipped mirror updates: always for POD vertex data, and only
+     * when profiling otherwise.
+     */
+    bool vdata_bytes_known() const {
+      return gl_is_pod<vertex_data_type>::value || profile;
+    }
+    
+    /**
+     * \brief Receive all incoming vertex data and update the local
+     * mirrors.
+     *
+     * This function returns when there are no more incoming vertex
+     * data and should be called after a flush of the vertex data
      * exchange.
      */
     void recv_vertex_data(const bool try_to_recv = false);
 
+    /**
+     * \brief Send the vertex programs and the vertex data of the
+     * applys, and receive those of the other machines.  Called by
+     * every thread once all applys are done.
+     */
+    void finish_applys(size_t thread_id);
+
     /**
      * \brief Send the gather value for the vertex id to its master.
+     * Outside of the pipelined phase the value is kept in the gather
+     * accumulator of the mirror until the end of the phase.
      *
      * @param [in] lvid the vertex to send the gather value to
      * @param [in] accum the locally computed gather value. 
@@ -900,13 +1611,48 @@ namespace graphlab {
      *
      * This function returns when there is nothing left in the
      * buffered exchange and should be called after the buffered
-     * exchange has been flushed
+     * exchange has been flushed.  In the pipelined phase masters whose
+     * gathers are complete are appended to completed.
+     */
+    void recv_gathers(const bool try_to_recv = false,
+                      std::vector<lvid_type>* completed = NULL);
+
+    /**
+     * \brief Adds a gather value to the accumulator of a master.
      */
-    void recv_gathers(const bool try_to_recv = false);
+    void combine_gather(lvid_type lvid, const gather_type& accum);
+
+    /**
+     * \brief Notify the master of the vertex that this mirror has no
+     * partial gather.  Only used in the pipelined phase.
+     */
+    void sync_empty_gather(lvid_type lvid, size_t thread_id);
+
+    /**
+     * \brief Receive the notices of mirrors without a partial gather.
+     * Masters whose gathers are complete are appended to completed.
+     */
+    void recv_empty_gathers(const bool try_to_recv = false,
+                            std::vector<lvid_type>* completed = NULL);
+
+    /**
+     * \brief Count an arrived partial gather of an active master in the
+     * pipelined phase.
+     *
+     * @return true if this was the last partial gather of the master
+     */
+    bool gather_arrived(lvid_type lvid);
+
+    /**
+     * \brief Claim the apply of a master whose partial gathers have all
+     * arrived. Returns true to exactly one caller.
+     */
+    bool claim_apply(lvid_type lvid);
 
     /**
      * \brief Send the accumulated message for the local vertex to its
-     * master.
+     * master.  The message is read and cleared when the message
+     * exchange is sent at the end of the phase.
      *
      * @param [in] lvid the vertex to send 
      */
@@ -976,11 +1722,17 @@ namespace graphlab {
     threads(opts.get_ncpus()), 
     thread_barrier(opts.get_ncpus()),
     max_iterations(-1), snapshot_interval(-1), iteration_counter(0),
-    timeout(0), sched_allv(false),
-    vprog_exchange(dc, opts.get_ncpus(), 65536), 
-    vdata_exchange(dc, opts.get_ncpus(), 65536), 
-    gather_exchange(dc, opts.get_ncpus(), 65536), 
-    message_exchange(dc, opts.get_ncpus(), 65536),
+    timeout(0), sched_allv(false), lockfree_messages(false),
+    frontier_alpha(0), sparse_minorstep(false), pull_scatter(false),
+    numa_aware(false), pin_threads(false),
+    skip_unchanged_vdata(false), pipelined_apply(false), 
+    gathers_flushed(false), profile(false), current_phase(NUM_PHASES),
+    vprog_exchange(dc), vdata_exchange(dc), gather_exchange(dc), 
+    pipelined_gather_exchange(dc, opts.get_ncpus(), 65536), 
+    empty_gather_exchange(dc, opts.get_ncpus(), 65536), 
+    pipelined_vprog_exchange(dc, opts.get_ncpus(), 65536), 
+    pipelined_vdata_exchange(dc, opts.get_ncpus(), 65536), 
+    message_exchange(dc),
     aggregator(dc, graph, new context_type(*this, graph)) {
     // Process any additional options
     std::vector<std::string> keys = opts.get_engine_args().get_option_keys();
@@ -1012,6 +1764,56 @@ namespace graphlab {
         if (rmi.procid() == 0)
           logstream(LOG_EMPH) << "Engine Option: snapshot_path = " 
             << snapshot_path << std::endl;
+      } else if (opt == "lockfree_messages") {
+        opts.get_engine_args().get_option("lockfree_messages", lockfree_messages);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: lockfree_messages = " 
+            << lockfree_messages << std::endl;
+        if (lockfree_messages && !lockfree_messages_supported::value) {
+          if (rmi.procid() == 0)
+            logstream(LOG_WARNING) 
+              << "lockfree_messages requires a trivially copyable message "
+              << "type of 1, 2, 4 or 8 bytes. Falling back to locked "
+              << "message combining." 
+              << std::endl;
+          lockfree_messages = false;
+        }
+      } else if (opt == "frontier_alpha") {
+        opts.get_engine_args().get_option("frontier_alpha", frontier_alpha);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: frontier_alpha = " 
+            << frontier_alpha << std::endl;
+      } else if (opt == "numa_aware") {
+        opts.get_engine_args().get_option("numa_aware", numa_aware);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: numa_aware = " 
+            << numa_aware << std::endl;
+      } else if (opt == "pin_threads") {
+        opts.get_engine_args().get_option("pin_threads", pin_threads);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: pin_threads = " 
+            << pin_threads << std::endl;
+      } else if (opt == "skip_unchanged_vdata") {
+        opts.get_engine_args().get_option("skip_unchanged_vdata", 
+                                          skip_unchanged_vdata);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: skip_unchanged_vdata = " 
+            << skip_unchanged_vdata << std::endl;
+      } else if (opt == "pipelined_apply") {
+        opts.get_engine_args().get_option("pipelined_apply", pipelined_apply);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: pipelined_apply = " 
+            << pipelined_apply << std::endl;
+      } else if (opt == "profile") {
+        opts.get_engine_args().get_option("profile", profile);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: profile = " 
+            << profile << std::endl;
+      } else if (opt == "trace") {
+        opts.get_engine_args().get_option("trace", trace_prefix);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: trace = " 
+            << trace_prefix << std::endl;
       } else if (opt == "sched_allv") {
         opts.get_engine_args().get_option("sched_allv", sched_allv);
         if (rmi.procid() == 0)
@@ -1034,6 +1836,16 @@ namespace graphlab {
 
     // Finalize the graph
     graph.finalize();
+    // Address the vertices shared with other machines by position
+    comm_plan.build(graph);
+    std::vector<size_t> plan_sizes(rmi.numprocs());
+    for (procid_t p = 0; p < rmi.numprocs(); ++p) {
+      plan_sizes[p] = comm_plan.plan_size(p);
+    }
+    vprog_exchange.resize(plan_sizes);
+    vdata_exchange.resize(plan_sizes);
+    gather_exchange.resize(plan_sizes);
+    message_exchange.resize(plan_sizes);
     memory_info::log_usage("Before Engine Initialization");
     // Allocate vertex locks and vertex programs
     vlocks.resize(graph.num_local_vertices());
@@ -1044,6 +1856,8 @@ namespace graphlab {
     messages.resize(graph.num_local_vertices(), message_type());
     has_message.resize(graph.num_local_vertices()); 
     has_message.clear();
+    message_ready.resize(graph.num_local_vertices());
+    message_ready.clear();
     // Allocate gather accumulators and accumulator bitset
     gather_accum.resize(graph.num_local_vertices(), gather_type());
     has_gather_accum.resize(graph.num_local_vertices());
@@ -1059,6 +1873,43 @@ namespace graphlab {
     active_superstep.clear();
     active_minorstep.resize(graph.num_local_vertices());
     active_minorstep.clear();
+    minorstep_frontier_edges = 0;
+    if (frontier_alpha > 0) {
+      scatter_in_edges.resize(graph.num_local_vertices());
+      scatter_in_edges.clear();
+      scatter_out_edges.resize(graph.num_local_vertices());
+      scatter_out_edges.clear();
+    }
+    if (skip_unchanged_vdata) {
+      vdata_unchanged.resize(graph.num_local_vertices());
+      vdata_unchanged.clear();
+    }
+    if (pipelined_apply) {
+      pending_gathers.resize(graph.num_local_vertices());
+    }
+    if (profile) {
+      thread_gather_edges.resize(threads.size());
+      thread_scatter_edges.resize(threads.size());
+    }
+    if (numa_aware) {
+      // split the local vertices into word aligned ranges, one per thread
+      const size_t nthreads = threads.size();
+      const size_t WORD_SIZE = 8 * sizeof(size_t);
+      thread_lvid_begin.resize(nthreads + 1);
+      for (size_t i = 0; i < nthreads; ++i) {
+        thread_lvid_begin[i] = 
+          (graph.num_local_vertices() * i / nthreads) / WORD_SIZE * WORD_SIZE;
+      }
+      thread_lvid_begin[nthreads] = graph.num_local_vertices();
+      thread_lvid_counter.resize(nthreads);
+      // hand the pages back to the OS and let each thread fault in
+      // the pages of its own range. The vertex programs have virtual
+      // functions and stay where they are.
+      release_vector_pages(messages);
+      release_vector_pages(gather_accum);
+      release_vector_pages(gather_cache);
+      run_synchronous( &synchronous_engine::first_touch );
+    }
     // Print memory usage after initialization
     memory_info::log_usage("After Engine Initialization");
     rmi.barrier();
@@ -1115,19 +1966,42 @@ namespace graphlab {
   void synchronous_engine<VertexProgram>::
   signal_vset(const vertex_set& vset,
              const message_type& message, const std::string& order) {
-    for(lvid_type lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
-      if(graph.l_is_master(lvid) && vset.l_contains(lvid)) {
+    if (vset.lazy) {
+      if (vset.is_complete_set) signal_all(message, order);
+      return;
+    }
+    // only visit the vertices in the set
+    foreach(uint32_t lvid, vset.localvset) {
+      if(graph.l_is_master(lvid)) {
         internal_signal(vertex_type(graph.l_vertex(lvid)), message);
       }
     }
-  } // end of signal all
+  } // end of signal_vset
  
 
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   internal_signal(const vertex_type& vertex,
                   const message_type& message) {
-    const lvid_type lvid = vertex.local_id();
+    combine_message(vertex.local_id(), message);
+  } // end of internal_signal
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  combine_message(lvid_type lvid, const message_type& message) {
+    if (lockfree_messages) {
+      combine_message(lvid, message, lockfree_messages_supported());
+    } else {
+      combine_message(lvid, message, boost::false_type());
+    }
+  } // end of combine_message
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  combine_message(lvid_type lvid, const message_type& message,
+                  boost::false_type) {
     vlocks[lvid].lock();
     if( has_message.get(lvid) ) {
       messages[lvid] += message;
@@ -1136,7 +2010,24 @@ namespace graphlab {
       has_message.set_bit(lvid);
     }
     vlocks[lvid].unlock();       
-  } // end of internal_signal
+  } // end of combine_message
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  combine_message(lvid_type lvid, const message_type& message,
+                  boost::true_type) {
+    // The sender which sets the has_message bit stores the first
+    // message and publishes it with the message_ready bit. The other
+    // senders wait for it and then combine their message into it.
+    if (!has_message.set_bit(lvid)) {
+      messages[lvid] = message;
+      message_ready.set_bit(lvid);
+    } else {
+      while (!message_ready.get(lvid)) cpu_relax();
+      atomic_combine(messages[lvid], message);
+    }
+  } // end of combine_message
 
 
   template<typename VertexProgram>
@@ -1198,6 +2089,181 @@ namespace graphlab {
 
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  internal_vertex_data_unchanged(const vertex_type& vertex) {
+    if (skip_unchanged_vdata) vdata_unchanged.set_bit(vertex.local_id());
+  } // end of vertex_data_unchanged
+
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  activate_minorstep(lvid_type lvid) {
+    const bool was_active = active_minorstep.set_bit(lvid);
+    if (!was_active && frontier_alpha > 0) {
+      const local_vertex_type local_vertex = graph.l_vertex(lvid);
+      minorstep_frontier_edges.inc(local_vertex.num_in_edges() + 
+                                   local_vertex.num_out_edges());
+    }
+  } // end of activate_minorstep
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::clear_minorstep() {
+    active_minorstep.clear();
+    minorstep_frontier_edges = 0;
+    sparse_minorstep = false;
+  } // end of clear_minorstep
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::choose_minorstep_direction() {
+    sparse_minorstep = active_minorstep.is_sparse() &&
+      (frontier_alpha <= 0 || 
+       frontier_alpha * minorstep_frontier_edges.value < 
+       double(graph.num_local_edges()));
+    if (sparse_minorstep) {
+      // visit the frontier in lvid order for locality
+      active_minorstep.sort();
+    }
+  } // end of choose_minorstep_direction
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::choose_scatter_direction() {
+    choose_minorstep_direction();
+    pull_scatter = frontier_alpha > 0 && 
+      minorstep_frontier_edges.value > 0 &&
+      frontier_alpha * minorstep_frontier_edges.value >= 
+      double(graph.num_local_edges());
+  } // end of choose_scatter_direction
+
+
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::
+  next_minorstep_block(size_t thread_id, std::vector<lvid_type>& lvids) {
+    return next_active_block(active_minorstep, sparse_minorstep, 
+                             thread_id, lvids);
+  } // end of next_minorstep_block
+
+
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::
+  next_active_block(adaptive_bitset& active_set, bool allow_sparse,
+                    size_t thread_id, std::vector<lvid_type>& lvids) {
+    if (!numa_aware || (allow_sparse && active_set.is_sparse())) {
+      return active_set.next_block(shared_lvid_counter, lvids, allow_sparse);
+    }
+    // start with the range of this thread and then help the others
+    const size_t nthreads = thread_lvid_counter.size();
+    for (size_t i = 0; i < nthreads; ++i) {
+      const size_t r = (thread_id + i) % nthreads;
+      if (active_set.next_block_in_range(thread_lvid_counter[r].value,
+                                         thread_lvid_begin[r],
+                                         thread_lvid_begin[r + 1],
+                                         lvids)) {
+        return true;
+      }
+    }
+    return false;
+  } // end of next_active_block
+
+
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::
+  next_lvid_word(size_t thread_id, lvid_type& lvid_block_start) {
+    const size_t WORD_SIZE = 8 * sizeof(size_t);
+    if (!numa_aware) {
+      lvid_block_start = shared_lvid_counter.inc_ret_last(WORD_SIZE);
+      return lvid_block_start < graph.num_local_vertices();
+    }
+    // start with the range of this thread and then help the others
+    const size_t nthreads = thread_lvid_counter.size();
+    for (size_t i = 0; i < nthreads; ++i) {
+      const size_t r = (thread_id + i) % nthreads;
+      const size_t start = thread_lvid_begin[r] + 
+        thread_lvid_counter[r].value.inc_ret_last(WORD_SIZE);
+      if (start < thread_lvid_begin[r + 1]) {
+        lvid_block_start = start;
+        return true;
+      }
+    }
+    return false;
+  } // end of next_lvid_word
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::first_touch(size_t thread_id) {
+    const lvid_type begin = thread_lvid_begin[thread_id];
+    const lvid_type end = thread_lvid_begin[thread_id + 1];
+    first_touch_range(messages, begin, end, message_type());
+    first_touch_range(gather_accum, begin, end, gather_type());
+    first_touch_range(gather_cache, begin, end, gather_type());
+  } // end of first_touch
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  read_exchange_bytes(std::vector<std::vector<size_t> >& bytes) const {
+    bytes.assign(NUM_EXCHANGES, std::vector<size_t>(rmi.numprocs()));
+    for (procid_t p = 0; p < rmi.numprocs(); ++p) {
+      bytes[MESSAGE_EXCHANGE][p] = message_exchange.bytes_sent(p);
+      bytes[VPROG_EXCHANGE][p] = vprog_exchange.bytes_sent(p) + 
+        pipelined_vprog_exchange.bytes_sent(p);
+      bytes[GATHER_EXCHANGE][p] = gather_exchange.bytes_sent(p) + 
+        pipelined_gather_exchange.bytes_sent(p);
+      bytes[EMPTY_GATHER_EXCHANGE][p] = empty_gather_exchange.bytes_sent(p);
+      bytes[VDATA_EXCHANGE][p] = vdata_exchange.bytes_sent(p) + 
+        pipelined_vdata_exchange.bytes_sent(p);
+    }
+  } // end of read_exchange_bytes
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::begin_superstep_profile() {
+    superstep_timer.start();
+    current_profile.phases.resize(NUM_PHASES);
+    for (size_t i = 0; i < NUM_PHASES; ++i) {
+      current_profile.phases[i].clear(threads.size());
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+      thread_gather_edges[i].value = 0;
+      thread_scatter_edges[i].value = 0;
+    }
+    read_exchange_bytes(superstep_start_bytes);
+  } // end of begin_superstep_profile
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::end_superstep_profile() {
+    current_profile.iteration = iteration_counter;
+    current_profile.wall_time = superstep_timer.current_time();
+    current_profile.active_vertices = num_active_vertices;
+    current_profile.gather_edges = 0;
+    current_profile.scatter_edges = 0;
+    for (size_t i = 0; i < threads.size(); ++i) {
+      current_profile.gather_edges += thread_gather_edges[i].value;
+      current_profile.scatter_edges += thread_scatter_edges[i].value;
+    }
+    current_profile.pulled_scatter_edges = 
+      pull_scatter ? current_profile.scatter_edges : 0;
+    read_exchange_bytes(current_profile.bytes_sent);
+    for (size_t e = 0; e < NUM_EXCHANGES; ++e) {
+      for (procid_t p = 0; p < rmi.numprocs(); ++p) {
+        current_profile.bytes_sent[e][p] -= superstep_start_bytes[e][p];
+      }
+    }
+    // collect the profiles of all machines on machine 0
+    std::vector<superstep_profile> all_profiles(rmi.numprocs());
+    all_profiles[rmi.procid()] = current_profile;
+    rmi.gather(all_profiles, 0);
+    if (rmi.procid() == 0) {
+      get_engine_profile_log().add_superstep(all_profiles);
+    }
+  } // end of end_superstep_profile
+
+
   template<typename VertexProgram>
   size_t synchronous_engine<VertexProgram>::
   num_updates() const { return completed_applys.value; }
@@ -1230,6 +2296,7 @@ namespace graphlab {
     graphlab::timer timer; timer.start();
     start_time = timer::approx_time_seconds();
     iteration_counter = 0;
+    total_skipped_vdata_syncs = 0; total_skipped_vdata_bytes = 0;
     force_abort = false;
     execution_status::status_enum termination_reason = 
       execution_status::UNSET; 
@@ -1248,8 +2315,29 @@ namespace graphlab {
       logstream(LOG_EMPH) << "Iteration counter will only output every 5 seconds." 
                         << std::endl;
     }
+    if (profile && rmi.procid() == 0) {
+      std::vector<std::string> phase_names;
+      for (size_t i = 0; i < NUM_PHASES; ++i) {
+        phase_names.push_back(phase_name(i));
+      }
+      const char* exchange_names[NUM_EXCHANGES] = 
+        { "messages", "vertex_programs", "gathers", "empty_gathers",
+          "vertex_data" };
+      get_engine_profile_log().
+        begin_run("synchronous", 
+                  phase_names,
+                  std::vector<std::string>(exchange_names, 
+                                           exchange_names + NUM_EXCHANGES),
+                  rmi.numprocs());
+    }
+    if (!trace_prefix.empty()) {
+      event_trace::clear();
+      event_trace::enable();
+      event_trace::set_thread_name("engine main");
+    }
     // Program Main loop ====================================================      
     while(iteration_counter < max_iterations && !force_abort ) {
+      TRACE_SCOPE("superstep");
 
       // Check first to see if we are out of time
       if(timeout != 0 && timeout < elapsed_seconds()) {
@@ -1258,6 +2346,7 @@ namespace graphlab {
       }
       
       bool print_this_round = (elapsed_seconds() - last_print) >= 5;
+      if (profile) begin_superstep_profile();
 
       if(rmi.procid() == 0 && print_this_round) {
         logstream(LOG_EMPH) 
@@ -1268,14 +2357,14 @@ namespace graphlab {
       // Reset Active vertices ---------------------------------------------- 
       // Clear the active super-step and minor-step bits which will
       // be set upon receiving messages
-      active_superstep.clear(); active_minorstep.clear();
+      active_superstep.clear(); clear_minorstep();
       has_gather_accum.clear(); 
       rmi.barrier();
 
       // Exchange Messages --------------------------------------------------
       // Exchange any messages in the local message vectors
       // if (rmi.procid() == 0) std::cout << "Exchange messages..." << std::endl;
-      run_synchronous( &synchronous_engine::exchange_messages );
+      run_synchronous( &synchronous_engine::exchange_messages, EXCHANGE_MESSAGES_PHASE );
       /**
        * Post conditions:
        *   1) only master vertices have messages
@@ -1288,11 +2377,13 @@ namespace graphlab {
 
       // if (rmi.procid() == 0) std::cout << "Receive messages..." << std::endl;
       num_active_vertices = 0; 
-      run_synchronous( &synchronous_engine::receive_messages );
+      run_synchronous( &synchronous_engine::receive_messages, RECEIVE_MESSAGES_PHASE );
       if (sched_allv) { 
         active_minorstep.fill();
+        minorstep_frontier_edges = graph.num_local_edges();
       }
       has_message.clear();
+      if (lockfree_messages) message_ready.clear();
       /**
        * Post conditions:
        *   1) there are no messages remaining
@@ -1321,23 +2412,51 @@ namespace graphlab {
       // Execute the gather operation for all vertices that are active
       // in this minor-step (active-minorstep bit set).
       // if (rmi.procid() == 0) std::cout << "Gathering..." << std::endl;
-      run_synchronous( &synchronous_engine::execute_gathers );
-      // Clear the minor step bit since only super-step vertices
-      // (only master vertices are required to participate in the
-      // apply step)
-      active_minorstep.clear(); // rmi.barrier();
-      /**
-       * Post conditions:
-       *   1) gather_accum for all master vertices contains the
-       *      result of all the gathers (even if they are drawn from
-       *      cache)
-       *   2) No minor-step bits are set
-       */
-
-      // Execute Apply Operations -------------------------------------------
-      // Run the apply function on all active vertices
-      // if (rmi.procid() == 0) std::cout << "Applying..." << std::endl;
-      run_synchronous( &synchronous_engine::execute_applys );
+      choose_minorstep_direction();
+      active_superstep.sort();
+      skipped_vdata_syncs = 0; skipped_vdata_bytes = 0;
+      if (pipelined_apply) {
+        // Gather and apply in one phase, applying each master as soon
+        // as its partial gathers have arrived
+        run_synchronous( &synchronous_engine::execute_gathers_and_applys,
+                         GATHER_APPLY_PHASE );
+      } else {
+        run_synchronous( &synchronous_engine::execute_gathers, GATHER_PHASE );
+        // Clear the minor step bit since only super-step vertices
+        // (only master vertices are required to participate in the
+        // apply step)
+        clear_minorstep(); // rmi.barrier();
+        /**
+         * Post conditions:
+         *   1) gather_accum for all master vertices contains the
+         *      result of all the gathers (even if they are drawn from
+         *      cache)
+         *   2) No minor-step bits are set
+         */
+
+        // Execute Apply Operations -----------------------------------------
+        // Run the apply function on all active vertices
+        // if (rmi.procid() == 0) std::cout << "Applying..." << std::endl;
+        run_synchronous( &synchronous_engine::execute_applys, APPLY_PHASE );
+      }
+      if (skip_unchanged_vdata) {
+        size_t skipped_syncs = skipped_vdata_syncs;
+        size_t skipped_bytes = skipped_vdata_bytes;
+        rmi.all_reduce(skipped_syncs);
+        rmi.all_reduce(skipped_bytes);
+        total_skipped_vdata_syncs += skipped_syncs;
+        total_skipped_vdata_bytes += skipped_bytes;
+        if (rmi.procid() == 0) {
+          std::stringstream strm;
+          strm << "\tUnchanged vertex data: skipped " << skipped_syncs 
+               << " mirror updates";
+          if (vdata_bytes_known()) {
+            strm << ", saving " << skipped_bytes << " bytes";
+          }
+          if (print_this_round) logstream(LOG_EMPH) << strm.str() << std::endl;
+          else logstream(LOG_INFO) << strm.str() << std::endl;
+        }
+      }
       /**
        * Post conditions:
        *   1) any changes to the vertex data have been synchronized
@@ -1352,7 +2471,8 @@ namespace graphlab {
 
       // Execute Scatter Operations -----------------------------------------
       // Execute each of the scatters on all minor-step active vertices.
-      run_synchronous( &synchronous_engine::execute_scatters );
+      choose_scatter_direction();
+      run_synchronous( &synchronous_engine::execute_scatters, SCATTER_PHASE );
       /**
        * Post conditions:
        *   1) NONE
@@ -1361,6 +2481,7 @@ namespace graphlab {
         logstream(LOG_EMPH) << "\t Running Aggregators" << std::endl;
       // probe the aggregator
       aggregator.tick_synchronous();
+      if (profile) end_superstep_profile();
       
       ++iteration_counter;
       
@@ -1386,6 +2507,19 @@ namespace graphlab {
     rmi.all_reduce(global_completed);
     completed_applys = global_completed;
     rmi.cout() << "Updates: " << completed_applys.value << "\n";
+    if (skip_unchanged_vdata && rmi.procid() == 0) {
+      std::stringstream strm;
+      strm << "Unchanged vertex data: skipped " << total_skipped_vdata_syncs
+           << " mirror updates";
+      if (vdata_bytes_known()) {
+        strm << ", saving " << total_skipped_vdata_bytes << " bytes";
+      }
+      logstream(LOG_EMPH) << strm.str() << std::endl;
+    }
+    if (profile && rmi.procid() == 0) {
+      logstream(LOG_EMPH) << "Profile: " 
+                          << get_engine_profile_log().summary() << std::endl;
+    }
     if (rmi.procid() == 0) { 
       logstream(LOG_INFO) << "Compute Balance: ";
       for (size_t i = 0;i < all_compute_time_vec.size(); ++i) {
@@ -1394,6 +2528,18 @@ namespace graphlab {
       logstream(LOG_INFO) << std::endl;
     } 
     rmi.full_barrier();
+    if (!trace_prefix.empty()) {
+      event_trace::disable();
+      const std::string fname = 
+        trace_prefix + "." + tostr(rmi.procid()) + ".json";
+      if (event_trace::write_chrome_trace(fname, rmi.procid())) {
+        logstream(LOG_INFO) << "Event trace written to " << fname 
+                            << std::endl;
+      } else {
+        logstream(LOG_ERROR) << "Unable to write the event trace to " 
+                             << fname << std::endl;
+      }
+    }
     // Stop the aggregator
     aggregator.stop();
     // return the final reason for termination
@@ -1412,11 +2558,9 @@ namespace graphlab {
     fixed_dense_bitset<sizeof(size_t)> local_bitset;
     // for(lvid_type lvid = thread_id; lvid < graph.num_local_vertices(); 
     //     lvid += threads.size()) {
-    while (1) {
-      // increment by a word at a time 
-      lvid_type lvid_block_start = 
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
+    lvid_type lvid_block_start = 0;
+    // claim a word at a time 
+    while (next_lvid_word(thread_id, lvid_block_start)) {
       // get the bit field from has_message
       size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
       if (lvid_bit_block == 0) continue;
@@ -1431,17 +2575,18 @@ namespace graphlab {
         if(!graph.l_is_master(lvid)) {
           sync_message(lvid, thread_id); 
           has_message.clear_bit(lvid);
-          // clear the message to save memory
-          messages[lvid] = message_type();
+          if (lockfree_messages) message_ready.clear_bit(lvid);
         }
         if(++vcount % TRY_RECV_MOD == 0) recv_messages(TRY_TO_RECV); 
       }
     } // end of loop over vertices to send messages
-    message_exchange.partial_flush(thread_id);
     // Finish sending and receiving all messages
-    thread_barrier.wait();
+    wait_for_threads(thread_id);
+    message_getter get_message(*this);
+    message_exchange.send_marked(get_message);
+    wait_for_threads(thread_id);
     if(thread_id == 0) message_exchange.flush(); 
-    thread_barrier.wait();
+    wait_for_threads(thread_id);
     recv_messages();
   } // end of exchange_messages
 
@@ -1456,11 +2601,9 @@ namespace graphlab {
     size_t vcount = 0;
     size_t nactive_inc = 0;
     fixed_dense_bitset<sizeof(size_t)> local_bitset;
-    while (1) {
-      // increment by a word at a time 
-      lvid_type lvid_block_start = 
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
+    lvid_type lvid_block_start = 0;
+    // claim a word at a time 
+    while (next_lvid_word(thread_id, lvid_block_start)) {
       // get the bit field from has_message
       size_t lvid_bit_block = has_message.containing_word(lvid_block_start);
       if (lvid_bit_block == 0) continue;
@@ -1482,29 +2625,38 @@ namespace graphlab {
           vertex_programs[lvid].init(context, vertex, messages[lvid]);
           // clear the message to save memory
           messages[lvid] = message_type();
+          // In the pipelined phase the apply waits for the partial
+          // gathers of all mirrors
+          if (pipelined_apply) {
+            pending_gathers[lvid].value = graph.l_vertex(lvid).num_mirrors();
+          }
           if (sched_allv) continue;
           // Determine if the gather should be run
           const vertex_program_type& const_vprog = vertex_programs[lvid];
           const vertex_type const_vertex = vertex;
           if(const_vprog.gather_edges(context, const_vertex) != 
               graphlab::NO_EDGES) {
-            active_minorstep.set_bit(lvid);
+            activate_minorstep(lvid);
             sync_vertex_program(lvid, thread_id);
-          }  
+          } else if (pipelined_apply) {
+            pending_gathers[lvid].value = 0;
+          }
         }
         if(++vcount % TRY_RECV_MOD == 0) recv_vertex_programs(TRY_TO_RECV);
       }
     }
 
     num_active_vertices += nactive_inc;
-    vprog_exchange.partial_flush(thread_id);
-    // Flush the buffer and finish receiving any remaining vertex
-    // programs.
-    thread_barrier.wait();
+    // Send the vertex programs and finish receiving any remaining
+    // vertex programs.
+    wait_for_threads(thread_id);
+    vprog_getter get_vprog(*this);
+    vprog_exchange.send_marked(get_vprog);
+    wait_for_threads(thread_id);
     if(thread_id == 0) {
       vprog_exchange.flush();
     }
-    thread_barrier.wait();
+    wait_for_threads(thread_id);
 
     recv_vertex_programs();
 
@@ -1518,103 +2670,101 @@ namespace graphlab {
     const bool TRY_TO_RECV = true;
     const size_t TRY_RECV_MOD = 1000;
     size_t vcount = 0;
-    const bool caching_enabled = !gather_cache.empty();
     // for(lvid_type lvid = thread_id; lvid < graph.num_local_vertices(); 
     //     lvid += threads.size()) {
     timer ti;
 
-    fixed_dense_bitset<sizeof(size_t)> local_bitset;
-    while (1) {
-      // increment by a word at a time 
-      lvid_type lvid_block_start = 
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield 
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-
-      foreach(uint32_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset; 
-        if (lvid >= graph.num_local_vertices()) break;
-
-        bool accum_is_set = false;
-        gather_type accum = gather_type();         
-        // if caching is enabled and we have a cache entry then use
-        // that as the accum
-        if( caching_enabled && has_cache.get(lvid) ) {
-          accum = gather_cache[lvid];
-          accum_is_set = true;
-        } else {
-          // recompute the local contribution to the gather
-          const vertex_program_type& vprog = vertex_programs[lvid];
-          local_vertex_type local_vertex = graph.l_vertex(lvid);
-          const vertex_type vertex(local_vertex);
-          const edge_dir_type gather_dir = vprog.gather_edges(context, vertex);
-          // Loop over in edges
-          size_t edges_touched = 0;
-          if(gather_dir == IN_EDGES || gather_dir == ALL_EDGES) {
-            foreach(local_edge_type local_edge, local_vertex.in_edges()) {
-              edge_type edge(local_edge);
-              // elocks[local_edge.id()].lock();
-              if(accum_is_set) { // \todo hint likely                
-                accum += vprog.gather(context, vertex, edge);
-              } else {
-                accum = vprog.gather(context, vertex, edge); 
-                accum_is_set = true;
-              }
-              ++edges_touched;
-              // elocks[local_edge.id()].unlock();
-            }
-          } // end of if in_edges/all_edges
-            // Loop over out edges
-          if(gather_dir == OUT_EDGES || gather_dir == ALL_EDGES) {
-            foreach(local_edge_type local_edge, local_vertex.out_edges()) {
-              edge_type edge(local_edge);
-              // elocks[local_edge.id()].lock();
-              if(accum_is_set) { // \todo hint likely
-                accum += vprog.gather(context, vertex, edge);              
-              } else {
-                accum = vprog.gather(context, vertex, edge);
-                accum_is_set = true;
-              }
-              // elocks[local_edge.id()].unlock();
-              ++edges_touched;
-            }
-            INCREMENT_EVENT(EVENT_GATHERS, edges_touched);
-          } // end of if out_edges/all_edges
-          // If caching is enabled then save the accumulator to the
-          // cache for future iterations.  Note that it is possible
-          // that the accumulator was never set in which case we are
-          // effectively "zeroing out" the cache.
-          if(caching_enabled && accum_is_set) {              
-            gather_cache[lvid] = accum; has_cache.set_bit(lvid); 
-          } // end of if caching enabled            
-        }
-        // If the accum contains a value for the local gather we put
-        // that estimate in the gather exchange.
-        if(accum_is_set) sync_gather(lvid, accum, thread_id);  
-        if(!graph.l_is_master(lvid)) {
-          // if this is not the master clear the vertex program
-          vertex_programs[lvid] = vertex_program_type();
-        }
-
+    std::vector<lvid_type> lvid_block;
+    while (next_minorstep_block(thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
+        gather_vertex(context, lvid, thread_id);
         // try to recv gathers if there are any in the buffer
         if(++vcount % TRY_RECV_MOD == 0) recv_gathers(TRY_TO_RECV);
       } 
     } // end of loop over vertices to compute gather accumulators
     per_thread_compute_time[thread_id] += ti.current_time();
-    gather_exchange.partial_flush(thread_id);
       // Finish sending and receiving all gather operations
-    thread_barrier.wait();
+    wait_for_threads(thread_id);
+    gather_getter get_gather(*this);
+    gather_exchange.send_marked(get_gather);
+    wait_for_threads(thread_id);
     if(thread_id == 0) gather_exchange.flush();
-    thread_barrier.wait();
+    wait_for_threads(thread_id);
     recv_gathers();
   } // end of execute_gathers
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  gather_vertex(context_type& context, lvid_type lvid, 
+                const size_t thread_id) {
+    const bool caching_enabled = !gather_cache.empty();
+    bool accum_is_set = false;
+    gather_type accum = gather_type();         
+    // if caching is enabled and we have a cache entry then use
+    // that as the accum
+    if( caching_enabled && has_cache.get(lvid) ) {
+      accum = gather_cache[lvid];
+      accum_is_set = true;
+    } else {
+      // recompute the local contribution to the gather
+      const vertex_program_type& vprog = vertex_programs[lvid];
+      local_vertex_type local_vertex = graph.l_vertex(lvid);
+      const vertex_type vertex(local_vertex);
+      const edge_dir_type gather_dir = vprog.gather_edges(context, vertex);
+      // Loop over in edges
+      size_t edges_touched = 0;
+      if(gather_dir == IN_EDGES || gather_dir == ALL_EDGES) {
+        foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+          edge_type edge(local_edge);
+          // elocks[local_edge.id()].lock();
+          if(accum_is_set) { // \todo hint likely                
+            accum += vprog.gather(context, vertex, edge);
+          } else {
+            accum = vprog.gather(context, vertex, edge); 
+            accum_is_set = true;
+          }
+          ++edges_touched;
+          // elocks[local_edge.id()].unlock();
+        }
+      } // end of if in_edges/all_edges
+        // Loop over out edges
+      if(gather_dir == OUT_EDGES || gather_dir == ALL_EDGES) {
+        foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+          edge_type edge(local_edge);
+          // elocks[local_edge.id()].lock();
+          if(accum_is_set) { // \todo hint likely
+            accum += vprog.gather(context, vertex, edge);              
+          } else {
+            accum = vprog.gather(context, vertex, edge);
+            accum_is_set = true;
+          }
+          // elocks[local_edge.id()].unlock();
+          ++edges_touched;
+        }
+        INCREMENT_EVENT(EVENT_GATHERS, edges_touched);
+      } // end of if out_edges/all_edges
+      if (profile) thread_gather_edges[thread_id].value += edges_touched;
+      // If caching is enabled then save the accumulator to the
+      // cache for future iterations.  Note that it is possible
+      // that the accumulator was never set in which case we are
+      // effectively "zeroing out" the cache.
+      if(caching_enabled && accum_is_set) {              
+        gather_cache[lvid] = accum; has_cache.set_bit(lvid); 
+      } // end of if caching enabled            
+    }
+    // If the accum contains a value for the local gather we put
+    // that estimate in the gather exchange.
+    if(accum_is_set) sync_gather(lvid, accum, thread_id);  
+    else if(pipelined_apply && !graph.l_is_master(lvid)) 
+      sync_empty_gather(lvid, thread_id);
+    if(!graph.l_is_master(lvid)) {
+      // if this is not the master clear the vertex program
+      vertex_programs[lvid] = vertex_program_type();
+    }
+  } // end of gather_vertex
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   execute_applys(const size_t thread_id) {
@@ -1626,65 +2776,162 @@ namespace graphlab {
      //   lvid += threads.size()) {
     timer ti;
 
-    fixed_dense_bitset<sizeof(size_t)> local_bitset;
-    while (1) {
-      // increment by a word at a time 
-      lvid_type lvid_block_start = 
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_superstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield 
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(uint32_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset; 
-        if (lvid >= graph.num_local_vertices()) break;
- 
-        // Only master vertices can be active in a super-step
-        ASSERT_TRUE(graph.l_is_master(lvid));
-        vertex_type vertex(graph.l_vertex(lvid));
-        // Get the local accumulator.  Note that it is possible that
-        // the gather_accum was not set during the gather.
-        const gather_type& accum = gather_accum[lvid];
-        INCREMENT_EVENT(EVENT_APPLIES, 1);
-        vertex_programs[lvid].apply(context, vertex, accum);
-        // record an apply as a completed task
-        ++completed_applys;
-        // Clear the accumulator to save some memory
-        gather_accum[lvid] = gather_type();
-        // synchronize the changed vertex data with all mirrors
-        sync_vertex_data(lvid, thread_id);  
-        // determine if a scatter operation is needed
-        const vertex_program_type& const_vprog = vertex_programs[lvid];
-        const vertex_type const_vertex = vertex;
-        if(const_vprog.scatter_edges(context, const_vertex) != 
-           graphlab::NO_EDGES) {
-          active_minorstep.set_bit(lvid);
-          sync_vertex_program(lvid, thread_id);
-        } else { // we are done so clear the vertex program
-          vertex_programs[lvid] = vertex_program_type();
+    vertex_data_type old_vdata;
+
+    std::vector<lvid_type> lvid_block;
+    while (next_active_block(active_superstep, true, thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
+        apply_vertex(context, lvid, thread_id, old_vdata);
+        // try to receive vertex data
+        if(++vcount % TRY_RECV_MOD == 0) {
+          recv_vertex_programs(TRY_TO_RECV);
+          recv_vertex_data(TRY_TO_RECV); 
         }
-      // try to receive vertex data
+      }
+    } // end of loop over vertices to run apply
+
+    per_thread_compute_time[thread_id] += ti.current_time();
+    // Finish sending and receiving all changes due to apply operations
+    finish_applys(thread_id);
+  } // end of execute_applys
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  apply_vertex(context_type& context, lvid_type lvid, 
+               const size_t thread_id, vertex_data_type& old_vdata) {
+    // POD vertex data is compared bytewise to detect unchanged applys
+    const bool compare_vdata = 
+      skip_unchanged_vdata && gl_is_pod<vertex_data_type>::value;
+    // Only master vertices can be active in a super-step
+    ASSERT_TRUE(graph.l_is_master(lvid));
+    vertex_type vertex(graph.l_vertex(lvid));
+    // Get the local accumulator.  Note that it is possible that
+    // the gather_accum was not set during the gather.
+    const gather_type& accum = gather_accum[lvid];
+    INCREMENT_EVENT(EVENT_APPLIES, 1);
+    if (compare_vdata) old_vdata = vertex.data();
+    vertex_programs[lvid].apply(context, vertex, accum);
+    // record an apply as a completed task
+    ++completed_applys;
+    // Clear the accumulator to save some memory
+    gather_accum[lvid] = gather_type();
+    // synchronize the changed vertex data with all mirrors
+    if (skip_unchanged_vdata && 
+        (vdata_unchanged.get(lvid) || 
+         (compare_vdata && memcmp(&old_vdata, &vertex.data(),
+                                  sizeof(vertex_data_type)) == 0))) {
+      vdata_unchanged.clear_bit(lvid);
+      count_skipped_vertex_data(lvid);
+    } else if (pipelined_apply) {
+      stream_vertex_data(lvid, thread_id);
+    } else {
+      sync_vertex_data(lvid, thread_id);  
+    }
+    // determine if a scatter operation is needed
+    const vertex_program_type& const_vprog = vertex_programs[lvid];
+    const vertex_type const_vertex = vertex;
+    if(const_vprog.scatter_edges(context, const_vertex) != 
+       graphlab::NO_EDGES) {
+      activate_minorstep(lvid);
+      if (pipelined_apply) stream_vertex_program(lvid, thread_id);
+      else sync_vertex_program(lvid, thread_id);
+    } else { // we are done so clear the vertex program
+      vertex_programs[lvid] = vertex_program_type();
+    }
+  } // end of apply_vertex
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  execute_gathers_and_applys(const size_t thread_id) {
+    context_type context(*this, graph);
+    const bool TRY_TO_RECV = true;
+    const size_t TRY_RECV_MOD = 1000;
+    size_t vcount = 0;
+    timer ti;
+    std::vector<lvid_type> lvid_block;
+    std::vector<lvid_type> completed;
+    vertex_data_type old_vdata;
+
+    // Compute the local gathers.  Partial gathers which arrive in the
+    // meantime are only counted: no vertex data may change before all
+    // local gathers are done.
+    while (next_minorstep_block(thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
+        gather_vertex(context, lvid, thread_id);
+        if(++vcount % TRY_RECV_MOD == 0) {
+          recv_gathers(TRY_TO_RECV);
+          recv_empty_gathers(TRY_TO_RECV);
+        }
+      } 
+    } // end of loop over vertices to compute gather accumulators
+    pipelined_gather_exchange.partial_flush(thread_id);
+    empty_gather_exchange.partial_flush(thread_id);
+    wait_for_threads(thread_id);
+    if(thread_id == 0) {
+      // the minor-step bits are reused for the scatter
+      clear_minorstep();
+      reset_lvid_counters();
+      gathers_flushed = false;
+    }
+    wait_for_threads(thread_id);
+
+    // Thread 0 completes the exchange of the partial gathers while the
+    // masters which have all their partial gathers are applied.  The
+    // remaining masters are applied by the thread which receives their
+    // last partial gather.
+    if(thread_id == 0) {
+      pipelined_gather_exchange.flush();
+      empty_gather_exchange.flush();
+      gathers_flushed = true;
+    }
+    while (next_active_block(active_superstep, true, thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
+        if(claim_apply(lvid)) apply_vertex(context, lvid, thread_id, old_vdata);
         if(++vcount % TRY_RECV_MOD == 0) {
+          apply_completed_gathers(context, thread_id, completed, old_vdata,
+                                  TRY_TO_RECV);
           recv_vertex_programs(TRY_TO_RECV);
           recv_vertex_data(TRY_TO_RECV); 
         }
       }
     } // end of loop over vertices to run apply
+    while(!gathers_flushed) {
+      if(!apply_completed_gathers(context, thread_id, completed, old_vdata,
+                                  TRY_TO_RECV)) {
+        recv_vertex_programs(TRY_TO_RECV);
+        recv_vertex_data(TRY_TO_RECV);
+        sched_yield();
+      }
+    }
+    // all partial gathers have arrived
+    apply_completed_gathers(context, thread_id, completed, old_vdata, false);
 
     per_thread_compute_time[thread_id] += ti.current_time();
-    vprog_exchange.partial_flush(thread_id);
-    vdata_exchange.partial_flush(thread_id);
-      // Finish sending and receiving all changes due to apply operations
-    thread_barrier.wait();
-    if(thread_id == 0) { vprog_exchange.flush(); vdata_exchange.flush(); }
-    thread_barrier.wait();
-    recv_vertex_programs();
-    recv_vertex_data();
+    // Finish sending and receiving all changes due to apply operations
+    finish_applys(thread_id);
+  } // end of execute_gathers_and_applys
 
-  } // end of execute_applys
+
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::
+  apply_completed_gathers(context_type& context, const size_t thread_id,
+                          std::vector<lvid_type>& completed,
+                          vertex_data_type& old_vdata,
+                          const bool try_to_recv) {
+    completed.clear();
+    recv_gathers(try_to_recv, &completed);
+    recv_empty_gathers(try_to_recv, &completed);
+    bool applied = false;
+    foreach(lvid_type lvid, completed) {
+      if(claim_apply(lvid)) {
+        apply_vertex(context, lvid, thread_id, old_vdata);
+        applied = true;
+      }
+    }
+    return applied;
+  } // end of apply_completed_gathers
 
 
 
@@ -1692,26 +2939,17 @@ namespace graphlab {
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   execute_scatters(const size_t thread_id) {
+    if (pull_scatter) {
+      pull_scatters(thread_id);
+      return;
+    }
     context_type context(*this, graph);
     // for(lvid_type lvid = thread_id; lvid < graph.num_local_vertices(); 
     //      lvid += threads.size()) {
     timer ti;
-    fixed_dense_bitset<sizeof(size_t)> local_bitset;
-    while (1) {
-      // increment by a word at a time 
-      lvid_type lvid_block_start = 
-                  shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
-      if (lvid_block_start >= graph.num_local_vertices()) break;
-      // get the bit field from has_message
-      size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
-      if (lvid_bit_block == 0) continue;
-      // initialize a word sized bitfield 
-      local_bitset.clear();
-      local_bitset.initialize_from_mem(&lvid_bit_block, sizeof(size_t));
-      foreach(uint32_t lvid_block_offset, local_bitset) {
-        lvid_type lvid = lvid_block_start + lvid_block_offset; 
-        if (lvid >= graph.num_local_vertices()) break;
- 
+    std::vector<lvid_type> lvid_block;
+    while (next_minorstep_block(thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
         const vertex_program_type& vprog = vertex_programs[lvid];
         local_vertex_type local_vertex = graph.l_vertex(lvid);
         const vertex_type vertex(local_vertex);
@@ -1738,6 +2976,12 @@ namespace graphlab {
 					++edges_touched;
         } // end of if out_edges/all_edges
 				INCREMENT_EVENT(EVENT_SCATTERS, edges_touched);
+        if (profile) {
+          if(scatter_dir == IN_EDGES || scatter_dir == ALL_EDGES) 
+            thread_scatter_edges[thread_id].value += local_vertex.num_in_edges();
+          if(scatter_dir == OUT_EDGES || scatter_dir == ALL_EDGES) 
+            thread_scatter_edges[thread_id].value += local_vertex.num_out_edges();
+        }
         // Clear the vertex program
         vertex_programs[lvid] = vertex_program_type();
       } // end of if active on this minor step
@@ -1747,22 +2991,106 @@ namespace graphlab {
   } // end of execute_scatters
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  pull_scatters(const size_t thread_id) {
+    context_type context(*this, graph);
+    timer ti;
+    std::vector<lvid_type> lvid_block;
+    // Mark the edges each active vertex scatters on
+    while (next_minorstep_block(thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
+        const local_vertex_type local_vertex = graph.l_vertex(lvid);
+        const vertex_type vertex(local_vertex);
+        const edge_dir_type scatter_dir = 
+          vertex_programs[lvid].scatter_edges(context, vertex);
+        if(scatter_dir == IN_EDGES || scatter_dir == ALL_EDGES) {
+          scatter_in_edges.set_bit(lvid);
+          INCREMENT_EVENT(EVENT_SCATTERS, 1);
+          if (profile) 
+            thread_scatter_edges[thread_id].value += local_vertex.num_in_edges();
+        }
+        if(scatter_dir == OUT_EDGES || scatter_dir == ALL_EDGES) {
+          scatter_out_edges.set_bit(lvid);
+          INCREMENT_EVENT(EVENT_SCATTERS, 1);
+          if (profile) 
+            thread_scatter_edges[thread_id].value += local_vertex.num_out_edges();
+        }
+      }
+    }
+    wait_for_threads(thread_id);
+    if (thread_id == 0) reset_lvid_counters();
+    wait_for_threads(thread_id);
+    // Walk the edges of every vertex and run the scatter of the active
+    // vertex at the other end
+    const lvid_type nverts = graph.num_local_vertices();
+    const size_t WORD_SIZE = 8 * sizeof(size_t);
+    lvid_type lvid_block_start = 0;
+    while (next_lvid_word(thread_id, lvid_block_start)) {
+      const lvid_type lvid_block_end = 
+        std::min(lvid_type(lvid_block_start + WORD_SIZE), nverts);
+      for (lvid_type lvid = lvid_block_start; lvid < lvid_block_end; ++lvid) {
+        local_vertex_type local_vertex = graph.l_vertex(lvid);
+        foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+          const local_vertex_type source = local_edge.source();
+          if (!scatter_out_edges.get(source.id())) continue;
+          edge_type edge(local_edge);
+          vertex_programs[source.id()].scatter(context, vertex_type(source), 
+                                               edge);
+        }
+        foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+          const local_vertex_type target = local_edge.target();
+          if (!scatter_in_edges.get(target.id())) continue;
+          edge_type edge(local_edge);
+          vertex_programs[target.id()].scatter(context, vertex_type(target), 
+                                               edge);
+        }
+      }
+    }
+    wait_for_threads(thread_id);
+    if (thread_id == 0) reset_lvid_counters();
+    wait_for_threads(thread_id);
+    // Clear the marks and the vertex programs
+    while (next_minorstep_block(thread_id, lvid_block)) {
+      foreach(lvid_type lvid, lvid_block) {
+        scatter_in_edges.clear_bit(lvid);
+        scatter_out_edges.clear_bit(lvid);
+        vertex_programs[lvid] = vertex_program_type();
+      }
+    }
+    per_thread_compute_time[thread_id] += ti.current_time();
+  } // end of pull_scatters
+
+
 
   // Data Synchronization ===================================================
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   sync_vertex_program(lvid_type lvid, const size_t thread_id) {
     ASSERT_TRUE(graph.l_is_master(lvid));
-    const vertex_id_type vid = graph.global_vid(lvid);
     local_vertex_type vertex = graph.l_vertex(lvid);
+    size_t i = 0;
     foreach(const procid_t& mirror, vertex.mirrors()) {
-      vprog_exchange.send(mirror, 
-                          std::make_pair(vid, vertex_programs[lvid]),
-                          thread_id);
+      vprog_exchange.mark(mirror, comm_plan.mirror_position(lvid, i++));
     }
   } // end of sync_vertex_program
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  stream_vertex_program(lvid_type lvid, const size_t thread_id) {
+    ASSERT_TRUE(graph.l_is_master(lvid));
+    local_vertex_type vertex = graph.l_vertex(lvid);
+    size_t i = 0;
+    foreach(const procid_t& mirror, vertex.mirrors()) {
+      const plan_position_type pos = comm_plan.mirror_position(lvid, i++);
+      pipelined_vprog_exchange.send(mirror, 
+                                    std::make_pair(pos, vertex_programs[lvid]),
+                                    thread_id);
+    }
+  } // end of stream_vertex_program
+
+
 
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
@@ -1770,11 +3098,20 @@ namespace graphlab {
     procid_t procid(-1);
     typename vprog_exchange_type::buffer_type buffer;
     while(vprog_exchange.recv(procid, buffer, try_to_recv)) {
-      foreach(const vid_prog_pair_type& pair, buffer) {
-        const lvid_type lvid = graph.local_vid(pair.first);
+      for (size_t i = 0; i < buffer.positions.size(); ++i) {
+        const lvid_type lvid = comm_plan.lvid(procid, buffer.positions[i]);
   //      ASSERT_FALSE(graph.l_is_master(lvid));
+        vertex_programs[lvid] = buffer.values[i];
+        activate_minorstep(lvid);
+      }
+    }
+    typename pipelined_vprog_exchange_type::buffer_type pipelined_buffer;
+    while(pipelined_vprog_exchange.recv(procid, pipelined_buffer, 
+                                        try_to_recv)) {
+      foreach(const pos_vprog_pair_type& pair, pipelined_buffer) {
+        const lvid_type lvid = comm_plan.lvid(procid, pair.first);
         vertex_programs[lvid] = pair.second;
-        active_minorstep.set_bit(lvid);
+        activate_minorstep(lvid);
       }
     }
   } // end of recv vertex programs
@@ -1784,14 +3121,51 @@ namespace graphlab {
   void synchronous_engine<VertexProgram>::
   sync_vertex_data(lvid_type lvid, const size_t thread_id) {
     ASSERT_TRUE(graph.l_is_master(lvid));
-    const vertex_id_type vid = graph.global_vid(lvid);
     local_vertex_type vertex = graph.l_vertex(lvid);
+    size_t i = 0;
     foreach(const procid_t& mirror, vertex.mirrors()) {
-      vdata_exchange.send(mirror, std::make_pair(vid, vertex.data()), thread_id);
+      vdata_exchange.mark(mirror, comm_plan.mirror_position(lvid, i++));
     }
   } // end of sync_vertex_data
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  stream_vertex_data(lvid_type lvid, const size_t thread_id) {
+    ASSERT_TRUE(graph.l_is_master(lvid));
+    local_vertex_type vertex = graph.l_vertex(lvid);
+    size_t i = 0;
+    foreach(const procid_t& mirror, vertex.mirrors()) {
+      const plan_position_type pos = comm_plan.mirror_position(lvid, i++);
+      pipelined_vdata_exchange.send(mirror, std::make_pair(pos, vertex.data()),
+                                    thread_id);
+    }
+  } // end of stream_vertex_data
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  count_skipped_vertex_data(lvid_type lvid) {
+    local_vertex_type vertex = graph.l_vertex(lvid);
+    const size_t nmirrors = vertex.num_mirrors();
+    if (nmirrors == 0) return;
+    skipped_vdata_syncs.inc(nmirrors);
+    if (!vdata_bytes_known()) return;
+    // the size of the vertex data sent by sync_vertex_data.  Other
+    // than POD data is only serialized to measure it when profiling,
+    // since it would put the serialization back into the apply.
+    size_t vdata_size = sizeof(vertex_data_type);
+    if (!gl_is_pod<vertex_data_type>::value) {
+      boost::iostreams::stream<char_counting_sink> strm(0);
+      oarchive oarc(strm);
+      oarc << vertex.data();
+      strm.flush();
+      vdata_size = strm->count;
+    }
+    skipped_vdata_bytes.inc(nmirrors * vdata_size);
+  } // end of count_skipped_vertex_data
+
+
 
 
 
@@ -1801,8 +3175,17 @@ namespace graphlab {
     procid_t procid(-1);
     typename vdata_exchange_type::buffer_type buffer;
     while(vdata_exchange.recv(procid, buffer, try_to_recv)) {
-      foreach(const vid_vdata_pair_type& pair, buffer) {
-        const lvid_type lvid = graph.local_vid(pair.first);
+      for (size_t i = 0; i < buffer.positions.size(); ++i) {
+        const lvid_type lvid = comm_plan.lvid(procid, buffer.positions[i]);
+        ASSERT_FALSE(graph.l_is_master(lvid));
+        graph.l_vertex(lvid).data() = buffer.values[i];
+      }
+    }
+    typename pipelined_vdata_exchange_type::buffer_type pipelined_buffer;
+    while(pipelined_vdata_exchange.recv(procid, pipelined_buffer, 
+                                        try_to_recv)) {
+      foreach(const pos_vdata_pair_type& pair, pipelined_buffer) {
+        const lvid_type lvid = comm_plan.lvid(procid, pair.first);
         ASSERT_FALSE(graph.l_is_master(lvid));
         graph.l_vertex(lvid).data() = pair.second;
       }
@@ -1810,55 +3193,145 @@ namespace graphlab {
   } // end of recv vertex data
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  finish_applys(const size_t thread_id) {
+    if (pipelined_apply) {
+      // only the partially filled buffers are left to send
+      pipelined_vprog_exchange.partial_flush(thread_id);
+      pipelined_vdata_exchange.partial_flush(thread_id);
+      wait_for_threads(thread_id);
+      if(thread_id == 0) {
+        pipelined_vprog_exchange.flush(); 
+        pipelined_vdata_exchange.flush();
+      }
+    } else {
+      wait_for_threads(thread_id);
+      vprog_getter get_vprog(*this);
+      vdata_getter get_vdata(*this);
+      vprog_exchange.send_marked(get_vprog);
+      vdata_exchange.send_marked(get_vdata);
+      wait_for_threads(thread_id);
+      if(thread_id == 0) { vprog_exchange.flush(); vdata_exchange.flush(); }
+    }
+    wait_for_threads(thread_id);
+    recv_vertex_programs();
+    recv_vertex_data();
+  } // end of finish_applys
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   sync_gather(lvid_type lvid, const gather_type& accum, const size_t thread_id) {
     if(graph.l_is_master(lvid)) {
-      vlocks[lvid].lock();
-      if(has_gather_accum.get(lvid)) {
-        gather_accum[lvid] += accum;
+      combine_gather(lvid, accum);
+    } else {
+      const procid_t master = graph.l_master(lvid);
+      const plan_position_type pos = comm_plan.master_position(lvid);
+      if (pipelined_apply) {
+        pipelined_gather_exchange.send(master, std::make_pair(pos, accum), 
+                                       thread_id);
       } else {
+        // sent from the accumulator of the mirror at the end of the phase
         gather_accum[lvid] = accum;
-        has_gather_accum.set_bit(lvid);
+        gather_exchange.mark(master, pos);
       }
-      vlocks[lvid].unlock();
-    } else {
-      const procid_t master = graph.l_master(lvid);
-      const vertex_id_type vid = graph.global_vid(lvid);
-      gather_exchange.send(master, std::make_pair(vid, accum), thread_id);
     }
   } // end of sync_gather
 
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
-  recv_gathers(const bool try_to_recv) {
+  recv_gathers(const bool try_to_recv, std::vector<lvid_type>* completed) {
     procid_t procid(-1);
     typename gather_exchange_type::buffer_type buffer;
     while(gather_exchange.recv(procid, buffer, try_to_recv)) {
-      foreach(const vid_gather_pair_type& pair, buffer) {
-        const lvid_type lvid = graph.local_vid(pair.first);
-        const gather_type& accum = pair.second;
+      for (size_t i = 0; i < buffer.positions.size(); ++i) {
+        const lvid_type lvid = comm_plan.lvid(procid, buffer.positions[i]);
         ASSERT_TRUE(graph.l_is_master(lvid));
-        vlocks[lvid].lock();
-        if( has_gather_accum.get(lvid) ) {
-          gather_accum[lvid] += accum;
-        } else {
-          gather_accum[lvid] = accum;
-          has_gather_accum.set_bit(lvid);
+        combine_gather(lvid, buffer.values[i]);
+      }
+    }
+    typename pipelined_gather_exchange_type::buffer_type pipelined_buffer;
+    while(pipelined_gather_exchange.recv(procid, pipelined_buffer, 
+                                         try_to_recv)) {
+      foreach(const pos_gather_pair_type& pair, pipelined_buffer) {
+        const lvid_type lvid = comm_plan.lvid(procid, pair.first);
+        ASSERT_TRUE(graph.l_is_master(lvid));
+        combine_gather(lvid, pair.second);
+        if(gather_arrived(lvid) && completed != NULL) {
+          completed->push_back(lvid);
         }
-        vlocks[lvid].unlock();
       }
     }
   } // end of recv_gather
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  combine_gather(lvid_type lvid, const gather_type& accum) {
+    vlocks[lvid].lock();
+    if( has_gather_accum.get(lvid) ) {
+      gather_accum[lvid] += accum;
+    } else {
+      gather_accum[lvid] = accum;
+      has_gather_accum.set_bit(lvid);
+    }
+    vlocks[lvid].unlock();
+  } // end of combine_gather
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  sync_empty_gather(lvid_type lvid, const size_t thread_id) {
+    ASSERT_FALSE(graph.l_is_master(lvid));
+    const procid_t master = graph.l_master(lvid);
+    const plan_position_type pos = comm_plan.master_position(lvid);
+    empty_gather_exchange.send(master, pos, thread_id);
+  } // end of sync_empty_gather
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  recv_empty_gathers(const bool try_to_recv, 
+                     std::vector<lvid_type>* completed) {
+    procid_t procid(-1);
+    typename empty_gather_exchange_type::buffer_type buffer;
+    while(empty_gather_exchange.recv(procid, buffer, try_to_recv)) {
+      foreach(const plan_position_type& pos, buffer) {
+        const lvid_type lvid = comm_plan.lvid(procid, pos);
+        ASSERT_TRUE(graph.l_is_master(lvid));
+        if(gather_arrived(lvid) && completed != NULL) {
+          completed->push_back(lvid);
+        }
+      }
+    }
+  } // end of recv_empty_gathers
+
+
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::
+  gather_arrived(lvid_type lvid) {
+    // with sched_allv the mirrors of inactive masters gather as well
+    return pipelined_apply && active_superstep.get(lvid) &&
+      pending_gathers[lvid].dec() == 0;
+  } // end of gather_arrived
+
+
+  template<typename VertexProgram>
+  bool synchronous_engine<VertexProgram>::
+  claim_apply(lvid_type lvid) {
+    return pending_gathers[lvid].value == 0 &&
+      atomic_compare_and_swap(pending_gathers[lvid].value, 
+                              uint32_t(0), uint32_t(-1));
+  } // end of claim_apply
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   sync_message(lvid_type lvid, const size_t thread_id) {
     ASSERT_FALSE(graph.l_is_master(lvid));
     const procid_t master = graph.l_master(lvid);
-    const vertex_id_type vid = graph.global_vid(lvid);
-    message_exchange.send(master, std::make_pair(vid, messages[lvid]), thread_id);
+    message_exchange.mark(master, comm_plan.master_position(lvid));
   } // end of send_message
 
 
@@ -1870,17 +3343,11 @@ namespace graphlab {
     procid_t procid(-1);
     typename message_exchange_type::buffer_type buffer;
     while(message_exchange.recv(procid, buffer, try_to_recv)) {
-      foreach(const vid_message_pair_type& pair, buffer) {
-        const lvid_type lvid = graph.local_vid(pair.first);
+      // the positions walk the plan of the sender in order
+      for (size_t i = 0; i < buffer.positions.size(); ++i) {
+        const lvid_type lvid = comm_plan.lvid(procid, buffer.positions[i]);
         ASSERT_TRUE(graph.l_is_master(lvid));
-        vlocks[lvid].lock();
-        if( has_message.get(lvid) ) {
-          messages[lvid] += pair.second;
-        } else {
-          messages[lvid] = pair.second;
-          has_message.set_bit(lvid);
-        }
-        vlocks[lvid].unlock();
+        combine_message(lvid, buffer.values[i]);
       }
     }
   } // end of recv_messages
@@ -33,6 +33,7 @@
 #include <boost/spirit/include/phoenix_stl.hpp>
 
 
+#include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/util/stl_util.hpp>
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
@@ -43,6 +44,20 @@
 namespace graphlab {
 
   namespace builtin_parsers {
+
+    /**
+     * \internal
+     * Returns true if the parsed id fits in vertex_id_type and is not the
+     * reserved id (vertex_id_type)(-1). Otherwise an error is logged: the
+     * id would be silently truncated by add_edge().
+     */
+    inline bool check_vid(size_t vid) {
+      if (vid < size_t(vertex_id_type(-1))) return true;
+      logstream(LOG_ERROR) << "Vertex id " << vid << " does not fit in a "
+                           << 8 * sizeof(vertex_id_type) << " bit vertex_id_type."
+                           << " Rebuild with ./configure --vid64." << std::endl;
+      return false;
+    }
   
     /**
      * \brief Parse files in the Stanford Network Analysis Package format.
@@ -68,6 +83,7 @@ namespace graphlab {
         source = strtoul(str.c_str(), &targetptr, 10);
         if (targetptr == NULL) return false;
         target = strtoul(targetptr, NULL, 10);
+        if (!check_vid(source) || !check_vid(target)) return false;
         if(source != target) graph.add_edge(source, target);
       }
       return true;
@@ -88,6 +104,7 @@ namespace graphlab {
       source = strtoul(str.c_str(), &targetptr, 10);
       if (targetptr == NULL) return false;
       target = strtoul(targetptr, NULL, 10);
+      if (!check_vid(source) || !check_vid(target)) return false;
       if(source != target) graph.add_edge(source, target);
       return true;
     } // end of tsv parser
@@ -102,9 +119,11 @@ namespace graphlab {
       namespace qi = boost::spirit::qi;
       namespace ascii = boost::spirit::ascii;
       namespace phoenix = boost::phoenix;
-      vertex_id_type source(-1);
-      vertex_id_type ntargets(-1);
-      std::vector<vertex_id_type> targets;
+      // parse into size_t so that ids too large for vertex_id_type
+      // are detected rather than truncated
+      size_t source(-1);
+      size_t ntargets(-1);
+      std::vector<size_t> targets;
       const bool success = qi::phrase_parse
         (line.begin(), line.end(),       
          //  Begin grammar
@@ -121,6 +140,10 @@ namespace graphlab {
         logstream(LOG_ERROR) << "Parse error in vertex prior parser." << std::endl;
         return false;
       }
+      if (!check_vid(source)) return false;
+      for(size_t i = 0; i < targets.size(); ++i) {
+        if (!check_vid(targets[i])) return false;
+      }
       for(size_t i = 0; i < targets.size(); ++i) {
         if(source != targets[i]) graph.add_edge(source, targets[i]);
       }
@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_GRAPH_COMMUNICATION_PLAN_HPP
+#define GRAPHLAB_GRAPH_COMMUNICATION_PLAN_HPP
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/macros_def.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief Positional addressing of the vertices replicated between
+   * this machine and each of its peers.
+   *
+   * For every peer the plan lists, ordered by global vertex id, the
+   * local vertices which have a master on one of the two machines and
+   * a mirror on the other. Both machines derive the same order from
+   * their own replica information (the master from its mirror set, the
+   * mirror from the owner of the vertex), so no communication is
+   * needed to build the plans.
+   *
+   * A master to mirror (or mirror to master) update can then be
+   * addressed by its position in the plan shared with the receiver,
+   * which the receiver resolves with an array lookup instead of a
+   * hash lookup of the global vertex id.
+   *
+   * The plan must be rebuilt if the graph is changed.
+   */
+  class communication_plan {
+  public:
+    /// The type of a position within the plan of a peer
+    typedef uint32_t position_type;
+
+    communication_plan() { }
+
+    /**
+     * \brief Builds the plans for a finalized distributed graph.
+     */
+    template <typename Graph>
+    void build(const Graph& graph) {
+      const size_t nverts = graph.num_local_vertices();
+      const procid_t procid = graph.procid();
+      // each master has a position for each of its mirrors and each
+      // mirror has a position in the plan of its master
+      offsets.resize(nverts + 1);
+      offsets[0] = 0;
+      for (lvid_type lvid = 0; lvid < nverts; ++lvid) {
+        const size_t npos = graph.l_master(lvid) == procid ? 
+          graph.l_get_vertex_record(lvid).num_mirrors() : 1;
+        offsets[lvid + 1] = offsets[lvid] + npos;
+      }
+      positions.resize(offsets[nverts]);
+
+      // collect the shared vertices of each peer
+      typedef std::pair<vertex_id_type, lvid_type> vid_lvid_pair_type;
+      std::vector<std::vector<vid_lvid_pair_type> > shared(graph.numprocs());
+      for (lvid_type lvid = 0; lvid < nverts; ++lvid) {
+        const vertex_id_type vid = graph.global_vid(lvid);
+        const procid_t master = graph.l_master(lvid);
+        if (master == procid) {
+          foreach(uint32_t mirror, 
+                  graph.l_get_vertex_record(lvid).mirrors()) {
+            shared[mirror].push_back(std::make_pair(vid, lvid));
+          }
+        } else {
+          shared[master].push_back(std::make_pair(vid, lvid));
+        }
+      }
+
+      // Order each plan by global vertex id. Peers are visited in
+      // increasing order which matches the order of the mirror set so
+      // the i-th position of a master belongs to its i-th mirror.
+      std::vector<uint32_t> filled(nverts, 0);
+      plans.resize(graph.numprocs());
+      for (procid_t peer = 0; peer < shared.size(); ++peer) {
+        std::sort(shared[peer].begin(), shared[peer].end());
+        plans[peer].resize(shared[peer].size());
+        for (size_t i = 0; i < shared[peer].size(); ++i) {
+          const lvid_type lvid = shared[peer][i].second;
+          plans[peer][i] = lvid;
+          positions[offsets[lvid] + filled[lvid]] = position_type(i);
+          ++filled[lvid];
+        }
+        std::vector<vid_lvid_pair_type>().swap(shared[peer]);
+      }
+    } // end of build
+
+    /**
+     * \brief Returns the local vertex at a position of the plan shared
+     * with a peer.
+     */
+    inline lvid_type lvid(procid_t peer, position_type pos) const {
+      return plans[peer][pos];
+    }
+
+    /**
+     * \brief Returns the position of a mirror in the plan shared with
+     * its master.
+     */
+    inline position_type master_position(lvid_type lvid) const {
+      return positions[offsets[lvid]];
+    }
+
+    /**
+     * \brief Returns the position of a master in the plan shared with
+     * its i-th mirror (in increasing order of procid).
+     */
+    inline position_type mirror_position(lvid_type lvid, size_t i) const {
+      return positions[offsets[lvid] + i];
+    }
+
+    /**
+     * \brief Returns the number of vertices shared with a peer.
+     */
+    inline size_t plan_size(procid_t peer) const {
+      return plans[peer].size();
+    }
+
+  private:
+    /// The local vertices shared with each peer, ordered by global id
+    std::vector<std::vector<lvid_type> > plans;
+    /// The first entry of each local vertex in positions
+    std::vector<size_t> offsets;
+    /// The positions of each local vertex in the plans of its peers
+    std::vector<position_type> positions;
+  }; // end of communication_plan
+
+} // namespace graphlab
+
+#include <graphlab/macros_undef.hpp>
+
+#endif
@@ -35,6 +35,7 @@
 #include <set>
 #include <map>
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/procid_set.hpp>
 
 
 #include <queue>
@@ -44,6 +45,7 @@
 #include <sstream>
 
 #include <boost/functional.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
@@ -87,6 +89,7 @@
 #include <graphlab/graph/builtin_parsers.hpp>
 #include <graphlab/graph/json_parser.hpp>
 #include <graphlab/graph/vertex_set.hpp>
+#include <graphlab/graph/rmat_generator.hpp>
 
 #include <graphlab/macros_def.hpp>
 namespace graphlab { 
@@ -361,7 +364,7 @@ namespace graphlab {
                                  const std::string&)> line_parser_type;
 
 
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> mirror_type;
+    typedef procid_set mirror_type;
 
     /// The type of the local graph used to store the graph data 
     typedef graphlab::local_graph<VertexData, EdgeData> local_graph_type;
@@ -2032,6 +2035,151 @@ namespace graphlab {
     } // end of load random powerlaw
 
 
+    /**
+     * \brief Constructs a synthetic R-MAT (Kronecker) graph. Must be
+     * called on all machines simultaneously.
+     *
+     * Generates edge_factor * 2^scale directed edges between 2^scale
+     * vertices with the \ref rmat_generator, using the quadrant
+     * probabilities a, b and c. The defaults are the Graph500
+     * parameters. Self edges and duplicate edges are dropped, so the
+     * graph has somewhat fewer edges than were generated, and vertices
+     * without edges are not created.
+     *
+     * Every machine generates an equal share of the edges on all its
+     * cores. The edges are then sent to the machine chosen by a hash of
+     * their endpoints, which removes the duplicates and adds the edges
+     * from all its cores through the per thread ingress buffers. The
+     * resulting graph only depends on the parameters and the seed, and
+     * in particular not on the number of machines or threads.
+     *
+     * \param scale The log2 of the number of vertices
+     * \param edge_factor The number of edges generated per vertex.
+     *                    Defaults to 16.
+     * \param seed The seed of the graph. Defaults to 1.
+     * \param a,b,c The probabilities of the top left, top right and
+     *              bottom left quadrants. The bottom right quadrant has
+     *              probability 1 - a - b - c.
+     */
+    void load_synthetic_rmat(size_t scale, size_t edge_factor = 16,
+                             size_t seed = 1, double a = 0.57,
+                             double b = 0.19, double c = 0.19) {
+      load_synthetic_rmat(scale, edge_factor, seed, a, b, c,
+                          unweighted_edge_data());
+    } // end of load synthetic rmat
+
+
+    /**
+     * \brief Constructs a weighted synthetic R-MAT graph. Must be called
+     * on all machines simultaneously.
+     *
+     * Behaves like load_synthetic_rmat() above, except that the data of
+     * each edge is given by <code>edge_data(weight)</code>, where weight
+     * is uniform in [0, 1) and only depends on the seed and the
+     * endpoints of the edge. \c edge_data is called concurrently from
+     * several threads.
+     */
+    template<typename EdgeDataFunction>
+    void load_synthetic_rmat(size_t scale, size_t edge_factor, size_t seed,
+                             double a, double b, double c,
+                             EdgeDataFunction edge_data) {
+      typedef std::pair<vertex_id_type, vertex_id_type> edge_pair_type;
+      if(finalized) {
+        logstream(LOG_FATAL) 
+          << "\n\tAttempting to add edges to a finalized graph."
+          << std::endl; 
+      }
+      ASSERT_LT(scale, 8 * sizeof(vertex_id_type));
+      ASSERT_NE(ingress_ptr, NULL);
+      rpc.full_barrier();
+      const rmat_generator generator(scale, seed, a, b, c);
+      const uint64_t nedges = uint64_t(edge_factor) << scale;
+      const uint64_t begin = nedges / rpc.numprocs() * rpc.procid() +
+        std::min<uint64_t>(rpc.procid(), nedges % rpc.numprocs());
+      const uint64_t end = begin + nedges / rpc.numprocs() +
+        (rpc.procid() < nedges % rpc.numprocs());
+#ifdef _OPENMP
+      const size_t nthreads = omp_get_max_threads();
+#else
+      const size_t nthreads = 1;
+#endif
+      boost::hash<edge_pair_type> hash_function;
+      buffered_exchange<edge_pair_type> edge_exchange(rpc.dc(), nthreads);
+
+      logstream(LOG_INFO) << "Generating R-MAT edges" << std::endl;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ptrdiff_t i = begin; i < ptrdiff_t(end); ++i) {
+#ifdef _OPENMP
+        const size_t thread_id = omp_get_thread_num();
+#else
+        const size_t thread_id = 0;
+#endif
+        const std::pair<uint64_t, uint64_t> edge = generator.edge(i);
+        if (edge.first == edge.second) continue;
+        const edge_pair_type pair(edge.first, edge.second);
+        edge_exchange.send(hash_function(pair) % rpc.numprocs(), pair,
+                           thread_id);
+      }
+      edge_exchange.flush();
+
+      // Split the received edges into one bucket per thread by hash, so
+      // that all the copies of an edge end up in the same bucket
+      std::vector<std::vector<edge_pair_type> > received;
+      procid_t sending_proc;
+      std::vector<edge_pair_type> buffer;
+      while (edge_exchange.recv(sending_proc, buffer)) {
+        received.push_back(std::vector<edge_pair_type>());
+        received.back().swap(buffer);
+      }
+      std::vector<std::vector<edge_pair_type> > buckets(nthreads * nthreads);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ptrdiff_t i = 0; i < ptrdiff_t(received.size()); ++i) {
+#ifdef _OPENMP
+        const size_t thread_id = omp_get_thread_num();
+#else
+        const size_t thread_id = 0;
+#endif
+        foreach(const edge_pair_type& pair, received[i]) {
+          const size_t bucket =
+            hash_function(pair) / rpc.numprocs() % nthreads;
+          buckets[thread_id * nthreads + bucket].push_back(pair);
+        }
+        std::vector<edge_pair_type>().swap(received[i]);
+      }
+
+      logstream(LOG_INFO) << "Adding R-MAT edges" << std::endl;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ptrdiff_t bucket = 0; bucket < ptrdiff_t(nthreads); ++bucket) {
+#ifdef _OPENMP
+        const size_t thread_id = omp_get_thread_num();
+#else
+        const size_t thread_id = 0;
+#endif
+        std::vector<edge_pair_type> edges;
+        for (size_t t = 0; t < nthreads; ++t) {
+          std::vector<edge_pair_type>& part = buckets[t * nthreads + bucket];
+          edges.insert(edges.end(), part.begin(), part.end());
+          std::vector<edge_pair_type>().swap(part);
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        foreach(const edge_pair_type& edge, edges) {
+          ingress_ptr->add_edge(edge.first, edge.second,
+                                edge_data(generator.weight(edge.first,
+                                                           edge.second)),
+                                thread_id);
+        }
+      }
+      rpc.full_barrier();
+    } // end of load synthetic rmat
+
+
     /**
      *  \brief load a graph with a standard format. Must be called on all 
      *  machines simultaneously.
@@ -2496,6 +2644,47 @@ namespace graphlab {
     } // end of synchronize
 
 
+    /** \internal
+     * This function combines the vertex data of every mirror into the
+     * master by calling combine(master_vertex, mirror_data) once for
+     * each mirror, where master_vertex is the vertex_type of the master.
+     * The mirrors are not changed; synchronize() copies the combined
+     * master data back to the mirrors.
+     * This function must be called simultaneously by all machines
+     */
+    template <typename CombineFunction>
+    void synchronize_mirrors_to_master(CombineFunction combine) {
+      typedef std::pair<vertex_id_type, vertex_data_type> pair_type;
+      typename buffered_exchange<pair_type>::buffer_type recv_buffer;
+      procid_t sending_proc;
+      for(lvid_type lvid = 0; lvid < lvid2record.size(); ++lvid) {
+        const vertex_record& record = lvid2record[lvid];
+        // if this machine is a mirror of a record then send the
+        // vertex data to the owner
+        if(record.owner != rpc.procid()) {
+          const pair_type pair(record.gvid, local_graph.vertex_data(lvid));
+          vertex_exchange.send(record.owner, pair);
+        }
+        while(vertex_exchange.recv(sending_proc, recv_buffer)) {
+          foreach(const pair_type& pair, recv_buffer)  {
+            vertex_type vtx(vertex(pair.first));
+            combine(vtx, pair.second);
+          }
+          recv_buffer.clear();
+        }
+      }
+      vertex_exchange.flush();
+      while(vertex_exchange.recv(sending_proc, recv_buffer)) {
+        foreach(const pair_type& pair, recv_buffer) {
+          vertex_type vtx(vertex(pair.first));
+          combine(vtx, pair.second);
+        }
+        recv_buffer.clear();
+      }
+      ASSERT_TRUE(vertex_exchange.empty());
+    } // end of synchronize_mirrors_to_master
+
+
 
 
 
@@ -2729,6 +2918,11 @@ namespace graphlab {
     
 
   private:
+
+    /** The edge data of load_synthetic_rmat() without weights */
+    struct unweighted_edge_data {
+      EdgeData operator()(double weight) const { return EdgeData(); }
+    };
       
     // PRIVATE DATA MEMBERS ===================================================> 
     /** The rpc interface for this class */
@@ -2841,8 +3035,11 @@ namespace graphlab {
 
     void save_bintsv4_to_stream(std::ostream& out) {
       for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
+        // bintsv4 stores 32 bit ids. (uint32_t)(-1) marks a lone vertex.
+        ASSERT_LT(l_vertex(i).global_id(), vertex_id_type(uint32_t(-1)));
         uint32_t src = l_vertex(i).global_id();
         foreach(local_edge_type e, l_vertex(i).out_edges()) {
+          ASSERT_LT(e.target().global_id(), vertex_id_type(uint32_t(-1)));
           uint32_t dest = e.target().global_id();
           out.write(reinterpret_cast<char*>(&src), 4);
           out.write(reinterpret_cast<char*>(&dest), 4);
@@ -27,10 +27,25 @@
 #include <stdint.h>
 
 namespace graphlab {
+#ifdef USE_VID64
+  /**
+   * Identifier type of a vertex which is globally consistent. Guaranteed
+   * to be integral. 64 bits wide since GraphLab was built with VID64
+   * (./configure --vid64), which defines USE_VID64. Code compiled
+   * against this build must define USE_VID64 as well.
+   */
+  typedef uint64_t vertex_id_type;
+#else
   /// Identifier type of a vertex which is globally consistent. Guaranteed to be integral
   typedef uint32_t vertex_id_type;
+#endif
   
-  /// Identifier type of a vertex which is only locally consistent. Guaranteed to be integral
+  /**
+   * Identifier type of a vertex which is only locally
+   * consistent. Guaranteed to be integral. This remains 32 bits wide
+   * even when vertex_id_type is 64 bits, so a single machine may hold
+   * at most 2^32 - 1 local vertices.
+   */
   typedef uint32_t lvid_type;
   
   /**
@@ -243,7 +243,8 @@ namespace graphlab {
       dht_degree_table_lock.readlock();
       foreach (vertex_id_type& vid, whohas) {
         size_t idx = vid_to_dht_entry_with_readlock(vid);
-        dht_degree_table[idx].set_bit_unsync(pid);
+        // entries are updated concurrently under the readlock
+        dht_degree_table[idx].set_bit(pid);
       }
       dht_degree_table_lock.unlock();
       END_TRACEPOINT(batch_ingress_update_degree_table);
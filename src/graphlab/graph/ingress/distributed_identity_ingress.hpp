@@ -62,10 +62,17 @@ namespace graphlab {
     /** Add an edge to the ingress object and assign the edge to itself. */
     void add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata) {
+      add_edge(source, target, edata, 0);
+    } // end of add edge
+
+    /** Add an edge using the send buffers of an ingress thread. */
+    void add_edge(vertex_id_type source, vertex_id_type target,
+                  const EdgeData& edata, size_t thread_id) {
       typedef typename base_type::edge_buffer_record edge_buffer_record;
       const procid_t owning_proc = base_type::rpc.procid();
       const edge_buffer_record record(source, target, edata);
-      base_type::edge_exchange.send(owning_proc, record);
+      base_type::edge_exchange.send(owning_proc, record,
+                                    thread_id % base_type::num_edge_threads);
     } // end of add edge
   }; // end of distributed_identity_ingress
 }; // end of namespace graphlab
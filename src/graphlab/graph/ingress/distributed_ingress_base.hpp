@@ -84,6 +84,8 @@ namespace graphlab {
       void load(iarchive& arc) { arc >> source >> target >> edata; }
       void save(oarchive& arc) const { arc << source << target << edata; }
     };
+    /// The number of ingress threads with their own edge send buffers
+    const size_t num_edge_threads;
     buffered_exchange<edge_buffer_record> edge_exchange;
 
    
@@ -117,7 +119,9 @@ namespace graphlab {
 
   public:
     distributed_ingress_base(distributed_control& dc, graph_type& graph) :
-      rpc(dc, this), graph(graph), vertex_exchange(dc), edge_exchange(dc),
+      rpc(dc, this), graph(graph), vertex_exchange(dc),
+      num_edge_threads(thread::cpu_count()),
+      edge_exchange(dc, num_edge_threads),
       edge_decision(dc) {
       rpc.barrier();
     } // end of constructor
@@ -189,6 +193,11 @@ namespace graphlab {
       logstream(LOG_INFO) << "Graph Finalize: constructing local graph" << std::endl;
       { // Add all the edges to the local graph
         const size_t nedges = edge_exchange.size()+1;
+        // local vertex and edge ids are 32 bit even with 64 bit
+        // global vertex ids
+        ASSERT_MSG(nedges < size_t(edge_id_type(-1)),
+                   "Too many edges on one machine for a 32 bit edge_id_type. "
+                   "Use more machines.");
         graph.local_graph.reserve_edge_space(nedges + 1);      
         edge_buffer_type edge_buffer;
         procid_t proc;
@@ -208,6 +217,7 @@ namespace graphlab {
               graph.vid2lvid[rec.target] = target_lvid;
               // graph.local_graph.resize(target_lvid + 1);
             } else target_lvid = graph.vid2lvid[rec.target];
+            ASSERT_LT(graph.vid2lvid.size(), size_t(lvid_type(-1)));
             graph.local_graph.add_edge(source_lvid, target_lvid, rec.edata);
           } // end of loop over add edges
         } // end for loop over buffers
@@ -63,10 +63,17 @@ namespace graphlab {
     /** Add an edge to the ingress object using random assignment. */
     void add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata) {
+      add_edge(source, target, edata, 0);
+    } // end of add edge
+
+    /** Add an edge using the send buffers of an ingress thread. */
+    void add_edge(vertex_id_type source, vertex_id_type target,
+                  const EdgeData& edata, size_t thread_id) {
       typedef typename base_type::edge_buffer_record edge_buffer_record;
       const procid_t owning_proc = edge_to_proc (source, target);
       const edge_buffer_record record(source, target, edata);
-      base_type::edge_exchange.send(owning_proc, record);
+      base_type::edge_exchange.send(owning_proc, record,
+                                    thread_id % base_type::num_edge_threads);
     } // end of add edge
 
     /** Helper funtion that computes a random assignment of an edge. */ 
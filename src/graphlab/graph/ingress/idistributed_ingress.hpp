@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
 
 
 namespace graphlab {
@@ -44,6 +45,18 @@ namespace graphlab {
      */
     virtual void add_edge(vertex_id_type source, vertex_id_type target,
                           const EdgeData& edata) = 0;
+    /**
+     * Add an edge to the ingress object from one of several ingress
+     * threads numbered from 0. Ingress methods which keep a send buffer
+     * per thread use the buffers of the given thread; the others
+     * serialize the calls.
+     */
+    virtual void add_edge(vertex_id_type source, vertex_id_type target,
+                          const EdgeData& edata, size_t thread_id) {
+      add_edge_lock.lock();
+      add_edge(source, target, edata);
+      add_edge_lock.unlock();
+    }
     /**
      * Add an vertex to the ingress object.
      */
@@ -62,6 +75,8 @@ namespace graphlab {
      * */
     virtual void exchange_global_info() = 0;
 
+  private:
+    mutex add_edge_lock;
   }; // end of idstributed_ingress
 
 }; // end of namespace graphlab
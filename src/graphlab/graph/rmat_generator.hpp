@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_GRAPH_RMAT_GENERATOR_HPP
+#define GRAPHLAB_GRAPH_RMAT_GENERATOR_HPP
+
+#include <utility>
+#include <stdint.h>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief A counter based R-MAT (Kronecker) edge generator.
+   *
+   * Edge \c i of a graph with 2^scale vertices is chosen by descending
+   * \c scale levels of the recursive adjacency matrix, picking the top
+   * left, top right, bottom left or bottom right quadrant with
+   * probability a, b, c and 1 - a - b - c. The defaults are the Graph500
+   * parameters. The vertex ids are then scrambled by a seeded bijection
+   * of [0, 2^scale) so that the high degree vertices are not clustered
+   * at the low ids.
+   *
+   * The random numbers of edge \c i are drawn from a stream derived from
+   * the seed and \c i alone. Any range of edges can therefore be
+   * generated by any thread of any machine and the resulting graph only
+   * depends on the seed and the parameters, not on how the edge range
+   * was partitioned.
+   */
+  class rmat_generator {
+  public:
+    /**
+     * \param scale The log2 of the number of vertices
+     * \param seed The seed of the generated graph
+     * \param a,b,c The quadrant probabilities
+     */
+    rmat_generator(size_t scale, uint64_t seed = 1,
+                   double a = 0.57, double b = 0.19, double c = 0.19) :
+      scale(scale), a(threshold(a)), ab(threshold(a + b)),
+      abc(threshold(a + b + c)),
+      mask((uint64_t(1) << scale) - 1),
+      key(mix(seed)) {
+      ASSERT_GT(scale, 0);
+      ASSERT_LT(scale, 64);
+      ASSERT_GE(a, 0); ASSERT_GE(b, 0); ASSERT_GE(c, 0);
+      ASSERT_LE(a + b + c, 1.0);
+    }
+
+    /// The number of vertices, 2^scale
+    uint64_t num_vertices() const { return mask + 1; }
+
+    /**
+     * Returns the source and target of edge i. Self edges and duplicate
+     * edges are possible and are left to the caller.
+     */
+    std::pair<uint64_t, uint64_t> edge(uint64_t i) const {
+      uint64_t state = mix(key ^ mix(i));
+      uint64_t source = 0, target = 0;
+      uint64_t bits = 0;
+      for (size_t level = 0; level < scale; ++level) {
+        if (level % LEVELS_PER_DRAW == 0) {
+          state += 0x9e3779b97f4a7c15ULL;
+          bits = mix(state);
+        }
+        const uint64_t r = bits & LEVEL_MASK;
+        bits >>= LEVEL_BITS;
+        // the quadrant 0 to 3 is the pair of source and target bits
+        const uint64_t quadrant = (r >= a) + (r >= ab) + (r >= abc);
+        source = (source << 1) | (quadrant >> 1);
+        target = (target << 1) | (quadrant & 1);
+      }
+      return std::make_pair(scramble(source), scramble(target));
+    }
+
+    /**
+     * Returns a weight uniform in [0, 1) which only depends on the seed
+     * and the endpoints of the edge, so that duplicates of an edge get
+     * the same weight.
+     */
+    double weight(uint64_t source, uint64_t target) const {
+      uint64_t state = mix(key ^ mix(source ^ mix(target)));
+      return uniform(state);
+    }
+
+  private:
+    /**
+     * Every level is decided by LEVEL_BITS random bits, so that three
+     * levels are drawn from one 64 bit random number. The quadrant
+     * probabilities are rounded to multiples of 2^-LEVEL_BITS.
+     */
+    static const size_t LEVEL_BITS = 21;
+    static const size_t LEVELS_PER_DRAW = 64 / LEVEL_BITS;
+    static const uint64_t LEVEL_MASK = (uint64_t(1) << LEVEL_BITS) - 1;
+
+    size_t scale;
+    /// The cumulative quadrant probabilities scaled to LEVEL_BITS bits
+    uint64_t a, ab, abc;
+    uint64_t mask;
+    uint64_t key;
+
+    static uint64_t threshold(double p) {
+      return uint64_t(p * (LEVEL_MASK + 1) + 0.5);
+    }
+
+    /// The splitmix64 finalizer
+    static uint64_t mix(uint64_t x) {
+      x += 0x9e3779b97f4a7c15ULL;
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+    }
+
+    /// Advances the splitmix64 stream and returns a double in [0, 1)
+    static double uniform(uint64_t& state) {
+      state += 0x9e3779b97f4a7c15ULL;
+      return (mix(state) >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * A bijection of [0, 2^scale): xor with a key, multiplication by an
+     * odd constant and xor with the high half are all invertible modulo
+     * 2^scale.
+     */
+    uint64_t scramble(uint64_t v) const {
+      const size_t shift = (scale + 1) / 2;
+      v = (v ^ key) & mask;
+      v = (v * 0xbf58476d1ce4e5b9ULL) & mask;
+      v ^= v >> shift;
+      v = (v * 0x94d049bb133111ebULL) & mask;
+      v ^= v >> shift;
+      return (v ^ (key >> 32)) & mask;
+    }
+  }; // end of rmat_generator
+
+} // end of namespace graphlab
+
+#endif
@@ -222,6 +222,9 @@ class vertex_set {
     template <typename VertexType, typename EdgeType>
     friend class distributed_graph;
 
+    template <typename VertexProgram>
+    friend class synchronous_engine;
+
   public:
     /// default constructor which constructs an empty set.
     vertex_set():is_complete_set(false), lazy(true){}
@@ -25,6 +25,12 @@
 #define GRAPHLAB_ATOMIC_OPS_HPP
 
 #include <stdint.h>
+#include <cstring>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+#include <graphlab/util/integer_selector.hpp>
 
 
 namespace graphlab {
@@ -112,6 +118,47 @@ namespace graphlab {
     return __sync_bool_compare_and_swap(a_ptr, *oldval_ptr, *newval_ptr);
   };
 
+  /**
+   * \ingroup util
+   * \brief True if T can be combined in place by \ref atomic_combine:
+   * T must be trivially copy constructible and destructible, and
+   * exactly 1, 2, 4 or 8 bytes wide.
+   */
+  template<typename T>
+  struct atomic_combine_supported : 
+    public boost::integral_constant<bool,
+      boost::has_trivial_copy<T>::value &&
+      boost::has_trivial_destructor<T>::value &&
+      (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || 
+       sizeof(T) == 8)> { };
+
+  /**
+   * \ingroup util
+   * \brief Atomically performs a += b.
+   *
+   * The combination is computed on a private copy of a and published
+   * with a compare-and-swap on its bit representation, retrying until
+   * no other thread has modified a in between. Any commutative and
+   * associative operator+= may be used (a sum, a minimum, ...); a must
+   * already hold a valid value since it is never reset to an identity.
+   * T must satisfy \ref atomic_combine_supported, which is checked at
+   * compile time.
+   */
+  template<typename T>
+  void atomic_combine(T& a, const T& b) {
+    BOOST_STATIC_ASSERT(atomic_combine_supported<T>::value);
+    typedef typename u_integer_selector<sizeof(T)>::integer_type int_type;
+    volatile int_type* a_ptr = reinterpret_cast<volatile int_type*>(&a);
+    int_type oldbits, newbits;
+    T newval;
+    do {
+      oldbits = *a_ptr;
+      memcpy(&newval, &oldbits, sizeof(T));
+      newval += b;
+      memcpy(&newbits, &newval, sizeof(T));
+    } while(!__sync_bool_compare_and_swap(a_ptr, oldbits, newbits));
+  };
+
   /** 
     * \ingroup util
     * \brief Atomically exchanges the values of a and b.
@@ -172,6 +172,34 @@ namespace graphlab {
     return 0;
 #endif
   } // end of cpu count
+
+  scoped_cpu_affinity::scoped_cpu_affinity(size_t cpu_id) : bound(false) {
+#if defined __linux__
+    if (pthread_getaffinity_np(pthread_self(), sizeof(saved_mask), 
+                               &saved_mask) != 0) return;
+    // pick among the processors the thread may currently run on
+    const int nallowed = CPU_COUNT(&saved_mask);
+    if (nallowed == 0) return;
+    int skip = int(cpu_id % nallowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (!CPU_ISSET(cpu, &saved_mask) || skip-- > 0) continue;
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(cpu, &cpu_set);
+      bound = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), 
+                                     &cpu_set) == 0;
+      break;
+    }
+#endif
+  } // end of scoped_cpu_affinity
+
+  scoped_cpu_affinity::~scoped_cpu_affinity() {
+#if defined __linux__
+    if (bound) {
+      pthread_setaffinity_np(pthread_self(), sizeof(saved_mask), &saved_mask);
+    }
+#endif
+  } // end of ~scoped_cpu_affinity
     
    /**
      * Allow defining a callback when thread is destroyed.
@@ -879,6 +879,35 @@ namespace graphlab {
     bool thread_started;
   }; // End of class thread
 
+
+  /**
+   * \ingroup util
+   * Binds the calling thread to one processing unit for the lifetime
+   * of the object and restores the previous affinity mask of the
+   * thread when destroyed.  Must be destroyed by the thread which
+   * created it.  Does nothing on systems without CPU affinity support.
+   */
+  class scoped_cpu_affinity {
+  public:
+    /**
+     * Binds the calling thread to the cpu_id-th (modulo their number)
+     * of the processors it is currently allowed to run on.
+     */
+    explicit scoped_cpu_affinity(size_t cpu_id);
+
+    /// Restores the affinity mask saved by the constructor
+    ~scoped_cpu_affinity();
+
+  private:
+    bool bound;
+#if defined __linux__
+    cpu_set_t saved_mask;
+#endif
+    // not copyable
+    scoped_cpu_affinity(const scoped_cpu_affinity&);
+    scoped_cpu_affinity& operator=(const scoped_cpu_affinity&);
+  }; // End of class scoped_cpu_affinity
+
   
 
 
@@ -24,10 +24,12 @@
 #ifndef GRAPHLAB_BUFFERED_EXCHANGE_HPP
 #define GRAPHLAB_BUFFERED_EXCHANGE_HPP
 
+#include <algorithm>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/event_trace.hpp>
 
 
 #include <graphlab/macros_def.hpp>
@@ -36,6 +38,12 @@ namespace graphlab {
   /**
    * \ingroup rpc
    * \internal
+   *
+   * Values sent to another machine are serialized straight into an RPC
+   * message, which is handed to the communication layer without a
+   * further copy once it is full. Values sent to this machine are kept
+   * as typed vectors which are moved to the receive queue without being
+   * serialized.
    */
   template<typename T>
   class buffered_exchange {
@@ -59,18 +67,45 @@ namespace graphlab {
 
 
     struct send_record {
-      send_record():buffer(128),numinserts(0){}
+      send_record():buffer(128),numinserts(0),count_offset(0){}
       // need a fake copy constructor here
       // just so I can make a vector of these
-      send_record(const send_record& ):buffer(128), numinserts(0) { }
+      send_record(const send_record& ):buffer(128), numinserts(0),
+                                       count_offset(0) { }
+      /// An rpc_recv call message. Empty if numinserts == 0
       charstream buffer;
       size_t numinserts;
+      /// Where the element count is stored in the message
+      size_t count_offset;
+      /// The values sent to this machine
+      buffer_type local_buffer;
+    };
+
+    /**
+     * The argument of rpc_recv. Reads the element count and the
+     * elements written by send() directly from the message.
+     */
+    struct recv_record {
+      buffer_type buffer;
+      void save(oarchive& oarc) const {
+        oarc << size_t(buffer.size());
+        for (size_t i = 0; i < buffer.size(); ++i) oarc << buffer[i];
+      }
+      void load(iarchive& iarc) {
+        size_t numel;
+        iarc >> numel;
+        buffer.resize(numel);
+        for (size_t i = 0; i < numel; ++i) iarc >> buffer[i];
+      }
     };
 
     std::vector<send_record> send_buffers;
     std::vector< mutex >  send_locks;
     const size_t num_threads;
     const size_t max_buffer_size;
+    /// The number of values sent to this machine which are buffered
+    /// before they are moved to the receive queue
+    const size_t max_local_buffer_size;
 
 
     // typedef boost::function<void (const T& tref)> handler_type;
@@ -84,10 +119,27 @@ namespace graphlab {
       send_buffers(num_threads *  dc.numprocs()), 
       send_locks(num_threads *  dc.numprocs()),
       num_threads(num_threads),
-      max_buffer_size(max_buffer_size) { 
+      max_buffer_size(scaled_buffer_size(max_buffer_size, dc.numprocs())),
+      max_local_buffer_size(max_buffer_size / sizeof(T) + 1) { 
        rpc.barrier(); 
       }
 
+    /**
+     * There is a send buffer per thread and machine. Beyond
+     * FULL_BUFFER_PROCS machines the size at which a buffer is sent is
+     * reduced proportionally (down to MIN_BUFFER_SIZE) so that the
+     * memory held in send buffers does not grow with the number of
+     * machines.
+     */
+    static size_t scaled_buffer_size(size_t max_buffer_size, 
+                                     size_t numprocs) {
+      const size_t FULL_BUFFER_PROCS = 64;
+      const size_t MIN_BUFFER_SIZE = 4096;
+      if (numprocs <= FULL_BUFFER_PROCS) return max_buffer_size;
+      return std::max(std::min(max_buffer_size, MIN_BUFFER_SIZE),
+                      max_buffer_size * FULL_BUFFER_PROCS / numprocs);
+    }
+
 
 
     ~buffered_exchange() { 
@@ -103,26 +155,19 @@ namespace graphlab {
       ASSERT_LT(thread_id, num_threads);
       const size_t index = thread_id * rpc.numprocs() + proc;
       ASSERT_LT(index, send_locks.size());
+      send_record& rec = send_buffers[index];
       send_locks[index].lock();
-
-      oarchive oarc(send_buffers[index].buffer);
-      ++send_buffers[index].numinserts;
-      oarc << value;
-      if(send_buffers[index].buffer->size() > max_buffer_size) {
-        send_buffers[index].buffer.flush();
-        graphlab::dc_impl::blob b(send_buffers[index].buffer->str, 
-                                  send_buffers[index].buffer->len);
-        if(proc == rpc.procid()) {
-          rpc_recv(proc, send_buffers[index].numinserts, b);
-          // here the blob is transimtted directly
-        } else {
-          rpc.remote_call(proc, &buffered_exchange::rpc_recv,
-                          rpc.procid(), send_buffers[index].numinserts, b);
-          // here I need to free the blob
-          b.free();
+      if(proc == rpc.procid()) {
+        rec.local_buffer.push_back(value);
+        if(rec.local_buffer.size() >= max_local_buffer_size) {
+          send_local_buffer(rec);
         }
-        send_buffers[index].buffer->relinquish();
-        send_buffers[index].numinserts = 0;
+      } else {
+        if(rec.numinserts == 0) begin_message(rec);
+        oarchive oarc(rec.buffer);
+        ++rec.numinserts;
+        oarc << value;
+        if(rec.buffer->size() > max_buffer_size) send_message(proc, rec);
       }
       send_locks[index].unlock();
     } // end of send
@@ -132,46 +177,22 @@ namespace graphlab {
       for(procid_t proc = 0; proc < rpc.numprocs(); ++proc) {
         const size_t index = thread_id * rpc.numprocs() + proc;
         ASSERT_LT(proc, rpc.numprocs());
-        if (send_buffers[index].buffer->len > 0) {
+        send_record& rec = send_buffers[index];
+        if (rec.numinserts > 0 || !rec.local_buffer.empty()) {
           send_locks[index].lock();
-          send_buffers[index].buffer.flush();
-          graphlab::dc_impl::blob b(send_buffers[index].buffer->str, 
-                                    send_buffers[index].buffer->len);
-          if(proc == rpc.procid()) {
-            rpc_recv(proc, send_buffers[index].numinserts, b);
-            // here the blob is transimtted directly
-          } else {
-            rpc.remote_call(proc, &buffered_exchange::rpc_recv,
-                rpc.procid(), send_buffers[index].numinserts, b);
-            // here I need to free the blob
-            b.free();
-          }
-          send_buffers[index].buffer->relinquish();
-          send_buffers[index].numinserts = 0;
+          flush_record(proc, rec);
           send_locks[index].unlock();
         }
       } 
     }
 
     void flush() {
+      TRACE_SCOPE("exchange_flush");
       for(size_t i = 0; i < send_buffers.size(); ++i) {
         const procid_t proc = i % rpc.numprocs();
         ASSERT_LT(proc, rpc.numprocs());
         send_locks[i].lock();
-        send_buffers[i].buffer.flush();
-        if (send_buffers[i].buffer->len > 0) {
-          graphlab::dc_impl::blob b(send_buffers[i].buffer->str, 
-                                    send_buffers[i].buffer->len);
-          if(proc == rpc.procid()) {
-            rpc_recv(proc, send_buffers[i].numinserts, b);
-          } else {
-            rpc.remote_call(proc, &buffered_exchange::rpc_recv,
-                            rpc.procid(),send_buffers[i].numinserts, b);
-            b.free();
-          }
-          send_buffers[i].buffer->relinquish();
-          send_buffers[i].numinserts = 0;
-        }
+        flush_record(proc, send_buffers[i]);
         send_locks[i].unlock();
       }
       rpc.full_barrier();
@@ -224,25 +245,59 @@ namespace graphlab {
 
     bool empty() const { return recv_buffers.empty(); }
 
+    /**
+     * Returns the number of bytes sent to machine proc. Values sent to
+     * this machine are not serialized and are not counted.
+     */
+    size_t bytes_sent(procid_t proc) const { return rpc.bytes_sent(proc); }
+
     void clear() {
     }
 
   private:
-    void rpc_recv(procid_t src_proc, size_t numel, dc_impl::blob& buffer) {
-      buffer_type tmp;
-      boost::iostreams::stream<boost::iostreams::array_source> strm(buffer.c, buffer.len);
-      iarchive iarc(strm);
-      tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
-      }
-      buffer.free();
- 
+    /// Starts an rpc_recv message in rec.buffer. Must hold the lock
+    void begin_message(send_record& rec) {
+      rpc.split_call_begin(rec.buffer, &buffered_exchange::rpc_recv);
+      // reserve room for the element count
+      rec.count_offset = rec.buffer->size();
+      oarchive oarc(rec.buffer);
+      oarc << size_t(0);
+    }
+
+    /**
+     * Fills in the element count and hands the message in rec.buffer
+     * to the communication layer. Must hold the lock.
+     */
+    void send_message(const procid_t proc, send_record& rec) {
+      rec.buffer.flush();
+      memcpy(rec.buffer->c_str() + rec.count_offset, 
+             &rec.numinserts, sizeof(size_t));
+      rpc.split_call_end(proc, rec.buffer);
+      rec.numinserts = 0;
+    }
+
+    /// Moves the local buffer to the receive queue. Must hold the lock
+    void send_local_buffer(send_record& rec) {
+      recv_lock.lock();
+      recv_buffers.push_back(buffer_record());
+      buffer_record& recv_rec = recv_buffers.back();
+      recv_rec.proc = rpc.procid();
+      recv_rec.buffer.swap(rec.local_buffer);
+      recv_lock.unlock();
+    }
+
+    /// Sends any values buffered in rec. Must hold the lock
+    void flush_record(const procid_t proc, send_record& rec) {
+      if (rec.numinserts > 0) send_message(proc, rec);
+      if (!rec.local_buffer.empty()) send_local_buffer(rec);
+    }
+
+    void rpc_recv(procid_t src_proc, recv_record& rec) {
       recv_lock.lock();
       recv_buffers.push_back(buffer_record());
-      buffer_record& rec = recv_buffers.back();
-      rec.proc = src_proc;
-      rec.buffer.swap(tmp);
+      buffer_record& recv_rec = recv_buffers.back();
+      recv_rec.proc = src_proc;
+      recv_rec.buffer.swap(rec.buffer);
       recv_lock.unlock();
     } // end of rpc rcv
 
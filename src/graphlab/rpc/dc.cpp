@@ -38,6 +38,7 @@
 #include <graphlab/util/stl_util.hpp>
 #include <graphlab/util/net_util.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/event_trace.hpp>
 
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_tcp_comm.hpp>
@@ -259,6 +260,7 @@ void distributed_control::deferred_function_call_chunk(char* buf, size_t len, pr
 
 
 void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
+  TRACE_SCOPE("rpc_receive");
   if (fcallblock.is_chunk == false) {
     for (size_t i = 0;i < fcallblock.calls.size(); ++i) {
       fcallqueue_length.dec();
@@ -42,6 +42,6 @@
   \def RPC_MAX_N_PROCS
   \brief Maximum number of processes supported 
  */ 
-#define RPC_MAX_N_PROCS 128
+#define RPC_MAX_N_PROCS 1024
 
 #endif
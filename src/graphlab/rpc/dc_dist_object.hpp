@@ -41,6 +41,7 @@
 #include <graphlab/util/charstream.hpp>
 #include <boost/preprocessor.hpp>
 #include <graphlab/util/tracepoint.hpp>
+#include <graphlab/util/event_trace.hpp>
 #include <graphlab/macros_def.hpp>
 
 #define BARRIER_BRANCH_FACTOR 128
@@ -275,6 +276,13 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
     }
     return ctr;
   }
+
+  /** \brief The number of bytes sent from this object to machine
+   * target, excluding headers and other control overhead.
+   */ 
+  size_t bytes_sent(procid_t target) const {
+    return bytessent[target].value;
+  }
   
   /// \brief A reference to the underlying distributed_control object
   distributed_control& dc() {
@@ -386,6 +394,51 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
   BOOST_PP_REPEAT(7, BROADCAST_INTERFACE_GENERATOR, (remote_call, dc_impl::object_broadcast_issue, STANDARD_CALL) )
   BOOST_PP_REPEAT(7, BROADCAST_INTERFACE_GENERATOR, (pod_call, dc_impl::object_podcall_broadcast_issue, STANDARD_CALL) )
 
+  /*
+  Split calls build the message for a call to
+  remote_function(procid_t source, U& arg) in a buffer owned by the caller,
+  which is then handed to the sender without being copied.
+  split_call_begin() writes the call header and the calling procid into
+  the empty stream strm. The caller then serializes a U into strm
+  (possibly over many writes) and finishes with split_call_end(), which
+  transfers the buffer to the communication layer and leaves strm empty.
+
+  \code
+    charstream strm(128);
+    rmi.split_call_begin(strm, &object_type::function_name);
+    oarchive oarc(strm);
+    oarc << arg;
+    rmi.split_call_end(target, strm);
+  \endcode
+  */
+  template <typename U>
+  void split_call_begin(charstream& strm,
+                        void (T::*remote_function)(procid_t, U&)) {
+    typedef void (T::*F)(procid_t, U&);
+    ASSERT_EQ(strm->size(), 0);
+    strm->advance(sizeof(dc_impl::packet_hdr));
+    oarchive arc(strm);
+    dc_impl::dispatch_type d =
+      dc_impl::OBJECT_NONINTRUSIVE_DISPATCH2<distributed_control,T,F,procid_t,U>;
+    arc << reinterpret_cast<size_t>(d);
+    serialize(arc, (char*)(&remote_function), sizeof(F));
+    arc << obj_id;
+    arc << procid();
+    strm.flush();
+  }
+
+  void split_call_end(procid_t target, charstream& strm) {
+    ASSERT_LT(target, dc_.senders.size());
+    BEGIN_TRACEPOINT(distobj_remote_call_time);
+    strm.flush();
+    inc_calls_sent(target);
+    const size_t len = strm->size();
+    dc_.senders[target]->send_data(target, STANDARD_CALL, strm->c_str(), len);
+    inc_bytes_sent(target, len);
+    strm->relinquish();
+    END_TRACEPOINT(distobj_remote_call_time);
+  }
+
   /*
   The generation procedure for requests are the same. The only
   difference is that the function name has to be changed a little to
@@ -1229,6 +1282,7 @@ private:
 
   /// \copydoc distributed_control::barrier()
   void barrier() {
+    TRACE_SCOPE("rpc_barrier");
     // upward message
     int barrier_val = barrier_sense;      
     barrier_mut.lock();
@@ -1298,6 +1352,7 @@ private:
   
   /// \copydoc distributed_control::full_barrier()
   void full_barrier() {
+    TRACE_SCOPE("rpc_full_barrier");
     // gather a sum of all the calls issued to machine 0
     std::vector<size_t> calls_sent_to_target(numprocs(), 0);
     for (size_t i = 0;i < numprocs(); ++i) {
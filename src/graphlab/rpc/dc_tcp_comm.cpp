@@ -31,11 +31,13 @@
 #include <netinet/tcp.h>
 #include <ifaddrs.h>
 #include <poll.h>
+#include <sys/resource.h>
 
 #include <event2/event.h>
 #include <event2/thread.h>
 
 #include <limits>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <map>
@@ -45,6 +47,7 @@
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/rpc/dc_tcp_comm.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
+#include <graphlab/util/event_trace.hpp>
 
 #define compile_barrier() asm volatile("": : :"memory")
 
@@ -72,6 +75,19 @@ namespace graphlab {
       portnums.resize(nprocs);
       assert(triggered_timeouts.size() >= nprocs);
       triggered_timeouts.clear();
+      { // each peer uses an incoming and an outgoing socket
+        const rlim_t required = 2 * rlim_t(nprocs) + 64;
+        struct rlimit rlim;
+        if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur < required) {
+          rlim.rlim_cur = std::min(required, rlim.rlim_max);
+          if (setrlimit(RLIMIT_NOFILE, &rlim) != 0 || 
+              rlim.rlim_cur < required) {
+            logstream(LOG_WARNING) 
+              << "Unable to raise the open file limit to " << required
+              << ". Connections to some machines may fail." << std::endl;
+          }
+        }
+      }
       // fill all the socks
       sock.resize(nprocs);
       for (size_t i = 0;i < nprocs; ++i) {
@@ -254,6 +270,7 @@ namespace graphlab {
 
     bool dc_tcp_comm::send_till_block(socket_info& sockinfo) {
       sockinfo.wouldblock = false;
+      TRACE_SCOPE("rpc_send");
       // while there is still data to be sent
       BEGIN_TRACEPOINT(tcp_send_call);
       while(!sockinfo.outvec.empty()) {
@@ -368,7 +385,8 @@ namespace graphlab {
       }
       logstream(LOG_INFO) << "Proc " << procid() 
                           << " listening on " << portnums[curid] << "\n";
-      ASSERT_EQ(0, listen(listensock, 128));
+      // all other machines may connect at once
+      ASSERT_EQ(0, listen(listensock, std::max<int>(128, nprocs)));
       // spawn a thread which loops around accept
       listenthread.launch(boost::bind(&dc_tcp_comm::accept_handler, this));
     } // end of open_listening
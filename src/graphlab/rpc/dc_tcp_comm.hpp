@@ -33,6 +33,7 @@
 
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
 #include <graphlab/rpc/dc_comm_base.hpp>
 #include <graphlab/rpc/circular_iovec_buffer.hpp>
@@ -245,7 +246,7 @@ class dc_tcp_comm:public dc_comm_base {
   timeout_event send_triggered_timeout;
   timeout_event send_all_timeout;
 
-  fixed_dense_bitset<256> triggered_timeouts;  
+  fixed_dense_bitset<RPC_MAX_N_PROCS> triggered_timeouts;  
   ////////////       Listening Sockets     //////////////////////
   int listensock;
   thread listenthread;
@@ -0,0 +1,276 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_PLAN_EXCHANGE_HPP
+#define GRAPHLAB_PLAN_EXCHANGE_HPP
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/event_trace.hpp>
+
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+  /**
+   * \ingroup rpc
+   * \internal
+   *
+   * Exchanges values addressed by their position in a plan of
+   * positions shared with each machine (see communication_plan), 
+   * without sending the positions themselves.
+   *
+   * While a phase computes, senders mark() the positions which have a
+   * value for a machine. At the end of the phase every thread calls
+   * send_marked(), which claims chunks of CHUNK_SIZE positions and
+   * sends the values of the marked positions, read from the getter at
+   * that time. A single thread then calls flush(). A chunk is sent as
+   * a presence bitmap (or the list of marked positions if that is
+   * smaller) followed by the values packed in position order.
+   */
+  template<typename T>
+  class plan_exchange {
+  public:
+    typedef uint32_t position_type;
+
+    /// The number of positions sent in one message. A multiple of 64
+    static const size_t CHUNK_SIZE = 65536;
+
+    /// The values received from one machine
+    struct buffer_type {
+      /// The marked positions, in increasing order
+      std::vector<position_type> positions;
+      /// The value of each of the positions
+      std::vector<T> values;
+      void clear() { positions.clear(); values.clear(); }
+      void save(oarchive& oarc) const {
+        oarc << position_type(0) << position_type(0) 
+             << uint32_t(positions.size()) << char(LIST_ENCODING);
+        for (size_t i = 0; i < positions.size(); ++i) oarc << positions[i];
+        for (size_t i = 0; i < values.size(); ++i) oarc << values[i];
+      }
+      void load(iarchive& iarc) { read_chunk(iarc, *this); }
+    };
+
+  private:
+    enum { BITMAP_ENCODING = 0, LIST_ENCODING = 1 };
+    typedef std::pair<procid_t, buffer_type> buffer_record;
+
+    /** The rpc interface for this class */
+    mutable dc_dist_object<plan_exchange> rpc;
+
+    /// The marked positions of each machine
+    std::vector<dense_bitset> marks;
+    /// The first chunk of each machine followed by the number of chunks
+    std::vector<size_t> chunk_begin;
+    /// The next chunk to be claimed by send_marked
+    atomic<size_t> next_chunk;
+
+    std::deque<buffer_record> recv_buffers;
+    mutex recv_lock;
+
+  public:
+    plan_exchange(distributed_control& dc) : 
+      rpc(dc, this), marks(dc.numprocs()), chunk_begin(dc.numprocs() + 1, 0),
+      next_chunk(0) { 
+      rpc.barrier(); 
+    }
+
+    /**
+     * Sets the number of positions shared with each machine and clears
+     * the marks.
+     */
+    void resize(const std::vector<size_t>& plan_sizes) {
+      ASSERT_EQ(plan_sizes.size(), rpc.numprocs());
+      for (procid_t proc = 0; proc < rpc.numprocs(); ++proc) {
+        marks[proc].resize(plan_sizes[proc]);
+        marks[proc].clear();
+        chunk_begin[proc + 1] = chunk_begin[proc] + 
+          (plan_sizes[proc] + CHUNK_SIZE - 1) / CHUNK_SIZE;
+      }
+    }
+
+    /// Marks a position of the plan shared with proc. Thread safe
+    void mark(procid_t proc, position_type pos) {
+      marks[proc].set_bit(pos);
+    }
+
+    /**
+     * Sends the marked positions of the chunks claimed by the calling
+     * thread along with their values get(proc, pos), and clears the
+     * marks.  Called by every thread once marking is complete.
+     */
+    template <typename Getter>
+    void send_marked(Getter& get) {
+      while(true) {
+        const size_t chunk = next_chunk.inc_ret_last();
+        if (chunk >= chunk_begin.back()) break;
+        const procid_t proc = 
+          std::upper_bound(chunk_begin.begin(), chunk_begin.end(), chunk) - 
+          chunk_begin.begin() - 1;
+        const size_t begin = (chunk - chunk_begin[proc]) * CHUNK_SIZE;
+        const size_t end = std::min(begin + CHUNK_SIZE, marks[proc].size());
+        if (!any_marked(marks[proc], begin, end)) continue;
+        charstream strm(128);
+        rpc.split_call_begin(strm, &plan_exchange::rpc_recv);
+        oarchive oarc(strm);
+        write_chunk(oarc, marks[proc], begin, end, proc, get);
+        rpc.split_call_end(proc, strm);
+      }
+    } // end of send_marked
+
+    /**
+     * Waits for the values sent by all machines to arrive.  Called by
+     * a single thread after all threads completed send_marked().
+     */
+    void flush() {
+      TRACE_SCOPE("exchange_flush");
+      rpc.full_barrier();
+      next_chunk = 0;
+    } // end of flush
+
+    bool recv(procid_t& ret_proc, buffer_type& ret_buffer, 
+              const bool try_lock = false) {
+      bool has_lock = false;
+      if(try_lock) {
+        if (recv_buffers.empty()) return false;
+        has_lock = recv_lock.try_lock();
+      } else { 
+        recv_lock.lock();
+        has_lock = true;
+      }
+      bool success = false;
+      if(has_lock) {
+        if(!recv_buffers.empty()) {
+          success = true;
+          buffer_record& rec = recv_buffers.front();
+          ret_proc = rec.first; 
+          ret_buffer.positions.swap(rec.second.positions);
+          ret_buffer.values.swap(rec.second.values);
+          recv_buffers.pop_front();
+        }
+        recv_lock.unlock();
+      }
+      return success;
+    } // end of recv
+
+    /// Returns the number of bytes sent to machine proc
+    size_t bytes_sent(procid_t proc) const { return rpc.bytes_sent(proc); }
+
+    /**
+     * Writes the marked positions in [begin, end) of marks and their
+     * values get(proc, pos), clearing the marks.  begin must be a
+     * multiple of 64.
+     */
+    template <typename Getter>
+    static void write_chunk(oarchive& oarc, dense_bitset& marks,
+                            size_t begin, size_t end, procid_t proc,
+                            Getter& get) {
+      const size_t WORD_SIZE = 8 * sizeof(size_t);
+      ASSERT_EQ(begin % WORD_SIZE, 0);
+      std::vector<size_t> words((end - begin + WORD_SIZE - 1) / WORD_SIZE);
+      size_t count = 0;
+      for (size_t i = 0; i < words.size(); ++i) {
+        words[i] = marks.get_containing_word_and_zero(begin + i * WORD_SIZE);
+        count += __builtin_popcountl(words[i]);
+      }
+      const size_t bitmap_bytes = words.size() * sizeof(size_t);
+      const size_t list_bytes = count * sizeof(position_type);
+      oarc << position_type(begin) << position_type(end) << uint32_t(count);
+      if (list_bytes < bitmap_bytes) {
+        oarc << char(LIST_ENCODING);
+        for (size_t i = 0; i < words.size(); ++i) {
+          for (size_t w = words[i]; w != 0; w &= w - 1) {
+            oarc << position_type(begin + i * WORD_SIZE + __builtin_ctzl(w));
+          }
+        }
+      } else {
+        oarc << char(BITMAP_ENCODING);
+        oarc.write(reinterpret_cast<const char*>(&words[0]), bitmap_bytes);
+      }
+      for (size_t i = 0; i < words.size(); ++i) {
+        for (size_t w = words[i]; w != 0; w &= w - 1) {
+          oarc << get(proc, position_type(begin + i * WORD_SIZE + 
+                                          __builtin_ctzl(w)));
+        }
+      }
+    } // end of write_chunk
+
+    /// Reads a chunk written by write_chunk
+    static void read_chunk(iarchive& iarc, buffer_type& buffer) {
+      const size_t WORD_SIZE = 8 * sizeof(size_t);
+      position_type begin, end;
+      uint32_t count;
+      char encoding;
+      iarc >> begin >> end >> count >> encoding;
+      buffer.positions.resize(count);
+      if (encoding == LIST_ENCODING) {
+        for (size_t i = 0; i < count; ++i) iarc >> buffer.positions[i];
+      } else {
+        std::vector<size_t> words((end - begin + WORD_SIZE - 1) / WORD_SIZE);
+        iarc.read(reinterpret_cast<char*>(&words[0]), 
+                  words.size() * sizeof(size_t));
+        size_t n = 0;
+        for (size_t i = 0; i < words.size(); ++i) {
+          for (size_t w = words[i]; w != 0; w &= w - 1) {
+            buffer.positions[n++] = begin + i * WORD_SIZE + __builtin_ctzl(w);
+          }
+        }
+        ASSERT_EQ(n, count);
+      }
+      buffer.values.resize(count);
+      for (size_t i = 0; i < count; ++i) iarc >> buffer.values[i];
+    } // end of read_chunk
+
+  private:
+    static bool any_marked(dense_bitset& marks, size_t begin, size_t end) {
+      const size_t WORD_SIZE = 8 * sizeof(size_t);
+      for (size_t b = begin; b < end; b += WORD_SIZE) {
+        if (marks.containing_word(b) != 0) return true;
+      }
+      return false;
+    }
+
+    void rpc_recv(procid_t src_proc, buffer_type& buffer) {
+      recv_lock.lock();
+      recv_buffers.push_back(buffer_record());
+      buffer_record& rec = recv_buffers.back();
+      rec.first = src_proc;
+      rec.second.positions.swap(buffer.positions);
+      rec.second.values.swap(buffer.values);
+      recv_lock.unlock();
+    } // end of rpc_recv
+
+  }; // end of plan_exchange
+
+}; // end of graphlab namespace
+#include <graphlab/macros_undef.hpp>
+
+#endif
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_ADAPTIVE_BITSET_HPP
+#define GRAPHLAB_ADAPTIVE_BITSET_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+namespace graphlab {
+
+  /**  \ingroup util
+   * \brief An atomic bitset which also keeps the list of set bits while
+   * only a few bits are set.
+   *
+   * Bits are always recorded in a \ref dense_bitset. In addition, while
+   * the number of set bits is at most the sparse capacity (a fraction of
+   * the bitset size) the positions of the set bits are appended to a list.
+   * Once the capacity is exceeded the list is abandoned and the set behaves
+   * like a plain dense_bitset until it is cleared.
+   *
+   * While the set is sparse, clear() and iteration with next_block() cost
+   * O(number of set bits) rather than O(size / 64). The default capacity
+   * of size / 32 entries uses the same memory as the bitset itself.
+   *
+   * Bits may only be set, not individually cleared, since a cleared bit
+   * would leave a stale entry in the list.
+   */
+  class adaptive_bitset {
+  public:
+
+    /**
+     * Constructs a bitset with 'size' bits. All bits will be cleared.
+     * \param size The number of bits
+     * \param max_sparse_fraction The fraction of the bits which may be set
+     *                            before the list of set bits is abandoned.
+     */
+    explicit adaptive_bitset(size_t size = 0,
+                             double max_sparse_fraction = 1.0 / 32) :
+      max_sparse_fraction(max_sparse_fraction) {
+      resize(size);
+      clear();
+    }
+
+    /// Resizes the bitset. The contents are undefined until clear() is called
+    inline void resize(size_t n) {
+      bits.resize(n);
+      list.resize(size_t(n * max_sparse_fraction));
+      bits.clear();
+      list_size = 0;
+      sorted = true;
+    }
+
+    /// Returns the number of bits in this bitset
+    inline size_t size() const {
+      return bits.size();
+    }
+
+    /// Clears all bits. O(number of set bits) while the set is sparse.
+    inline void clear() {
+      if (is_sparse()) {
+        for (size_t i = 0; i < list_size.value; ++i) {
+          bits.clear_bit_unsync(list[i]);
+        }
+      } else {
+        bits.clear();
+      }
+      list_size = 0;
+      sorted = true;
+    }
+
+    /// Sets all bits to 1. The set becomes dense.
+    inline void fill() {
+      bits.fill();
+      list_size = list.size() + 1;
+    }
+
+    /// Returns the value of the bit b
+    inline bool get(uint32_t b) const {
+      return bits.get(b);
+    }
+
+    /**
+     * Atomically sets the bit at position b to true returning the old
+     * value. Safe to call concurrently with other calls to set_bit().
+     */
+    inline bool set_bit(uint32_t b) {
+      const bool was_set = bits.set_bit(b);
+      if (!was_set) {
+        const size_t pos = list_size.inc_ret_last();
+        if (pos < list.size()) list[pos] = b;
+        sorted = false;
+      }
+      return was_set;
+    }
+
+    /// Returns true if the list of set bits is available
+    inline bool is_sparse() const {
+      return list_size.value <= list.size();
+    }
+
+    /**
+     * Returns the number of set bits if the set is sparse.
+     * If the set is dense the result is only a lower bound.
+     */
+    inline size_t sparse_count() const {
+      const size_t count = list_size.value;
+      return std::min<size_t>(count, list.size());
+    }
+
+    /**
+     * Sorts the list of set bits so that next_block() returns bits in
+     * increasing order. Not thread safe; should be called between
+     * parallel phases.
+     */
+    inline void sort() {
+      if (is_sparse() && !sorted) {
+        std::sort(list.begin(), list.begin() + list_size.value);
+        sorted = true;
+      }
+    }
+
+    /**
+     * Claims the next block of set bits. Threads sharing \c counter
+     * (which must be zero before the first call) receive disjoint blocks
+     * which together cover all the set bits. While sparse, blocks are
+     * taken from the list of set bits; otherwise from consecutive words
+     * of the bitset. All threads sharing \c counter must pass the same
+     * \c allow_sparse.
+     *
+     * \param counter The shared position counter
+     * \param [out] ret The positions of the set bits in the block
+     * \param allow_sparse If false, the bitset is scanned even if the
+     *                     list of set bits is available
+     * \return false once all set bits have been claimed
+     */
+    inline bool next_block(atomic<size_t>& counter,
+                           std::vector<uint32_t>& ret,
+                           bool allow_sparse = true) {
+      const size_t BLOCK_SIZE = 8 * sizeof(size_t);
+      ret.clear();
+      if (allow_sparse && is_sparse()) {
+        const size_t count = list_size.value;
+        const size_t block_start = counter.inc_ret_last(BLOCK_SIZE);
+        if (block_start >= count) return false;
+        const size_t block_end = std::min(block_start + BLOCK_SIZE, count);
+        ret.insert(ret.end(), list.begin() + block_start,
+                   list.begin() + block_end);
+        return true;
+      }
+      return next_block_in_range(counter, 0, bits.size(), ret);
+    }
+
+    /**
+     * Claims the next word-sized block of set bits in the range
+     * [begin, end) of the bitset, ignoring the list of set bits.
+     * \c begin must be a multiple of the word size and \c end must
+     * either be a multiple of the word size or equal to size(), so that
+     * disjoint ranges are scanned without overlap. \c counter is
+     * relative to \c begin and must be zero before the first call.
+     */
+    inline bool next_block_in_range(atomic<size_t>& counter,
+                                    size_t begin, size_t end,
+                                    std::vector<uint32_t>& ret) {
+      const size_t BLOCK_SIZE = 8 * sizeof(size_t);
+      ret.clear();
+      while (ret.empty()) {
+        const size_t block_start = begin + counter.inc_ret_last(BLOCK_SIZE);
+        if (block_start >= end) return false;
+        size_t word = bits.containing_word(block_start);
+        while (word != 0) {
+          const uint32_t offset = __builtin_ctzl(word);
+          ret.push_back(block_start + offset);
+          word &= word - 1;
+        }
+      }
+      return true;
+    }
+
+    /// Returns a const reference to the underlying dense bitset
+    inline const dense_bitset& get_bitset() const {
+      return bits;
+    }
+
+  private:
+    /// The bitset. Always holds the set contents.
+    dense_bitset bits;
+    /// The positions of the set bits. Valid while list_size <= list.size()
+    std::vector<uint32_t> list;
+    /// The number of bits set since the last clear
+    atomic<size_t> list_size;
+    /// The fraction of bits which may be listed
+    double max_sparse_fraction;
+    /// True if the list is known to be sorted
+    bool sorted;
+  }; // end of adaptive_bitset
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,325 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <sys/time.h>
+#include <pthread.h>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/event_trace.hpp>
+
+
+namespace graphlab {
+
+  namespace {
+    /// The ring buffer of events of one thread
+    struct thread_buffer {
+      std::vector<event_trace::event> events;
+      size_t mask;
+      /// The number of events recorded since the last clear
+      size_t count;
+      size_t tid;
+      std::string name;
+      /// Set once the thread has exited. Freed by the next clear
+      bool retired;
+      /// Held by the thread while it appends an event and by readers
+      simple_spinlock lock;
+    };
+
+    pthread_key_t buffer_key;
+    pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+
+    /// Protects all the fields below
+    mutex buffers_lock;
+    /// The buffers of all threads which recorded events since the last
+    /// clear, and of the live threads
+    std::vector<thread_buffer*> buffers;
+    /// The tid of the next buffer
+    size_t next_tid = 0;
+    size_t capacity = event_trace::DEFAULT_CAPACITY;
+    /// The tick and the wall clock time of the first enable
+    unsigned long long base_ticks = 0;
+    double base_wall_time = 0;
+
+    /**
+     * Called when a thread with a buffer exits. The ring is replaced
+     * by a copy of the events it holds, oldest first, or freed if it
+     * holds none.
+     */
+    void retire_buffer(void* ptr) {
+      thread_buffer* buf = reinterpret_cast<thread_buffer*>(ptr);
+      buffers_lock.lock();
+      buf->lock.lock();
+      const size_t n = std::min(buf->count, buf->events.size());
+      const size_t first = buf->count - n;
+      std::vector<event_trace::event> kept(n);
+      for (size_t j = 0; j < n; ++j) {
+        kept[j] = buf->events[(first + j) & buf->mask];
+      }
+      buf->events.swap(kept);
+      buf->mask = size_t(-1);
+      buf->count = n;
+      buf->retired = true;
+      buf->lock.unlock();
+      if (n == 0) {
+        buffers.erase(std::find(buffers.begin(), buffers.end(), buf));
+        delete buf;
+      }
+      buffers_lock.unlock();
+    }
+
+    void create_buffer_key() {
+      int error = pthread_key_create(&buffer_key, retire_buffer);
+      ASSERT_EQ(error, 0);
+    }
+
+    double wall_time() {
+      timeval tv;
+      gettimeofday(&tv, NULL);
+      return tv.tv_sec + tv.tv_usec * 1e-6;
+    }
+
+    /// Returns the buffer of the calling thread, creating it if needed
+    inline thread_buffer& get_buffer() {
+      pthread_once(&buffer_key_once, create_buffer_key);
+      thread_buffer* buf =
+        reinterpret_cast<thread_buffer*>(pthread_getspecific(buffer_key));
+      if (__unlikely__(buf == NULL)) {
+        buf = new thread_buffer;
+        buffers_lock.lock();
+        size_t n = 1;
+        while (n < capacity) n *= 2;
+        buf->events.resize(n);
+        buf->mask = n - 1;
+        buf->count = 0;
+        buf->tid = next_tid++;
+        buf->retired = false;
+        buffers.push_back(buf);
+        buffers_lock.unlock();
+        pthread_setspecific(buffer_key, buf);
+      }
+      return *buf;
+    }
+
+    inline void append(const event_trace::event& ev) {
+      thread_buffer& buf = get_buffer();
+      buf.lock.lock();
+      buf.events[buf.count & buf.mask] = ev;
+      ++buf.count;
+      buf.lock.unlock();
+    }
+
+    /// Copies the events held by a buffer, oldest first
+    void copy_events(thread_buffer& buf, 
+                     std::vector<event_trace::event>& ret) {
+      buf.lock.lock();
+      const size_t n = std::min(buf.count, buf.events.size());
+      const size_t first = buf.count - n;
+      ret.resize(n);
+      for (size_t j = 0; j < n; ++j) {
+        ret[j] = buf.events[(first + j) & buf.mask];
+      }
+      buf.lock.unlock();
+    }
+
+    /// Writes a string as a JSON string literal
+    void write_json_string(std::ostream& out, const char* str) {
+      out << '"';
+      for (const char* c = str; *c != 0; ++c) {
+        const unsigned char ch = *c;
+        if (ch == '"' || ch == '\\') {
+          out << '\\' << char(ch);
+        } else if (ch < 0x20) {
+          const char* hex = "0123456789abcdef";
+          out << "\\u00" << hex[ch >> 4] << hex[ch & 0xf];
+        } else {
+          out << char(ch);
+        }
+      }
+      out << '"';
+    }
+  } // end of anonymous namespace
+
+
+  volatile bool event_trace::enabled = false;
+
+
+  void event_trace::enable(size_t events_per_thread) {
+    ASSERT_GT(events_per_thread, 0);
+    buffers_lock.lock();
+    capacity = events_per_thread;
+    if (base_ticks == 0) {
+      base_ticks = rdtsc();
+      base_wall_time = wall_time();
+    }
+    buffers_lock.unlock();
+    enabled = true;
+  }
+
+
+  void event_trace::disable() {
+    enabled = false;
+  }
+
+
+  void event_trace::clear() {
+    buffers_lock.lock();
+    size_t n = 0;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      thread_buffer* buf = buffers[i];
+      if (buf->retired) {
+        delete buf;
+      } else {
+        buf->lock.lock();
+        buf->count = 0;
+        buf->lock.unlock();
+        buffers[n++] = buf;
+      }
+    }
+    buffers.resize(n);
+    buffers_lock.unlock();
+  }
+
+
+  void event_trace::set_thread_name(const std::string& name) {
+    if (!enabled) return;
+    thread_buffer& buf = get_buffer();
+    buffers_lock.lock();
+    buf.name = name;
+    buffers_lock.unlock();
+  }
+
+
+  void event_trace::record_span(const char* name, unsigned long long begin) {
+    event ev;
+    ev.begin = begin;
+    ev.end = rdtsc();
+    ev.name = name;
+    ev.id = 0;
+    ev.phase = 'X';
+    append(ev);
+  }
+
+
+  void event_trace::record(const char* name, char phase, size_t id) {
+    event ev;
+    ev.begin = rdtsc();
+    ev.end = ev.begin;
+    ev.name = name;
+    ev.id = id;
+    ev.phase = phase;
+    append(ev);
+  }
+
+
+  size_t event_trace::num_events() {
+    size_t ret = 0;
+    buffers_lock.lock();
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      buffers[i]->lock.lock();
+      ret += std::min(buffers[i]->count, buffers[i]->events.size());
+      buffers[i]->lock.unlock();
+    }
+    buffers_lock.unlock();
+    return ret;
+  }
+
+
+  size_t event_trace::num_buffers() {
+    buffers_lock.lock();
+    const size_t ret = buffers.size();
+    buffers_lock.unlock();
+    return ret;
+  }
+
+
+  bool event_trace::write_chrome_trace(const std::string& filename,
+                                       size_t pid) {
+    // written under another name and renamed once complete so that a
+    // reader never sees a partial file
+    const std::string tmpname = filename + ".tmp";
+    std::ofstream fout(tmpname.c_str());
+    if (!fout.good()) return false;
+    buffers_lock.lock();
+    // measure the tick rate over the time since tracing was first
+    // enabled. Fall back to the (slow) estimate if that is too short.
+    const unsigned long long now_ticks = rdtsc();
+    const double elapsed = wall_time() - base_wall_time;
+    double ticks_per_us = 0;
+    if (base_ticks != 0 && elapsed > 0.1) {
+      ticks_per_us = (now_ticks - base_ticks) / (elapsed * 1e6);
+    } else {
+      ticks_per_us = estimate_ticks_per_second() / 1e6;
+    }
+    const long double base_us = (long double)base_wall_time * 1e6;
+
+    fout << std::fixed << std::setprecision(3);
+    fout << "{\"traceEvents\":[\n";
+    fout << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+         << ",\"args\":{\"name\":\"graphlab process " << pid << "\"}}";
+    std::vector<event> events;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      thread_buffer& buf = *buffers[i];
+      if (!buf.name.empty()) {
+        fout << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+             << ",\"tid\":" << buf.tid << ",\"args\":{\"name\":";
+        write_json_string(fout, buf.name.c_str());
+        fout << "}}";
+      }
+      // the thread keeps recording while its events are written
+      copy_events(buf, events);
+      for (size_t j = 0; j < events.size(); ++j) {
+        const event& ev = events[j];
+        const long double ts =
+          base_us + ((long double)ev.begin - base_ticks) / ticks_per_us;
+        fout << ",\n{\"name\":";
+        write_json_string(fout, ev.name);
+        fout << ",\"cat\":\"graphlab\""
+             << ",\"ph\":\"" << ev.phase << "\",\"ts\":" << ts
+             << ",\"pid\":" << pid << ",\"tid\":" << buf.tid;
+        if (ev.phase == 'X') {
+          fout << ",\"dur\":" << (ev.end - ev.begin) / ticks_per_us;
+        } else if (ev.phase == 'i') {
+          fout << ",\"s\":\"t\"";
+        } else {
+          fout << ",\"id\":" << ev.id;
+        }
+        fout << "}";
+      }
+    }
+    buffers_lock.unlock();
+    fout << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    fout.close();
+    if (fout.fail()) {
+      std::remove(tmpname.c_str());
+      return false;
+    }
+    return std::rename(tmpname.c_str(), filename.c_str()) == 0;
+  }
+
+} // end of namespace graphlab
@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_UTIL_EVENT_TRACE_HPP
+#define GRAPHLAB_UTIL_EVENT_TRACE_HPP
+
+#include <string>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/branch_hints.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * \brief Per-thread event tracing with export to the Chrome trace
+   * format.
+   *
+   * Every thread which records an event while tracing is enabled gets
+   * a fixed size ring buffer of timestamped events. Recording an event
+   * appends to the buffer of the calling thread under a lock of that
+   * buffer, which is only contended while the events are read; once
+   * the buffer is full the oldest events are overwritten. While tracing
+   * is disabled, recording costs a single branch. When a thread exits
+   * its ring buffer is replaced by a copy of the events it holds, which
+   * is freed by the next clear().
+   *
+   * The events of all threads of the process can be written with
+   * write_chrome_trace() as a JSON file which can be opened in
+   * chrome://tracing or https://ui.perfetto.dev . Timestamps are wall
+   * clock microseconds so that the files written by the machines of a
+   * distributed job can be loaded together.
+   *
+   * Events are normally recorded with the macros:
+   * \code
+   * void flush() {
+   *   TRACE_SCOPE("flush");   // a span from here to the end of the scope
+   *   ...
+   * }
+   * TRACE_ASYNC_BEGIN("lock", lvid);  // a span which may begin and
+   * TRACE_ASYNC_END("lock", lvid);    // end on different threads
+   * TRACE_INSTANT("steal");
+   * \endcode
+   * The name of an event is not copied and must be a string literal.
+   */
+  class event_trace {
+  public:
+    /**
+     * A recorded event. The phase is the Chrome trace event type:
+     * 'X' for a span, 'b' and 'e' for the ends of an asynchronous span
+     * and 'i' for an instant.
+     */
+    struct event {
+      unsigned long long begin;
+      unsigned long long end;
+      const char* name;
+      size_t id;
+      char phase;
+    };
+
+    /// The default number of events kept per thread
+    static const size_t DEFAULT_CAPACITY = 65536;
+
+    /// Returns true while events are recorded
+    static inline bool is_enabled() {
+      return enabled;
+    }
+
+    /**
+     * Starts recording events. The capacity of the ring buffers, which
+     * is rounded up to a power of two, applies to the threads which
+     * record their first event after this call.
+     */
+    static void enable(size_t capacity = DEFAULT_CAPACITY);
+
+    /// Stops recording events. The recorded events are kept.
+    static void disable();
+
+    /**
+     * Discards all recorded events and frees the buffers of the
+     * threads which have exited.
+     */
+    static void clear();
+
+    /// Names the calling thread in the trace
+    static void set_thread_name(const std::string& name);
+
+    /// Records a span which started at the tick begin and ends now
+    static void record_span(const char* name, unsigned long long begin);
+
+    /// Records an event of the given phase ('b', 'e' or 'i') now
+    static void record(const char* name, char phase, size_t id = 0);
+
+    /// Returns the number of events held in the buffers of all threads
+    static size_t num_events();
+
+    /// Returns the number of buffers held, including those of exited threads
+    static size_t num_buffers();
+
+    /**
+     * Writes the recorded events of all threads as a Chrome trace JSON
+     * file. Events are listed under the process id pid. Threads may
+     * keep recording events while the trace is written. The file is
+     * replaced at once when it is complete.
+     * \return false if the file could not be written
+     */
+    static bool write_chrome_trace(const std::string& filename, size_t pid);
+
+  private:
+    static volatile bool enabled;
+  }; // end of event_trace
+
+
+  /**
+   * \ingroup util
+   * \brief Records a span from its construction to its destruction.
+   * Use the TRACE_SCOPE macro.
+   */
+  class trace_scope {
+  public:
+    inline explicit trace_scope(const char* name) : name(name), begin(0) {
+      if (__unlikely__(event_trace::is_enabled())) begin = rdtsc();
+    }
+    inline ~trace_scope() {
+      if (__unlikely__(begin != 0)) event_trace::record_span(name, begin);
+    }
+  private:
+    const char* name;
+    unsigned long long begin;
+  }; // end of trace_scope
+
+} // end of namespace graphlab
+
+#define TRACE_SCOPE_CONCAT2(a, b) a ## b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT2(a, b)
+
+/// Records a span named name from here to the end of the enclosing scope
+#define TRACE_SCOPE(name)                                               \
+  graphlab::trace_scope TRACE_SCOPE_CONCAT(__trace_scope_, __LINE__)(name)
+
+/// Records the start of an asynchronous span identified by name and id
+#define TRACE_ASYNC_BEGIN(name, id)                                     \
+  do {                                                                  \
+    if (__unlikely__(graphlab::event_trace::is_enabled()))              \
+      graphlab::event_trace::record(name, 'b', id);                     \
+  } while (0)
+
+/// Records the end of an asynchronous span identified by name and id
+#define TRACE_ASYNC_END(name, id)                                       \
+  do {                                                                  \
+    if (__unlikely__(graphlab::event_trace::is_enabled()))              \
+      graphlab::event_trace::record(name, 'e', id);                     \
+  } while (0)
+
+/// Records an instant event
+#define TRACE_INSTANT(name)                                             \
+  do {                                                                  \
+    if (__unlikely__(graphlab::event_trace::is_enabled()))              \
+      graphlab::event_trace::record(name, 'i');                         \
+  } while (0)
+
+#endif
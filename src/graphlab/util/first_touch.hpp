@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_FIRST_TOUCH_HPP
+#define GRAPHLAB_FIRST_TOUCH_HPP
+
+#include <vector>
+#include <new>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+
+namespace graphlab {
+
+  /**  \ingroup util
+   * \brief True if the pages of a std::vector<T> may be released and
+   * refilled by release_vector_pages() and first_touch_range(): T must
+   * be trivially copy constructible and destructible so that its
+   * objects may be zeroed and then copied in place.  Classes with
+   * virtual functions (such as vertex programs) are not.
+   */
+  template <typename T>
+  struct first_touch_supported : 
+    public boost::integral_constant<bool,
+      boost::has_trivial_copy<T>::value &&
+      boost::has_trivial_destructor<T>::value> { };
+
+
+  /**  \ingroup util
+   * \brief Returns the pages backing a vector to the operating system
+   * so that the next write to each page allocates it again on the NUMA
+   * node of the writing thread (first-touch placement).
+   *
+   * Only the pages lying entirely inside the vector are released. Their
+   * contents read as zero afterwards, so the caller must refill every
+   * element with first_touch_range(), typically in parallel with each
+   * thread filling the range it will later process. Vectors of types
+   * which do not satisfy first_touch_supported are left untouched.
+   *
+   * \return true if any pages were released
+   */
+  template <typename T>
+  bool release_vector_pages(std::vector<T>& vec) {
+    if (!first_touch_supported<T>::value || vec.empty()) return false;
+#if defined __linux__
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    // use the address of the last element rather than the size since
+    // std::vector<empty> is specialized to not store its elements
+    const size_t begin = 
+      (size_t(&vec[0]) + page_size - 1) / page_size * page_size;
+    const size_t end = 
+      size_t(&vec[vec.size() - 1] + 1) / page_size * page_size;
+    if (end <= begin) return false;
+    return madvise((void*)begin, end - begin, MADV_DONTNEED) == 0;
+#else
+    return false;
+#endif
+  } // end of release_vector_pages
+
+
+  /**  \ingroup util
+   * \brief Copies value into the elements [begin, end) of a vector whose
+   * pages were released by release_vector_pages(), placing the pages
+   * on the NUMA node of the calling thread. Does nothing for the types
+   * which release_vector_pages() leaves untouched.
+   */
+  template <typename T>
+  void first_touch_range(std::vector<T>& vec, size_t begin, size_t end,
+                         const T& value = T()) {
+    if (!first_touch_supported<T>::value) return;
+    for (size_t i = begin; i < end && i < vec.size(); ++i) {
+      new (&vec[i]) T(value);
+    }
+  } // end of first_touch_range
+
+} // namespace graphlab
+
+#endif
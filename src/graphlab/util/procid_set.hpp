@@ -0,0 +1,308 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_PROCID_SET_HPP
+#define GRAPHLAB_PROCID_SET_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <stdint.h>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**  \ingroup util
+   * \brief A compact sorted set of process ids.
+   *
+   * The set occupies a single 64 bit word. Up to INLINE_CAPACITY
+   * process ids are stored inline in the word; larger sets spill to a
+   * sorted heap array which grows as needed. Since most vertices are
+   * replicated on only a few machines this is far smaller than a
+   * bitset over all possible processes, and places no limit on the
+   * number of processes.
+   *
+   * The interface follows fixed_dense_bitset so the set can be used
+   * for mirror sets: elements are visited in increasing order by
+   * begin()/end(), first_bit() and next_bit(). Unlike a bitset, the set
+   * is not thread safe: set_bit() and set_bit_unsync() are identical and
+   * may reallocate the set. Sets updated by several threads at once,
+   * such as the degree tables of the greedy ingress, should use a
+   * fixed_dense_bitset instead.
+   */
+  class procid_set {
+  public:
+    /// The number of process ids stored without a heap allocation
+    static const size_t INLINE_CAPACITY = 3;
+
+    /// Constructs an empty set
+    procid_set() : word(INLINE_TAG) { }
+
+    /// Make a copy of another set
+    procid_set(const procid_set& other) : word(INLINE_TAG) {
+      *this = other;
+    }
+
+    ~procid_set() { release(); }
+
+    /// Make a copy of another set
+    procid_set& operator=(const procid_set& other) {
+      if (this == &other) return *this;
+      release();
+      if (other.is_inline()) {
+        word = other.word;
+      } else {
+        const size_t n = other.popcount();
+        procid_t* arr = allocate(n);
+        memcpy(arr + HEADER_SIZE, other.heap() + HEADER_SIZE, 
+               n * sizeof(procid_t));
+        arr[0] = procid_t(n);
+        set_heap(arr);
+      }
+      return *this;
+    }
+
+    /// Removes all elements, releasing any heap storage
+    inline void clear() {
+      release();
+      word = INLINE_TAG;
+    }
+
+    /// Returns true if the set is empty
+    inline bool empty() const { return popcount() == 0; }
+
+    /// Returns the number of elements in the set
+    inline size_t popcount() const {
+      return is_inline() ? size_t((word >> 1) & 0x3) : size_t(heap()[0]);
+    }
+
+    /// Returns the i-th smallest element
+    inline procid_t element(size_t i) const {
+      return is_inline() ? procid_t(word >> (16 * (i + 1))) 
+                         : heap()[HEADER_SIZE + i];
+    }
+
+    /// Returns true if p is in the set
+    inline bool get(uint32_t p) const {
+      const size_t pos = find(p);
+      return pos < popcount() && element(pos) == p;
+    }
+
+    /**
+     * Inserts p returning true if it was already in the set.
+     */
+    inline bool set_bit(uint32_t p) {
+      ASSERT_LT(p, size_t(procid_t(-1)));
+      const size_t n = popcount();
+      const size_t pos = find(p);
+      if (pos < n && element(pos) == p) return true;
+      if (is_inline() && n < INLINE_CAPACITY) {
+        procid_t vals[INLINE_CAPACITY + 1];
+        for (size_t i = 0; i < n; ++i) vals[i] = element(i);
+        std::copy_backward(vals + pos, vals + n, vals + n + 1);
+        vals[pos] = procid_t(p);
+        set_inline(vals, n + 1);
+        return false;
+      }
+      procid_t* arr = NULL;
+      if (is_inline()) {
+        // spill to the heap
+        arr = allocate(2 * INLINE_CAPACITY + 2);
+        for (size_t i = 0; i < n; ++i) arr[HEADER_SIZE + i] = element(i);
+        set_heap(arr);
+      } else {
+        arr = heap();
+        if (n == arr[1]) {
+          arr = (procid_t*)realloc(arr, (HEADER_SIZE + 2 * n) * 
+                                   sizeof(procid_t));
+          ASSERT_TRUE(arr != NULL);
+          arr[1] = procid_t(std::min<size_t>(2 * n, procid_t(-1)));
+          set_heap(arr);
+        }
+      }
+      procid_t* elems = arr + HEADER_SIZE;
+      std::copy_backward(elems + pos, elems + n, elems + n + 1);
+      elems[pos] = procid_t(p);
+      arr[0] = procid_t(n + 1);
+      return false;
+    }
+
+    /// Same as set_bit()
+    inline bool set_bit_unsync(uint32_t p) { return set_bit(p); }
+
+    /**
+     * Removes p returning true if it was in the set.
+     */
+    inline bool clear_bit(uint32_t p) {
+      const size_t n = popcount();
+      const size_t pos = find(p);
+      if (pos >= n || element(pos) != p) return false;
+      if (is_inline()) {
+        procid_t vals[INLINE_CAPACITY];
+        for (size_t i = 0; i < n; ++i) vals[i] = element(i);
+        std::copy(vals + pos + 1, vals + n, vals + pos);
+        set_inline(vals, n - 1);
+      } else {
+        procid_t* elems = heap() + HEADER_SIZE;
+        std::copy(elems + pos + 1, elems + n, elems + pos);
+        heap()[0] = procid_t(n - 1);
+      }
+      return true;
+    }
+
+    /// Same as clear_bit()
+    inline bool clear_bit_unsync(uint32_t p) { return clear_bit(p); }
+
+    /**
+     * Stores the smallest element in b. Returns false if the set is
+     * empty.
+     */
+    inline bool first_bit(uint32_t& b) const {
+      if (empty()) return false;
+      b = element(0);
+      return true;
+    }
+
+    /**
+     * Stores the smallest element larger than b in b. Returns false if
+     * there is none.
+     */
+    inline bool next_bit(uint32_t& b) const {
+      const size_t pos = find(b + 1);
+      if (pos >= popcount()) return false;
+      b = element(pos);
+      return true;
+    }
+
+    /// Iterates over the elements in increasing order
+    struct const_iterator {
+      typedef std::forward_iterator_tag iterator_category;
+      typedef procid_t value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const procid_t* pointer;
+      typedef procid_t reference;
+
+      const_iterator() : set(NULL), pos(0) { }
+      const_iterator(const procid_set* set, size_t pos) : 
+        set(set), pos(pos) { }
+      procid_t operator*() const { return set->element(pos); }
+      const_iterator& operator++() { ++pos; return *this; }
+      const_iterator operator++(int) { 
+        const_iterator ret = *this; ++pos; return ret; 
+      }
+      bool operator==(const const_iterator& other) const {
+        return set == other.set && pos == other.pos;
+      }
+      bool operator!=(const const_iterator& other) const {
+        return !(*this == other);
+      }
+    private:
+      const procid_set* set;
+      size_t pos;
+    };
+    typedef const_iterator iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, popcount()); }
+
+    /// Serializes this set to an archive
+    inline void save(oarchive& oarc) const {
+      const size_t n = popcount();
+      oarc << procid_t(n);
+      for (size_t i = 0; i < n; ++i) oarc << element(i);
+    }
+
+    /// Deserializes this set from an archive
+    inline void load(iarchive& iarc) {
+      clear();
+      procid_t n = 0, p = 0;
+      iarc >> n;
+      for (size_t i = 0; i < n; ++i) {
+        iarc >> p;
+        set_bit(p);
+      }
+    }
+
+  private:
+    /** 
+     * If the lowest bit is set, bits 1-2 hold the number of elements
+     * and the elements are stored in the following 16 bit fields.
+     * Otherwise the word is a pointer to a heap array holding the
+     * number of elements, the capacity and the elements.
+     */
+    uint64_t word;
+
+    static const uint64_t INLINE_TAG = 1;
+    static const size_t HEADER_SIZE = 2;
+
+    inline bool is_inline() const { return word & INLINE_TAG; }
+
+    inline procid_t* heap() const { 
+      return reinterpret_cast<procid_t*>(size_t(word)); 
+    }
+
+    inline void set_heap(procid_t* arr) { 
+      word = uint64_t(reinterpret_cast<size_t>(arr)); 
+    }
+
+    inline void set_inline(const procid_t* vals, size_t n) {
+      word = INLINE_TAG | (uint64_t(n) << 1);
+      for (size_t i = 0; i < n; ++i) {
+        word |= uint64_t(vals[i]) << (16 * (i + 1));
+      }
+    }
+
+    /// Allocates an empty heap array with the given capacity
+    inline static procid_t* allocate(size_t capacity) {
+      procid_t* arr = (procid_t*)malloc((HEADER_SIZE + capacity) * 
+                                        sizeof(procid_t));
+      ASSERT_TRUE(arr != NULL);
+      arr[0] = 0;
+      arr[1] = procid_t(capacity);
+      return arr;
+    }
+
+    inline void release() {
+      if (!is_inline()) free(heap());
+    }
+
+    /// Returns the position of the first element not less than p
+    inline size_t find(uint32_t p) const {
+      const size_t n = popcount();
+      if (is_inline()) {
+        size_t i = 0;
+        while (i < n && element(i) < p) ++i;
+        return i;
+      } else {
+        const procid_t* elems = heap() + HEADER_SIZE;
+        return std::lower_bound(elems, elems + n, p) - elems;
+      }
+    }
+  }; // end of procid_set
+
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_SORTED_SET_INTERSECTION_HPP
+#define GRAPHLAB_SORTED_SET_INTERSECTION_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * If one set is more than this many times larger than the other,
+   * count_sorted_intersection() searches the larger set for each
+   * element of the smaller one instead of merging the two.
+   */
+  const size_t GALLOP_RATIO = 8;
+
+  namespace sorted_set_impl {
+
+    /// Counts the common elements by merging
+    template<typename T>
+    size_t merge_count(const T* a, size_t na, const T* b, size_t nb) {
+      size_t count = 0;
+      size_t i = 0, j = 0;
+      while (i < na && j < nb) {
+        const T x = a[i], y = b[j];
+        count += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+      }
+      return count;
+    }
+
+    /**
+     * Counts the common elements by an exponential search of b, from
+     * the position of the previous element, for each element of a.
+     */
+    template<typename T>
+    size_t gallop_count(const T* a, size_t na, const T* b, size_t nb) {
+      size_t count = 0;
+      size_t j = 0;
+      for (size_t i = 0; i < na && j < nb; ++i) {
+        const T x = a[i];
+        size_t lo = j, hi = j, step = 1;
+        while (hi < nb && b[hi] < x) {
+          lo = hi + 1;
+          hi += step;
+          step <<= 1;
+        }
+        j = std::lower_bound(b + lo, b + std::min(hi, nb), x) - b;
+        count += (j < nb && b[j] == x);
+      }
+      return count;
+    }
+
+#if defined(__AVX2__)
+    /**
+     * Compares blocks of 8 elements of a with all 8 rotations of
+     * blocks of b and advances the block with the smaller maximum.
+     */
+    inline size_t block_count(const uint32_t*& a, const uint32_t* a_end,
+                              const uint32_t*& b, const uint32_t* b_end) {
+      size_t count = 0;
+      const __m256i rotate = _mm256_set_epi32(0, 7, 6, 5, 4, 3, 2, 1);
+      while (a_end - a >= 8 && b_end - b >= 8) {
+        const __m256i va = _mm256_loadu_si256((const __m256i*)a);
+        __m256i vb = _mm256_loadu_si256((const __m256i*)b);
+        __m256i match = _mm256_cmpeq_epi32(va, vb);
+        for (size_t r = 1; r < 8; ++r) {
+          vb = _mm256_permutevar8x32_epi32(vb, rotate);
+          match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+        }
+        count += __builtin_popcount(
+            _mm256_movemask_ps(_mm256_castsi256_ps(match)));
+        const uint32_t a_max = a[7], b_max = b[7];
+        if (a_max <= b_max) a += 8;
+        if (b_max <= a_max) b += 8;
+      }
+      return count;
+    }
+#elif defined(__SSE2__)
+    /**
+     * Compares blocks of 4 elements of a with all 4 rotations of
+     * blocks of b and advances the block with the smaller maximum.
+     */
+    inline size_t block_count(const uint32_t*& a, const uint32_t* a_end,
+                              const uint32_t*& b, const uint32_t* b_end) {
+      size_t count = 0;
+      while (a_end - a >= 4 && b_end - b >= 4) {
+        const __m128i va = _mm_loadu_si128((const __m128i*)a);
+        const __m128i vb = _mm_loadu_si128((const __m128i*)b);
+        const __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x4e)),
+                         _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x93))));
+        count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(match)));
+        const uint32_t a_max = a[3], b_max = b[3];
+        if (a_max <= b_max) a += 4;
+        if (b_max <= a_max) b += 4;
+      }
+      return count;
+    }
+#else
+    inline size_t block_count(const uint32_t*& a, const uint32_t* a_end,
+                              const uint32_t*& b, const uint32_t* b_end) {
+      return 0;
+    }
+#endif
+
+    template<typename T>
+    size_t merge_count_blocks(const T* a, size_t na, const T* b, size_t nb) {
+      return merge_count(a, na, b, nb);
+    }
+
+    inline size_t merge_count_blocks(const uint32_t* a, size_t na,
+                                     const uint32_t* b, size_t nb) {
+      const uint32_t* a_end = a + na;
+      const uint32_t* b_end = b + nb;
+      const size_t count = block_count(a, a_end, b, b_end);
+      return count + merge_count(a, a_end - a, b, b_end - b);
+    }
+  } // end of namespace sorted_set_impl
+
+
+  /**
+   * \ingroup util
+   * \brief Returns the number of elements common to two strictly
+   * increasing arrays.
+   *
+   * Sets of similar size are merged. For 32 bit elements the merge
+   * compares a block of elements of one set with all the rotations of
+   * a block of the other, using AVX2 (8 elements) or SSE2 (4 elements)
+   * when the compiler targets them. If one set is more than
+   * GALLOP_RATIO times larger, the larger set is galloped over instead.
+   */
+  template<typename T>
+  size_t count_sorted_intersection(const T* a, size_t na,
+                                   const T* b, size_t nb) {
+    if (na > nb) {
+      std::swap(a, b);
+      std::swap(na, nb);
+    }
+    if (na == 0) return 0;
+    // the ranges do not overlap
+    if (a[na - 1] < b[0] || b[nb - 1] < a[0]) return 0;
+    if (na * GALLOP_RATIO < nb) {
+      return sorted_set_impl::gallop_count(a, na, b, nb);
+    }
+    return sorted_set_impl::merge_count_blocks(a, na, b, nb);
+  }
+
+  /// count_sorted_intersection() of two strictly increasing vectors
+  template<typename T>
+  size_t count_sorted_intersection(const std::vector<T>& a,
+                                   const std::vector<T>& b) {
+    if (a.empty() || b.empty()) return 0;
+    return count_sorted_intersection(&a[0], a.size(), &b[0], b.size());
+  }
+
+} // end of namespace graphlab
+
+#endif
@@ -151,6 +151,13 @@ namespace graphlab {
       engine.internal_clear_gather_cache(vertex);      
     }
 
+    /**
+     * Declare that the current apply did not change the vertex data.
+     */
+    void vertex_data_unchanged(const vertex_type& vertex) {
+      engine.internal_vertex_data_unchanged(vertex);
+    }
+
 
                                                 
 
@@ -264,6 +264,22 @@ namespace graphlab {
      */
     virtual void clear_gather_cache(const vertex_type& vertex) { } 
 
+    /**
+     * \brief Declare that the current apply did not change the vertex
+     * data.
+     *
+     * Must only be called from ivertex_program::apply on the vertex
+     * being applied.  Engines which support it (the synchronous engine
+     * with skip_unchanged_vdata set) then do not send the vertex data
+     * to the mirrors of the vertex.  A vertex program may also call
+     * this when the data changed by less than some tolerance, in which
+     * case the mirrors keep the previous value until a later apply
+     * synchronizes them.
+     *
+     * \param vertex [in] the vertex being applied
+     */
+    virtual void vertex_data_unchanged(const vertex_type& vertex) { } 
+
   }; // end of icontext
   
 } // end of namespace
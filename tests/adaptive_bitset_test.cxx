@@ -0,0 +1,88 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <algorithm>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/adaptive_bitset.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+class AdaptiveBitsetTestSuite : public CxxTest::TestSuite {
+  // collect all the bits returned by next_block
+  std::vector<uint32_t> collect(adaptive_bitset& d, bool allow_sparse) {
+    atomic<size_t> counter(0);
+    std::vector<uint32_t> block, ret;
+    while (d.next_block(counter, block, allow_sparse)) {
+      TS_ASSERT(!block.empty());
+      ret.insert(ret.end(), block.begin(), block.end());
+    }
+    return ret;
+  }
+
+public:
+  void test_sparse(void) {
+    adaptive_bitset d(1000);
+    uint32_t probelocations[7] = {999, 10, 12, 50, 66, 81, 0};
+    for (size_t i= 0;i < 7; ++i) {
+      TS_ASSERT_EQUALS(d.set_bit(probelocations[i]), false);
+    }
+    // setting twice does not duplicate the entry
+    TS_ASSERT_EQUALS(d.set_bit(50), true);
+    TS_ASSERT(d.is_sparse());
+    TS_ASSERT_EQUALS(d.sparse_count(), 7);
+
+    d.sort();
+    std::vector<uint32_t> sorted(probelocations, probelocations + 7);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<uint32_t> bits = collect(d, true);
+    TS_ASSERT(bits == sorted);
+    bits = collect(d, false);
+    TS_ASSERT(bits == sorted);
+
+    d.clear();
+    for (size_t i = 0;i < 1000; ++i) TS_ASSERT_EQUALS(d.get(i), false);
+    TS_ASSERT(collect(d, true).empty());
+  }
+
+  void test_dense(void) {
+    adaptive_bitset d(1000);
+    // 1000 / 32 = 31 entries fit in the list
+    for (uint32_t i = 0;i < 1000; i += 3) d.set_bit(i);
+    TS_ASSERT(!d.is_sparse());
+    std::vector<uint32_t> bits = collect(d, true);
+    TS_ASSERT_EQUALS(bits.size(), 334);
+    for (size_t i = 0;i < bits.size(); ++i) {
+      TS_ASSERT_EQUALS(bits[i], 3 * i);
+    }
+    d.clear();
+    TS_ASSERT(d.is_sparse());
+    for (size_t i = 0;i < 1000; ++i) TS_ASSERT_EQUALS(d.get(i), false);
+
+    d.fill();
+    TS_ASSERT(!d.is_sparse());
+    TS_ASSERT_EQUALS(collect(d, true).size(), 1000);
+    d.clear();
+    TS_ASSERT(collect(d, true).empty());
+  }
+};
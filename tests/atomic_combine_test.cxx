@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/parallel/atomic_ops.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <boost/bind.hpp>
+
+using namespace graphlab;
+
+/**
+ * Keeps the smallest value combined into it.
+ */
+struct min_value {
+  int32_t value;
+  explicit min_value(int32_t value = 0) : value(value) { }
+  min_value& operator+=(const min_value& other) {
+    value = std::min(value, other.value);
+    return *this;
+  }
+};
+
+/**
+ * A 2 byte pair of counters summed independently.
+ */
+struct byte_pair {
+  uint8_t a, b;
+  byte_pair& operator+=(const byte_pair& other) {
+    a += other.a; b += other.b;
+    return *this;
+  }
+};
+
+struct not_trivially_copyable {
+  int value;
+  not_trivially_copyable(const not_trivially_copyable& other) 
+    : value(other.value) { }
+};
+
+struct three_bytes {
+  char c[3];
+};
+
+const size_t NTHREADS = 8;
+const size_t NCOMBINES = 100000;
+
+void combine_sum(int64_t* sum, size_t thread_id) {
+  for (size_t i = 0; i < NCOMBINES; ++i) {
+    atomic_combine(*sum, int64_t(thread_id + 1));
+  }
+}
+
+void combine_min(min_value* min, size_t thread_id) {
+  for (size_t i = 0; i < NCOMBINES; ++i) {
+    atomic_combine(*min, min_value(thread_id * NCOMBINES + NCOMBINES - i));
+  }
+}
+
+void combine_pair(byte_pair* pair, size_t thread_id) {
+  for (size_t i = 0; i < 255; ++i) {
+    byte_pair v;
+    v.a = 1; v.b = (thread_id == 0);
+    atomic_combine(*pair, v);
+  }
+}
+
+class AtomicCombineTestSuite : public CxxTest::TestSuite {
+public:
+  void test_supported_types() {
+    TS_ASSERT(atomic_combine_supported<int64_t>::value);
+    TS_ASSERT(atomic_combine_supported<float>::value);
+    TS_ASSERT(atomic_combine_supported<min_value>::value);
+    TS_ASSERT(atomic_combine_supported<byte_pair>::value);
+    TS_ASSERT(!atomic_combine_supported<std::string>::value);
+    TS_ASSERT(!atomic_combine_supported<not_trivially_copyable>::value);
+    TS_ASSERT(!atomic_combine_supported<three_bytes>::value);
+  }
+
+  void test_concurrent_sum() {
+    int64_t sum = 0;
+    thread_group group;
+    for (size_t i = 0; i < NTHREADS; ++i) {
+      group.launch(boost::bind(combine_sum, &sum, i));
+    }
+    group.join();
+    TS_ASSERT_EQUALS(sum, int64_t(NCOMBINES * NTHREADS * (NTHREADS + 1) / 2));
+  }
+
+  void test_concurrent_min() {
+    // the starting value is a real message, not an identity
+    min_value min(std::numeric_limits<int32_t>::max());
+    thread_group group;
+    for (size_t i = 0; i < NTHREADS; ++i) {
+      group.launch(boost::bind(combine_min, &min, i));
+    }
+    group.join();
+    TS_ASSERT_EQUALS(min.value, 1);
+  }
+
+  void test_concurrent_subword() {
+    byte_pair pair;
+    pair.a = 0; pair.b = 0;
+    thread_group group;
+    // the counters wrap around independently
+    for (size_t i = 0; i < 2; ++i) {
+      group.launch(boost::bind(combine_pair, &pair, i));
+    }
+    group.join();
+    TS_ASSERT_EQUALS(int(pair.a), int(uint8_t(2 * 255)));
+    TS_ASSERT_EQUALS(int(pair.b), 255);
+  }
+};
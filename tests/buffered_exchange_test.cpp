@@ -0,0 +1,143 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+/*
+ * Every thread of every machine sends a numbered sequence of records
+ * to every machine, including itself, through a buffered_exchange with
+ * small buffers. The receivers check that each record arrives exactly
+ * once, that each received buffer (one split call, or one moved local
+ * buffer) keeps the order in which the records were sent, and that the
+ * records sent to this machine are delivered without being serialized.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+const size_t NUM_THREADS = 4;
+const size_t NUM_RECORDS = 20000;
+// small enough that every thread sends many messages to every machine
+const size_t BUFFER_SIZE = 1024;
+
+/// The record type. Not POD so the values are serialized one by one
+struct record {
+  procid_t proc;
+  size_t thread;
+  size_t seq;
+  std::string tag;
+  record() : proc(0), thread(0), seq(0) { }
+  record(procid_t proc, size_t thread, size_t seq) :
+    proc(proc), thread(thread), seq(seq), tag(expected_tag(seq)) { }
+  static std::string expected_tag(size_t seq) {
+    return std::string(seq % 7, 'a' + seq % 26);
+  }
+  void save(oarchive& oarc) const { oarc << proc << thread << seq << tag; }
+  void load(iarchive& iarc) { iarc >> proc >> thread >> seq >> tag; }
+};
+
+typedef buffered_exchange<record> exchange_type;
+
+void send_records(exchange_type& exchange, procid_t procid, 
+                  procid_t numprocs, size_t thread) {
+  for (size_t seq = 0; seq < NUM_RECORDS; ++seq) {
+    for (procid_t proc = 0; proc < numprocs; ++proc) {
+      exchange.send(proc, record(procid, thread, seq), thread);
+    }
+  }
+  exchange.partial_flush(thread);
+}
+
+int main(int argc, char ** argv) {
+  mpi_tools::init(argc, argv);
+  dc_init_param param;
+  if (init_param_from_mpi(param) == false) {
+    return 0;
+  }
+  distributed_control dc(param);
+  const procid_t procid = dc.procid();
+  const procid_t numprocs = dc.numprocs();
+  exchange_type exchange(dc, NUM_THREADS, BUFFER_SIZE);
+
+  thread_group thrgrp; 
+  for (size_t i = 0; i < NUM_THREADS; ++i) {
+    thrgrp.launch(boost::bind(send_records, boost::ref(exchange), 
+                              procid, numprocs, i));
+  }
+  thrgrp.join();
+  exchange.flush();
+
+  // received[proc][thread][seq]
+  std::vector<std::vector<std::vector<bool> > > received
+    (numprocs, std::vector<std::vector<bool> >
+     (NUM_THREADS, std::vector<bool>(NUM_RECORDS, false)));
+  // the last sequence number received from each thread of this machine
+  std::vector<size_t> last_local(NUM_THREADS, 0);
+  size_t num_received = 0, num_buffers = 0;
+  procid_t sending_proc = -1;
+  exchange_type::buffer_type buffer;
+  while(exchange.recv(sending_proc, buffer)) {
+    ++num_buffers;
+    ASSERT_LT(sending_proc, numprocs);
+    // the order of the sends from each thread is kept within a buffer
+    std::vector<size_t> next_seq(NUM_THREADS, 0);
+    foreach(const record& rec, buffer) {
+      ASSERT_EQ(rec.proc, sending_proc);
+      ASSERT_LT(rec.thread, NUM_THREADS);
+      ASSERT_LT(rec.seq, NUM_RECORDS);
+      ASSERT_EQ(rec.tag, record::expected_tag(rec.seq));
+      ASSERT_GE(rec.seq, next_seq[rec.thread]);
+      next_seq[rec.thread] = rec.seq + 1;
+      ASSERT_FALSE(received[rec.proc][rec.thread][rec.seq]);
+      received[rec.proc][rec.thread][rec.seq] = true;
+      ++num_received;
+      // local buffers are queued in the order they are filled
+      if (sending_proc == procid) {
+        ASSERT_EQ(rec.seq, last_local[rec.thread]);
+        ++last_local[rec.thread];
+      }
+    }
+  }
+  ASSERT_EQ(num_received, NUM_RECORDS * NUM_THREADS * numprocs);
+  // the records were split over many messages
+  ASSERT_GT(num_buffers, NUM_THREADS * numprocs);
+  for (size_t i = 0; i < NUM_THREADS; ++i) {
+    ASSERT_EQ(last_local[i], NUM_RECORDS);
+  }
+  // nothing is serialized for this machine
+  ASSERT_EQ(exchange.bytes_sent(procid), 0);
+  for (procid_t proc = 0; proc < numprocs; ++proc) {
+    if (proc != procid) ASSERT_GT(exchange.bytes_sent(proc), 0);
+  }
+  ASSERT_TRUE(exchange.empty());
+  dc.barrier();
+  std::cout << "Received " << num_received << " records in " 
+            << num_buffers << " buffers" << std::endl;
+  mpi_tools::finalize();
+}
@@ -0,0 +1,122 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <cstdlib>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/graph/communication_plan.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+/**
+ * The replica information of one machine, laid out like the vertex
+ * records of distributed_graph.
+ */
+struct mock_graph {
+  struct vertex_record {
+    procid_t owner;
+    vertex_id_type gvid;
+    fixed_dense_bitset<8> _mirrors;
+    const fixed_dense_bitset<8>& mirrors() const { return _mirrors; }
+    size_t num_mirrors() const { return _mirrors.popcount(); }
+  };
+  procid_t proc, nprocs;
+  std::vector<vertex_record> records;
+
+  size_t num_local_vertices() const { return records.size(); }
+  procid_t procid() const { return proc; }
+  procid_t numprocs() const { return nprocs; }
+  procid_t l_master(lvid_type lvid) const { return records[lvid].owner; }
+  vertex_id_type global_vid(lvid_type lvid) const { 
+    return records[lvid].gvid; 
+  }
+  const vertex_record& l_get_vertex_record(lvid_type lvid) const {
+    return records[lvid];
+  }
+};
+
+
+class CommunicationPlanTestSuite : public CxxTest::TestSuite {
+public:
+  void test_positions_agree(void) {
+    const procid_t NPROCS = 4;
+    const vertex_id_type NVERTS = 1000;
+    std::vector<mock_graph> graphs(NPROCS);
+    for (procid_t p = 0; p < NPROCS; ++p) {
+      graphs[p].proc = p;
+      graphs[p].nprocs = NPROCS;
+    }
+    // replicate each vertex on a random set of machines and add the
+    // local vertices of each machine in a scrambled order
+    srand(1);
+    std::vector<std::vector<procid_t> > replicas(NVERTS);
+    for (vertex_id_type vid = 0; vid < NVERTS; ++vid) {
+      const procid_t owner = rand() % NPROCS;
+      fixed_dense_bitset<8> mirrors;
+      mirrors.clear();
+      for (procid_t p = 0; p < NPROCS; ++p) {
+        if (p != owner && rand() % 2) mirrors.set_bit(p);
+      }
+      for (procid_t p = 0; p < NPROCS; ++p) {
+        if (p != owner && !mirrors.get(p)) continue;
+        mock_graph::vertex_record record;
+        record.owner = owner;
+        record.gvid = (vid * 7919) % NVERTS;
+        record._mirrors = mirrors;
+        graphs[p].records.push_back(record);
+      }
+    }
+    std::vector<communication_plan> plans(NPROCS);
+    for (procid_t p = 0; p < NPROCS; ++p) plans[p].build(graphs[p]);
+
+    for (procid_t p = 0; p < NPROCS; ++p) {
+      const mock_graph& graph = graphs[p];
+      for (lvid_type lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
+        const vertex_id_type vid = graph.global_vid(lvid);
+        if (graph.l_master(lvid) == p) {
+          // each mirror resolves the position to the same vertex
+          size_t i = 0;
+          foreach(uint32_t mirror, graph.l_get_vertex_record(lvid).mirrors()) {
+            const communication_plan::position_type pos = 
+              plans[p].mirror_position(lvid, i++);
+            const lvid_type remote = plans[mirror].lvid(p, pos);
+            TS_ASSERT_EQUALS(graphs[mirror].global_vid(remote), vid);
+            TS_ASSERT_EQUALS(plans[p].lvid(mirror, pos), lvid);
+          }
+        } else {
+          // the master resolves the position to the same vertex
+          const procid_t master = graph.l_master(lvid);
+          const communication_plan::position_type pos = 
+            plans[p].master_position(lvid);
+          const lvid_type remote = plans[master].lvid(p, pos);
+          TS_ASSERT_EQUALS(graphs[master].global_vid(remote), vid);
+          TS_ASSERT_EQUALS(plans[p].lvid(master, pos), lvid);
+        }
+      }
+      for (procid_t q = 0; q < NPROCS; ++q) {
+        TS_ASSERT_EQUALS(plans[p].plan_size(q), plans[q].plan_size(p));
+      }
+    }
+  }
+};
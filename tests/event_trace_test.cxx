@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/event_trace.hpp>
+using namespace graphlab;
+
+void record_spans(size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    TRACE_SCOPE("span");
+  }
+}
+
+void record_until(volatile bool* done) {
+  while (!*done) {
+    TRACE_SCOPE("span");
+    TRACE_INSTANT("instant");
+  }
+}
+
+class EventTraceTestSuite : public CxxTest::TestSuite {
+  std::string read_file(const std::string& fname) {
+    std::ifstream fin(fname.c_str());
+    std::stringstream strm;
+    strm << fin.rdbuf();
+    return strm.str();
+  }
+
+  size_t count(const std::string& s, const std::string& pattern) {
+    size_t ret = 0;
+    for (size_t pos = s.find(pattern); pos != std::string::npos;
+         pos = s.find(pattern, pos + 1)) ++ret;
+    return ret;
+  }
+
+public:
+  void test_disabled(void) {
+    event_trace::disable();
+    event_trace::clear();
+    record_spans(10);
+    TRACE_INSTANT("instant");
+    TS_ASSERT_EQUALS(event_trace::num_events(), 0);
+  }
+
+  void test_record(void) {
+    event_trace::clear();
+    event_trace::enable();
+    event_trace::set_thread_name("test main");
+    record_spans(3);
+    TRACE_ASYNC_BEGIN("async", 5);
+    TRACE_ASYNC_END("async", 5);
+    TRACE_INSTANT("instant");
+    thread_group group;
+    for (size_t i = 0; i < 4; ++i) group.launch(boost::bind(record_spans, 10));
+    group.join();
+    event_trace::disable();
+    record_spans(10);
+    TS_ASSERT_EQUALS(event_trace::num_events(), 46);
+
+    const std::string fname = "event_trace_test.0.json";
+    TS_ASSERT(event_trace::write_chrome_trace(fname, 0));
+    const std::string trace = read_file(fname);
+    TS_ASSERT_EQUALS(trace.substr(0, 15), "{\"traceEvents\":");
+    TS_ASSERT_EQUALS(count(trace, "\"name\":\"span\""), 43);
+    TS_ASSERT_EQUALS(count(trace, "\"ph\":\"X\""), 43);
+    TS_ASSERT_EQUALS(count(trace, "\"ph\":\"b\""), 1);
+    TS_ASSERT_EQUALS(count(trace, "\"ph\":\"e\""), 1);
+    TS_ASSERT_EQUALS(count(trace, "\"ph\":\"i\""), 1);
+    TS_ASSERT_EQUALS(count(trace, "\"test main\""), 1);
+    std::remove(fname.c_str());
+  }
+
+  void test_escape(void) {
+    event_trace::clear();
+    event_trace::enable();
+    event_trace::set_thread_name("main \"thread\"");
+    { TRACE_SCOPE("quote\" backslash\\ tab\t"); }
+    event_trace::disable();
+    const std::string fname = "event_trace_test.1.json";
+    TS_ASSERT(event_trace::write_chrome_trace(fname, 1));
+    const std::string trace = read_file(fname);
+    TS_ASSERT_EQUALS(count(trace, "\"quote\\\" backslash\\\\ tab\\u0009\""), 1);
+    TS_ASSERT_EQUALS(count(trace, "\"main \\\"thread\\\"\""), 1);
+    std::remove(fname.c_str());
+    event_trace::set_thread_name("test main");
+  }
+
+  void test_thread_exit(void) {
+    event_trace::clear();
+    const size_t nbuffers = event_trace::num_buffers();
+    event_trace::enable();
+    thread_group group;
+    for (size_t i = 0; i < 4; ++i) group.launch(boost::bind(record_spans, 10));
+    // threads which record nothing do not keep a buffer
+    for (size_t i = 0; i < 4; ++i) group.launch(boost::bind(record_spans, 0));
+    group.join();
+    event_trace::disable();
+    // the events of the exited threads are kept until the next clear
+    TS_ASSERT_EQUALS(event_trace::num_buffers(), nbuffers + 4);
+    TS_ASSERT_EQUALS(event_trace::num_events(), 40);
+    const std::string fname = "event_trace_test.2.json";
+    TS_ASSERT(event_trace::write_chrome_trace(fname, 2));
+    TS_ASSERT_EQUALS(count(read_file(fname), "\"name\":\"span\""), 40);
+    std::remove(fname.c_str());
+    event_trace::clear();
+    TS_ASSERT_EQUALS(event_trace::num_buffers(), nbuffers);
+    TS_ASSERT_EQUALS(event_trace::num_events(), 0);
+  }
+
+  void test_write_while_recording(void) {
+    event_trace::clear();
+    event_trace::enable(1024);
+    volatile bool done = false;
+    thread_group group;
+    for (size_t i = 0; i < 4; ++i) group.launch(boost::bind(record_until, &done));
+    const std::string fname = "event_trace_test.3.json";
+    for (size_t i = 0; i < 20; ++i) {
+      TS_ASSERT(event_trace::write_chrome_trace(fname, 3));
+      const std::string trace = read_file(fname);
+      TS_ASSERT_EQUALS(trace.substr(0, 15), "{\"traceEvents\":");
+      TS_ASSERT_EQUALS(trace.substr(trace.size() - 27), 
+                       "\n],\"displayTimeUnit\":\"ms\"}\n");
+      event_trace::clear();
+      TS_ASSERT(event_trace::num_events() <= 4 * 1024);
+    }
+    // the scopes still open when tracing is disabled are recorded
+    event_trace::disable();
+    done = true;
+    group.join();
+    std::remove(fname.c_str());
+    event_trace::clear();
+  }
+
+  void test_ring_buffer(void) {
+    event_trace::clear();
+    // the capacity applies to threads which have no buffer yet
+    event_trace::enable(5);
+    thread_group group;
+    group.launch(boost::bind(record_spans, 100));
+    group.join();
+    event_trace::disable();
+    // rounded up to 8 events, the oldest are overwritten
+    TS_ASSERT_EQUALS(event_trace::num_events(), 8);
+    event_trace::clear();
+    TS_ASSERT_EQUALS(event_trace::num_events(), 0);
+  }
+};
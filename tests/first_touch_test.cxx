@@ -0,0 +1,82 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/first_touch.hpp>
+using namespace graphlab;
+
+/**
+ * Trivially copyable but not trivially constructible
+ */
+struct distance_message {
+  float dist;
+  distance_message(float dist = 1e30f) : dist(dist) { }
+};
+
+/**
+ * Has a virtual table, like a vertex program
+ */
+struct virtual_program {
+  int value;
+  virtual_program() : value(7) { }
+  virtual ~virtual_program() { }
+  virtual int get() const { return value; }
+};
+
+class FirstTouchTestSuite : public CxxTest::TestSuite {
+public:
+  void test_supported_types(void) {
+    TS_ASSERT(first_touch_supported<double>::value);
+    TS_ASSERT(first_touch_supported<distance_message>::value);
+    TS_ASSERT(!first_touch_supported<virtual_program>::value);
+    TS_ASSERT(!first_touch_supported<std::vector<int> >::value);
+  }
+
+  void test_release_and_refill(void) {
+    const size_t n = 1 << 20;
+    std::vector<distance_message> vec(n, distance_message(5));
+    TS_ASSERT(release_vector_pages(vec));
+    // the released pages read as zero until they are refilled
+    TS_ASSERT_EQUALS(vec[n / 2].dist, 0);
+    first_touch_range(vec, 0, n / 3);
+    first_touch_range(vec, n / 3, n);
+    for (size_t i = 0; i < n; ++i) {
+      if (vec[i].dist != 1e30f) {
+        TS_FAIL("element not refilled");
+        break;
+      }
+    }
+  }
+
+  void test_unsupported_left_alone(void) {
+    const size_t n = 1 << 18;
+    std::vector<virtual_program> vec(n);
+    vec[n / 2].value = 3;
+    TS_ASSERT(!release_vector_pages(vec));
+    first_touch_range(vec, 0, n);
+    TS_ASSERT_EQUALS(vec[n / 2].get(), 3);
+    TS_ASSERT_EQUALS(vec[n - 1].get(), 7);
+  }
+};
@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <cmath>
+#include <limits>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/random.hpp>
+#include "../toolkits/graphical_models/message_kernels.hpp"
+using namespace graphlab;
+
+/*
+ * Compares the message kernels of pairwise_potential against the
+ * dense O(L^2) evaluation of the messages from the potential values.
+ */
+class MessageKernelsTestSuite : public CxxTest::TestSuite {
+  // a cavity with a spread of several units in log space
+  Eigen::VectorXd random_cavity(int n) {
+    Eigen::VectorXd cavity(n);
+    for (int j = 0; j < n; ++j) {
+      cavity(j) = random::fast_uniform<double>(-8, 0);
+    }
+    return cavity;
+  }
+
+  Eigen::VectorXd dense_sum_product(const pairwise_potential& potential,
+                                    const Eigen::VectorXd& cavity,
+                                    int nstates) {
+    Eigen::VectorXd message(nstates);
+    for (int i = 0; i < nstates; ++i) {
+      double shift = -std::numeric_limits<double>::infinity();
+      for (int j = 0; j < cavity.size(); ++j) {
+        shift = std::max(shift, potential(i, j) + cavity(j));
+      }
+      double sum = 0;
+      for (int j = 0; j < cavity.size(); ++j) {
+        sum += std::exp(potential(i, j) + cavity(j) - shift);
+      }
+      message(i) = shift + std::log(sum);
+    }
+    return message;
+  }
+
+  Eigen::VectorXd dense_max_product(const pairwise_potential& potential,
+                                    const Eigen::VectorXd& cavity,
+                                    int nstates) {
+    Eigen::VectorXd message(nstates);
+    for (int i = 0; i < nstates; ++i) {
+      message(i) = -std::numeric_limits<double>::infinity();
+      for (int j = 0; j < cavity.size(); ++j) {
+        message(i) = std::max(message(i), potential(i, j) + cavity(j));
+      }
+    }
+    return message;
+  }
+
+  // checks both kernels against the dense evaluation
+  void check(const pairwise_potential& potential, int nsend, int nreceive) {
+    const Eigen::VectorXd cavity = random_cavity(nsend);
+    Eigen::VectorXd message(nreceive);
+    potential.sum_product_message(cavity, message);
+    // the sum-product messages do not underflow below the floor
+    const double floor =
+      cavity.maxCoeff() + std::log(std::numeric_limits<double>::min());
+    const double sum_error =
+      (message - dense_sum_product(potential, cavity, nreceive)
+       .cwiseMax(Eigen::VectorXd::Constant(nreceive, floor)))
+      .cwiseAbs().maxCoeff();
+    TS_ASSERT_LESS_THAN(sum_error, 1.0E-9);
+    potential.max_product_message(cavity, message);
+    const double max_error =
+      (message - dense_max_product(potential, cavity, nreceive))
+      .cwiseAbs().maxCoeff();
+    TS_ASSERT_LESS_THAN(max_error, 1.0E-9);
+  }
+
+  void check_kind(pairwise_potential::kind_type kind) {
+    const double inf = std::numeric_limits<double>::infinity();
+    const double lambdas[] = { 0, 0.05, 0.3, 1, 4 };
+    const double truncations[] = { inf, 0, 1, 2.5, 9, 40 };
+    const int sizes[] = { 1, 2, 7, 32, 101 };
+    for (size_t l = 0; l < sizeof(lambdas) / sizeof(double); ++l) {
+      for (size_t t = 0; t < sizeof(truncations) / sizeof(double); ++t) {
+        const pairwise_potential potential(kind, lambdas[l], truncations[t]);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(int); ++s) {
+          check(potential, sizes[s], sizes[s]);
+        }
+        // the two variables may have different numbers of states
+        check(potential, 7, 32);
+        check(potential, 32, 7);
+      }
+    }
+  }
+
+public:
+  void test_linear(void) {
+    random::seed(1);
+    check_kind(pairwise_potential::LINEAR);
+  }
+
+  void test_quadratic(void) {
+    random::seed(2);
+    check_kind(pairwise_potential::QUADRATIC);
+  }
+
+  void test_potts(void) {
+    random::seed(3);
+    check_kind(pairwise_potential::POTTS);
+  }
+
+  void test_repulsive(void) {
+    random::seed(4);
+    check(pairwise_potential(pairwise_potential::LINEAR, -0.5, 3), 20, 20);
+    check(pairwise_potential(pairwise_potential::QUADRATIC, -0.1), 20, 12);
+  }
+
+  void test_table(void) {
+    random::seed(5);
+    Eigen::MatrixXd table(12, 9);
+    for (int i = 0; i < table.rows(); ++i) {
+      for (int j = 0; j < table.cols(); ++j) {
+        table(i, j) = random::fast_uniform<double>(-3, 1);
+      }
+    }
+    check(pairwise_potential(table), 9, 12);
+  }
+};
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+/*
+ * Runs the dynamic PageRank of the toolkit on a graph without sinks,
+ * on which the ranks of the fixed point sum to the number of
+ * vertices, and checks that the converged ranks keep that mass with
+ * and without the delta cache.  The hubs of the graph have a large
+ * out-degree, so their changes are small on every single out-edge.
+ */
+
+#include <cmath>
+#include <iostream>
+
+#include <graphlab.hpp>
+
+#define main pagerank_toolkit_main
+#include "../toolkits/graph_analytics/pagerank.cpp"
+#undef main
+
+
+const size_t NVERTICES = 2000;
+const size_t NHUBS = 20;
+
+double rank_value(const graph_type::vertex_type& vertex) {
+  return vertex.data();
+}
+
+/*
+ * The first NHUBS vertices link to every other vertex, which links
+ * back to every hub.
+ */
+void build_hub_graph(graphlab::distributed_control& dc, graph_type& graph) {
+  if (dc.procid() == 0) {
+    for (graphlab::vertex_id_type hub = 0; hub < NHUBS; ++hub) {
+      for (graphlab::vertex_id_type i = NHUBS; i < NVERTICES; ++i) {
+        graph.add_edge(hub, i);
+        graph.add_edge(i, hub);
+      }
+    }
+  }
+  graph.finalize();
+}
+
+void test_rank_mass(graphlab::distributed_control& dc,
+                    graphlab::command_line_options clopts,
+                    const std::string& engine_type,
+                    bool use_delta) {
+  USE_DELTA_CACHE = use_delta;
+  clopts.get_engine_args().set_option("use_cache", use_delta);
+  graph_type graph(dc, clopts);
+  build_hub_graph(dc, graph);
+  graph.transform_vertices(init_vertex);
+  graphlab::omni_engine<pagerank> engine(dc, graph, engine_type, clopts);
+  engine.signal_all();
+  engine.start();
+  const double mass = graph.map_reduce_vertices<double>(rank_value);
+  dc.cout() << engine_type << (use_delta ? " delta" : "")
+            << ": rank mass " << mass << " of " << NVERTICES << std::endl;
+  // Every vertex stops with less than TOLERANCE of change left, which
+  // the damping spreads over at most 1 / RESET_PROB times the mass
+  ASSERT_LT(std::fabs(mass - NVERTICES), NVERTICES * TOLERANCE / RESET_PROB);
+}
+
+
+int main(int argc, char** argv) {
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::dc_init_param rpc_parameters;
+  graphlab::init_param_from_mpi(rpc_parameters);
+  graphlab::distributed_control dc(rpc_parameters);
+  global_logger().set_log_level(LOG_WARNING);
+
+  graphlab::command_line_options clopts("PageRank test.");
+  TOLERANCE = 1.0E-3;
+  test_rank_mass(dc, clopts, "synchronous", false);
+  test_rank_mass(dc, clopts, "synchronous", true);
+  test_rank_mass(dc, clopts, "asynchronous", false);
+  test_rank_mass(dc, clopts, "asynchronous", true);
+
+  graphlab::mpi_tools::finalize();
+} // end of main
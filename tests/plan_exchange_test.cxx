@@ -0,0 +1,144 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/rpc/plan_exchange.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+typedef plan_exchange<double> exchange_type;
+
+// the value of position pos for machine proc
+struct value_getter {
+  size_t calls;
+  value_getter() : calls(0) { }
+  double operator()(procid_t proc, exchange_type::position_type pos) {
+    ++calls;
+    return proc * 1000000.0 + pos + 0.5;
+  }
+};
+
+class PlanExchangeTestSuite : public CxxTest::TestSuite {
+  // writes the marked positions of [begin, end) and reads them back,
+  // returning the size of the chunk in bytes
+  size_t round_trip(dense_bitset& marks, size_t begin, size_t end,
+                    exchange_type::buffer_type& buffer) {
+    charstream strm(128);
+    oarchive oarc(strm);
+    value_getter get;
+    exchange_type::write_chunk(oarc, marks, begin, end, 3, get);
+    strm.flush();
+    const size_t bytes = strm->size();
+    boost::iostreams::stream<boost::iostreams::array_source> 
+      istrm(strm->c_str(), bytes);
+    iarchive iarc(istrm);
+    exchange_type::read_chunk(iarc, buffer);
+    TS_ASSERT_EQUALS(get.calls, buffer.values.size());
+    return bytes;
+  }
+
+  void check(const std::vector<size_t>& expected, 
+             const exchange_type::buffer_type& buffer) {
+    TS_ASSERT_EQUALS(buffer.positions.size(), expected.size());
+    TS_ASSERT_EQUALS(buffer.values.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      TS_ASSERT_EQUALS(buffer.positions[i], expected[i]);
+      TS_ASSERT_EQUALS(buffer.values[i], 3000000.0 + expected[i] + 0.5);
+    }
+  }
+
+  // the size of the chunk as (position, value) records
+  static size_t record_bytes(size_t n) {
+    return n * (sizeof(exchange_type::position_type) + sizeof(double));
+  }
+
+public:
+  void test_dense_chunk(void) {
+    // every third position is marked: sent as a bitmap
+    dense_bitset marks(10000);
+    marks.clear();
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < 10000; i += 3) {
+      marks.set_bit(i);
+      expected.push_back(i);
+    }
+    exchange_type::buffer_type buffer;
+    const size_t bytes = round_trip(marks, 0, 10000, buffer);
+    check(expected, buffer);
+    TS_ASSERT_LESS_THAN(bytes, record_bytes(expected.size()));
+    // bitmap and values, plus a small header
+    TS_ASSERT_LESS_THAN(bytes, 10000 / 8 + 8 + 
+                        expected.size() * sizeof(double) + 16);
+    // the marks are cleared
+    TS_ASSERT_EQUALS(marks.popcount(), 0);
+  }
+
+  void test_sparse_chunk(void) {
+    // a few positions in the second chunk: sent as a list
+    dense_bitset marks(2 * exchange_type::CHUNK_SIZE);
+    marks.clear();
+    size_t marked[4] = {5, 64, 65, 40000};
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < 4; ++i) {
+      marks.set_bit(exchange_type::CHUNK_SIZE + marked[i]);
+      expected.push_back(exchange_type::CHUNK_SIZE + marked[i]);
+    }
+    // a mark outside the chunk is kept
+    marks.set_bit(7);
+    exchange_type::buffer_type buffer;
+    const size_t bytes = round_trip(marks, exchange_type::CHUNK_SIZE, 
+                                    2 * exchange_type::CHUNK_SIZE, buffer);
+    check(expected, buffer);
+    TS_ASSERT(bytes <= record_bytes(expected.size()) + 16);
+    TS_ASSERT_EQUALS(marks.popcount(), 1);
+    TS_ASSERT(marks.get(7));
+  }
+
+  void test_partial_chunk(void) {
+    // a chunk which does not end on a word boundary
+    dense_bitset marks(100);
+    marks.clear();
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < 100; ++i) {
+      if (i % 2 == 0 || i == 99) {
+        marks.set_bit(i);
+        expected.push_back(i);
+      }
+    }
+    exchange_type::buffer_type buffer;
+    round_trip(marks, 0, 100, buffer);
+    check(expected, buffer);
+  }
+
+  void test_empty_chunk(void) {
+    dense_bitset marks(1000);
+    marks.clear();
+    exchange_type::buffer_type buffer;
+    buffer.positions.push_back(1);
+    round_trip(marks, 0, 1000, buffer);
+    TS_ASSERT(buffer.positions.empty());
+    TS_ASSERT(buffer.values.empty());
+  }
+};
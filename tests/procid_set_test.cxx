@@ -0,0 +1,115 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <set>
+#include <vector>
+#include <sstream>
+#include <cstdlib>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/procid_set.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+class ProcidSetTestSuite : public CxxTest::TestSuite {
+  // checks that s holds exactly the elements of ref in increasing order
+  void check(const procid_set& s, const std::set<procid_t>& ref) {
+    TS_ASSERT_EQUALS(s.popcount(), ref.size());
+    std::vector<procid_t> elems(s.begin(), s.end());
+    TS_ASSERT(elems == std::vector<procid_t>(ref.begin(), ref.end()));
+    uint32_t b = 0;
+    size_t count = 0;
+    if (s.first_bit(b)) {
+      do {
+        TS_ASSERT(ref.count(b));
+        ++count;
+      } while (s.next_bit(b));
+    }
+    TS_ASSERT_EQUALS(count, ref.size());
+    for (procid_t p = 0; p < 2048; ++p) {
+      TS_ASSERT_EQUALS(s.get(p), ref.count(p) > 0);
+    }
+  }
+
+public:
+  void test_inline(void) {
+    procid_set s;
+    std::set<procid_t> ref;
+    TS_ASSERT(s.empty());
+    TS_ASSERT_EQUALS(s.set_bit(70), false);
+    TS_ASSERT_EQUALS(s.set_bit(3), false);
+    TS_ASSERT_EQUALS(s.set_bit(70), true);
+    TS_ASSERT_EQUALS(s.set_bit(1023), false);
+    ref.insert(70); ref.insert(3); ref.insert(1023);
+    check(s, ref);
+    TS_ASSERT_EQUALS(s.clear_bit(3), true);
+    TS_ASSERT_EQUALS(s.clear_bit(3), false);
+    ref.erase(3);
+    check(s, ref);
+  }
+
+  void test_spill(void) {
+    procid_set s;
+    std::set<procid_t> ref;
+    srand(1);
+    for (size_t i = 0; i < 500; ++i) {
+      const procid_t p = rand() % 2048;
+      TS_ASSERT_EQUALS(s.set_bit(p), ref.count(p) > 0);
+      ref.insert(p);
+      if (i % 3 == 0) {
+        const procid_t q = rand() % 2048;
+        TS_ASSERT_EQUALS(s.clear_bit(q), ref.erase(q) > 0);
+      }
+    }
+    check(s, ref);
+
+    // copies are deep
+    procid_set copy = s;
+    s.clear();
+    check(s, std::set<procid_t>());
+    check(copy, ref);
+    s = copy;
+    copy.set_bit(*ref.begin() + 1);
+    check(s, ref);
+  }
+
+  void test_serialize(void) {
+    procid_set small, large;
+    std::set<procid_t> small_ref, large_ref;
+    small.set_bit(5); small_ref.insert(5);
+    for (procid_t p = 0; p < 1024; p += 7) {
+      large.set_bit(p); 
+      large_ref.insert(p);
+    }
+    std::stringstream strm;
+    oarchive oarc(strm);
+    oarc << small << large;
+    strm.flush();
+    iarchive iarc(strm);
+    procid_set small2, large2;
+    large2.set_bit(1);
+    iarc >> small2 >> large2;
+    check(small2, small_ref);
+    check(large2, large_ref);
+  }
+};
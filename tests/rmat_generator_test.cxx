@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <algorithm>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/graph/rmat_generator.hpp>
+using namespace graphlab;
+
+class RmatGeneratorTestSuite : public CxxTest::TestSuite {
+public:
+  void test_range_and_determinism(void) {
+    rmat_generator gen(10, 7), same(10, 7), other(10, 8);
+    TS_ASSERT_EQUALS(gen.num_vertices(), 1024);
+    size_t differ = 0;
+    for (uint64_t i = 0; i < 10000; ++i) {
+      const std::pair<uint64_t, uint64_t> e = gen.edge(i);
+      TS_ASSERT_LESS_THAN(e.first, 1024);
+      TS_ASSERT_LESS_THAN(e.second, 1024);
+      // edge i only depends on the seed and i
+      TS_ASSERT(e == same.edge(i));
+      differ += (e != other.edge(i));
+      const double w = gen.weight(e.first, e.second);
+      TS_ASSERT(w >= 0 && w < 1);
+      TS_ASSERT_EQUALS(w, same.weight(e.first, e.second));
+    }
+    TS_ASSERT_LESS_THAN(9000, differ);
+  }
+
+  void test_skew(void) {
+    // with the Graph500 parameters a few vertices get most of the edges
+    const size_t scale = 12;
+    rmat_generator gen(scale);
+    std::vector<size_t> degree(gen.num_vertices(), 0);
+    const size_t nedges = 16 * gen.num_vertices();
+    for (uint64_t i = 0; i < nedges; ++i) ++degree[gen.edge(i).first];
+    std::sort(degree.begin(), degree.end());
+    size_t top = 0;
+    for (size_t i = degree.size() - degree.size() / 100;
+         i < degree.size(); ++i) top += degree[i];
+    // the top 1% of the sources have over 10% of the edges
+    TS_ASSERT_LESS_THAN(nedges / 10, top);
+    // and many vertices have no out edges at all
+    TS_ASSERT_EQUALS(degree[degree.size() / 10], 0);
+  }
+
+  void test_uniform(void) {
+    // a = b = c = 1/4 gives an Erdos-Renyi graph whose ids cover the range
+    rmat_generator gen(8, 1, 0.25, 0.25, 0.25);
+    std::vector<size_t> degree(gen.num_vertices(), 0);
+    for (uint64_t i = 0; i < 256 * 64; ++i) ++degree[gen.edge(i).second];
+    TS_ASSERT_LESS_THAN(*std::max_element(degree.begin(), degree.end()), 128);
+    TS_ASSERT_LESS_THAN(20, *std::min_element(degree.begin(), degree.end()));
+  }
+};
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/sorted_set_intersection.hpp>
+#include <graphlab/util/random.hpp>
+using namespace graphlab;
+
+class SortedSetIntersectionTestSuite : public CxxTest::TestSuite {
+  // n distinct sorted values below range
+  template<typename T>
+  std::vector<T> random_set(size_t n, size_t range) {
+    std::vector<T> ret;
+    for (size_t i = 0; i < n; ++i) {
+      ret.push_back(random::fast_uniform<size_t>(0, range - 1));
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+  }
+
+  template<typename T>
+  void check(size_t na, size_t nb, size_t range) {
+    std::vector<T> a = random_set<T>(na, range), b = random_set<T>(nb, range);
+    std::vector<T> common;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(common));
+    TS_ASSERT_EQUALS(count_sorted_intersection(a, b), common.size());
+    TS_ASSERT_EQUALS(count_sorted_intersection(b, a), common.size());
+  }
+
+public:
+  void test_merge(void) {
+    random::seed(1);
+    for (size_t n = 0; n < 100; ++n) {
+      check<uint32_t>(n, n + random::fast_uniform<size_t>(0, 20), 2 * n + 10);
+      check<uint64_t>(n, n + random::fast_uniform<size_t>(0, 20), 2 * n + 10);
+    }
+    check<uint32_t>(10000, 20000, 40000);
+    // equal sets
+    std::vector<uint32_t> a = random_set<uint32_t>(1000, 5000);
+    TS_ASSERT_EQUALS(count_sorted_intersection(a, a), a.size());
+  }
+
+  void test_gallop(void) {
+    random::seed(2);
+    for (size_t n = 1; n < 20; ++n) {
+      check<uint32_t>(n, 100 * n * GALLOP_RATIO, 200 * n * GALLOP_RATIO);
+      check<uint64_t>(n, 100 * n * GALLOP_RATIO, 200 * n * GALLOP_RATIO);
+    }
+    // every element of the smaller set is in the larger one
+    std::vector<uint32_t> b = random_set<uint32_t>(100000, 1000000), a;
+    for (size_t i = 0; i < b.size(); i += 997) a.push_back(b[i]);
+    TS_ASSERT_EQUALS(count_sorted_intersection(a, b), a.size());
+  }
+
+  void test_disjoint(void) {
+    std::vector<uint32_t> a, b;
+    TS_ASSERT_EQUALS(count_sorted_intersection(a, b), 0);
+    for (uint32_t i = 0; i < 100; ++i) {
+      a.push_back(2 * i);
+      b.push_back(2 * i + 1);
+    }
+    TS_ASSERT_EQUALS(count_sorted_intersection(a, b), 0);
+    b.clear();
+    for (uint32_t i = 0; i < 100; ++i) b.push_back(1000 + i);
+    TS_ASSERT_EQUALS(count_sorted_intersection(a, b), 0);
+  }
+};
@@ -20,9 +20,14 @@
  *
  */
 
+#include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <limits>
 
 
 // #include <cxxtest/TestSuite.h>
@@ -207,9 +212,433 @@ void test_messages(graphlab::distributed_control& dc,
 }
 
 
+/**
+ * A message which keeps the smallest value sent to a vertex. The
+ * default constructed message (0) is below every value sent, so it is
+ * not the identity of +=.
+ */
+struct min_message : public graphlab::IS_POD_TYPE {
+  int value;
+  min_message(int value = 0) : value(value) { }
+  min_message& operator+=(const min_message& other) {
+    value = std::min(value, other.value);
+    return *this;
+  }
+}; // end of min_message
+
+
+/**
+ * In the first iteration every vertex sends its id + 1 to its out
+ * neighbors. In the second iteration each receiver checks the
+ * combined message against the minimum gathered over its in edges.
+ */
+class min_messages : 
+  public graphlab::ivertex_program<graph_type, min_message, min_message>,
+  public graphlab::IS_POD_TYPE {
+  min_message received;
+public:
+  void init(icontext_type& context, const vertex_type& vertex, 
+            const min_message& msg) {
+    received = msg;
+  }
+  edge_dir_type 
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return context.iteration() == 0 ? graphlab::NO_EDGES : graphlab::IN_EDGES;
+  }
+  min_message gather(icontext_type& context, const vertex_type& vertex, 
+                     edge_type& edge) const {
+    return min_message(edge.source().id() + 1);
+  }
+  void apply(icontext_type& context, vertex_type& vertex, 
+             const min_message& total) {
+    if (context.iteration() == 0) return;
+    ASSERT_GT(vertex.num_in_edges(), 0);
+    ASSERT_EQ(received.value, total.value);
+    vertex.data() = received.value;
+  }
+  edge_dir_type 
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return context.iteration() == 0 ? graphlab::OUT_EDGES : graphlab::NO_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex, 
+               edge_type& edge) const {
+    context.signal(edge.target(), min_message(vertex.id() + 1));
+  }
+}; // end of min_messages
+
+int count_received(const graph_type::vertex_type& vertex) {
+  return vertex.data() > 0;
+}
+
+int count_with_in_edges(const graph_type::vertex_type& vertex) {
+  return vertex.num_in_edges() > 0;
+}
+
+void clear_vertex_data(graph_type::vertex_type& vertex) {
+  vertex.data() = 0;
+}
+
+void test_min_messages(graphlab::distributed_control& dc,
+                       graphlab::command_line_options& clopts,
+                       graph_type& graph, bool lockfree) {
+  std::cout << "Testing min combined messages (lockfree_messages = " 
+            << lockfree << ")" << std::endl;
+  typedef graphlab::synchronous_engine<min_messages> engine_type;
+  // or else lockfree_messages falls back to locking
+  ASSERT_TRUE(graphlab::atomic_combine_supported<min_message>::value);
+  graphlab::command_line_options min_opts = clopts;
+  // several threads signal the high in-degree vertices concurrently
+  min_opts.set_ncpus(4);
+  min_opts.engine_args.set_option("lockfree_messages", lockfree);
+  graph.transform_vertices(clear_vertex_data);
+  engine_type engine(dc, graph, min_opts);
+  engine.signal_all(min_message(std::numeric_limits<int>::max()));
+  engine.start();
+  ASSERT_EQ(engine.iteration(), 2);
+  // every vertex with an in edge received (and checked) its message
+  ASSERT_EQ(graph.map_reduce_vertices<int>(count_received),
+            graph.map_reduce_vertices<int>(count_with_in_edges));
+  graph.transform_vertices(clear_vertex_data);
+  std::cout << "Finished" << std::endl;
+}
+
+
+/**
+ * Every vertex scatters in the first super-step, which pulls the
+ * scatter, and only one in a thousand in the second, which pushes it.
+ * The receivers check and record the number of messages they got.
+ */
+class direction_messages : 
+  public graphlab::ivertex_program<graph_type, int, int>,
+  public graphlab::IS_POD_TYPE {
+  int message_value;
+public:
+  void init(icontext_type& context, const vertex_type& vertex,
+            const message_type& msg) {
+    message_value = msg;
+  } 
+  edge_dir_type 
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+  void apply(icontext_type& context, vertex_type& vertex, 
+             const gather_type& total) {
+    if (context.iteration() == 1) {
+      ASSERT_EQ(message_value, int(vertex.num_in_edges()));
+    } else if (context.iteration() == 2) {
+      vertex.data() = message_value;
+    }
+  }
+  edge_dir_type 
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    if (context.iteration() == 0 || 
+        (context.iteration() == 1 && vertex.id() % 1000 == 0)) {
+      return graphlab::OUT_EDGES;
+    }
+    return graphlab::NO_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex, 
+               edge_type& edge) const {
+    context.signal(edge.target(), 1);
+  }
+}; // end of direction_messages
+
+size_t sparse_source_out_edges(const graph_type::vertex_type& vertex) {
+  return vertex.id() % 1000 == 0 ? vertex.num_out_edges() : 0;
+}
+
+size_t vertex_data_sum(const graph_type::vertex_type& vertex) {
+  return vertex.data();
+}
+
+/**
+ * Reads the value of a counter of the given super-step from the
+ * engine_profile.json page.
+ */
+size_t superstep_counter(const std::string& json, size_t iteration, 
+                         const std::string& name) {
+  size_t pos = json.find("\"iteration\": " + graphlab::tostr(iteration) + ",");
+  ASSERT_NE(pos, std::string::npos);
+  pos = json.find("\"" + name + "\": ", pos);
+  ASSERT_NE(pos, std::string::npos);
+  return atol(json.c_str() + pos + name.size() + 4);
+}
+
+void test_scatter_direction(graphlab::distributed_control& dc,
+                            graphlab::command_line_options& clopts,
+                            graph_type& graph) {
+  std::cout << "Testing pushed and pulled scatters" << std::endl;
+  typedef graphlab::synchronous_engine<direction_messages> engine_type;
+  graphlab::command_line_options direction_opts = clopts;
+  direction_opts.set_ncpus(4);
+  direction_opts.engine_args.set_option("frontier_alpha", 14);
+  direction_opts.engine_args.set_option("profile", true);
+  graph.transform_vertices(clear_vertex_data);
+  engine_type engine(dc, graph, direction_opts);
+  engine.signal_all(0);
+  engine.start();
+  ASSERT_EQ(engine.iteration(), 3);
+  const size_t sparse_edges = 
+    graph.map_reduce_vertices<size_t>(sparse_source_out_edges);
+  ASSERT_GT(sparse_edges, 0);
+  ASSERT_EQ(graph.map_reduce_vertices<size_t>(vertex_data_sum), sparse_edges);
+  if (dc.procid() == 0) {
+    const std::string json = 
+      graphlab::get_engine_profile_log().json(0, size_t(-1));
+    // all vertices are active: every machine pulls
+    ASSERT_EQ(superstep_counter(json, 0, "scatter_edges"), graph.num_edges());
+    ASSERT_EQ(superstep_counter(json, 0, "pulled_scatter_edges"), 
+              graph.num_edges());
+    // a few sources: every machine pushes
+    ASSERT_EQ(superstep_counter(json, 1, "scatter_edges"), sparse_edges);
+    ASSERT_EQ(superstep_counter(json, 1, "pulled_scatter_edges"), 0);
+  }
+  graph.transform_vertices(clear_vertex_data);
+  std::cout << "Finished" << std::endl;
+}
 
 
+/**
+ * The number of processors an engine thread is expected to be allowed
+ * to run on while it runs a phase.
+ */
+int expected_cpu_count = 0;
+
+int thread_cpu_count() {
+#if defined __linux__
+  cpu_set_t mask;
+  pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask);
+  return CPU_COUNT(&mask);
+#else
+  return 0;
+#endif
+}
 
+/**
+ * Counts the in edges of every vertex through both the gather and the
+ * messages, whose arrays are refilled by the owning threads with
+ * numa_aware, and checks the affinity of the engine threads.
+ */
+class numa_messages : 
+  public graphlab::ivertex_program<graph_type, int, int>,
+  public graphlab::IS_POD_TYPE {
+  int message_value;
+public:
+  void init(icontext_type& context, const vertex_type& vertex,
+            const message_type& msg) {
+    message_value = msg;
+  } 
+  edge_dir_type 
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return context.iteration() == 1 ? graphlab::IN_EDGES : graphlab::NO_EDGES;
+  }
+  gather_type gather(icontext_type& context, const vertex_type& vertex, 
+                     edge_type& edge) const {
+    return 1;
+  }
+  void apply(icontext_type& context, vertex_type& vertex, 
+             const gather_type& total) {
+    ASSERT_EQ(thread_cpu_count(), expected_cpu_count);
+    if (context.iteration() == 1) {
+      ASSERT_EQ(message_value, int(vertex.num_in_edges()));
+      ASSERT_EQ(total, int(vertex.num_in_edges()));
+      vertex.data() = total;
+    }
+  }
+  edge_dir_type 
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return context.iteration() == 0 ? graphlab::OUT_EDGES : graphlab::NO_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex, 
+               edge_type& edge) const {
+    context.signal(edge.target(), 1);
+  }
+}; // end of numa_messages
+
+void test_numa_aware(graphlab::distributed_control& dc,
+                     graphlab::command_line_options& clopts,
+                     graph_type& graph, bool pin_threads) {
+  std::cout << "Testing NUMA aware vertex ranges (pin_threads = " 
+            << pin_threads << ")" << std::endl;
+  typedef graphlab::synchronous_engine<numa_messages> engine_type;
+  graphlab::command_line_options numa_opts = clopts;
+  numa_opts.set_ncpus(4);
+  numa_opts.engine_args.set_option("numa_aware", true);
+  numa_opts.engine_args.set_option("pin_threads", pin_threads);
+  const int calling_cpu_count = thread_cpu_count();
+  // the threads are only bound when asked to
+  expected_cpu_count = pin_threads ? 1 : calling_cpu_count;
+  graph.transform_vertices(clear_vertex_data);
+  engine_type engine(dc, graph, numa_opts);
+  engine.signal_all(0);
+  engine.start();
+  ASSERT_EQ(engine.iteration(), 2);
+  ASSERT_EQ(graph.map_reduce_vertices<size_t>(vertex_data_sum), 
+            graph.num_edges());
+  // the affinity of the calling thread is left alone
+  ASSERT_EQ(thread_cpu_count(), calling_cpu_count);
+  graph.transform_vertices(clear_vertex_data);
+  std::cout << "Finished" << std::endl;
+}
+
+
+
+class unchanged_vertex_data : 
+  public graphlab::ivertex_program<graph_type, int>,
+  public graphlab::IS_POD_TYPE {
+public:
+  edge_dir_type 
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::IN_EDGES;
+  }
+  gather_type 
+  gather(icontext_type& context, const vertex_type& vertex, 
+         edge_type& edge) const {
+    return 1;    
+  }
+  void apply(icontext_type& context, vertex_type& vertex, 
+             const gather_type& total) {
+    // odd iterations declare the data unchanged explicitly, even
+    // iterations rely on the engine comparing the data
+    if (vertex.data() == total && context.iteration() % 2 == 1) {
+      context.vertex_data_unchanged(vertex);
+    }
+    vertex.data() = total;
+    context.signal(vertex);
+  }
+  edge_dir_type
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::OUT_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex, 
+               edge_type& edge) const {
+    // mirrors must still see the data of the first apply
+    ASSERT_EQ(vertex.data(), int(vertex.num_in_edges()));
+  }
+}; // end of unchanged_vertex_data
+
+
+void test_skip_unchanged_vdata(graphlab::distributed_control& dc,
+                               graphlab::command_line_options& clopts,
+                               graph_type& graph) {
+  std::cout << "Testing skipping unchanged vertex data" << std::endl;
+  typedef graphlab::synchronous_engine<unchanged_vertex_data> engine_type;
+  graphlab::command_line_options skip_opts = clopts;
+  skip_opts.engine_args.set_option("skip_unchanged_vdata", true);
+  engine_type engine(dc, graph, skip_opts);
+  engine.signal_all();
+  engine.start();
+  std::cout << "Finished" << std::endl;
+  graph.transform_vertices(clear_vertex_data);
+}
+
+
+
+class superstep_order : 
+  public graphlab::ivertex_program<graph_type, int>,
+  public graphlab::IS_POD_TYPE {
+public:
+  edge_dir_type 
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    // some vertices apply without gathering
+    if (vertex.id() % 3 == 0) return graphlab::NO_EDGES;
+    return graphlab::IN_EDGES;
+  }
+  gather_type 
+  gather(icontext_type& context, const vertex_type& vertex, 
+         edge_type& edge) const {
+    // no neighbor may have applied in this super-step yet
+    ASSERT_EQ(edge.source().data(), context.iteration());
+    return 1;    
+  }
+  void apply(icontext_type& context, vertex_type& vertex, 
+             const gather_type& total) {
+    if (vertex.id() % 3 == 0) ASSERT_EQ(total, 0);
+    else ASSERT_EQ(total, int(vertex.num_in_edges()));
+    ASSERT_EQ(vertex.data(), context.iteration());
+    vertex.data() = context.iteration() + 1;
+    context.signal(vertex);
+  }
+  edge_dir_type
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::OUT_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex, 
+               edge_type& edge) const {
+    // all applies have been synchronized with the mirrors
+    ASSERT_EQ(edge.source().data(), context.iteration() + 1);
+    ASSERT_EQ(edge.target().data(), context.iteration() + 1);
+  }
+}; // end of superstep_order
+
+
+void test_pipelined_apply(graphlab::distributed_control& dc,
+                          graphlab::command_line_options& clopts,
+                          graph_type& graph) {
+  std::cout << "Testing pipelined gathers and applys" << std::endl;
+  typedef graphlab::synchronous_engine<superstep_order> engine_type;
+  graphlab::command_line_options pipelined_opts = clopts;
+  pipelined_opts.engine_args.set_option("pipelined_apply", true);
+  engine_type engine(dc, graph, pipelined_opts);
+  engine.signal_all();
+  engine.start();
+  std::cout << "Finished" << std::endl;
+  graph.transform_vertices(clear_vertex_data);
+}
+
+
+void test_profile(graphlab::distributed_control& dc,
+                  graphlab::command_line_options& clopts,
+                  graph_type& graph) {
+  std::cout << "Testing the superstep profile" << std::endl;
+  typedef graphlab::synchronous_engine<count_in_neighbors> engine_type;
+  graphlab::command_line_options profile_opts = clopts;
+  profile_opts.engine_args.set_option("profile", true);
+  engine_type engine(dc, graph, profile_opts);
+  engine.signal_all();
+  engine.start();
+  if (dc.procid() == 0) {
+    graphlab::engine_profile_log& profile_log = 
+      graphlab::get_engine_profile_log();
+    const std::string json = profile_log.json(0, size_t(-1));
+    ASSERT_NE(json.find("\"num_supersteps\": 10"), std::string::npos);
+    ASSERT_NE(json.find("\"name\": \"gather\""), std::string::npos);
+    // only the last superstep
+    const std::string last = profile_log.json(0, 1);
+    ASSERT_NE(last.find("\"iteration\": 9"), std::string::npos);
+    ASSERT_EQ(last.find("\"iteration\": 8"), std::string::npos);
+    const std::string metrics = profile_log.prometheus();
+    ASSERT_NE(metrics.find("graphlab_engine_supersteps_total 10"), 
+              std::string::npos);
+  }
+  std::cout << "Finished" << std::endl;
+}
+
+
+void test_trace(graphlab::distributed_control& dc,
+                graphlab::command_line_options& clopts,
+                graph_type& graph) {
+  std::cout << "Testing the event trace" << std::endl;
+  typedef graphlab::synchronous_engine<count_in_neighbors> engine_type;
+  graphlab::command_line_options trace_opts = clopts;
+  trace_opts.engine_args.set_option("trace", "synchronous_engine_test");
+  engine_type engine(dc, graph, trace_opts);
+  engine.signal_all();
+  engine.start();
+  ASSERT_FALSE(graphlab::event_trace::is_enabled());
+  const std::string fname = 
+    "synchronous_engine_test." + graphlab::tostr(dc.procid()) + ".json";
+  std::ifstream fin(fname.c_str());
+  std::stringstream strm;
+  strm << fin.rdbuf();
+  const std::string trace = strm.str();
+  ASSERT_NE(trace.find("\"name\":\"superstep\""), std::string::npos);
+  ASSERT_NE(trace.find("\"name\":\"gather\""), std::string::npos);
+  ASSERT_NE(trace.find("\"name\":\"rpc_barrier\""), std::string::npos);
+  fin.close();
+  std::remove(fname.c_str());
+  std::cout << "Finished" << std::endl;
+}
 
 
 class count_aggregators : 
@@ -289,6 +718,15 @@ int main(int argc, char** argv) {
   test_out_neighbors(dc, clopts, graph);
   test_all_neighbors(dc, clopts, graph);
   test_messages(dc, clopts, graph);
+  test_min_messages(dc, clopts, graph, false);
+  test_min_messages(dc, clopts, graph, true);
+  test_scatter_direction(dc, clopts, graph);
+  test_numa_aware(dc, clopts, graph, false);
+  test_numa_aware(dc, clopts, graph, true);
+  test_skip_unchanged_vdata(dc, clopts, graph);
+  test_pipelined_apply(dc, clopts, graph);
+  test_profile(dc, clopts, graph);
+  test_trace(dc, clopts, graph);
   test_count_aggregators(dc, clopts, graph);
 
   graphlab::mpi_tools::finalize();
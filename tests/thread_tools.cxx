@@ -156,6 +156,26 @@ void test_pool_exception_forwarding(){
 
 
 
+void test_scoped_affinity() {
+#if defined __linux__
+  cpu_set_t before, pinned, after;
+  TS_ASSERT_EQUALS(pthread_getaffinity_np(pthread_self(), 
+                                          sizeof(before), &before), 0);
+  {
+    scoped_cpu_affinity affinity(CPU_COUNT(&before) + 1);
+    pthread_getaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+    // bound to one of the processors allowed before
+    TS_ASSERT_EQUALS(CPU_COUNT(&pinned), 1);
+    CPU_AND(&pinned, &pinned, &before);
+    TS_ASSERT_EQUALS(CPU_COUNT(&pinned), 1);
+  }
+  pthread_getaffinity_np(pthread_self(), sizeof(after), &after);
+  TS_ASSERT(CPU_EQUAL(&before, &after));
+#endif
+}
+
+
+
 class ThreadToolsTestSuite : public CxxTest::TestSuite {
 public:
   void test_thread_group_exception(void) {
@@ -170,4 +190,8 @@ public:
     test_pool_exception_forwarding();
   }
 
+  void test_scoped_cpu_affinity(void) {
+    test_scoped_affinity();
+  }
+
 };
@@ -0,0 +1,160 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+/*
+ * Runs the 64 bit global vertex id path (USE_VID64) end to end: global
+ * ids above 2^32 go through the parser, the ingress records, vid2lvid
+ * and the engine exchanges. The ids of the test collide when truncated
+ * to 32 bits, so any truncation merges the components of the graph.
+ *
+ * The 64 bit path only changes headers, so this test is built with
+ * USE_VID64 in every build (see tests/CMakeLists.txt).
+ */
+
+#include <iostream>
+#include <limits>
+
+#include <graphlab.hpp>
+
+#ifndef USE_VID64
+#error "vid64_test must be compiled with USE_VID64"
+#endif
+
+typedef graphlab::vertex_id_type vertex_id_type;
+
+// the smallest id of each chain is its label
+typedef graphlab::distributed_graph<vertex_id_type, graphlab::empty> graph_type;
+
+/// The ids of chain c are chain_base(c) + i
+const vertex_id_type CHAIN_STRIDE = vertex_id_type(1) << 40;
+const size_t CHAIN_LENGTH = 1000;
+const size_t NUM_CHAINS = 2;
+
+vertex_id_type chain_base(size_t c) { return CHAIN_STRIDE * (c + 1); }
+
+
+/**
+ * The message type: combining keeps the smallest label.
+ */
+struct min_label : public graphlab::IS_POD_TYPE {
+  vertex_id_type value;
+  explicit min_label(vertex_id_type value = 
+                     std::numeric_limits<vertex_id_type>::max()) : 
+    value(value) { }
+  min_label& operator+=(const min_label& other) {
+    value = std::min(value, other.value);
+    return *this;
+  }
+};
+
+
+/**
+ * Propagates the smallest vertex id of each connected component.
+ */
+class label_components : 
+  public graphlab::ivertex_program<graph_type, graphlab::empty, min_label>,
+  public graphlab::IS_POD_TYPE {
+  min_label received;
+  bool changed;
+public:
+  void init(icontext_type& context, const vertex_type& vertex, 
+            const min_label& msg) {
+    received = msg;
+  }
+  edge_dir_type 
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+  void apply(icontext_type& context, vertex_type& vertex, 
+             const graphlab::empty& empty) {
+    changed = context.iteration() == 0 || received.value < vertex.data();
+    vertex.data() = std::min(vertex.data(), received.value);
+  }
+  edge_dir_type 
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return changed ? graphlab::ALL_EDGES : graphlab::NO_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex, 
+               edge_type& edge) const {
+    const vertex_type other = 
+      edge.source().id() == vertex.id() ? edge.target() : edge.source();
+    if (vertex.data() < other.data()) {
+      context.signal(other, min_label(vertex.data()));
+    }
+  }
+}; // end of label_components
+
+
+void init_label(graph_type::vertex_type& vertex) {
+  vertex.data() = vertex.id();
+}
+
+size_t count_large_ids(const graph_type::vertex_type& vertex) {
+  return vertex.id() > std::numeric_limits<uint32_t>::max();
+}
+
+size_t count_wrong_labels(const graph_type::vertex_type& vertex) {
+  // the label is the first vertex of the chain
+  return vertex.data() != vertex.id() - vertex.id() % CHAIN_STRIDE;
+}
+
+
+int main(int argc, char** argv) {
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::dc_init_param rpc_parameters;
+  graphlab::init_param_from_mpi(rpc_parameters);
+  graphlab::distributed_control dc(rpc_parameters);
+  graphlab::command_line_options clopts("64 bit vertex id test.");
+
+  ASSERT_EQ(sizeof(vertex_id_type), 8);
+  ASSERT_EQ(sizeof(graphlab::lvid_type), 4);
+
+  std::cout << "Creating chains with 64 bit ids" << std::endl;
+  graph_type graph(dc, clopts);
+  for (size_t c = 0; c < NUM_CHAINS; ++c) {
+    for (size_t i = dc.procid(); i + 1 < CHAIN_LENGTH; i += dc.numprocs()) {
+      graph.add_edge(chain_base(c) + i, chain_base(c) + i + 1);
+    }
+  }
+  // The parsers read the full 64 bit ids. The parsed edge starts a
+  // new chain.
+  if (dc.procid() == 0) {
+    std::stringstream strm;
+    strm << chain_base(NUM_CHAINS) << "\t" << chain_base(NUM_CHAINS) + 1;
+    ASSERT_TRUE(graphlab::builtin_parsers::tsv_parser(graph, "", strm.str()));
+  }
+  graph.finalize();
+  const size_t nverts = NUM_CHAINS * CHAIN_LENGTH + 2;
+  ASSERT_EQ(graph.num_vertices(), nverts);
+  ASSERT_EQ(graph.num_edges(), NUM_CHAINS * (CHAIN_LENGTH - 1) + 1);
+  ASSERT_EQ(graph.map_reduce_vertices<size_t>(count_large_ids), nverts);
+
+  std::cout << "Labeling the chains" << std::endl;
+  graph.transform_vertices(init_label);
+  graphlab::synchronous_engine<label_components> engine(dc, graph, clopts);
+  engine.signal_all();
+  engine.start();
+  ASSERT_EQ(graph.map_reduce_vertices<size_t>(count_wrong_labels), 0);
+  std::cout << "Finished" << std::endl;
+
+  graphlab::mpi_tools::finalize();
+} // end of main
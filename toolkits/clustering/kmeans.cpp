@@ -36,6 +36,17 @@
  * It constructs a graph with a single vertex for each data point and simply
  * uses the "Map-Reduce" scheme to perform a k-means clustering of all
  * the datapoints.
+ *
+ * The iterations use the triangle inequality to avoid most distance
+ * computations (Hamerly, Making k-means even faster, SDM 2010, with the
+ * center to center pruning of Elkan, Using the triangle inequality to
+ * accelerate k-means, ICML 2003). Every point keeps an upper bound on
+ * the distance to its center and a lower bound on the distance to all
+ * the other centers. Only the points whose bounds are violated after
+ * the centers move compute distances, and only the points which change
+ * cluster are reduced to update the centers. Alternatively the
+ * centers can be learned from random mini-batches (Sculley, Web-scale
+ * k-means clustering, WWW 2010).
  */
 
 
@@ -45,46 +56,94 @@
 #include <boost/spirit/include/phoenix_operator.hpp>
 #include <boost/spirit/include/phoenix_stl.hpp>
 
+#include <cmath>
 #include <limits>
 #include <vector>
 #include <iostream>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #include <graphlab.hpp>
 
 
 size_t NUM_CLUSTERS = 0;
 
+// the dimension of the data points
+size_t NUM_DIMENSIONS = 0;
+
+// the expected number of points in a mini-batch (0 for full batches)
+size_t BATCH_SIZE = 0;
+
+// the probability that a point is part of a mini-batch
+double BATCH_PROBABILITY = 1;
+
 struct cluster {
-  cluster(): count(0), changed(false) { }
-  std::vector<double> center;
+  cluster(): lost(false), count(0), moved(0), half_gap(0) { }
+  // true if the cluster has no points and thus no center
+  bool lost;
   size_t count;
-  bool changed;
+  // the distance the center moved in the last iteration
+  double moved;
+  // half the distance to the nearest other center
+  double half_gap;
 
   void save(graphlab::oarchive& oarc) const {
-    oarc << center << count << changed;
+    oarc << lost << count << moved << half_gap;
   }
 
   void load(graphlab::iarchive& iarc) {
-    iarc >> center >> count >> changed;
+    iarc >> lost >> count >> moved >> half_gap;
   }
 };
 
 std::vector<cluster> CLUSTERS;
 
+// the centers of all clusters in one NUM_CLUSTERS x NUM_DIMENSIONS
+// array, so that the scan over the centers reads contiguous memory
+std::vector<float> CENTERS;
+
+float* cluster_center(size_t i) {
+  return &CENTERS[i * NUM_DIMENSIONS];
+}
+
+// the distances between all pairs of centers
+std::vector<double> CENTER_DISTANCES;
+
+// the cluster whose center moved the most in the last iteration, how
+// far it moved and how far the center which moved second most moved
+size_t MAX_MOVED_CLUSTER = 0;
+double MAX_MOVED = 0;
+double SECOND_MAX_MOVED = 0;
+
+// the sums of the points assigned to each cluster (NUM_CLUSTERS x
+// NUM_DIMENSIONS) and their number
+std::vector<double> CLUSTER_SUMS;
+std::vector<long> CLUSTER_COUNTS;
+
 // the current cluster to initialize
 size_t KMEANS_INITIALIZATION;
 
 struct vertex_data{
-  std::vector<double> point;
+  std::vector<float> point;
   size_t best_cluster;
   double best_distance;
+  // the cluster of the point before the last iteration
+  size_t prev_cluster;
+  // upper bound on the distance to best_cluster
+  double upper_bound;
+  // lower bound on the distance to every other cluster
+  double lower_bound;
   bool changed;
 
   void save(graphlab::oarchive& oarc) const {
-    oarc << point << best_cluster << best_distance << changed;
+    oarc << point << best_cluster << best_distance << prev_cluster
+         << upper_bound << lower_bound << changed;
   }
   void load(graphlab::iarchive& iarc) {
-    iarc >> point >> best_cluster >> best_distance >> changed;
+    iarc >> point >> best_cluster >> best_distance >> prev_cluster
+         >> upper_bound >> lower_bound >> changed;
   }
 };
 
@@ -92,34 +151,33 @@ struct vertex_data{
 
 
 // helper function to compute distance between points
-double sqr_distance(const std::vector<double>& a, 
-                    const std::vector<double>& b) {
-  ASSERT_EQ(a.size(), b.size());
-  double total = 0;
-  for (size_t i = 0;i < a.size(); ++i) {
-    double d = a[i] - b[i];
+double sqr_distance(const float* a, const float* b, size_t n) {
+  size_t i = 0;
+  float total = 0;
+#ifdef __SSE__
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+    __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+  total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+  for (; i < n; ++i) {
+    float d = a[i] - b[i];
     total += d * d;
   }
   return total;
 }
 
-
-// helper function to add two vectors 
-std::vector<double>& plus_equal_vector(std::vector<double>& a, 
-                                       const std::vector<double>& b) {
-  ASSERT_EQ(a.size(), b.size());
-  for (size_t i = 0;i < a.size(); ++i) {
-    a[i] += b[i];
-  }
-  return a;
-}
-
-// helper function to scale a vector vectors 
-std::vector<double>& scale_vector(std::vector<double>& a, double d) {
-  for (size_t i = 0;i < a.size(); ++i) {
-    a[i] *= d;
-  }
-  return a;
+// distance between a point and a center
+double sqr_distance(const std::vector<float>& point, const float* center) {
+  ASSERT_EQ(point.size(), NUM_DIMENSIONS);
+  return sqr_distance(&point[0], center, NUM_DIMENSIONS);
 }
 
 
@@ -139,7 +197,7 @@ bool vertex_loader(graph_type& graph, const std::string& fname,
     (line.begin(), line.end(),       
      //  Begin grammar
      (
-      (qi::double_[phoenix::push_back(phoenix::ref(vtx.point), qi::_1)] % -qi::char_(",") )
+      (qi::float_[phoenix::push_back(phoenix::ref(vtx.point), qi::_1)] % -qi::char_(",") )
       )
      ,
      //  End grammar
@@ -148,6 +206,9 @@ bool vertex_loader(graph_type& graph, const std::string& fname,
   if (!success) return false;
   vtx.best_cluster = (size_t)(-1);
   vtx.best_distance = std::numeric_limits<double>::infinity();
+  vtx.prev_cluster = (size_t)(-1);
+  vtx.upper_bound = std::numeric_limits<double>::infinity();
+  vtx.lower_bound = 0;
   vtx.changed = false;
   graph.add_vertex(NEXT_VID.inc_ret_last(graph.numprocs()), vtx);
   return true;
@@ -200,8 +261,8 @@ struct min_point_size_reducer: public graphlab::IS_POD_TYPE {
  * is smaller that its previous cluster asssignment
  */
 void kmeans_pp_initialization(graph_type::vertex_type& v) {
-  double d = sqr_distance(v.data().point, 
-                          CLUSTERS[KMEANS_INITIALIZATION].center);
+  double d = sqr_distance(v.data().point,
+                          cluster_center(KMEANS_INITIALIZATION));
   if (v.data().best_distance > d) {
     v.data().best_distance = d;
     v.data().best_cluster = KMEANS_INITIALIZATION;
@@ -213,11 +274,11 @@ void kmeans_pp_initialization(graph_type::vertex_type& v) {
  * proportionate to the "best distance" stored in the vertex.
  */
 struct random_sample_reducer {
-  std::vector<double> vtx;
+  std::vector<float> vtx;
   double weight;
  
   random_sample_reducer():weight(0) { }
-  random_sample_reducer(const std::vector<double>& vtx, 
+  random_sample_reducer(const std::vector<float>& vtx,
                         double weight):vtx(vtx),weight(weight) { }
 
   static random_sample_reducer get_weight(const graph_type::vertex_type& v) {
@@ -259,96 +320,254 @@ struct random_sample_reducer {
 
 
 
-
 /*
- * This transform vertices call is used during the 
- * actual k-means iteration. It computes distance to 
- * all "changed" clusters and reassigns itself if necessary
+ * Assigns the point to its nearest center and resets its bounds.
+ * The scan starts from the current center of the point, and skips
+ * the centers which are at least twice as far from the best center
+ * found so far as the point is. Their distance to the point is then
+ * bounded from below by the triangle inequality.
  */
-void kmeans_iteration(graph_type::vertex_type& v) {
-  // if current vertex's cluster was modified, we invalidate the distance.
-  // and we need to recompute to all existing clusters
-  // otherwise, we just need to recompute to changed cluster centers.
-  size_t prev_asg = v.data().best_cluster;
-  if (CLUSTERS[v.data().best_cluster].changed) {
-    // invalidate. recompute to all
-    v.data().best_cluster = (size_t)(-1);
-    v.data().best_distance = std::numeric_limits<double>::infinity();
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      if (CLUSTERS[i].center.size() > 0) {
-        double d = sqr_distance(v.data().point, 
-                                CLUSTERS[i].center);
-        if (d < v.data().best_distance) {
-          v.data().best_distance = d;
-          v.data().best_cluster = i;
-        }
+void assign_nearest_cluster(vertex_data& vdata, double best_distance) {
+  const float* point = &vdata.point[0];
+  size_t best = vdata.best_cluster;
+  if (best == (size_t)(-1) || CLUSTERS[best].lost) {
+    best = (size_t)(-1);
+    best_distance = std::numeric_limits<double>::infinity();
+  }
+  double second_distance = std::numeric_limits<double>::infinity();
+  for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
+    if (i == best || CLUSTERS[i].lost) continue;
+    if (best != (size_t)(-1)) {
+      const double gap = CENTER_DISTANCES[best * NUM_CLUSTERS + i];
+      if (gap >= 2 * best_distance) {
+        second_distance = std::min(second_distance, gap - best_distance);
+        continue;
       }
     }
+    double d = std::sqrt(sqr_distance(point, cluster_center(i),
+                                      NUM_DIMENSIONS));
+    if (d < best_distance) {
+      second_distance = best_distance;
+      best_distance = d;
+      best = i;
+    }
+    else {
+      second_distance = std::min(second_distance, d);
+    }
   }
-  else {
-    // just compute distance to what has changed
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      if (CLUSTERS[i].changed && CLUSTERS[i].center.size() > 0) {
-        double d = sqr_distance(v.data().point, 
-                                CLUSTERS[i].center);
-        if (d < v.data().best_distance) {
-          v.data().best_distance = d;
-          v.data().best_cluster = i;
-        }
-      }
+  vdata.best_cluster = best;
+  vdata.best_distance = best_distance * best_distance;
+  vdata.upper_bound = best_distance;
+  vdata.lower_bound = second_distance;
+}
+
+
+/*
+ * This transform vertices call is used during the 
+ * actual k-means iteration. It moves the bounds of the point by the
+ * distances the centers moved, and only searches for the nearest
+ * center if the bounds no longer guarantee that it is the current one.
+ */
+void kmeans_iteration(graph_type::vertex_type& v) {
+  vertex_data& vdata = v.data();
+  const size_t prev_asg = vdata.best_cluster;
+  const cluster& c = CLUSTERS[prev_asg];
+  vdata.prev_cluster = prev_asg;
+  vdata.upper_bound += c.moved;
+  vdata.lower_bound -= (prev_asg == MAX_MOVED_CLUSTER) ?
+                       SECOND_MAX_MOVED : MAX_MOVED;
+  const double bound = std::max(vdata.lower_bound, c.half_gap);
+  if (vdata.upper_bound > bound) {
+    // tighten the upper bound and test again
+    vdata.upper_bound = std::sqrt(sqr_distance(vdata.point,
+                                               cluster_center(prev_asg)));
+    vdata.best_distance = vdata.upper_bound * vdata.upper_bound;
+    if (vdata.upper_bound > bound) {
+      assign_nearest_cluster(vdata, vdata.upper_bound);
     }
   }
-  v.data().changed = (prev_asg != v.data().best_cluster);
+  vdata.changed = (prev_asg != vdata.best_cluster);
 }
 
+/*
+ * Assigns the points of a mini-batch, or all points once the
+ * mini-batch iterations are done.
+ */
+void kmeans_assignment(graph_type::vertex_type& v) {
+  vertex_data& vdata = v.data();
+  const size_t prev_asg = vdata.best_cluster;
+  double best_distance = std::numeric_limits<double>::infinity();
+  if (prev_asg != (size_t)(-1) && !CLUSTERS[prev_asg].lost) {
+    best_distance = std::sqrt(sqr_distance(vdata.point,
+                                           cluster_center(prev_asg)));
+  }
+  assign_nearest_cluster(vdata, best_distance);
+  vdata.changed = (prev_asg != vdata.best_cluster);
+}
 
+bool select_batch(const graph_type::vertex_type& v) {
+  return graphlab::random::bernoulli(BATCH_PROBABILITY);
+}
 
+bool select_changed(const graph_type::vertex_type& v) {
+  return v.data().changed;
+}
 
 
 
 
 /*
- * computes new cluster centers
+ * Sums the points assigned to each cluster. The points of changed
+ * vertices can also be removed from the cluster they left so that
+ * only the changes need to be reduced.
  * Also accumulates a counter counting the number of vertices which
  * assignments changed.
  */
 struct cluster_center_reducer {
-  std::vector<cluster> new_clusters;
+  // NUM_CLUSTERS x NUM_DIMENSIONS sums and the counts. These are
+  // empty while the reducer holds a single point.
+  std::vector<double> sums;
+  std::vector<long> counts;
   size_t num_changed;
+  // a single point added to one cluster and removed from another
+  std::vector<float> point;
+  size_t add_to;
+  size_t remove_from;
 
-  cluster_center_reducer():new_clusters(NUM_CLUSTERS), num_changed(0) { }
+  cluster_center_reducer(): num_changed(0), add_to((size_t)(-1)),
+                            remove_from((size_t)(-1)) { }
 
   static cluster_center_reducer get_center(const graph_type::vertex_type& v) {
     cluster_center_reducer cc;
     ASSERT_NE(v.data().best_cluster, (size_t)(-1));
-    
-    cc.new_clusters[v.data().best_cluster].center = v.data().point;
-    cc.new_clusters[v.data().best_cluster].count = 1;
+    cc.point = v.data().point;
+    cc.add_to = v.data().best_cluster;
     cc.num_changed = v.data().changed;
     return cc;
   }
 
+  static cluster_center_reducer get_change(const graph_type::vertex_type& v) {
+    cluster_center_reducer cc = get_center(v);
+    cc.remove_from = v.data().prev_cluster;
+    return cc;
+  }
+
+  // Adds the reduced points to the given sums and counts
+  void add_to_sums(std::vector<double>& total_sums,
+                   std::vector<long>& total_counts) const {
+    if (!sums.empty()) {
+      for (size_t i = 0;i < sums.size(); ++i) total_sums[i] += sums[i];
+      for (size_t i = 0;i < counts.size(); ++i) total_counts[i] += counts[i];
+      return;
+    }
+    if (add_to != (size_t)(-1)) {
+      double* sum = &total_sums[add_to * NUM_DIMENSIONS];
+      for (size_t i = 0;i < NUM_DIMENSIONS; ++i) sum[i] += point[i];
+      ++total_counts[add_to];
+    }
+    if (remove_from != (size_t)(-1)) {
+      double* sum = &total_sums[remove_from * NUM_DIMENSIONS];
+      for (size_t i = 0;i < NUM_DIMENSIONS; ++i) sum[i] -= point[i];
+      --total_counts[remove_from];
+    }
+  }
+
   cluster_center_reducer& operator+=(const cluster_center_reducer& other) {
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      if (new_clusters[i].count == 0) new_clusters[i] = other.new_clusters[i];
-      else if (other.new_clusters[i].count > 0) {
-        plus_equal_vector(new_clusters[i].center, other.new_clusters[i].center);
-        new_clusters[i].count += other.new_clusters[i].count;
-      }
+    if (sums.empty()) {
+      sums.resize(NUM_CLUSTERS * NUM_DIMENSIONS, 0);
+      counts.resize(NUM_CLUSTERS, 0);
+      cluster_center_reducer single;
+      single.point.swap(point);
+      single.add_to = add_to; single.remove_from = remove_from;
+      single.add_to_sums(sums, counts);
+      add_to = remove_from = (size_t)(-1);
     }
+    other.add_to_sums(sums, counts);
     num_changed += other.num_changed;
     return *this;
   }
 
   void save(graphlab::oarchive& oarc) const { 
-    oarc << new_clusters << num_changed;
+    oarc << sums << counts << num_changed << point << add_to << remove_from;
   }
 
   void load(graphlab::iarchive& iarc) {
-    iarc >> new_clusters >> num_changed;
+    iarc >> sums >> counts >> num_changed >> point >> add_to >> remove_from;
   }
 };
 
+
+/*
+ * Computes the distances between all pairs of centers, half the
+ * distance from each center to the nearest other one and the largest
+ * moves of the centers.
+ */
+void update_center_distances() {
+  const double inf = std::numeric_limits<double>::infinity();
+  CENTER_DISTANCES.assign(NUM_CLUSTERS * NUM_CLUSTERS, inf);
+  for (size_t i = 0;i < NUM_CLUSTERS; ++i) CLUSTERS[i].half_gap = inf;
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0;i < (int)NUM_CLUSTERS; ++i) {
+    if (CLUSTERS[i].lost) continue;
+    for (size_t j = i + 1;j < NUM_CLUSTERS; ++j) {
+      if (CLUSTERS[j].lost) continue;
+      CENTER_DISTANCES[i * NUM_CLUSTERS + j] = CENTER_DISTANCES[j * NUM_CLUSTERS + i] =
+        std::sqrt(sqr_distance(cluster_center(i), cluster_center(j),
+                               NUM_DIMENSIONS));
+    }
+  }
+  MAX_MOVED_CLUSTER = 0; MAX_MOVED = 0; SECOND_MAX_MOVED = 0;
+  for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
+    for (size_t j = 0;j < NUM_CLUSTERS; ++j) {
+      if (i != j) {
+        CLUSTERS[i].half_gap = std::min(CLUSTERS[i].half_gap,
+                                        CENTER_DISTANCES[i * NUM_CLUSTERS + j] / 2);
+      }
+    }
+    if (CLUSTERS[i].moved > MAX_MOVED) {
+      SECOND_MAX_MOVED = MAX_MOVED;
+      MAX_MOVED = CLUSTERS[i].moved;
+      MAX_MOVED_CLUSTER = i;
+    }
+    else {
+      SECOND_MAX_MOVED = std::max(SECOND_MAX_MOVED, CLUSTERS[i].moved);
+    }
+  }
+}
+
+/*
+ * Moves the centers to the means of the clusters and records how far
+ * each moved. Returns the clusters which were lost.
+ */
+std::vector<size_t> update_centers() {
+  std::vector<size_t> lost;
+  for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
+    cluster& c = CLUSTERS[i];
+    c.moved = 0;
+    if (CLUSTER_COUNTS[i] == 0) {
+      if (c.count > 0) lost.push_back(i);
+      c.lost = true;
+      c.count = 0;
+      continue;
+    }
+    float* center = cluster_center(i);
+    const double* sum = &CLUSTER_SUMS[i * NUM_DIMENSIONS];
+    double moved = 0;
+    for (size_t j = 0;j < NUM_DIMENSIONS; ++j) {
+      const float prev = center[j];
+      center[j] = sum[j] / CLUSTER_COUNTS[i];
+      moved += double(center[j] - prev) * (center[j] - prev);
+    }
+    if (!c.lost) c.moved = std::sqrt(moved);
+    c.lost = false;
+    c.count = CLUSTER_COUNTS[i];
+  }
+  update_center_distances();
+  return lost;
+}
+
 struct vertex_writer {
   std::string save_vertex(graph_type::vertex_type v) {
     std::stringstream strm;
@@ -379,6 +598,7 @@ int main(int argc, char** argv) {
   std::string datafile;
   std::string outcluster_file;
   std::string outdata_file;
+  size_t max_iterations = 0;
   clopts.attach_option("data", datafile,
                        "Input file. Each line hold a white-space or comma separated numeric vector");
   clopts.attach_option("clusters", NUM_CLUSTERS,
@@ -392,6 +612,12 @@ int main(int argc, char** argv) {
                        "last column denoting the assigned cluster centers. The output "
                        "will be written to a sequence of filenames where each file is "
                        "prefixed by this value. This may be on HDFS.");
+  clopts.attach_option("batch-size", BATCH_SIZE,
+                       "If set, the centers are learned from random mini-batches "
+                       "of about this many datapoints.");
+  clopts.attach_option("max-iterations", max_iterations,
+                       "The maximum number of iterations. 0 runs until no "
+                       "assignment changes, or 100 mini-batches.");
 
   if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
   if (datafile == "") {
@@ -433,14 +659,13 @@ int main(int argc, char** argv) {
               << "! K-means cannot proceed!" << std::endl;
     return EXIT_FAILURE;
   }
+  NUM_DIMENSIONS = max_p_size;
 
 
   dc.cout() << "Initializing using Kmeans++\n";
   // allocate clusters
   CLUSTERS.resize(NUM_CLUSTERS);
-  for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-    CLUSTERS[i].center.resize(max_p_size);
-  }
+  CENTERS.assign(NUM_CLUSTERS * NUM_DIMENSIONS, 0);
 
   // ok. perform kmeans++ initialization
   for (KMEANS_INITIALIZATION = 0; 
@@ -448,47 +673,80 @@ int main(int argc, char** argv) {
        ++KMEANS_INITIALIZATION) {
     random_sample_reducer rs = graph.map_reduce_vertices<random_sample_reducer>
                                       (random_sample_reducer::get_weight);
-    CLUSTERS[KMEANS_INITIALIZATION].center = rs.vtx;
+    std::copy(rs.vtx.begin(), rs.vtx.end(),
+              cluster_center(KMEANS_INITIALIZATION));
     graph.transform_vertices(kmeans_pp_initialization);
   } 
+  update_center_distances();
 
-  // "reset" all clusters
-  for (size_t i = 0; i < NUM_CLUSTERS; ++i) CLUSTERS[i].changed = true;
-  // perform Kmeans iteration 
+  CLUSTER_SUMS.assign(NUM_CLUSTERS * NUM_DIMENSIONS, 0);
+  CLUSTER_COUNTS.assign(NUM_CLUSTERS, 0);
   
-  dc.cout() << "Running Kmeans...\n";
-  bool clusters_changed = true;
-  size_t iteration_count = 0;
-  while(clusters_changed) {
-
+  if (BATCH_SIZE > 0) {
+    // Mini-batch iterations. Each batch moves every center towards the
+    // mean of its batch points with a learning rate of the number of
+    // batch points over the number of points it has been given so far.
+    if (max_iterations == 0) max_iterations = 100;
+    BATCH_PROBABILITY = std::min(1.0, double(BATCH_SIZE) / graph.num_vertices());
+    dc.cout() << "Running mini-batch Kmeans...\n";
+    for (size_t iteration_count = 1;
+         iteration_count <= max_iterations; ++iteration_count) {
+      graphlab::vertex_set batch = graph.select(select_batch);
+      graph.transform_vertices(kmeans_assignment, batch);
+      cluster_center_reducer cc = graph.map_reduce_vertices<cluster_center_reducer>
+                                      (cluster_center_reducer::get_center, batch);
+      std::vector<double> batch_sums(NUM_CLUSTERS * NUM_DIMENSIONS, 0);
+      std::vector<long> batch_counts(NUM_CLUSTERS, 0);
+      cc.add_to_sums(batch_sums, batch_counts);
+      size_t batch_points = 0;
+      for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
+        cluster& c = CLUSTERS[i];
+        c.moved = 0;
+        if (batch_counts[i] == 0) continue;
+        batch_points += batch_counts[i];
+        CLUSTER_COUNTS[i] += batch_counts[i];
+        const double rate = 1.0 / CLUSTER_COUNTS[i];
+        float* center = cluster_center(i);
+        double moved = 0;
+        for (size_t j = 0;j < NUM_DIMENSIONS; ++j) {
+          const float prev = center[j];
+          center[j] += rate * (batch_sums[i * NUM_DIMENSIONS + j] -
+                               batch_counts[i] * double(prev));
+          moved += double(center[j] - prev) * (center[j] - prev);
+        }
+        c.moved = std::sqrt(moved);
+      }
+      update_center_distances();
+      dc.cout() << "Mini-batch iteration " << iteration_count << ": " <<
+                 "# points in batch = " << batch_points << std::endl;
+    }
+    // assign all points to the final centers
+    graph.transform_vertices(kmeans_assignment);
+  }
+  else {
+    // perform Kmeans iteration
+    dc.cout() << "Running Kmeans...\n";
+    // sum up the clusters of the Kmeans++ initialization
     cluster_center_reducer cc = graph.map_reduce_vertices<cluster_center_reducer>
                                     (cluster_center_reducer::get_center);  
-    // the first round (iteration_count == 0) is not so meaningful
-    // since I am just recomputing the centers from the output of the KMeans++
-    // initialization
-    if (iteration_count > 0) {
+    cc.add_to_sums(CLUSTER_SUMS, CLUSTER_COUNTS);
+    size_t iteration_count = 0;
+    while(max_iterations == 0 || iteration_count < max_iterations) {
+      std::vector<size_t> lost = update_centers();
+      for (size_t i = 0;i < lost.size(); ++i) {
+        dc.cout() << "Cluster " << lost[i] << " lost" << std::endl;
+      }
+      graph.transform_vertices(kmeans_iteration);
+      ++iteration_count;
+      // reduce only the points which changed cluster
+      graphlab::vertex_set changed = graph.select(select_changed);
+      cc = graph.map_reduce_vertices<cluster_center_reducer>
+               (cluster_center_reducer::get_change, changed);
       dc.cout() << "Kmeans iteration " << iteration_count << ": " <<
                  "# points with changed assignments = " << cc.num_changed << std::endl;
+      if (cc.num_changed == 0) break;
+      cc.add_to_sums(CLUSTER_SUMS, CLUSTER_COUNTS);
     }
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      double d = cc.new_clusters[i].count;
-      if (d > 0) scale_vector(cc.new_clusters[i].center, 1.0 / d);
-      if (cc.new_clusters[i].count == 0 && CLUSTERS[i].count > 0) {
-        dc.cout() << "Cluster " << i << " lost" << std::endl;
-        CLUSTERS[i].center.clear();
-        CLUSTERS[i].count = 0;
-        CLUSTERS[i].changed = false;
-      }
-      else {
-        CLUSTERS[i] = cc.new_clusters[i];
-        CLUSTERS[i].changed = true;
-      }
-    }
-    clusters_changed = iteration_count == 0 || cc.num_changed > 0;
-
-    graph.transform_vertices(kmeans_iteration);
-
-    ++iteration_count;
   }
 
 
@@ -496,8 +754,9 @@ int main(int argc, char** argv) {
     dc.cout() << "Writing Cluster Centers..." << std::endl;
     std::ofstream fout(outcluster_file.c_str());
     for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      for (size_t j = 0; j < CLUSTERS[i].center.size(); ++j) {
-        fout << CLUSTERS[i].center[j] << "\t";
+      // the line of a lost cluster is empty
+      for (size_t j = 0; !CLUSTERS[i].lost && j < NUM_DIMENSIONS; ++j) {
+        fout << cluster_center(i)[j] << "\t";
       }
       fout << "\n";
     }
@@ -510,5 +769,3 @@ int main(int argc, char** argv) {
 
   graphlab::mpi_tools::finalize();
 }
-
-
@@ -35,6 +35,7 @@
 #include "eigen_serialization.hpp"
 #include <Eigen/Dense>
 #include <graphlab/macros_def.hpp>
+#include "hogwild.hpp"
 
 
 
@@ -363,6 +364,9 @@ struct error_aggregator : public graphlab::IS_POD_TYPE {
     return *this;
   }
   static error_aggregator map(icontext_type& context, const graph_type::edge_type& edge) {
+    return map_edge(edge);
+  }
+  static error_aggregator map_edge(const graph_type::edge_type& edge) {
     error_aggregator agg;
     if (edge.data().role == edge_data::TRAIN){
       agg.train_error = extract_l2_error(edge); agg.ntrain = 1;
@@ -409,6 +413,80 @@ double extract_l2_error(const graph_type::edge_type & edge) {
 } // end of extract_l2_error
 
 
+/**
+ * \brief The Hogwild SGD step of a training edge, updating the user
+ * and item biases and pvecs in place
+ */
+struct biassgd_hogwild_update {
+  void operator()(graph_type::edge_type& edge) const {
+    if (edge.data().role != edge_data::TRAIN)
+      return;
+    vertex_data& user = edge.source().data();
+    vertex_data& item = edge.target().data();
+    double pred = biassgd_vertex_program::GLOBAL_MEAN + 
+      user.bias + item.bias + user.pvec.dot(item.pvec);
+    pred = std::min(pred, biassgd_vertex_program::MAXVAL);
+    pred = std::max(pred, biassgd_vertex_program::MINVAL); 
+    const double err = pred - edge.data().obs;
+    if (std::isnan(err))
+      logstream(LOG_FATAL)<<"Got into numeric errors.. try to tune step size and regularization using --lambda and --gamma flags" << std::endl;
+    const double gamma = biassgd_vertex_program::GAMMA;
+    const double lambda = biassgd_vertex_program::LAMBDA;
+    user.bias -= gamma*(err + lambda*user.bias);
+    item.bias -= gamma*(err + lambda*item.bias);
+    for (int i = 0; i < user.pvec.size(); ++i) {
+      const double u = user.pvec[i], v = item.pvec[i];
+      user.pvec[i] = u - gamma*(err*v + lambda*u);
+      item.pvec[i] = v - gamma*(err*u + lambda*v);
+    }
+  }
+}; // end of biassgd_hogwild_update
+
+void add_model(graph_type::vertex_type& vertex, const vertex_data& other) {
+  vertex.data().pvec += other.pvec;
+  vertex.data().bias += other.bias;
+}
+void scale_model(vertex_data& vdata, double scale) {
+  vdata.pvec *= scale;
+  vdata.bias *= scale;
+}
+
+/**
+ * \brief Runs Bias-SGD in Hogwild mode instead of the engine.
+ *
+ * Every epoch streams over the local training edges in shuffled
+ * blocks, updating the biases and pvecs in place, and then averages
+ * them over the replicas of each vertex. Stops after max_iter epochs,
+ * or once the training RMSE changes by less than tol. Returns the
+ * number of epochs.
+ */
+size_t run_hogwild(graphlab::distributed_control& dc, graph_type& graph) {
+  graphlab::timer timer;
+  // start all the replicas of a vertex from the master model
+  graph.synchronize();
+  double prev_train_error = std::numeric_limits<double>::max();
+  size_t epoch = 0;
+  while (epoch < biassgd_vertex_program::MAX_UPDATES) {
+    hogwild_epoch(graph, biassgd_hogwild_update());
+    average_replicas(graph, add_model, scale_model);
+    ++epoch;
+    const error_aggregator agg =
+      graph.map_reduce_edges<error_aggregator>(error_aggregator::map_edge);
+    ASSERT_GT(agg.ntrain, 0);
+    const double train_error = std::sqrt(agg.train_error / agg.ntrain);
+    dc.cout() << std::setw(8) << timer.current_time() << std::setw(8) << train_error;
+    if(agg.nvalidation > 0)
+      dc.cout() << std::setw(8) << std::sqrt(agg.validation_error / agg.nvalidation);
+    dc.cout() << std::endl;
+    biassgd_vertex_program::GAMMA *= biassgd_vertex_program::STEP_DEC;
+    if (std::fabs(prev_train_error - train_error) < biassgd_vertex_program::TOLERANCE)
+      break;
+    prev_train_error = train_error;
+  }
+  return epoch;
+} // end of run_hogwild
+
+
 struct prediction_saver {
   typedef graph_type::vertex_type vertex_type;
   typedef graph_type::edge_type   edge_type;
@@ -592,6 +670,7 @@ int main(int argc, char** argv) {
   std::string predictions;
   size_t interval = 0;
   std::string exec_type = "synchronous";
+  bool hogwild = false;
   clopts.attach_option("matrix", input_dir,
                        "The directory containing the matrix file");
   clopts.add_positional("matrix");
@@ -599,6 +678,9 @@ int main(int argc, char** argv) {
                        "Number of latent parameters to use.");
   clopts.attach_option("engine", exec_type, 
                        "The engine type synchronous or asynchronous");
+  clopts.attach_option("hogwild", hogwild,
+                       "If true, run lock free SGD over the local edges instead of the "
+                       "engine. max_iter is then the maximum number of epochs");
   clopts.attach_option("max_iter", biassgd_vertex_program::MAX_UPDATES,
                        "The maxumum number of udpates allowed for a vertex");
   clopts.attach_option("lambda", biassgd_vertex_program::LAMBDA, 
@@ -667,45 +749,60 @@ dc.cout() << "Finalizing graph." << std::endl;
       << float(graph.num_local_edges())/graph.num_edges()
       << std::endl;
  
-  dc.cout() << "Creating engine" << std::endl;
-  engine_type engine(dc, graph, exec_type, clopts);
-
-  // Add error reporting to the engine
-  const bool success = engine.add_edge_aggregator<error_aggregator>
-    ("error", error_aggregator::map, error_aggregator::finalize) &&
-    engine.aggregate_periodic("error", interval);
-  ASSERT_TRUE(success);
-  
-
   biassgd_vertex_program::GLOBAL_MEAN = graph.map_reduce_edges<double>(calc_global_mean);
   biassgd_vertex_program::NUM_TRAINING_EDGES = graph.map_reduce_edges<size_t>(count_edges);
   biassgd_vertex_program::GLOBAL_MEAN /= biassgd_vertex_program::NUM_TRAINING_EDGES;
   dc.cout() << "Global mean is: " <<biassgd_vertex_program::GLOBAL_MEAN << std::endl;
 
-  // Signal all vertices on the vertices on the left (libersgd) 
-  engine.map_reduce_vertices<graphlab::empty>(biassgd_vertex_program::signal_left);
+  if (hogwild) {
+    dc.cout() << "Running Hogwild Bias-SGD" << std::endl;
+    dc.cout() << "Time   Training    Validation" <<std::endl;
+    dc.cout() << "       RMSE        RMSE " <<std::endl;
+    timer.start();
+    const size_t epochs = run_hogwild(dc, graph);
+    const double runtime = timer.current_time();
+    dc.cout() << "----------------------------------------------------------"
+              << std::endl
+              << "Final Runtime (seconds):   " << runtime << std::endl
+              << "Epochs executed: " << epochs << std::endl;
+  }
+  else {
+    dc.cout() << "Creating engine" << std::endl;
+    engine_type engine(dc, graph, exec_type, clopts);
+
+    // Add error reporting to the engine
+    const bool success = engine.add_edge_aggregator<error_aggregator>
+      ("error", error_aggregator::map, error_aggregator::finalize) &&
+      engine.aggregate_periodic("error", interval);
+    ASSERT_TRUE(success);
+  
+
+
+    // Signal all vertices on the vertices on the left (libersgd) 
+    engine.map_reduce_vertices<graphlab::empty>(biassgd_vertex_program::signal_left);
  
 
-  dc.cout() << "Running Bias-SGD" << std::endl;
-  dc.cout() << "(C) Code by Danny Bickson, CMU " << std::endl;
-  dc.cout() << "Please send bug reports to danny.bickson@gmail.com" << std::endl;
-  dc.cout() << "Time   Training    Validation" <<std::endl;
-  dc.cout() << "       RMSE        RMSE " <<std::endl;
-  timer.start();
-  engine.start();  
-
-  const double runtime = timer.current_time();
-  dc.cout() << "----------------------------------------------------------"
-            << std::endl
-            << "Final Runtime (seconds):   " << runtime 
-            << std::endl
-            << "Updates executed: " << engine.num_updates() << std::endl
-            << "Update Rate (updates/second): " 
-            << engine.num_updates() / runtime << std::endl;
-
-  // Compute the final training error -----------------------------------------
-  dc.cout() << "Final error: " << std::endl;
-  engine.aggregate_now("error");
+    dc.cout() << "Running Bias-SGD" << std::endl;
+    dc.cout() << "(C) Code by Danny Bickson, CMU " << std::endl;
+    dc.cout() << "Please send bug reports to danny.bickson@gmail.com" << std::endl;
+    dc.cout() << "Time   Training    Validation" <<std::endl;
+    dc.cout() << "       RMSE        RMSE " <<std::endl;
+    timer.start();
+    engine.start();  
+
+    const double runtime = timer.current_time();
+    dc.cout() << "----------------------------------------------------------"
+              << std::endl
+              << "Final Runtime (seconds):   " << runtime 
+              << std::endl
+              << "Updates executed: " << engine.num_updates() << std::endl
+              << "Update Rate (updates/second): " 
+              << engine.num_updates() / runtime << std::endl;
+
+    // Compute the final training error -----------------------------------------
+    dc.cout() << "Final error: " << std::endl;
+    engine.aggregate_now("error");
+  }
 
   // Make predictions ---------------------------------------------------------
   if(!predictions.empty()) {
@@ -0,0 +1,96 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ * Lock free (Hogwild) stochastic gradient descent over the local edges
+ */
+
+
+#ifndef TK_HOGWILD
+#define TK_HOGWILD
+
+#include <vector>
+#include <algorithm>
+#include <graphlab/util/random.hpp>
+
+
+/**
+ * \brief Runs one Hogwild epoch over the edges stored on this machine.
+ *
+ * The local vertices are cut into blocks of block_size consecutive
+ * vertices which the threads visit in a random order. update(edge) is
+ * called on every out edge of every vertex of a block, and changes the
+ * data of both endpoints in place without any locking (Niu, Recht, Re
+ * and Wright, Hogwild!, NIPS 2011). Concurrent updates of the same
+ * vertex may overwrite each other, which is rare on sparse rating
+ * matrices and does not prevent convergence. All the out edges of a
+ * vertex are visited by the same thread, so an update may accumulate
+ * into the source vertex without races.
+ *
+ * Only the local replicas are changed: average_replicas() reconciles
+ * the replicas of the vertices whose edges span several machines.
+ */
+template <typename Graph, typename UpdateFunction>
+void hogwild_epoch(Graph& graph, UpdateFunction update,
+                   size_t block_size = 64) {
+  typedef typename Graph::local_edge_type local_edge_type;
+  typedef typename Graph::edge_type edge_type;
+  const size_t nverts = graph.num_local_vertices();
+  const size_t nblocks = (nverts + block_size - 1) / block_size;
+  std::vector<size_t> order(nblocks);
+  for (size_t i = 0; i < nblocks; ++i) order[i] = i;
+  graphlab::random::shuffle(order);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (int i = 0; i < (int)nblocks; ++i) {
+    const size_t begin = order[i] * block_size;
+    const size_t end = std::min(begin + block_size, nverts);
+    for (size_t lvid = begin; lvid < end; ++lvid) {
+      foreach(const local_edge_type& e, graph.l_vertex(lvid).out_edges()) {
+        edge_type edge(e);
+        update(edge);
+      }
+    }
+  }
+} // end of hogwild_epoch
+
+
+/**
+ * \brief Replaces the data of every vertex which has mirrors by the
+ * average of the data of all its replicas.
+ *
+ * add(vertex, data) must add the vertex data of a mirror to the data of
+ * the master vertex, and scale(data, s) multiply the vertex data by s.
+ * Must be called by all machines.
+ */
+template <typename Graph, typename AddFunction, typename ScaleFunction>
+void average_replicas(Graph& graph, AddFunction add, ScaleFunction scale) {
+  typedef typename Graph::local_vertex_type local_vertex_type;
+  graph.synchronize_mirrors_to_master(add);
+  for (size_t lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
+    local_vertex_type vertex = graph.l_vertex(lvid);
+    if (vertex.owned() && vertex.num_mirrors() > 0)
+      scale(vertex.data(), 1.0 / (vertex.num_mirrors() + 1));
+  }
+  graph.synchronize();
+} // end of average_replicas
+
+
+#endif //TK_HOGWILD
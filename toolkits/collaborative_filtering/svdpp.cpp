@@ -35,6 +35,7 @@
 #include "eigen_serialization.hpp"
 #include <Eigen/Dense>
 #include <graphlab/macros_def.hpp>
+#include "hogwild.hpp"
 
 
 
@@ -84,7 +85,7 @@ struct vertex_data {
    * \brief Simple default constructor which randomizes the vertex
    *  data 
    */
-  vertex_data() : nupdates(0) { randomize(); } 
+  vertex_data() : nupdates(0), bias(0) { randomize(); } 
   /** \brief Randomizes the latent pvec */
   void randomize() { pvec.resize(NLATENT); pvec.setRandom(); weight.resize(NLATENT); weight.setRandom(); }
   /** \brief Save the vertex data to a binary archive */
@@ -425,6 +426,9 @@ struct error_aggregator : public graphlab::IS_POD_TYPE {
     return *this;
   }
   static error_aggregator map(icontext_type& context, const graph_type::edge_type& edge) {
+    return map_edge(edge);
+  }
+  static error_aggregator map_edge(const graph_type::edge_type& edge) {
     error_aggregator agg;
     if (edge.data().role == edge_data::TRAIN){
       agg.train_error = extract_l2_error(edge); agg.ntrain = 1;
@@ -476,6 +480,124 @@ double extract_l2_error(const graph_type::edge_type & edge) {
 } // end of extract_l2_error
 
 
+/**
+ * \brief Adds the weight of the item of an edge to the weight of its
+ * user, which then holds the implicit feedback sum of the user
+ */
+struct svdpp_implicit_sum {
+  void operator()(graph_type::edge_type& edge) const {
+    edge.source().data().weight += edge.target().data().weight;
+  }
+}; // end of svdpp_implicit_sum
+
+// the weights of the items are model parameters and are not summed
+void add_user_weight(graph_type::vertex_type& vertex, const vertex_data& other) {
+  if (vertex.num_in_edges() == 0)
+    vertex.data().weight += other.weight;
+}
+
+/**
+ * \brief Sets the weight of every user to the normalized sum of the
+ * weights of its items, as the first phase of the vertex program does
+ */
+void compute_user_weights(graph_type& graph) {
+  for (size_t lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
+    graph_type::local_vertex_type vertex = graph.l_vertex(lvid);
+    if (vertex.global_num_in_edges() == 0)
+      vertex.data().weight.setZero();
+  }
+  hogwild_epoch(graph, svdpp_implicit_sum());
+  graph.synchronize_mirrors_to_master(add_user_weight);
+  for (size_t lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
+    graph_type::local_vertex_type vertex = graph.l_vertex(lvid);
+    if (vertex.owned() && vertex.global_num_in_edges() == 0)
+      vertex.data().weight *= 1.0/sqrt(vertex.global_num_out_edges());
+  }
+  graph.synchronize();
+} // end of compute_user_weights
+
+/**
+ * \brief The Hogwild SGD step of a training edge, updating the biases
+ * and pvecs of the user and item and the weight of the item in place
+ */
+struct svdpp_hogwild_update {
+  void operator()(graph_type::edge_type& edge) const {
+    if (edge.data().role != edge_data::TRAIN)
+      return;
+    graph_type::vertex_type user_vertex = edge.source();
+    vertex_data& user = user_vertex.data();
+    vertex_data& item = edge.target().data();
+    double pred = svdpp_vertex_program::GLOBAL_MEAN + 
+      user.bias + item.bias + user.pvec.dot(item.pvec + item.weight);
+    pred = std::min(pred, svdpp_vertex_program::MAXVAL);
+    pred = std::max(pred, svdpp_vertex_program::MINVAL); 
+    const double err = edge.data().obs - pred;
+    if (std::isnan(err))
+      logstream(LOG_FATAL)<<"Got into numeric errors.. try to tune step size and regularization using command line flags" << std::endl;
+    user.bias += usrBiasStep*(err - usrBiasReg*user.bias);
+    item.bias += itmBiasStep*(err - itmBiasReg*item.bias);
+    const double usrNorm = 1.0/sqrt(user_vertex.num_out_edges());
+    for (int i = 0; i < user.pvec.size(); ++i) {
+      const double usrFctr = user.pvec[i], itmFctr = item.pvec[i];
+      user.pvec[i] += usrFctrStep*(err*(itmFctr - usrFctrReg*usrFctr));
+      item.pvec[i] += itmFctrStep*(err*(usrFctr + user.weight[i]) - itmFctrReg*itmFctr);
+      item.weight[i] += itmFctr2Step*(usrNorm*err*itmFctr - itmFctr2Reg*item.weight[i]);
+    }
+  }
+}; // end of svdpp_hogwild_update
+
+void add_model(graph_type::vertex_type& vertex, const vertex_data& other) {
+  vertex.data().pvec += other.pvec;
+  vertex.data().weight += other.weight;
+  vertex.data().bias += other.bias;
+}
+void scale_model(vertex_data& vdata, double scale) {
+  vdata.pvec *= scale;
+  vdata.weight *= scale;
+  vdata.bias *= scale;
+}
+
+/**
+ * \brief Runs SVD++ in Hogwild mode instead of the engine.
+ *
+ * Every epoch computes the user weights, streams over the local
+ * training edges in shuffled blocks, updating the model in place, and
+ * then averages the model over the replicas of each vertex. Stops
+ * after max_iter epochs, or once the training RMSE changes by less
+ * than tol. Returns the number of epochs.
+ */
+size_t run_hogwild(graphlab::distributed_control& dc, graph_type& graph) {
+  graphlab::timer timer;
+  // start all the replicas of a vertex from the master model
+  graph.synchronize();
+  double prev_train_error = std::numeric_limits<double>::max();
+  size_t epoch = 0;
+  while (epoch < svdpp_vertex_program::MAX_UPDATES) {
+    compute_user_weights(graph);
+    hogwild_epoch(graph, svdpp_hogwild_update());
+    average_replicas(graph, add_model, scale_model);
+    ++epoch;
+    const error_aggregator agg =
+      graph.map_reduce_edges<error_aggregator>(error_aggregator::map_edge);
+    ASSERT_GT(agg.ntrain, 0);
+    const double train_error = std::sqrt(agg.train_error / agg.ntrain);
+    dc.cout() << std::setw(8) << timer.current_time() << std::setw(8) << train_error;
+    if(agg.nvalidation > 0)
+      dc.cout() << std::setw(8) << std::sqrt(agg.validation_error / agg.nvalidation);
+    dc.cout() << std::endl;
+    usrBiasStep *= svdpp_vertex_program::STEP_DEC;
+    itmBiasStep *= svdpp_vertex_program::STEP_DEC;
+    usrFctrStep  *= svdpp_vertex_program::STEP_DEC;
+    itmFctrStep  *= svdpp_vertex_program::STEP_DEC;
+    itmFctr2Step *= svdpp_vertex_program::STEP_DEC;
+    if (std::fabs(prev_train_error - train_error) < svdpp_vertex_program::TOLERANCE)
+      break;
+    prev_train_error = train_error;
+  }
+  return epoch;
+} // end of run_hogwild
+
+
 struct prediction_saver {
   typedef graph_type::vertex_type vertex_type;
   typedef graph_type::edge_type   edge_type;
@@ -659,6 +781,7 @@ int main(int argc, char** argv) {
   std::string predictions;
   size_t interval = 0;
   std::string exec_type = "synchronous";
+  bool hogwild = false;
   clopts.attach_option("matrix", input_dir,
       "The directory containing the matrix file");
   clopts.add_positional("matrix");
@@ -666,6 +789,9 @@ int main(int argc, char** argv) {
       "Number of latent parameters to use.");
   clopts.attach_option("engine", exec_type, 
       "The engine type synchronous or asynchronous");
+  clopts.attach_option("hogwild", hogwild,
+                       "If true, run lock free SGD over the local edges instead of the "
+                       "engine. max_iter is then the maximum number of epochs");
   clopts.attach_option("max_iter", svdpp_vertex_program::MAX_UPDATES,
       "The maxumum number of udpates allowed for a vertex");
   clopts.attach_option("lambda", svdpp_vertex_program::LAMBDA, 
@@ -743,46 +869,61 @@ int main(int argc, char** argv) {
     << float(graph.num_local_edges())/graph.num_edges()
     << std::endl;
 
-  dc.cout() << "Creating engine" << std::endl;
-  engine_type engine(dc, graph, exec_type, clopts);
-
-  // Add error reporting to the engine
-  const bool success = engine.add_edge_aggregator<error_aggregator>
-    ("error", error_aggregator::map, error_aggregator::finalize) &&
-    engine.aggregate_periodic("error", interval);
-  ASSERT_TRUE(success);
-
-
   svdpp_vertex_program::GLOBAL_MEAN = graph.map_reduce_edges<double>(calc_global_mean);
   svdpp_vertex_program::NUM_TRAINING_EDGES = graph.map_reduce_edges<size_t>(count_edges);
   svdpp_vertex_program::GLOBAL_MEAN /= svdpp_vertex_program::NUM_TRAINING_EDGES;
   dc.cout() << "Global mean is: " <<svdpp_vertex_program::GLOBAL_MEAN << std::endl;
 
-  // Signal all vertices on the vertices on the left (libersgd) 
-  engine.map_reduce_vertices<graphlab::empty>(svdpp_vertex_program::signal_left);
-
-
-  // Run the PageRank ---------------------------------------------------------
-  dc.cout() << "Running Bias-SGD" << std::endl;
-  dc.cout() << "(C) Code by Danny Bickson, CMU " << std::endl;
-  dc.cout() << "Please send bug reports to danny.bickson@gmail.com" << std::endl;
-  dc.cout() << "Time   Training    Validation" <<std::endl;
-  dc.cout() << "       RMSE        RMSE " <<std::endl;
-  timer.start();
-  engine.start();  
-
-  const double runtime = timer.current_time();
-  dc.cout() << "----------------------------------------------------------"
-    << std::endl
-    << "Final Runtime (seconds):   " << runtime 
-                                        << std::endl
-                                        << "Updates executed: " << engine.num_updates() << std::endl
-                                        << "Update Rate (updates/second): " 
-                                          << engine.num_updates() / runtime << std::endl;
-
-  // Compute the final training error -----------------------------------------
-  dc.cout() << "Final error: " << std::endl;
-  engine.aggregate_now("error");
+  if (hogwild) {
+    dc.cout() << "Running Hogwild SVD++" << std::endl;
+    dc.cout() << "Time   Training    Validation" <<std::endl;
+    dc.cout() << "       RMSE        RMSE " <<std::endl;
+    timer.start();
+    const size_t epochs = run_hogwild(dc, graph);
+    const double runtime = timer.current_time();
+    dc.cout() << "----------------------------------------------------------"
+              << std::endl
+              << "Final Runtime (seconds):   " << runtime << std::endl
+              << "Epochs executed: " << epochs << std::endl;
+  }
+  else {
+    dc.cout() << "Creating engine" << std::endl;
+    engine_type engine(dc, graph, exec_type, clopts);
+
+    // Add error reporting to the engine
+    const bool success = engine.add_edge_aggregator<error_aggregator>
+      ("error", error_aggregator::map, error_aggregator::finalize) &&
+      engine.aggregate_periodic("error", interval);
+    ASSERT_TRUE(success);
+
+
+
+    // Signal all vertices on the vertices on the left (libersgd) 
+    engine.map_reduce_vertices<graphlab::empty>(svdpp_vertex_program::signal_left);
+
+
+    // Run the PageRank ---------------------------------------------------------
+    dc.cout() << "Running Bias-SGD" << std::endl;
+    dc.cout() << "(C) Code by Danny Bickson, CMU " << std::endl;
+    dc.cout() << "Please send bug reports to danny.bickson@gmail.com" << std::endl;
+    dc.cout() << "Time   Training    Validation" <<std::endl;
+    dc.cout() << "       RMSE        RMSE " <<std::endl;
+    timer.start();
+    engine.start();  
+
+    const double runtime = timer.current_time();
+    dc.cout() << "----------------------------------------------------------"
+      << std::endl
+      << "Final Runtime (seconds):   " << runtime 
+                                          << std::endl
+                                          << "Updates executed: " << engine.num_updates() << std::endl
+                                          << "Update Rate (updates/second): " 
+                                            << engine.num_updates() / runtime << std::endl;
+
+    // Compute the final training error -----------------------------------------
+    dc.cout() << "Final error: " << std::endl;
+    engine.aggregate_now("error");
+  }
 
   // Make predictions ---------------------------------------------------------
   if(!predictions.empty()) {
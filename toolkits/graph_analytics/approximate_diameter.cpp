@@ -27,98 +27,159 @@
 #include <algorithm>
 #include <vector>
 #include <map>
+#include <cmath>
+#include <cstring>
 #include <time.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <graphlab.hpp>
 
-//helper function
-float myrand() {
-  return static_cast<float>(rand() / (RAND_MAX + 1.0));
+//helper function to hash a vertex id into 64 well mixed bits (splitmix64)
+uint64_t hash_vertex_id(uint64_t id) {
+  uint64_t z = id + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
 }
 
-//helper function to return hash for Flajolet & Martin bitmask
-size_t hash_value() {
-  size_t ret = 0;
-  while (myrand() < 0.5) {
-    ret++;
+// log2 of the number of HyperLogLog registers
+const size_t HLL_REGISTER_BITS = 6;
+const size_t HLL_REGISTERS = size_t(1) << HLL_REGISTER_BITS;
+
+// HyperLogLog sketch of a set of vertices (Flajolet, Fusy, Gandouet &
+// Meunier, 2007). Each of the 64 one-byte registers keeps the maximum
+// rank of the hashes which fall into it, so a sketch is one cache line
+// and the union of two sets is the register-wise maximum.
+// The relative standard error of the estimate is 1.04 / sqrt(64) = 13%.
+struct hll_sketch: public graphlab::IS_POD_TYPE {
+  uint8_t registers[HLL_REGISTERS];
+
+  hll_sketch() {
+    memset(registers, 0, sizeof(registers));
+  }
+
+  void insert(size_t id) {
+    const uint64_t hash = hash_vertex_id(id);
+    const size_t index = hash & (HLL_REGISTERS - 1);
+    const uint64_t rest = hash >> HLL_REGISTER_BITS;
+    const uint8_t rank = (rest == 0) ? uint8_t(64 - HLL_REGISTER_BITS + 1)
+                                     : uint8_t(__builtin_ctzll(rest) + 1);
+    registers[index] = std::max(registers[index], rank);
+  }
+
+  //plus is the union of the sets
+  hll_sketch& operator+=(const hll_sketch& other) {
+#ifdef __SSE2__
+    for (size_t i = 0; i < HLL_REGISTERS; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(registers + i));
+      __m128i b = _mm_loadu_si128((const __m128i*)(other.registers + i));
+      _mm_storeu_si128((__m128i*)(registers + i), _mm_max_epu8(a, b));
+    }
+#else
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+      registers[i] = std::max(registers[i], other.registers[i]);
+    }
+#endif
+    return *this;
   }
-  return ret;
-}
 
-const size_t DUPULICATION_OF_BITMASKS = 20;
+  //the estimated number of vertices in the set
+  double estimate() const {
+    const double m = HLL_REGISTERS;
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < HLL_REGISTERS; ++i) {
+      sum += ldexp(1.0, -int(registers[i]));
+      zeros += (registers[i] == 0);
+    }
+    double estimate = 0.709 * m * m / sum;
+    //small range correction: linear counting on the empty registers
+    if (estimate <= 2.5 * m && zeros > 0)
+      estimate = m * std::log(m / zeros);
+    return estimate;
+  }
+};
+
+// Exact set of vertices as a packed bitmask indexed by vertex id
+// (needs large memory: one bit per vertex id for every vertex)
+struct exact_sketch {
+  std::vector<uint64_t> words;
+
+  void insert(size_t id) {
+    if (words.size() <= id / 64)
+      words.resize(id / 64 + 1, 0);
+    words[id / 64] |= uint64_t(1) << (id % 64);
+  }
+
+  //plus is bitwise-or
+  exact_sketch& operator+=(const exact_sketch& other) {
+    //nothing to add, and words may be empty too
+    if (other.words.empty())
+      return *this;
+    if (words.size() < other.words.size())
+      words.resize(other.words.size(), 0);
+    uint64_t* __restrict__ a = &words[0];
+    const uint64_t* __restrict__ b = &other.words[0];
+    for (size_t i = 0; i < other.words.size(); ++i)
+      a[i] |= b[i];
+    return *this;
+  }
+
+  //the number of vertices in the set
+  double estimate() const {
+    size_t count = 0;
+    for (size_t i = 0; i < words.size(); ++i)
+      count += __builtin_popcountll(words[i]);
+    return count;
+  }
+
+  void save(graphlab::oarchive& oarc) const {
+    oarc << words;
+  }
+  void load(graphlab::iarchive& iarc) {
+    iarc >> words;
+  }
+};
+
+//the number of pairs reached from a vertex, given its sketch
+size_t reached_pairs(const hll_sketch& sketch) {
+  return (size_t) (sketch.estimate() + 0.5);
+}
+//the vertex itself is not counted as reached
+size_t reached_pairs(const exact_sketch& sketch) {
+  return (size_t) sketch.estimate() - 1;
+}
 
+template <typename Sketch>
 struct vdata {
   //use two bitmasks for consistency
-  std::vector<std::vector<bool> > bitmask1;
-  std::vector<std::vector<bool> > bitmask2;
+  Sketch bitmask1;
+  Sketch bitmask2;
   //indicate which is the bitmask for reading (or writing)
   bool odd_iteration;
   vdata() :
       bitmask1(), bitmask2(), odd_iteration(true) {
   }
-  //for exact counting (but needs large memory)
   void create_bitmask(size_t id) {
-    std::vector<bool> mask1(id + 2, 0);
-    mask1[id] = 1;
-    bitmask1.push_back(mask1);
-    std::vector<bool> mask2(id + 2, 0);
-    mask2[id] = 1;
-    bitmask2.push_back(mask2);
-  }
-  //for approximate Flajolet & Martin counting
-  void create_hashed_bitmask(size_t id) {
-    for (size_t i = 0; i < DUPULICATION_OF_BITMASKS; ++i) {
-      size_t hash_val = hash_value();
-      std::vector<bool> mask1(hash_val + 2, 0);
-      mask1[hash_val] = 1;
-      bitmask1.push_back(mask1);
-      std::vector<bool> mask2(hash_val + 2, 0);
-      mask2[hash_val] = 1;
-      bitmask2.push_back(mask2);
-    }
+    bitmask1.insert(id);
+    bitmask2.insert(id);
   }
   void save(graphlab::oarchive& oarc) const {
-    size_t num = bitmask1.size();
-    oarc << num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = bitmask1[a].size();
-      oarc << size;
-      for (size_t i = 0; i < size; ++i)
-        oarc << bitmask1[a][i];
-      for (size_t i = 0; i < size; ++i)
-        oarc << bitmask2[a][i];
-    }
+    oarc << bitmask1 << bitmask2 << odd_iteration;
   }
   void load(graphlab::iarchive& iarc) {
-    size_t num = 0;
-    iarc >> num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = 0;
-      iarc >> size;
-      std::vector<bool> mask1;
-      for (size_t i = 0; i < size; ++i) {
-        bool element = true;
-        iarc >> element;
-        mask1.push_back(element);
-      }
-      bitmask1.push_back(mask1);
-      std::vector<bool> mask2;
-      for (size_t i = 0; i < size; ++i) {
-        bool element = true;
-        iarc >> element;
-        mask2.push_back(element);
-      }
-      bitmask2.push_back(mask2);
-    }
+    iarc >> bitmask1 >> bitmask2 >> odd_iteration;
   }
 };
 
-typedef graphlab::distributed_graph<vdata, graphlab::empty> graph_type;
-
 //[vertex_id1] [vertex_id2]
 // NOTE: vertex id must start from 0.
 //       A vertex that has no edge must not exist.
-bool line_parser(graph_type& graph, const std::string& filename,
+template <typename Graph>
+bool line_parser(Graph& graph, const std::string& filename,
     const std::string& textline) {
   std::stringstream strm(textline);
   size_t source = 0;
@@ -133,82 +194,27 @@ bool line_parser(graph_type& graph, const std::string& filename,
 }
 
 //initialize bitmask
-void initialize_vertex(graph_type::vertex_type& v) {
+template <typename Graph>
+void initialize_vertex(typename Graph::vertex_type& v) {
   v.data().create_bitmask(v.id());
 }
-//initialize bitmask
-void initialize_vertex_for_approximation(graph_type::vertex_type& v) {
-  v.data().create_hashed_bitmask(v.id());
-}
-
-//helper function to compute OR
-void bitwise_or(std::vector<std::vector<bool> >& v1,
-    const std::vector<std::vector<bool> >& v2) {
-  for (size_t a = 0; a < v1.size(); ++a) {
-    while (v1[a].size() < v2[a].size()) {
-      v1[a].push_back(false);
-    }
-    for (size_t i = 0; i < v2[a].size(); ++i) {
-      v1[a][i] = v1[a][i] || v2[a][i];
-    }
-  }
-}
-
-struct bitmask_gatherer {
-  std::vector<std::vector<bool> > bitmask;
-
-  bitmask_gatherer() :
-      bitmask() {
-  }
-  explicit bitmask_gatherer(const std::vector<std::vector<bool> > & in_b) {
-    bitmask = in_b;
-  }
-
-  //plus is bitwise-or
-  bitmask_gatherer& operator+=(const bitmask_gatherer& other) {
-    bitwise_or(bitmask, other.bitmask);
-    return *this;
-  }
-
-  void save(graphlab::oarchive& oarc) const {
-    size_t num = bitmask.size();
-    oarc << num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = bitmask[a].size();
-      oarc << size;
-      for (size_t i = 0; i < size; ++i)
-        oarc << bitmask[a][i];
-    }
-  }
-  void load(graphlab::iarchive& iarc) {
-    size_t num = 0;
-    iarc >> num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = 0;
-      iarc >> size;
-      std::vector<bool> mask1;
-      for (size_t i = 0; i < size; ++i) {
-        bool element = true;
-        iarc >> element;
-        mask1.push_back(element);
-      }
-      bitmask.push_back(mask1);
-    }
-  }
-};
 
 //The next bitmask b(h + 1; i) of i at the hop h + 1 is given as:
 //b(h + 1; i) = b(h; i) BITWISE-OR {b(h; k) | source = i & target = k}.
-class one_hop: public graphlab::ivertex_program<graph_type, bitmask_gatherer>,
+//The gather type is the sketch itself, whose plus is the set union.
+template <typename Sketch>
+class one_hop: public graphlab::ivertex_program<
+    graphlab::distributed_graph<vdata<Sketch>, graphlab::empty>, Sketch>,
     public graphlab::IS_POD_TYPE {
-private:
 public:
-  one_hop() {
-  }
-
-  void init(icontext_type& context, const vertex_type& vertex,
-      const message_type& msg) {
-  }
+  typedef graphlab::ivertex_program<
+      graphlab::distributed_graph<vdata<Sketch>, graphlab::empty>, Sketch>
+      base_type;
+  typedef typename base_type::icontext_type icontext_type;
+  typedef typename base_type::vertex_type vertex_type;
+  typedef typename base_type::edge_type edge_type;
+  typedef typename base_type::gather_type gather_type;
+  typedef typename base_type::edge_dir_type edge_dir_type;
 
   //we are going to gather on out edges
   edge_dir_type gather_edges(icontext_type& context,
@@ -217,12 +223,12 @@ public:
   }
 
   //for each edge gather the bitmask of the edge
-  bitmask_gatherer gather(icontext_type& context, const vertex_type& vertex,
+  gather_type gather(icontext_type& context, const vertex_type& vertex,
       edge_type& edge) const {
     if (vertex.data().odd_iteration) {
-      return bitmask_gatherer(edge.target().data().bitmask2);
+      return edge.target().data().bitmask2;
     } else {
-      return bitmask_gatherer(edge.target().data().bitmask1);
+      return edge.target().data().bitmask1;
     }
   }
 
@@ -230,12 +236,10 @@ public:
   void apply(icontext_type& context, vertex_type& vertex,
       const gather_type& total) {
     if (vertex.data().odd_iteration) {
-      if (total.bitmask.size() > 0)
-        bitwise_or(vertex.data().bitmask1, total.bitmask);
+      vertex.data().bitmask1 += total;
       vertex.data().odd_iteration = false;
     } else {
-      if (total.bitmask.size() > 0)
-        bitwise_or(vertex.data().bitmask2, total.bitmask);
+      vertex.data().bitmask2 += total;
       vertex.data().odd_iteration = true;
     }
   }
@@ -275,61 +279,30 @@ struct pair_counter {
 };
 
 //count the number of notes reached in the current hop
-pair_counter absolute_vertex_data(const graph_type::vertex_type& vertex) {
+template <typename Graph>
+pair_counter absolute_vertex_data(const typename Graph::vertex_type& vertex) {
   if (vertex.data().odd_iteration == false) { //odd_iteration has just finished
-    size_t count = 0;
-    for (size_t i = 0; i < vertex.data().bitmask1[0].size(); ++i)
-      if (vertex.data().bitmask1[0][i])
-        count++;
-    return pair_counter(count - 1);
-  } else {
-    size_t count = 0;
-    for (size_t i = 0; i < vertex.data().bitmask2[0].size(); ++i)
-      if (vertex.data().bitmask2[0][i])
-        count++;
-    return pair_counter(count - 1);
-  }
-}
-
-//count the number of notes reached in the current hop with Flajolet & Martin counting method
-size_t approximate_pair_number(std::vector<std::vector<bool> > bitmask) {
-  float sum = 0.0;
-  for (size_t a = 0; a < bitmask.size(); ++a) {
-    for (size_t i = 0; i < bitmask[a].size(); ++i) {
-      if (bitmask[a][i] == 0) {
-        sum += (float) i;
-        break;
-      }
-    }
-  }
-  return (size_t) (pow(2.0, sum / (float) (bitmask.size())) / 0.77351);
-}
-//count the number of notes reached in the current hop
-pair_counter absolute_vertex_data_for_approximation(
-    const graph_type::vertex_type& vertex) {
-  if (vertex.data().odd_iteration == false) { //odd_iteration has just finished
-    size_t count = approximate_pair_number(vertex.data().bitmask1);
-    return pair_counter(count);
+    return pair_counter(reached_pairs(vertex.data().bitmask1));
   } else {
-    size_t count = approximate_pair_number(vertex.data().bitmask2);
-    return pair_counter(count);
+    return pair_counter(reached_pairs(vertex.data().bitmask2));
   }
 }
 
+template <typename Graph>
 class graph_writer {
 public:
   graph_writer() {
   }
-  std::string save_vertex(graph_type::vertex_type v) {
+  std::string save_vertex(typename Graph::vertex_type v) {
     std::stringstream strm;
     strm << v.id();
-    strm << " " << approximate_pair_number(v.data().bitmask1);
-    strm << " " << approximate_pair_number(v.data().bitmask2);
+    strm << " " << reached_pairs(v.data().bitmask1);
+    strm << " " << reached_pairs(v.data().bitmask2);
     strm << "\n";
     return strm.str();
   }
 
-  std::string save_edge(graph_type::edge_type e) {
+  std::string save_edge(typename Graph::edge_type e) {
     std::stringstream strm;
     size_t source = e.source().id();
     size_t target = e.target().id();
@@ -338,62 +311,32 @@ public:
   }
 };
 
-//return number of data
-int main(int argc, char** argv) {
-  std::cout << "Approximate graph diameter\n\n";
-  graphlab::mpi_tools::init(argc, argv);
-  graphlab::distributed_control dc;
-
-  std::string datafile;
-  float termination_criteria = 0.001;
-  bool approximation = true;
-  //parse command line
-  graphlab::command_line_options clopts(
-                "Approximate graph diameter. The input data file is "
-                "provided by the --graph argument which is non-optional. "
-                "Directions of edges are considered.");
-  std::string graph_dir;
-  std::string format = "adj";
-  std::string exec_type = "synchronous";
-  clopts.attach_option("graph", graph_dir,
-                       "The graph file. This is not optional");
-  clopts.add_positional("graph");
-  clopts.attach_option("engine", exec_type,
-                       "The engine type synchronous or asynchronous");
-  clopts.attach_option("tol", termination_criteria,
-                       "The permissible change at convergence.");
-  clopts.attach_option("format", format,
-                       "The graph file format");
-  clopts.attach_option("approximation", approximation,
-                       "If true, use Flajolet & Martin bitmask with "
-                       "a smaller memory");
-
-  if (!clopts.parse(argc, argv)){
-    dc.cout() << "Error in parsing command line arguments." << std::endl;
-    return EXIT_FAILURE;
-  }
-  if (graph_dir == "") {
-    std::cout << "--graph is not optional\n";
-    return EXIT_FAILURE;
-  }
+//load the graph and iterate hops until the number of reached pairs
+//converges, returning the approximate diameter
+template <typename Sketch>
+size_t compute_diameter(graphlab::distributed_control& dc,
+                        graphlab::command_line_options& clopts,
+                        const std::string& graph_dir,
+                        const std::string& format,
+                        const std::string& exec_type,
+                        float termination_criteria) {
+  typedef graphlab::distributed_graph<vdata<Sketch>, graphlab::empty>
+      graph_type;
 
   //load graph
   graph_type graph(dc, clopts);
   dc.cout() << "Loading graph in format: "<< format << std::endl;
   graph.load_format(graph_dir, format);
-//  graph.load(datafile, line_parser);
+//  graph.load(datafile, line_parser<graph_type>);
   graph.finalize();
 
   time_t start, end;
   //initialize vertices
   time(&start);
-  if (approximation == false)
-    graph.transform_vertices(initialize_vertex);
-  else
-    graph.transform_vertices(initialize_vertex_for_approximation);
+  graph.transform_vertices(initialize_vertex<graph_type>);
 
   graphlab::graphlab_options ops;
-  graphlab::omni_engine<one_hop> engine(dc, graph, exec_type, ops);
+  graphlab::omni_engine<one_hop<Sketch> > engine(dc, graph, exec_type, ops);
 
   //main iteration
   size_t previous_count = 0;
@@ -401,12 +344,9 @@ int main(int argc, char** argv) {
   for (size_t iter = 0; iter < 100; ++iter) {
     engine.signal_all();
     engine.start();
-    pair_counter stat;
-    if (approximation == false)
-      stat = graph.map_reduce_vertices<pair_counter>(absolute_vertex_data);
-    else
-      stat = graph.map_reduce_vertices<pair_counter>(
-          absolute_vertex_data_for_approximation);
+    pair_counter stat =
+        graph.template map_reduce_vertices<pair_counter>(
+            absolute_vertex_data<graph_type>);
     size_t current_count = stat.count;
     dc.cout() << iter + 1 << "-th hop: " << current_count
         << " edge pairs are reached\n";
@@ -422,17 +362,65 @@ int main(int argc, char** argv) {
   time(&end);
 
   dc.cout() << "graph calculation time is " << (end - start) << " sec\n";
-  dc.cout() << "approximate diameter is " << diameter << "\n";
 
 //  const std::string outputname = datafile + "_out";
 //  graph.save(
 //      outputname,
-//      graph_writer(), false, //set to true if each output file is to be gzipped
+//      graph_writer<graph_type>(), false, //set to true if each output file is to be gzipped
 //      true, //whether vertices are saved
 //      false)//whether edges are saved
+  return diameter;
+}
+
+//return number of data
+int main(int argc, char** argv) {
+  std::cout << "Approximate graph diameter\n\n";
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+
+  float termination_criteria = 0.001;
+  bool approximation = true;
+  //parse command line
+  graphlab::command_line_options clopts(
+                "Approximate graph diameter. The input data file is "
+                "provided by the --graph argument which is non-optional. "
+                "Directions of edges are considered.");
+  std::string graph_dir;
+  std::string format = "adj";
+  std::string exec_type = "synchronous";
+  clopts.attach_option("graph", graph_dir,
+                       "The graph file. This is not optional");
+  clopts.add_positional("graph");
+  clopts.attach_option("engine", exec_type,
+                       "The engine type synchronous or asynchronous");
+  clopts.attach_option("tol", termination_criteria,
+                       "The permissible change at convergence.");
+  clopts.attach_option("format", format,
+                       "The graph file format");
+  clopts.attach_option("approximation", approximation,
+                       "If true, use HyperLogLog sketches of "
+                       "64 bytes per vertex instead of exact bitmasks");
+
+  if (!clopts.parse(argc, argv)){
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (graph_dir == "") {
+    std::cout << "--graph is not optional\n";
+    return EXIT_FAILURE;
+  }
+
+  size_t diameter = 0;
+  if (approximation == false)
+    diameter = compute_diameter<exact_sketch>(dc, clopts, graph_dir, format,
+                                              exec_type, termination_criteria);
+  else
+    diameter = compute_diameter<hll_sketch>(dc, clopts, graph_dir, format,
+                                            exec_type, termination_criteria);
+
+  dc.cout() << "approximate diameter is " << diameter << "\n";
 
   graphlab::mpi_tools::finalize();
 
   return EXIT_SUCCESS;
 }
-
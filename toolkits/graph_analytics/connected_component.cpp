@@ -29,6 +29,7 @@
 
 #include <graphlab.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/util/union_find.hpp>
 
 struct vdata {
   size_t labelid;
@@ -151,6 +152,84 @@ public:
   }
 };
 
+//combine the label of a mirror into the master
+void min_label(graph_type::vertex_type& vertex, const vdata& mirror) {
+  vertex.data().labelid = std::min(vertex.data().labelid, mirror.labelid);
+}
+
+//Label the components without the engine. Each machine first merges
+//the endpoints of its local edges with a union-find, so that a whole
+//local component takes the minimum label of its vertices at once.
+//The local components only connect through the replicas of the
+//vertices spanning several machines: every round, all replicas of
+//such a vertex agree on their minimum label and each local component
+//then jumps to the minimum label of its boundary vertices. The number
+//of rounds is bounded by the diameter of the graph of local components
+//rather than by the diameter of the graph. Returns the number of rounds.
+size_t union_find_components(graphlab::distributed_control& dc,
+                             graph_type& graph) {
+  typedef graph_type::local_edge_type local_edge_type;
+  const size_t nverts = graph.num_local_vertices();
+  ASSERT_LT(nverts, size_t(uint32_t(-1)));
+  graphlab::concurrent_union_find local_components;
+  local_components.init(nverts);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+  for (int lvid = 0; lvid < (int)nverts; ++lvid) {
+    graph_type::local_edge_list_type edges = graph.l_vertex(lvid).out_edges();
+    for (graph_type::local_edge_list_type::iterator it = edges.begin();
+         it != edges.end(); ++it) {
+      local_edge_type edge = *it;
+      local_components.merge(lvid, edge.target().id());
+    }
+  }
+
+  //the label of a local component is kept at its root
+  std::vector<uint32_t> root(nverts);
+  std::vector<size_t> root_label(nverts, std::numeric_limits<size_t>::max());
+  std::vector<uint32_t> boundary;
+  for (size_t lvid = 0; lvid < nverts; ++lvid) {
+    graph_type::local_vertex_type vertex = graph.l_vertex(lvid);
+    root[lvid] = local_components.find(lvid);
+    root_label[root[lvid]] = std::min(root_label[root[lvid]],
+                                      size_t(vertex.global_id()));
+    if (!vertex.owned() || vertex.num_mirrors() > 0) boundary.push_back(lvid);
+  }
+  for (size_t i = 0; i < boundary.size(); ++i) {
+    graph.l_vertex(boundary[i]).data().labelid = root_label[root[boundary[i]]];
+  }
+
+  size_t rounds = 0;
+  while (true) {
+    ++rounds;
+    graph.synchronize_mirrors_to_master(min_label);
+    graph.synchronize();
+    //shortcut every local component to its smallest boundary label
+    for (size_t i = 0; i < boundary.size(); ++i) {
+      const size_t label = graph.l_vertex(boundary[i]).data().labelid;
+      size_t& current = root_label[root[boundary[i]]];
+      current = std::min(current, label);
+    }
+    size_t changed = 0;
+    for (size_t i = 0; i < boundary.size(); ++i) {
+      size_t& label = graph.l_vertex(boundary[i]).data().labelid;
+      if (label != root_label[root[boundary[i]]]) {
+        label = root_label[root[boundary[i]]];
+        ++changed;
+      }
+    }
+    dc.all_reduce(changed);
+    if (changed == 0) break;
+  }
+
+  //the interior vertices only take the final label of their component
+  for (size_t lvid = 0; lvid < nverts; ++lvid) {
+    graph.l_vertex(lvid).data().labelid = root_label[root[lvid]];
+  }
+  return rounds;
+}
+
 class graph_writer {
 public:
   std::string save_vertex(graph_type::vertex_type v) {
@@ -237,6 +316,7 @@ int main(int argc, char** argv) {
   std::string saveprefix;
   std::string format = "adj";
   std::string exec_type = "synchronous";
+  bool use_union_find = false;
   clopts.attach_option("graph", graph_dir,
                        "The graph file. This is not optional");
   clopts.add_positional("graph");
@@ -244,6 +324,11 @@ int main(int argc, char** argv) {
                        "The engine type synchronous or asynchronous");
   clopts.attach_option("format", format,
                        "The graph file format");
+  clopts.attach_option("union_find", use_union_find,
+                       "If true, merge the local components of every "
+                       "machine with a union-find and only propagate labels "
+                       "between the replicas of the boundary vertices, "
+                       "instead of running label propagation on the engine");
   clopts.attach_option("saveprefix", saveprefix,
                        "If set, will save the pairs of a vertex id and "
                        "a component id to a sequence of files with prefix "
@@ -268,10 +353,16 @@ int main(int argc, char** argv) {
 
   //running the engine
   time_t start, end;
-  graphlab::omni_engine<label_propergation> engine(dc, graph, exec_type, clopts);
-  engine.signal_all();
   time(&start);
-  engine.start();
+  if (use_union_find) {
+    const size_t rounds = union_find_components(dc, graph);
+    dc.cout() << "union-find converged in " << rounds << " rounds\n";
+  } else {
+    graphlab::omni_engine<label_propergation> engine(dc, graph, exec_type,
+                                                     clopts);
+    engine.signal_all();
+    engine.start();
+  }
 
   //take statistics
   label_counter stat = graph.map_reduce_vertices<label_counter>(
@@ -35,11 +35,29 @@
  *  - Essentially, recursively remove everything with degree 1
  *  - Then recursively remove everything with degree 2
  *  - etc.
+ *
+ * This needs one engine run per K. By default we instead compute the
+ * core number (coreness) of every vertex in a single run with the
+ * distributed algorithm of
+ *
+ * A. Montresor, F. De Pellegrini and D. Miorandi, Distributed k-Core
+ * Decomposition, IEEE TPDS 2013.
+ *
+ *  - Every vertex starts with its degree as an upper bound of its
+ *    coreness.
+ *  - A vertex lowers its bound to the largest k such that at least k
+ *    neighbors have a bound of at least k (the h-index of the bounds
+ *    of its neighbors, capped at its own bound).
+ *  - The neighbors of a vertex whose bound dropped are signaled again,
+ *    until no bound changes.
+ *
+ * The K-core is then the set of vertices with coreness at least K.
  */
 
 /*
  * Each vertex maintains a "degree" count. If this value
- * is 0, the vertex is "deleted"
+ * is 0, the vertex is "deleted".
+ * When computing the coreness this is the upper bound of the coreness.
  */
 typedef int vertex_data_type;
 
@@ -145,6 +163,165 @@ public:
 // type of the synchronous_engine
 typedef graphlab::synchronous_engine<k_core> engine_type;
 
+
+/*
+ * The gather type of the coreness program: the coreness bounds of the
+ * neighbors, each capped at the bound of the gathering vertex.
+ * A single bound is kept outside of the vector so that gathering an
+ * edge does not allocate. gather() sets capacity to the degree so that
+ * the vector is allocated once at its final size.
+ */
+struct bound_list {
+  // a single bound, or -1 if the bounds are in the vector
+  int bound;
+  std::vector<int> bounds;
+  // not serialized
+  size_t capacity;
+
+  bound_list() : bound(-1), capacity(0) { }
+
+  size_t size() const {
+    return bound >= 0 ? 1 : bounds.size();
+  }
+  int operator[](size_t i) const {
+    return bound >= 0 ? bound : bounds[i];
+  }
+
+  bound_list& operator+=(const bound_list& other) {
+    capacity = std::max(capacity, other.capacity);
+    if (size() == 0 && other.bound >= 0) {
+      bound = other.bound;
+    } else if (other.size() > 0) {
+      if (bound >= 0) {
+        bounds.reserve(std::max(capacity, 1 + other.size()));
+        bounds.push_back(bound);
+        bound = -1;
+      }
+      if (other.bound >= 0) bounds.push_back(other.bound);
+      else bounds.insert(bounds.end(), other.bounds.begin(),
+                         other.bounds.end());
+    }
+    return *this;
+  }
+  void save(graphlab::oarchive& oarc) const { oarc << bound << bounds; }
+  void load(graphlab::iarchive& iarc) {
+    capacity = 0;
+    iarc >> bound >> bounds;
+  }
+};
+
+/*
+ * Computes the coreness of every vertex in a single run.
+ * Each vertex holds an upper bound of its coreness, initially its
+ * degree, which it lowers to the h-index of the bounds of its
+ * neighbors. If the bound drops, the neighbors which may now drop
+ * too are signaled.
+ */
+class coreness :
+  public graphlab::ivertex_program<graph_type, bound_list>,
+  public graphlab::IS_POD_TYPE  {
+public:
+  // set if the bound dropped in apply
+  bool changed;
+
+  coreness():changed(false) { }
+
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::ALL_EDGES;
+  }
+
+  bound_list gather(icontext_type& context, const vertex_type& vertex,
+                    edge_type& edge) const {
+    const vertex_type other = edge.source().id() == vertex.id() ?
+      edge.target() : edge.source();
+    bound_list ret;
+    ret.bound = std::min(other.data(), vertex.data());
+    ret.capacity = vertex.num_in_edges() + vertex.num_out_edges();
+    return ret;
+  }
+
+  /*
+   * Lowers the bound to the largest k such that at least k neighbors
+   * have a bound of at least k.
+   */
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& neighbors) {
+    const int bound = vertex.data();
+    std::vector<size_t> count(bound + 1, 0);
+    for (size_t i = 0; i < neighbors.size(); ++i) ++count[neighbors[i]];
+    int k = bound;
+    size_t at_least_k = 0;
+    for (; k > 0; --k) {
+      at_least_k += count[k];
+      if (at_least_k >= size_t(k)) break;
+    }
+    changed = k < bound;
+    vertex.data() = k;
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    return changed ? graphlab::ALL_EDGES : graphlab::NO_EDGES;
+  }
+
+  /*
+   * Only the neighbors with a larger bound count this vertex with a
+   * smaller value than before.
+   */
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    const vertex_type other = edge.source().id() == vertex.id() ?
+      edge.target() : edge.source();
+    if (other.data() > vertex.data()) context.signal(other);
+  }
+};
+
+
+/*
+ * A histogram of core numbers, reduced over the vertices or edges
+ */
+struct core_histogram {
+  std::vector<size_t> counts;
+  core_histogram() { }
+  explicit core_histogram(int core) : counts(core + 1, 0) {
+    counts[core] = 1;
+  }
+  core_histogram& operator+=(const core_histogram& other) {
+    if (counts.size() < other.counts.size()) {
+      counts.resize(other.counts.size(), 0);
+    }
+    for (size_t i = 0; i < other.counts.size(); ++i) {
+      counts[i] += other.counts[i];
+    }
+    return *this;
+  }
+  void save(graphlab::oarchive& oarc) const { oarc << counts; }
+  void load(graphlab::iarchive& iarc) { iarc >> counts; }
+};
+
+core_histogram vertex_coreness(const graph_type::vertex_type& vertex) {
+  return core_histogram(vertex.data());
+}
+
+// an edge is in the K-core if both of its ends are
+core_histogram edge_coreness(const graph_type::edge_type& edge) {
+  return core_histogram(std::min(edge.source().data(),
+                                 edge.target().data()));
+}
+
+/*
+ * Returns the number of elements with core number at least k,
+ * for every k.
+ */
+std::vector<size_t> at_least(const core_histogram& hist) {
+  std::vector<size_t> ret(hist.counts.size() + 1, 0);
+  for (size_t k = hist.counts.size(); k > 0; --k) {
+    ret[k - 1] = ret[k] + hist.counts[k - 1];
+  }
+  return ret;
+}
+
 /*
  * Called before any graph operation is performed.
  * Initializes all vertex data to the number of adjacent edges.
@@ -188,17 +365,31 @@ size_t double_count_active_edges(const graph_type::vertex_type& vertex) {
  * Saves the graph in a tsv format with the condition that
  * the adjacent vertices have not yet been deleted.
  * This allows saving of the k-core graph.
+ * With coreness, the adjacent vertices must have coreness at least K.
  */
 struct save_core_at_k {
+  bool coreness;
+  save_core_at_k(bool coreness) : coreness(coreness) { }
   std::string save_vertex(graph_type::vertex_type) { return ""; }
   std::string save_edge(graph_type::edge_type e) {
-    if (e.source().data() > 0 && e.target().data() > 0) {
+    const int min_data = coreness ? std::max<int>(CURRENT_K, 1) : 1;
+    if (e.source().data() >= min_data && e.target().data() >= min_data) {
       return graphlab::tostr(e.source().id()) + "\t" +
         graphlab::tostr(e.target().id()) + "\n";
     }
     else return "";
   }
 };
+
+/*
+ * Saves the coreness of each vertex: one vid / coreness pair per line
+ */
+struct save_coreness {
+  std::string save_vertex(graph_type::vertex_type v) {
+    return graphlab::tostr(v.id()) + "\t" + graphlab::tostr(v.data()) + "\n";
+  }
+  std::string save_edge(graph_type::edge_type e) { return ""; }
+};
     
 int main(int argc, char** argv) {
   std::cout << "Computes a k-core decomposition of a graph.\n\n";
@@ -213,6 +404,8 @@ int main(int argc, char** argv) {
   size_t kmin = 0;
   size_t kmax = (size_t)(-1);
   std::string savecores;
+  bool use_coreness = true;
+  std::string savecoreness;
   clopts.attach_option("graph", prefix,
                        "Graph input. reads all graphs matching prefix*");
   clopts.attach_option("format", format,
@@ -223,6 +416,14 @@ int main(int argc, char** argv) {
                        "Compute the k-Core for k the range [kmin,kmax]");
   clopts.attach_option("savecores", savecores,
                        "If non-empty, will save tsv of each core with prefix [savecores].K.");
+  clopts.attach_option("coreness", use_coreness,
+                       "If true, computes the core number of every vertex "
+                       "in a single run and derives the K-cores from it. "
+                       "Otherwise the graph is peeled with one run per K.");
+  clopts.attach_option("savecoreness", savecoreness,
+                       "If non-empty and coreness is set, will save the "
+                       "core number of each vertex with prefix "
+                       "[savecoreness].");
 
   if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
   if (prefix == "") {
@@ -252,6 +453,48 @@ int main(int argc, char** argv) {
 
   graphlab::timer ti;
 
+  if (use_coreness) {
+    graphlab::synchronous_engine<coreness> engine(dc, graph, clopts);
+    // initialize the vertex data with the degree
+    graph.transform_vertices(initialize_vertex_values);
+    engine.signal_all();
+    engine.start();
+    dc.cout() << "Coreness computed in " << ti.current_time()
+              << " seconds" << std::endl;
+    if (savecoreness != "") {
+      graph.save(savecoreness, save_coreness(),
+                 false, /* no compression */
+                 true, /* save vertex */
+                 false, /* do not save edge */
+                 clopts.get_ncpus()); /* one file per machine */
+    }
+    // the sizes of all the K-cores
+    const std::vector<size_t> numv_at_least =
+      at_least(graph.map_reduce_vertices<core_histogram>(vertex_coreness));
+    const std::vector<size_t> nume_at_least =
+      at_least(graph.map_reduce_edges<core_histogram>(edge_coreness));
+    for (CURRENT_K = kmin; CURRENT_K <= kmax; CURRENT_K++) {
+      // vertices without edges are never in a K-core
+      const size_t k = std::max<size_t>(CURRENT_K, 1);
+      if (k >= numv_at_least.size()) break;
+      const size_t numv = numv_at_least[k];
+      const size_t nume = k < nume_at_least.size() ? nume_at_least[k] : 0;
+      if (numv == 0) break;
+      dc.cout() << "K=" << CURRENT_K << ":  #V = "
+                << numv << "   #E = " << nume << std::endl;
+      if (savecores != "") {
+        graph.save(savecores + "." + graphlab::tostr(CURRENT_K) + ".",
+                   save_core_at_k(true),
+                   false, /* no compression */ 
+                   false, /* do not save vertex */
+                   true, /* save edge */ 
+                   clopts.get_ncpus()); /* one file per machine */
+      }
+    }
+    graphlab::mpi_tools::finalize();
+    return EXIT_SUCCESS;
+  }
+
   graphlab::synchronous_engine<k_core> engine(dc, graph, clopts);
 
   // initialize the vertex data with the degree
@@ -274,7 +517,7 @@ int main(int argc, char** argv) {
     // Saves the result if requested
     if (savecores != "") {
       graph.save(savecores + "." + graphlab::tostr(CURRENT_K) + ".",
-                 save_core_at_k(),
+                 save_core_at_k(false),
                  false, /* no compression */ 
                  false, /* do not save vertex */
                  true, /* save edge */ 
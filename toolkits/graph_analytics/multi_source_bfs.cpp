@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+
+#include <graphlab.hpp>
+
+#include "source_batches.hpp"
+
+/*
+ * Multi-source breadth first search.  Up to 512 sources are searched
+ * at once by giving every source one bit of a packed bitset: a vertex
+ * forwards the bits which reached it for the first time, and the
+ * bits arriving from all its neighbors are or-ed together into a
+ * single message.  A vertex is therefore activated once per distinct
+ * hop distance rather than once per source, and the whole batch costs
+ * about as much as a single traversal.
+ */
+
+/**
+ * \brief The supported batch widths, in sources.
+ */
+const size_t BATCH_WIDTHS[] = {64, 128, 256, 512};
+
+/**
+ * \brief Hop distances are saturated at this value.
+ */
+const uint16_t MAX_HOPS = 0xFFFF;
+
+/**
+ * \brief Use directed or undireced edges.
+ */
+bool DIRECTED_BFS = false;
+
+
+/**
+ * \brief A set of source slots packed into WORDS 64 bit words.  It
+ * is used both as the message type, where plus is the union, and to
+ * record the sources which reached a vertex.
+ */
+template <size_t WORDS>
+struct source_bitset : public graphlab::IS_POD_TYPE {
+  uint64_t words[WORDS];
+
+  source_bitset() { clear(); }
+
+  void clear() { memset(words, 0, sizeof(words)); }
+
+  void set(size_t slot) { words[slot / 64] |= uint64_t(1) << (slot % 64); }
+
+  bool empty() const {
+    uint64_t any = 0;
+    for (size_t i = 0; i < WORDS; ++i) any |= words[i];
+    return any == 0;
+  }
+
+  size_t popcount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < WORDS; ++i) count += __builtin_popcountll(words[i]);
+    return count;
+  }
+
+  //removes the slots which are in other
+  void subtract(const source_bitset& other) {
+    for (size_t i = 0; i < WORDS; ++i) words[i] &= ~other.words[i];
+  }
+
+  //plus is the union of the sets
+  source_bitset& operator+=(const source_bitset& other) {
+    for (size_t i = 0; i < WORDS; ++i) words[i] |= other.words[i];
+    return *this;
+  }
+
+  //calls fn(slot) for every slot in the set, in increasing order
+  template <typename Fn>
+  void for_each(Fn& fn) const {
+    for (size_t i = 0; i < WORDS; ++i) {
+      uint64_t w = words[i];
+      while (w) {
+        fn(i * 64 + __builtin_ctzll(w));
+        w &= w - 1;
+      }
+    }
+  }
+};
+
+
+/**
+ * \brief The sources which reached the vertex.  The hop distances
+ * are not part of the vertex data, so that the mirrors only receive
+ * the bitset.
+ */
+template <size_t WORDS>
+struct bfs_vertex_data : public graphlab::IS_POD_TYPE {
+  source_bitset<WORDS> reached;
+};
+
+
+/**
+ * \brief The hop distances of the sources of the current batch on
+ * this machine, one row of batch width slots per local vertex.  Only
+ * the rows of the masters are written, and the slot of a source is
+ * only meaningful if the source is in reached.  Empty if the
+ * distances are not saved.
+ */
+std::vector<uint16_t> HOPS;
+
+
+/**
+ * \brief Forgets the previous batch.
+ */
+template <typename Graph>
+void clear_vertex(typename Graph::vertex_type& vertex) {
+  vertex.data().reached.clear();
+}
+
+
+/**
+ * \brief Get the other vertex in the edge.
+ */
+template <typename Graph>
+inline typename Graph::vertex_type
+get_other_vertex(const typename Graph::edge_type& edge,
+                 const typename Graph::vertex_type& vertex) {
+  return vertex.id() == edge.source().id()? edge.target() : edge.source();
+}
+
+
+/**
+ * \brief Records the hop distance of each newly reached slot.
+ */
+struct record_hops {
+  uint16_t* hops;
+  uint16_t distance;
+  void operator()(size_t slot) { hops[slot] = distance; }
+};
+
+
+/**
+ * \brief The multi-source BFS vertex program.  The hop distance is
+ * the super-step in which a source's bit first arrives, so it must
+ * be run on the synchronous engine.
+ */
+template <size_t WORDS>
+class multi_source_bfs :
+  public graphlab::ivertex_program<
+    graphlab::distributed_graph<bfs_vertex_data<WORDS>, graphlab::empty>,
+    graphlab::empty,
+    source_bitset<WORDS> >,
+  public graphlab::IS_POD_TYPE {
+public:
+  typedef graphlab::distributed_graph<bfs_vertex_data<WORDS>, graphlab::empty>
+      graph_type;
+  typedef typename graph_type::vertex_type vertex_type;
+  typedef typename graph_type::edge_type edge_type;
+  typedef typename graphlab::ivertex_program<graph_type, graphlab::empty,
+      source_bitset<WORDS> >::icontext_type icontext_type;
+  typedef graphlab::edge_dir_type edge_dir_type;
+
+private:
+  //the sources which reach the vertex for the first time
+  source_bitset<WORDS> frontier;
+
+public:
+  void init(icontext_type& context, const vertex_type& vertex,
+            const source_bitset<WORDS>& msg) {
+    frontier = msg;
+  }
+
+  /**
+   * \brief We use the messaging model to compute the BFS
+   */
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+
+  /**
+   * \brief Keep the sources which are new to this vertex
+   */
+  void apply(icontext_type& context, vertex_type& vertex,
+             const graphlab::empty& empty) {
+    frontier.subtract(vertex.data().reached);
+    if (frontier.empty()) return;
+    vertex.data().reached += frontier;
+    if (HOPS.empty()) return;
+    record_hops record;
+    record.hops = &HOPS[vertex.local_id() * WORDS * 64];
+    record.distance = uint16_t(std::min<int>(context.iteration(), MAX_HOPS));
+    frontier.for_each(record);
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    if (frontier.empty()) return graphlab::NO_EDGES;
+    return DIRECTED_BFS ? graphlab::OUT_EDGES : graphlab::ALL_EDGES;
+  }
+
+  /**
+   * \brief Forward the new sources which the neighbor has not seen
+   */
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    const vertex_type other = get_other_vertex<graph_type>(edge, vertex);
+    source_bitset<WORDS> msg = frontier;
+    msg.subtract(other.data().reached);
+    if (!msg.empty()) context.signal(other, msg);
+  }
+}; // end of multi-source BFS vertex program
+
+
+/**
+ * \brief Writes one "source vertex hops" line for every source which
+ * reached the vertex.
+ */
+template <size_t WORDS>
+struct hops_writer {
+  typedef graphlab::distributed_graph<bfs_vertex_data<WORDS>, graphlab::empty>
+      graph_type;
+  const std::vector<graphlab::vertex_id_type>* batch;
+
+  struct write_line {
+    std::stringstream* strm;
+    const std::vector<graphlab::vertex_id_type>* batch;
+    graphlab::vertex_id_type vid;
+    const uint16_t* hops;
+    void operator()(size_t slot) {
+      (*strm) << (*batch)[slot] << "\t" << vid << "\t" << hops[slot] << "\n";
+    }
+  };
+
+  std::string save_vertex(const typename graph_type::vertex_type& vtx) {
+    std::stringstream strm;
+    write_line line;
+    line.strm = &strm;
+    line.batch = batch;
+    line.vid = vtx.id();
+    line.hops = &HOPS[vtx.local_id() * WORDS * 64];
+    vtx.data().reached.for_each(line);
+    return strm.str();
+  }
+  std::string save_edge(typename graph_type::edge_type e) { return ""; }
+}; // end of hops_writer
+
+
+/**
+ * \brief Counts the (source, vertex) pairs reached.
+ */
+template <typename Graph>
+size_t reached_pairs(const typename Graph::vertex_type& vtx) {
+  return vtx.data().reached.popcount();
+}
+
+
+/**
+ * \brief Loads the graph and runs the sources in batches of
+ * WORDS * 64.
+ */
+template <size_t WORDS>
+void run_batches(graphlab::distributed_control& dc,
+                 graphlab::command_line_options& clopts,
+                 const std::string& graph_dir,
+                 const std::string& format,
+                 size_t powerlaw,
+                 const std::vector<graphlab::vertex_id_type>& sources,
+                 const std::string& saveprefix) {
+  typedef typename multi_source_bfs<WORDS>::graph_type graph_type;
+  const size_t width = WORDS * 64;
+
+  // Build the graph ----------------------------------------------------------
+  graph_type graph(dc, clopts);
+  if(powerlaw > 0) { // make a synthetic graph
+    dc.cout() << "Loading synthetic Powerlaw graph." << std::endl;
+    graph.load_synthetic_powerlaw(powerlaw, false, 2, 100000000);
+  } else {
+    dc.cout() << "Loading graph in format: "<< format << std::endl;
+    graph.load_format(graph_dir, format);
+  }
+  // must call finalize before querying the graph
+  graph.finalize();
+  dc.cout() << "#vertices:  " << graph.num_vertices() << std::endl
+            << "#edges:     " << graph.num_edges() << std::endl;
+
+  // Running The Engine -------------------------------------------------------
+  graphlab::synchronous_engine<multi_source_bfs<WORDS> >
+      engine(dc, graph, clopts);
+  if (saveprefix != "") HOPS.resize(graph.num_local_vertices() * width);
+  const size_t nbatches = (sources.size() + width - 1) / width;
+  float runtime = 0;
+  size_t total_pairs = 0;
+  for (size_t b = 0; b < nbatches; ++b) {
+    const std::vector<graphlab::vertex_id_type>
+        batch(sources.begin() + b * width,
+              sources.begin() + std::min(sources.size(), (b + 1) * width));
+    graph.transform_vertices(clear_vertex<graph_type>);
+    // Each source starts with its own bit
+    for (size_t slot = 0; slot < batch.size(); ++slot) {
+      source_bitset<WORDS> msg;
+      msg.set(slot);
+      engine.signal(batch[slot], msg);
+    }
+    engine.start();
+    runtime += engine.elapsed_seconds();
+    const size_t pairs =
+        graph.template map_reduce_vertices<size_t>(reached_pairs<graph_type>);
+    total_pairs += pairs;
+    dc.cout() << "Batch " << b << ": " << batch.size() << " sources reached "
+              << pairs << " (source, vertex) pairs in "
+              << engine.iteration() << " hops" << std::endl;
+
+    // Save the batch -----------------------------------------------------------
+    if (saveprefix != "") {
+      hops_writer<WORDS> writer;
+      writer.batch = &batch;
+      graph.save(saveprefix + "." + graphlab::tostr(b), writer,
+                 false,    // do not gzip
+                 true,     // save vertices
+                 false);   // do not save edges
+    }
+  }
+  dc.cout() << "Finished Running engine in " << runtime
+            << " seconds." << std::endl
+            << "Reached pairs: " << total_pairs << std::endl;
+}
+
+
+int main(int argc, char** argv) {
+  // Initialize control plain using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_INFO);
+
+  // Parse command line options -----------------------------------------------
+  graphlab::command_line_options
+    clopts("Multi-Source Breadth First Search.");
+  std::string graph_dir;
+  std::string format = "adj";
+  size_t powerlaw = 0;
+  std::vector<graphlab::vertex_id_type> sources;
+  std::string source_file;
+  size_t batch = 512;
+  clopts.attach_option("graph", graph_dir,
+                       "The graph file.  If none is provided "
+                       "then a toy graph will be created");
+  clopts.add_positional("graph");
+  clopts.attach_option("format", format,
+                       "The graph file format");
+  clopts.attach_option("source", sources,
+                       "The source vertices");
+  clopts.add_positional("source");
+  clopts.attach_option("source_file", source_file,
+                       "A file of source vertices, one per line");
+  clopts.attach_option("batch", batch,
+                       "The number of sources searched at once: "
+                       "64, 128, 256 or 512");
+  clopts.attach_option("directed", DIRECTED_BFS,
+                       "Treat edges as directed.");
+  clopts.attach_option("powerlaw", powerlaw,
+                       "Generate a synthetic powerlaw out-degree graph. ");
+  std::string saveprefix;
+  clopts.attach_option("saveprefix", saveprefix,
+                       "If set, will save the hop distances of batch b to "
+                       "a sequence of files with prefix saveprefix.b");
+
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (powerlaw == 0 && graph_dir.length() == 0) {
+    dc.cout() << "graph or powerlaw option must be specified" << std::endl;
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  if (source_file != "" && !read_sources(source_file, sources)) {
+    dc.cout() << "Unable to read source file " << source_file << std::endl;
+    return EXIT_FAILURE;
+  }
+  if(sources.empty()) {
+    dc.cout()
+      << "No source vertex provided. Adding vertex 0 as source"
+      << std::endl;
+    sources.push_back(0);
+  }
+  remove_duplicate_sources(sources);
+
+  const size_t width =
+      choose_batch_width(BATCH_WIDTHS, sizeof(BATCH_WIDTHS) / sizeof(size_t),
+                         batch, sources.size());
+  dc.cout() << "Searching " << sources.size() << " sources in batches of "
+            << width << std::endl;
+  switch (width) {
+    case 64:
+      run_batches<1>(dc, clopts, graph_dir, format, powerlaw,
+                     sources, saveprefix);
+      break;
+    case 128:
+      run_batches<2>(dc, clopts, graph_dir, format, powerlaw,
+                     sources, saveprefix);
+      break;
+    case 256:
+      run_batches<4>(dc, clopts, graph_dir, format, powerlaw,
+                     sources, saveprefix);
+      break;
+    default:
+      run_batches<8>(dc, clopts, graph_dir, format, powerlaw,
+                     sources, saveprefix);
+      break;
+  }
+
+  // Tear-down communication layer and quit -----------------------------------
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+} // End of main
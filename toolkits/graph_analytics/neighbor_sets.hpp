@@ -0,0 +1,242 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_TOOLKITS_NEIGHBOR_SETS_HPP
+#define GRAPHLAB_TOOLKITS_NEIGHBOR_SETS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <graphlab.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/sorted_set_intersection.hpp>
+#include <graphlab/macros_def.hpp>
+
+/*
+ * The neighbor sets shared by the triangle counting programs.
+ * Everything here is inline or constant, so that the header may be
+ * included by several translation units of one program.
+ */
+
+// Radix sort implementation from https://github.com/gorset/radix
+// Thanks to Erik Gorset
+//
+/*
+Copyright 2011 Erik Gorset. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this list of
+conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list
+of conditions and the following disclaimer in the documentation and/or other materials
+provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Erik Gorset ``AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Erik Gorset OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Erik Gorset.
+*/
+inline void radix_sort(graphlab::vertex_id_type *array, int offset, int end,
+                       int shift) {
+    int x, y;
+    graphlab::vertex_id_type value, temp;
+    int last[256] = { 0 }, pointer[256];
+
+    for (x=offset; x<end; ++x) {
+        ++last[(array[x] >> shift) & 0xFF];
+    }
+
+    last[0] += offset;
+    pointer[0] = offset;
+    for (x=1; x<256; ++x) {
+        pointer[x] = last[x-1];
+        last[x] += last[x-1];
+    }
+
+    for (x=0; x<256; ++x) {
+        while (pointer[x] != last[x]) {
+            value = array[pointer[x]];
+            y = (value >> shift) & 0xFF;
+            while (x != y) {
+                temp = array[pointer[y]];
+                array[pointer[y]++] = value;
+                value = temp;
+                y = (value >> shift) & 0xFF;
+            }
+            array[pointer[x]++] = value;
+        }
+    }
+
+    if (shift > 0) {
+        shift -= 8;
+        for (x=0; x<256; ++x) {
+            temp = x > 0 ? pointer[x] - pointer[x-1] : pointer[0] - offset;
+            if (temp > 64) {
+                radix_sort(array, pointer[x] - temp, pointer[x], shift);
+            } else if (temp > 1) {
+                std::sort(array + (pointer[x] - temp), array + pointer[x]);
+                //insertion_sort(array, pointer[x] - temp, pointer[x]);
+            }
+        }
+    }
+}
+
+/*
+ * The default of the smallest neighbor set which is also stored as a
+ * bitmap if the bitmap is dense enough. The programs pass their
+ * threshold (the --ht option) to vid_vector::finalize.
+ */
+const size_t DEFAULT_HUB_THRESHOLD = 64;
+
+/*
+ * A bitmap over the range of a neighbor set may have up to this many
+ * bits per element, i.e. take up to twice the memory of the sorted
+ * vector of 32 bit ids.
+ */
+const size_t MAX_BITS_PER_HUB_NEIGHBOR = 64;
+
+// On each vertex, a sorted vector of VIDs. Each machine collects the
+// neighbors on its local edges, the master appends the parts of its
+// mirrors and finalizes the set before it is sent back to the mirrors.
+// The neighbor sets of
+// high degree vertices (hubs) with at least hub_threshold elements
+// also keep a bitmap of the VIDs from the smallest to the largest,
+// if it has at most MAX_BITS_PER_HUB_NEIGHBOR bits per element.
+// The bitmap is not sent: only whether there is one, so that the
+// mirrors rebuild it after deserialization exactly when the master
+// built it.
+struct vid_vector{
+  std::vector<graphlab::vertex_id_type> vid_vec;
+  // bit i is set if bitmap_offset + i is in the set. Empty if not a hub.
+  graphlab::dense_bitset bitmap;
+  graphlab::vertex_id_type bitmap_offset;
+
+  vid_vector(): bitmap_offset(0) { }
+
+  // appends the VIDs of another part of the same neighbor set.
+  // The set must be finalized before it is intersected.
+  void append(const vid_vector& other) {
+    vid_vec.insert(vid_vec.end(), other.vid_vec.begin(), other.vid_vec.end());
+  }
+
+  // sorts the vector in place and removes the duplicates,
+  // then builds a bitmap if it has at least hub_threshold elements.
+  void finalize(size_t hub_threshold) {
+    if (has_bitmap()) bitmap.resize(0);
+    if (vid_vec.size() > 64) {
+      radix_sort(&(vid_vec[0]), 0, vid_vec.size(),
+                 8 * sizeof(graphlab::vertex_id_type) - 8);
+    }
+    else {
+      std::sort(vid_vec.begin(), vid_vec.end());
+    }
+    std::vector<graphlab::vertex_id_type>::iterator new_end = std::unique(vid_vec.begin(),
+                                             vid_vec.end());
+    vid_vec.erase(new_end, vid_vec.end());
+    if (vid_vec.size() >= hub_threshold) build_bitmap();
+  }
+
+  // builds the bitmap of a hub, if it is dense enough
+  void build_bitmap() {
+    if (vid_vec.empty()) return;
+    const size_t range = vid_vec.back() - vid_vec.front() + 1;
+    if (range > MAX_BITS_PER_HUB_NEIGHBOR * vid_vec.size()) return;
+    bitmap_offset = vid_vec.front();
+    bitmap.resize(range);
+    bitmap.clear();
+    foreach(graphlab::vertex_id_type vid, vid_vec) {
+      bitmap.set_bit_unsync(vid - bitmap_offset);
+    }
+  }
+
+  bool has_bitmap() const {
+    return bitmap.size() > 0;
+  }
+
+  // Returns 1 if vid is in the set. Requires a bitmap.
+  size_t bitmap_count(graphlab::vertex_id_type vid) const {
+    return vid >= bitmap_offset && vid - bitmap_offset < bitmap.size() &&
+           bitmap.get(vid - bitmap_offset);
+  }
+
+  void save(graphlab::oarchive& oarc) const {
+    oarc << vid_vec << has_bitmap();
+  }
+
+  void clear() {
+    vid_vec.clear();
+    // frees the bitmap
+    if (has_bitmap()) bitmap.resize(0);
+  }
+
+  size_t size() const {
+    return vid_vec.size();
+  }
+
+  void load(graphlab::iarchive& iarc) {
+    clear();
+    bool hub;
+    iarc >> vid_vec >> hub;
+    if (hub) build_bitmap();
+  }
+};
+
+
+/*
+ * Computes the size of the intersection of two vid_vector's.
+ * Every element of the smaller set is looked up in the bitmap of the
+ * larger set if it has one. Otherwise the sorted vectors are
+ * intersected by graphlab::count_sorted_intersection.
+ */
+inline uint32_t count_set_intersect(
+             const vid_vector& smaller_set,
+             const vid_vector& larger_set) {
+  if (smaller_set.size() > larger_set.size()) {
+    return count_set_intersect(larger_set, smaller_set);
+  }
+  if (larger_set.has_bitmap()) {
+    size_t i = 0;
+    foreach(graphlab::vertex_id_type vid, smaller_set.vid_vec) {
+      i += larger_set.bitmap_count(vid);
+    }
+    return i;
+  }
+  return graphlab::count_sorted_intersection(smaller_set.vid_vec,
+                                             larger_set.vid_vec);
+}
+
+
+#include <graphlab/macros_undef.hpp>
+#endif
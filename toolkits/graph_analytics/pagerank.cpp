@@ -87,7 +87,11 @@ public:
   void apply(icontext_type& context, vertex_type& vertex,
              const gather_type& total) {
     float newval = (1.0 - RESET_PROB) * total + RESET_PROB;
-    last_change = (newval - vertex.data()) / vertex.num_out_edges();
+    // The convergence test uses the total change of the rank, which
+    // is the rank mass the out-neighbors have not seen yet.  Testing
+    // the change per out-edge would let the vertices with many
+    // out-edges stop while they still hold a large change.
+    last_change = newval - vertex.data();
     vertex.data() = newval;
     if (ITERATIONS) context.signal(vertex);
   }
@@ -95,11 +99,17 @@ public:
   /* The scatter edges depend on whether the pagerank has converged */
   edge_dir_type scatter_edges(icontext_type& context,
                               const vertex_type& vertex) const {
+    // The cached gathers of the out-neighbors must see every change,
+    // however small, or they drift from the true sum.  Vertices which
+    // did not change have nothing to post.
+    if (USE_DELTA_CACHE) {
+      return last_change != 0 ? graphlab::OUT_EDGES : graphlab::NO_EDGES;
+    }
     // If an iteration counter is set then 
     if (ITERATIONS) return graphlab::NO_EDGES;
-    // In the dynamic case we run scatter on out edges if the we need
-    // to maintain the delta cache or the tolerance is above bound.
-    if(USE_DELTA_CACHE || std::fabs(last_change) > TOLERANCE ) {
+    // In the dynamic case we run scatter on out edges if the
+    // tolerance is above bound.
+    if(std::fabs(last_change) > TOLERANCE) {
       return graphlab::OUT_EDGES;
     } else {
       return graphlab::NO_EDGES;
@@ -110,8 +120,11 @@ public:
   void scatter(icontext_type& context, const vertex_type& vertex,
                edge_type& edge) const {
     if(USE_DELTA_CACHE) {
-      context.post_delta(edge.target(), last_change);
-      if(last_change > TOLERANCE || last_change < -TOLERANCE)
+      // Fold the change into the neighbor's cached gather so that it
+      // only re-gathers once its cache is invalidated, and wake it
+      // only if the change is large enough to matter.
+      context.post_delta(edge.target(), last_change / vertex.num_out_edges());
+      if(ITERATIONS == 0 && std::fabs(last_change) > TOLERANCE)
         context.signal(edge.target()); 
     } else {
       context.signal(edge.target());
@@ -119,10 +132,10 @@ public:
   }
 
   void save(graphlab::oarchive& oarc) const {
-    if (ITERATIONS == 0) oarc << last_change;
+    if (ITERATIONS == 0 || USE_DELTA_CACHE) oarc << last_change;
   }
   void load(graphlab::iarchive& iarc) {
-    if (ITERATIONS == 0) iarc >> last_change;
+    if (ITERATIONS == 0 || USE_DELTA_CACHE) iarc >> last_change;
   }
 
 }; // end of factorized_pagerank update functor
@@ -174,7 +187,8 @@ int main(int argc, char** argv) {
                        "number of iterations. Also overrides the iterations "
                        "option in the engine");
   clopts.attach_option("use_delta", USE_DELTA_CACHE,
-                       "Use the delta cache to reduce time in gather.");
+                       "Propagate rank changes through the gather cache "
+                       "instead of re-gathering all in-edges.");
   std::string saveprefix;
   clopts.attach_option("saveprefix", saveprefix,
                        "If set, will save the resultant pagerank to a "
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+
+#include <boost/unordered_map.hpp>
+
+#include <graphlab.hpp>
+
+#include "source_batches.hpp"
+
+/*
+ * Personalized PageRank from a batch of sources at once.  Every
+ * vertex holds a fixed-width vector with one rank per source, so a
+ * single gather over the in-edges updates the ranks of all the
+ * sources of the batch and the batch costs about as much as one
+ * PageRank computation.
+ */
+
+/**
+ * \brief The supported batch widths, in sources.
+ */
+const size_t BATCH_WIDTHS[] = {8, 16, 32, 64};
+
+// Global random reset probability
+float RESET_PROB = 0.15;
+
+float TOLERANCE = 1.0E-6;
+
+/**
+ * \brief Marks a vertex which is not a source of the current batch.
+ */
+const uint32_t NO_SLOT = uint32_t(-1);
+
+
+/**
+ * \brief One rank per source of the batch.  This is also the gather
+ * type, where plus is the element-wise sum.
+ */
+template <size_t WIDTH>
+struct rank_vector : public graphlab::IS_POD_TYPE {
+  float values[WIDTH];
+
+  rank_vector() { clear(); }
+
+  void clear() { std::fill(values, values + WIDTH, 0.0f); }
+
+  rank_vector& operator+=(const rank_vector& other) {
+    for (size_t i = 0; i < WIDTH; ++i) values[i] += other.values[i];
+    return *this;
+  }
+};
+
+
+/**
+ * \brief The ranks of the vertex and its slot in the batch if the
+ * vertex is one of the sources.
+ */
+template <size_t WIDTH>
+struct ppr_vertex_data : public graphlab::IS_POD_TYPE {
+  rank_vector<WIDTH> rank;
+  uint32_t slot;
+};
+
+
+/**
+ * \brief Resets the ranks and assigns the slots of a new batch.
+ */
+template <typename Graph>
+struct reset_vertex {
+  const boost::unordered_map<graphlab::vertex_id_type, uint32_t>* slots;
+  void operator()(typename Graph::vertex_type& vertex) const {
+    vertex.data().rank.clear();
+    typename boost::unordered_map<graphlab::vertex_id_type, uint32_t>
+        ::const_iterator it = slots->find(vertex.id());
+    vertex.data().slot = (it == slots->end()) ? NO_SLOT : it->second;
+  }
+};
+
+
+/**
+ * \brief The personalized PageRank vertex program.  The rank of
+ * source s at vertex v is the probability that a random walk from s,
+ * restarting at s with probability RESET_PROB at each step, is at v.
+ */
+template <size_t WIDTH>
+class personalized_pagerank :
+  public graphlab::ivertex_program<
+    graphlab::distributed_graph<ppr_vertex_data<WIDTH>, graphlab::empty>,
+    rank_vector<WIDTH> >,
+  public graphlab::IS_POD_TYPE {
+public:
+  typedef graphlab::distributed_graph<ppr_vertex_data<WIDTH>, graphlab::empty>
+      graph_type;
+  typedef typename graph_type::vertex_type vertex_type;
+  typedef typename graph_type::edge_type edge_type;
+  typedef typename graphlab::ivertex_program<graph_type, rank_vector<WIDTH> >
+      ::icontext_type icontext_type;
+  typedef graphlab::edge_dir_type edge_dir_type;
+
+private:
+  float last_change;
+
+public:
+  /* Gather the weighted ranks of the adjacent page   */
+  rank_vector<WIDTH> gather(icontext_type& context, const vertex_type& vertex,
+                            edge_type& edge) const {
+    const vertex_type source = edge.source();
+    const float weight = 1.0f / source.num_out_edges();
+    rank_vector<WIDTH> ret;
+    for (size_t i = 0; i < WIDTH; ++i) {
+      ret.values[i] = weight * source.data().rank.values[i];
+    }
+    return ret;
+  }
+
+  /* Use the total ranks of adjacent pages to update this page */
+  void apply(icontext_type& context, vertex_type& vertex,
+             const rank_vector<WIDTH>& total) {
+    rank_vector<WIDTH>& rank = vertex.data().rank;
+    float change = 0;
+    for (size_t i = 0; i < WIDTH; ++i) {
+      float newval = (1.0 - RESET_PROB) * total.values[i];
+      if (i == vertex.data().slot) newval += RESET_PROB;
+      change = std::max(change, std::fabs(newval - rank.values[i]));
+      rank.values[i] = newval;
+    }
+    // Every source contributes a total rank of at most one, so unlike
+    // pagerank the change is not divided among the out-edges: this
+    // would stop the many low rank vertices far too early.
+    last_change = vertex.num_out_edges() == 0 ? 0 : change;
+  }
+
+  /* Only scatter while the ranks have not converged */
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    if (last_change > TOLERANCE) return graphlab::OUT_EDGES;
+    else return graphlab::NO_EDGES;
+  }
+
+  /* The scatter function just signal adjacent pages */
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    context.signal(edge.target());
+  }
+}; // end of personalized pagerank vertex program
+
+
+/**
+ * \brief Writes one "source vertex rank" line for every source whose
+ * rank at the vertex is at least min_rank.
+ */
+template <size_t WIDTH>
+struct rank_writer {
+  typedef graphlab::distributed_graph<ppr_vertex_data<WIDTH>, graphlab::empty>
+      graph_type;
+  const std::vector<graphlab::vertex_id_type>* batch;
+  float min_rank;
+
+  std::string save_vertex(const typename graph_type::vertex_type& vtx) {
+    std::stringstream strm;
+    const rank_vector<WIDTH>& rank = vtx.data().rank;
+    for (size_t i = 0; i < batch->size(); ++i) {
+      if (rank.values[i] > 0 && rank.values[i] >= min_rank) {
+        strm << (*batch)[i] << "\t" << vtx.id() << "\t"
+             << rank.values[i] << "\n";
+      }
+    }
+    return strm.str();
+  }
+  std::string save_edge(typename graph_type::edge_type e) { return ""; }
+}; // end of rank_writer
+
+
+/**
+ * \brief Loads the graph and runs the sources in batches of WIDTH.
+ */
+template <size_t WIDTH>
+void run_batches(graphlab::distributed_control& dc,
+                 graphlab::command_line_options& clopts,
+                 const std::string& graph_dir,
+                 const std::string& format,
+                 size_t powerlaw,
+                 const std::vector<graphlab::vertex_id_type>& sources,
+                 const std::string& saveprefix,
+                 float min_rank) {
+  typedef typename personalized_pagerank<WIDTH>::graph_type graph_type;
+
+  // Build the graph ----------------------------------------------------------
+  graph_type graph(dc, clopts);
+  if(powerlaw > 0) { // make a synthetic graph
+    dc.cout() << "Loading synthetic Powerlaw graph." << std::endl;
+    graph.load_synthetic_powerlaw(powerlaw, false, 2.1, 100000000);
+  } else {
+    dc.cout() << "Loading graph in format: "<< format << std::endl;
+    graph.load_format(graph_dir, format);
+  }
+  // must call finalize before querying the graph
+  graph.finalize();
+  dc.cout() << "#vertices: " << graph.num_vertices()
+            << " #edges:" << graph.num_edges() << std::endl;
+
+  // Running The Engine -------------------------------------------------------
+  graphlab::synchronous_engine<personalized_pagerank<WIDTH> >
+      engine(dc, graph, clopts);
+  const size_t nbatches = (sources.size() + WIDTH - 1) / WIDTH;
+  float runtime = 0;
+  for (size_t b = 0; b < nbatches; ++b) {
+    const std::vector<graphlab::vertex_id_type>
+        batch(sources.begin() + b * WIDTH,
+              sources.begin() + std::min(sources.size(), (b + 1) * WIDTH));
+    boost::unordered_map<graphlab::vertex_id_type, uint32_t> slots;
+    for (size_t slot = 0; slot < batch.size(); ++slot) {
+      slots[batch[slot]] = slot;
+    }
+    reset_vertex<graph_type> reset;
+    reset.slots = &slots;
+    graph.transform_vertices(reset);
+    // The ranks start at zero so only the sources need to be updated
+    for (size_t slot = 0; slot < batch.size(); ++slot) {
+      engine.signal(batch[slot]);
+    }
+    engine.start();
+    runtime += engine.elapsed_seconds();
+    dc.cout() << "Batch " << b << ": " << batch.size() << " sources in "
+              << engine.iteration() << " iterations" << std::endl;
+
+    // Save the batch -----------------------------------------------------------
+    if (saveprefix != "") {
+      rank_writer<WIDTH> writer;
+      writer.batch = &batch;
+      writer.min_rank = min_rank;
+      graph.save(saveprefix + "." + graphlab::tostr(b), writer,
+                 false,    // do not gzip
+                 true,     // save vertices
+                 false);   // do not save edges
+    }
+  }
+  dc.cout() << "Finished Running engine in " << runtime
+            << " seconds." << std::endl;
+}
+
+
+int main(int argc, char** argv) {
+  // Initialize control plain using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_INFO);
+
+  // Parse command line options -----------------------------------------------
+  graphlab::command_line_options clopts("Personalized PageRank algorithm.");
+  std::string graph_dir;
+  std::string format = "adj";
+  size_t powerlaw = 0;
+  std::vector<graphlab::vertex_id_type> sources;
+  std::string source_file;
+  size_t batch = 16;
+  float min_rank = 1.0E-4;
+  clopts.attach_option("graph", graph_dir,
+                       "The graph file.  If none is provided "
+                       "then a toy graph will be created");
+  clopts.add_positional("graph");
+  clopts.attach_option("format", format,
+                       "The graph file format");
+  clopts.attach_option("source", sources,
+                       "The source vertices");
+  clopts.add_positional("source");
+  clopts.attach_option("source_file", source_file,
+                       "A file of source vertices, one per line");
+  clopts.attach_option("batch", batch,
+                       "The number of sources computed at once: "
+                       "8, 16, 32 or 64");
+  clopts.attach_option("tol", TOLERANCE,
+                       "The permissible change at convergence.");
+  clopts.attach_option("min_rank", min_rank,
+                       "Ranks below this value are not saved.");
+  clopts.attach_option("powerlaw", powerlaw,
+                       "Generate a synthetic powerlaw out-degree graph. ");
+  std::string saveprefix;
+  clopts.attach_option("saveprefix", saveprefix,
+                       "If set, will save the ranks of batch b to a "
+                       "sequence of files with prefix saveprefix.b");
+
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (powerlaw == 0 && graph_dir.length() == 0) {
+    dc.cout() << "graph or powerlaw option must be specified" << std::endl;
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  if (source_file != "" && !read_sources(source_file, sources)) {
+    dc.cout() << "Unable to read source file " << source_file << std::endl;
+    return EXIT_FAILURE;
+  }
+  if(sources.empty()) {
+    dc.cout()
+      << "No source vertex provided. Adding vertex 0 as source"
+      << std::endl;
+    sources.push_back(0);
+  }
+  remove_duplicate_sources(sources);
+
+  const size_t width =
+      choose_batch_width(BATCH_WIDTHS, sizeof(BATCH_WIDTHS) / sizeof(size_t),
+                         batch, sources.size());
+  dc.cout() << "Ranking " << sources.size() << " sources in batches of "
+            << width << std::endl;
+  switch (width) {
+    case 8:
+      run_batches<8>(dc, clopts, graph_dir, format, powerlaw,
+                     sources, saveprefix, min_rank);
+      break;
+    case 16:
+      run_batches<16>(dc, clopts, graph_dir, format, powerlaw,
+                      sources, saveprefix, min_rank);
+      break;
+    case 32:
+      run_batches<32>(dc, clopts, graph_dir, format, powerlaw,
+                      sources, saveprefix, min_rank);
+      break;
+    default:
+      run_batches<64>(dc, clopts, graph_dir, format, powerlaw,
+                      sources, saveprefix, min_rank);
+      break;
+  }
+
+  // Tear-down communication layer and quit -----------------------------------
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+} // End of main
@@ -37,37 +37,62 @@ typedef graphlab::empty edge_data_type;
 
 
 /*
- * This is the gathering type which accumulates an (unordered) set of
- * all neighboring colors 
- * It is a simple wrapper around a boost::unordered_set with
- * an operator+= which simply performs a set union.
- *
- * This struct can be significantly accelerated for small sets.
- * Small collections of vertex IDs should not require the overhead
- * of the unordered_set.
+ * The color of a vertex which has not been colored yet
+ */
+const color_type UNCOLORED = color_type(-1);
+
+/*
+ * This is the gathering type which accumulates the set of all
+ * neighboring colors.
+ * It is a bitset with one bit per color, whose first 64 colors are
+ * held inline, so that gathering the color of one neighbor does not
+ * allocate unless the color is large. operator+= is a set union.
  */
-struct set_union_gather {
-  boost::unordered_set<color_type> colors;
+struct color_set {
+  uint64_t low;
+  std::vector<uint64_t> high;
+
+  color_set() : low(0) { }
+
+  void insert(color_type color) {
+    if (color == UNCOLORED) return;
+    if (color < 64) {
+      low |= uint64_t(1) << color;
+    } else {
+      const size_t word = color / 64 - 1;
+      if (high.size() <= word) high.resize(word + 1, 0);
+      high[word] |= uint64_t(1) << (color % 64);
+    }
+  }
 
   /*
-   * Combining with another collection of vertices.
+   * Combining with another collection of colors.
    * Union it into the current set.
    */
-  set_union_gather& operator+=(const set_union_gather& other) {
-    foreach(graphlab::vertex_id_type othervid, other.colors) {
-      colors.insert(othervid);
-    }
+  color_set& operator+=(const color_set& other) {
+    low |= other.low;
+    if (high.size() < other.high.size()) high.resize(other.high.size(), 0);
+    for (size_t i = 0; i < other.high.size(); ++i) high[i] |= other.high[i];
     return *this;
   }
-  
+
+  // the smallest color not in the set
+  color_type smallest_free() const {
+    if (~low) return __builtin_ctzll(~low);
+    for (size_t i = 0; i < high.size(); ++i) {
+      if (~high[i]) return 64 * (i + 1) + __builtin_ctzll(~high[i]);
+    }
+    return 64 * (high.size() + 1);
+  }
+
   // serialize
   void save(graphlab::oarchive& oarc) const {
-    oarc << colors;
+    oarc << low << high;
   }
 
   // deserialize
   void load(graphlab::iarchive& iarc) {
-    iarc >> colors;
+    iarc >> low >> high;
   }
 };
 
@@ -83,7 +108,7 @@ typedef graphlab::distributed_graph<color_type,
  */
 class graph_coloring:
       public graphlab::ivertex_program<graph_type,
-                                      set_union_gather>,
+                                      color_set>,
       /* I have no data. Just force it to POD */
       public graphlab::IS_POD_TYPE  {
 public:
@@ -100,10 +125,10 @@ public:
   gather_type gather(icontext_type& context,
                      const vertex_type& vertex,
                      edge_type& edge) const {
-    set_union_gather gather;
+    color_set gather;
     color_type other_color = edge.source().id() == vertex.id() ?
                                  edge.target().data(): edge.source().data();
-    gather.colors.insert(other_color);
+    gather.insert(other_color);
     return gather;
   }
 
@@ -114,13 +139,7 @@ public:
   void apply(icontext_type& context, vertex_type& vertex,
              const gather_type& neighborhood) {
     // find the smallest color not described in the neighborhood
-    size_t neighborhoodsize = neighborhood.colors.size();
-    for (color_type curcolor = 0; curcolor < neighborhoodsize + 1; ++curcolor) {
-      if (neighborhood.colors.count(curcolor) == 0) {
-        vertex.data() = curcolor;
-        break;
-      }
-    }
+    vertex.data() = neighborhood.smallest_free();
   }
 
 
@@ -147,6 +166,86 @@ public:
 };
 
 
+/*
+ * Speculative coloring (Gebremedhin & Manne, 2000) for the synchronous
+ * engine, which needs no locking. In every super-step the active
+ * vertices optimistically take the smallest color not used by their
+ * neighbors, although neighbors active in the same super-step may take
+ * the same color. Scatter then finds the edges whose endpoints share a
+ * color and signals only the endpoint of lower priority, which
+ * recolors in the next super-step. Higher degree vertices have priority,
+ * ties are broken by the smaller vertex id.
+ */
+class speculative_coloring:
+      public graphlab::ivertex_program<graph_type,
+                                      color_set>,
+      public graphlab::IS_POD_TYPE  {
+public:
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::ALL_EDGES;
+  } 
+
+  gather_type gather(icontext_type& context,
+                     const vertex_type& vertex,
+                     edge_type& edge) const {
+    color_set gather;
+    gather.insert(edge.source().id() == vertex.id() ?
+                  edge.target().data(): edge.source().data());
+    return gather;
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& neighborhood) {
+    vertex.data() = neighborhood.smallest_free();
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::ALL_EDGES;
+  } 
+
+  // true if vertex a must give up its color to vertex b on a conflict
+  static bool yields_to(const vertex_type& a, const vertex_type& b) {
+    const size_t adegree = a.num_in_edges() + a.num_out_edges();
+    const size_t bdegree = b.num_in_edges() + b.num_out_edges();
+    return adegree < bdegree || (adegree == bdegree && a.id() > b.id());
+  }
+
+  void scatter(icontext_type& context,
+              const vertex_type& vertex,
+              edge_type& edge) const {
+    if (edge.source().data() == edge.target().data()) {
+      const vertex_type other = edge.source().id() == vertex.id() ?
+                                  edge.target() : edge.source();
+      context.signal(yields_to(vertex, other) ? vertex : other);
+    }
+  }
+};
+
+
+/*
+ * Initializes a vertex for speculative coloring
+ */
+void clear_color(graph_type::vertex_type& vertex) {
+  vertex.data() = UNCOLORED;
+}
+
+/*
+ * Reduces the number of colors used, which is the largest color plus one
+ */
+struct color_count : public graphlab::IS_POD_TYPE {
+  size_t value;
+  explicit color_count(size_t value = 0) : value(value) { }
+  color_count& operator+=(const color_count& other) {
+    value = std::max(value, other.value);
+    return *this;
+  }
+};
+
+color_count vertex_color_count(const graph_type::vertex_type& vertex) {
+  return color_count(vertex.data() + 1);
+}
 
 
 /*
@@ -176,11 +275,13 @@ int main(int argc, char** argv) {
             "provided graph.\n\n";
 
   graphlab::command_line_options clopts("Graph coloring. "
-    "Given a graph, this program computes a graph coloring of the graph."
-    "The Asynchronous engine is used.");
+    "Given a graph, this program computes a graph coloring of the graph. "
+    "The graph is colored with the asynchronous engine using edge "
+    "consistency, or speculatively with the synchronous engine.");
   std::string prefix, format;
   std::string output;
   size_t powerlaw = 0;
+  bool speculative = false;
   clopts.attach_option("graph", prefix,
                        "Graph input. reads all graphs matching prefix*");
   clopts.attach_option("format", format,
@@ -189,6 +290,12 @@ int main(int argc, char** argv) {
                        "A prefix to save the output.");
     clopts.attach_option("powerlaw", powerlaw,
                        "Generate a synthetic powerlaw out-degree graph. ");
+    clopts.attach_option("speculative", speculative,
+                       "If true, colors speculatively with the synchronous "
+                       "engine and recolors only conflicting vertices, "
+                       "instead of using the locking asynchronous engine. "
+                       "This avoids the lock round trips between machines "
+                       "but is slower on a single machine.");
  
   if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
   if (prefix.length() == 0) {
@@ -225,13 +332,22 @@ int main(int argc, char** argv) {
 
   graphlab::timer ti;
   
-  // create engine to count the number of triangles
   dc.cout() << "Coloring..." << std::endl;
-  graphlab::async_consistent_engine<graph_coloring> engine(dc, graph, clopts);
-  engine.signal_all();
-  engine.start();
+  if (speculative) {
+    graph.transform_vertices(clear_color);
+    graphlab::synchronous_engine<speculative_coloring> engine(dc, graph, clopts);
+    engine.signal_all();
+    engine.start();
+  } else {
+    graphlab::async_consistent_engine<graph_coloring> engine(dc, graph, clopts);
+    engine.signal_all();
+    engine.start();
+  }
 
   dc.cout() << "Colored in " << ti.current_time() << " seconds" << std::endl;
+  dc.cout() << "Number of colors: "
+            << graph.map_reduce_vertices<color_count>(vertex_color_count).value
+            << std::endl;
   if (output != "") {
     graph.save(output,
               save_colors(),
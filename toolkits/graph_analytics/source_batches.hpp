@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_TOOLKITS_SOURCE_BATCHES_HPP
+#define GRAPHLAB_TOOLKITS_SOURCE_BATCHES_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <graphlab.hpp>
+#include <boost/unordered_set.hpp>
+
+/*
+ * The source lists shared by the multi-source programs
+ * (multi_source_bfs and personalized_pagerank).  The sources are
+ * processed in batches, each batch being one engine run in which
+ * every source owns one slot of a fixed-width vertex data vector.
+ */
+
+/**
+ * \brief Appends the vertex ids listed in the file (one per line,
+ * blank lines ignored) to the sources.  Every machine reads the
+ * file so it must be visible to all of them.  Returns false if the
+ * file cannot be read.
+ */
+inline bool read_sources(const std::string& fname,
+                         std::vector<graphlab::vertex_id_type>& sources) {
+  std::ifstream fin(fname.c_str());
+  if (!fin.good()) return false;
+  graphlab::vertex_id_type vid;
+  while (fin >> vid) sources.push_back(vid);
+  return fin.eof();
+}
+
+/**
+ * \brief Removes repeated sources, keeping the first occurrence so
+ * that every machine assigns the same slots.
+ */
+inline void remove_duplicate_sources
+(std::vector<graphlab::vertex_id_type>& sources) {
+  boost::unordered_set<graphlab::vertex_id_type> seen;
+  size_t n = 0;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (seen.insert(sources[i]).second) sources[n++] = sources[i];
+  }
+  sources.resize(n);
+}
+
+/**
+ * \brief Returns the smallest of the (increasing) supported batch
+ * widths which holds min(batch, nsources) sources, or the largest
+ * width if none does.
+ */
+inline size_t choose_batch_width(const size_t* widths, size_t nwidths,
+                                 size_t batch, size_t nsources) {
+  const size_t wanted = std::min(batch, nsources);
+  for (size_t i = 0; i < nwidths; ++i) {
+    if (widths[i] >= wanted) return widths[i];
+  }
+  return widths[nwidths - 1];
+}
+
+#endif
@@ -24,7 +24,7 @@
 #include <boost/unordered_set.hpp>
 #include <graphlab.hpp>
 #include <graphlab/ui/metrics_server.hpp>
-#include <graphlab/util/hopscotch_set.hpp>
+#include "neighbor_sets.hpp"
 #include <graphlab/macros_def.hpp>
 /**
  *  
@@ -35,7 +35,8 @@
  *    Phd in computer science, University Karlsruhe, 2007.
  *
  * The procedure is quite straightforward:
- *   - each vertex maintains a list of all of its neighbors in a hash set.
+ *   - each vertex maintains a sorted list of all of its neighbors, and
+ *     for high degree vertices also a bitmap of them.
  *   - For each edge (u,v) in the graph, count the number of intersections
  *     of the neighbor set on u and the neighbor set on v.
  *   - We store the size of the intersection on the edge.
@@ -69,256 +70,6 @@
  */
  
 
-// Radix sort implementation from https://github.com/gorset/radix
-// Thanks to Erik Gorset
-//
-/*
-Copyright 2011 Erik Gorset. All rights reserved.
-
-Redistribution and use in source and binary forms, with or without modification, are
-permitted provided that the following conditions are met:
-
-1. Redistributions of source code must retain the above copyright notice, this list of
-conditions and the following disclaimer.
-
-2. Redistributions in binary form must reproduce the above copyright notice, this list
-of conditions and the following disclaimer in the documentation and/or other materials
-provided with the distribution.
-
-THIS SOFTWARE IS PROVIDED BY Erik Gorset ``AS IS'' AND ANY EXPRESS OR IMPLIED
-WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
-FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Erik Gorset OR
-CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
-CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
-SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
-ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
-NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
-ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-The views and conclusions contained in the software and documentation are those of the
-authors and should not be interpreted as representing official policies, either expressed
-or implied, of Erik Gorset.
-*/
-void radix_sort(graphlab::vertex_id_type *array, int offset, int end, int shift) {
-    int x, y;
-    graphlab::vertex_id_type value, temp;
-    int last[256] = { 0 }, pointer[256];
-
-    for (x=offset; x<end; ++x) {
-        ++last[(array[x] >> shift) & 0xFF];
-    }
-
-    last[0] += offset;
-    pointer[0] = offset;
-    for (x=1; x<256; ++x) {
-        pointer[x] = last[x-1];
-        last[x] += last[x-1];
-    }
-
-    for (x=0; x<256; ++x) {
-        while (pointer[x] != last[x]) {
-            value = array[pointer[x]];
-            y = (value >> shift) & 0xFF;
-            while (x != y) {
-                temp = array[pointer[y]];
-                array[pointer[y]++] = value;
-                value = temp;
-                y = (value >> shift) & 0xFF;
-            }
-            array[pointer[x]++] = value;
-        }
-    }
-
-    if (shift > 0) {
-        shift -= 8;
-        for (x=0; x<256; ++x) {
-            temp = x > 0 ? pointer[x] - pointer[x-1] : pointer[0] - offset;
-            if (temp > 64) {
-                radix_sort(array, pointer[x] - temp, pointer[x], shift);
-            } else if (temp > 1) {
-                std::sort(array + (pointer[x] - temp), array + pointer[x]);
-                //insertion_sort(array, pointer[x] - temp, pointer[x]);
-            }
-        }
-    }
-}
-
-size_t HASH_THRESHOLD = 64;
-
-// We on each vertex, either a vector of sorted VIDs
-// or a hash set (cuckoo hash) of VIDs.
-// If the number of elements is greater than HASH_THRESHOLD,
-// the hash set is used. Otherwise the vector is used.
-struct vid_vector{
-  std::vector<graphlab::vertex_id_type> vid_vec;
-  graphlab::hopscotch_set<graphlab::vertex_id_type, false> *cset;
-  vid_vector(): cset(NULL) { }
-  vid_vector(const vid_vector& v):cset(NULL) {
-    (*this) = v;
-  }
-
-  vid_vector& operator=(const vid_vector& v) {
-    if (this == &v) return *this;
-    vid_vec = v.vid_vec;
-    if (v.cset != NULL) {
-      // allocate the cuckoo set if the other side is using a cuckoo set
-      // or clear if I alrady have one
-      if (cset == NULL) {
-        cset = new graphlab::hopscotch_set<graphlab::vertex_id_type, false>(HASH_THRESHOLD);
-      }
-      else {
-        cset->clear();
-      }
-      (*cset) = *(v.cset);
-    }
-    else {
-      // if the other side is not using a cuckoo set, lets not use a cuckoo set
-      // either
-      if (cset != NULL) {
-        delete cset;
-        cset = NULL;
-      }
-    }
-    return *this;
-  }
-
-  ~vid_vector() {
-    if (cset != NULL) delete cset;
-  }
-
-  // assigns a vector of vertex IDs to this storage.
-  // this function will clear the contents of the vid_vector
-  // and reconstruct it.
-  // If the assigned values has length >= HASH_THRESHOLD,
-  // we will allocate a cuckoo set to store it. Otherwise,
-  // we just store a sorted vector
-  void assign(const std::vector<graphlab::vertex_id_type>& vec) {
-    clear();
-    if (vec.size() >= HASH_THRESHOLD) {
-        // move to cset
-        cset = new graphlab::hopscotch_set<graphlab::vertex_id_type, false>(HASH_THRESHOLD);
-        foreach (graphlab::vertex_id_type v, vec) {
-          cset->insert(v);
-        }
-    }
-    else {
-      vid_vec = vec;
-      if (vid_vec.size() > 64) {
-        radix_sort(&(vid_vec[0]), 0, vid_vec.size(), 24);
-      }
-      else {
-        std::sort(vid_vec.begin(), vid_vec.end());
-      }
-      std::vector<graphlab::vertex_id_type>::iterator new_end = std::unique(vid_vec.begin(),
-                                               vid_vec.end());
-      vid_vec.erase(new_end, vid_vec.end());
-    }
-  }
-
-  void save(graphlab::oarchive& oarc) const {
-    oarc << (cset != NULL);
-    if (cset == NULL) oarc << vid_vec;
-    else oarc << (*cset);
-  }
-
-
-  void clear() {
-    vid_vec.clear();
-    if (cset != NULL) {
-      delete cset;
-      cset = NULL;
-    }
-  }
-
-  size_t size() const {
-    return cset == NULL ? vid_vec.size() : cset->size();
-  }
-
-  void load(graphlab::iarchive& iarc) {
-    clear();
-    bool hascset;
-    iarc >> hascset;
-    if (!hascset) iarc >> vid_vec;
-    else {
-      cset = new graphlab::hopscotch_set<graphlab::vertex_id_type, false>(HASH_THRESHOLD);
-      iarc >> (*cset);
-    }
-  }
-};
-
-/*
-  A simple counting iterator which can be used as an insert iterator.
-  but only counts the number of elements inserted. Useful for
-  use with counting the size of an intersection using std::set_intersection
-*/
-template <typename T>
-struct counting_inserter {
-  size_t* i;
-  counting_inserter(size_t* i):i(i) { }
-  counting_inserter& operator++() {
-    ++(*i);
-    return *this;
-  }
-  void operator++(int) {
-    ++(*i);
-  }
-
-  struct empty_val {
-    empty_val operator=(const T&) { return empty_val(); }
-  };
-
-  empty_val operator*() {
-    return empty_val();
-  }
-
-  typedef empty_val reference;
-};
-
-
-/*
- * Computes the size of the intersection of two vid_vector's
- */
-static uint32_t count_set_intersect(
-             const vid_vector& smaller_set,
-             const vid_vector& larger_set) {
-
-  if (smaller_set.cset == NULL && larger_set.cset == NULL) {
-    size_t i = 0;
-    counting_inserter<graphlab::vertex_id_type> iter(&i);
-    std::set_intersection(smaller_set.vid_vec.begin(), smaller_set.vid_vec.end(),
-                          larger_set.vid_vec.begin(), larger_set.vid_vec.end(),
-                          iter);
-    return i;
-  }
-  else if (smaller_set.cset == NULL && larger_set.cset != NULL) {
-    size_t i = 0;
-    foreach(graphlab::vertex_id_type vid, smaller_set.vid_vec) {
-      i += larger_set.cset->count(vid);
-    }
-    return i;
-  }
-  else if (smaller_set.cset != NULL && larger_set.cset == NULL) {
-    size_t i = 0;
-    foreach(graphlab::vertex_id_type vid, larger_set.vid_vec) {
-      i += smaller_set.cset->count(vid);
-    }
-    return i;
-  }
-  else {
-    size_t i = 0;
-    foreach(graphlab::vertex_id_type vid, *(smaller_set.cset)) {
-      i += larger_set.cset->count(vid);
-    }
-    return i;
-
-  }
-}
-
-
-
-
-
-
 /*
  * Each vertex maintains a list of all its neighbors.
  * and a final count for the number of triangles it is involved in
@@ -344,146 +95,110 @@ struct vertex_data_type {
  */
 typedef uint32_t edge_data_type;
 
-// To collect the set of neighbors, we need a message type which is
-// basically a set of vertex IDs
-
 bool PER_VERTEX_COUNT = false;
 
+// The smallest neighbor set which is also stored as a bitmap
+size_t HUB_THRESHOLD = DEFAULT_HUB_THRESHOLD;
+
 
 /*
- * This is the gathering type which accumulates an array of
- * all neighboring vertices.
- * It is a simple wrapper around a vector with
- * an operator+= which simply performs a  +=
+ * Define the type of the graph
  */
-struct set_union_gather {
-  graphlab::vertex_id_type v;
-  std::vector<graphlab::vertex_id_type> vid_vec;
+typedef graphlab::distributed_graph<vertex_data_type,
+                                    edge_data_type> graph_type;
 
-  set_union_gather():v(-1) {
-  }
 
-  size_t size() const {
-    if (v == (graphlab::vertex_id_type)-1) return vid_vec.size();
-    else return 1;
-  }
-  /*
-   * Combining with another collection of vertices.
-   * Union it into the current set.
-   */
-  set_union_gather& operator+=(const set_union_gather& other) {
-    if (size() == 0) {
-      (*this) = other;
-      return (*this);
-    }
-    else if (other.size() == 0) {
-      return *this;
-    }
 
-    if (vid_vec.size() == 0) {
-      vid_vec.push_back(v);
-      v = (graphlab::vertex_id_type)(-1);
-    }
-    if (other.vid_vec.size() > 0) {
-      size_t ct = vid_vec.size();
-      vid_vec.resize(vid_vec.size() + other.vid_vec.size());
-      for (size_t i = 0; i < other.vid_vec.size(); ++i) {
-        vid_vec[ct + i] = other.vid_vec[i];
-      }
-    }
-    else if (other.v != (graphlab::vertex_id_type)-1) {
-      vid_vec.push_back(other.v);
-    }
-    return *this;
-  }
-  
-  // serialize
-  void save(graphlab::oarchive& oarc) const {
-    oarc << bool(vid_vec.size() == 0);
-    if (vid_vec.size() == 0) oarc << v;
-    else oarc << vid_vec;
-  }
+/*
+ * Without per vertex counts, only one end point of an edge needs the
+ * other one in its neighbor set: the one with fewer neighbors, or the
+ * smaller id if both have as many.  The degrees are those of the whole
+ * graph, so that every machine decides alike.
+ */
+bool keeps_neighbor(graph_type::local_vertex_type vertex,
+                    graph_type::local_vertex_type other) {
+  if (PER_VERTEX_COUNT) return true;
+  const size_t my_nbrs = vertex.global_num_in_edges() +
+                         vertex.global_num_out_edges();
+  const size_t other_nbrs = other.global_num_in_edges() +
+                            other.global_num_out_edges();
+  return other_nbrs > my_nbrs ||
+         (other_nbrs == my_nbrs && other.global_id() > vertex.global_id());
+}
 
-  // deserialize
-  void load(graphlab::iarchive& iarc) {
-    bool novvec;
-    v = (graphlab::vertex_id_type)(-1);
-    vid_vec.clear();
-    iarc >> novvec;
-    if (novvec) iarc >> v;
-    else iarc >> vid_vec;
-  }
-};
+//combine the part of a neighbor set collected by a mirror into the master
+void append_neighbor_set(graph_type::vertex_type& vertex,
+                         const vertex_data_type& mirror) {
+  vertex.data().vid_set.append(mirror.vid_set);
+}
 
 /*
- * Define the type of the graph
+ * Collects the neighbor sets without the engine.  Every machine
+ * walks the local edges of its replicas once, writing the neighbors
+ * straight into the vertex data, and the mirrors then append their
+ * parts to the master.  The sets are only finalized by the apply of
+ * triangle_count on the master, which also sends them to the mirrors.
  */
-typedef graphlab::distributed_graph<vertex_data_type,
-                                    edge_data_type> graph_type;
-
+void build_neighbor_sets(graph_type& graph) {
+  typedef graph_type::local_edge_list_type local_edge_list_type;
+  const size_t nverts = graph.num_local_vertices();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+  for (int lvid = 0; lvid < (int)nverts; ++lvid) {
+    graph_type::local_vertex_type vertex = graph.l_vertex(lvid);
+    vid_vector& vid_set = vertex.data().vid_set;
+    vid_set.clear();
+    vid_set.vid_vec.reserve(vertex.num_in_edges() + vertex.num_out_edges());
+    local_edge_list_type in_edges = vertex.in_edges();
+    for (local_edge_list_type::iterator it = in_edges.begin();
+         it != in_edges.end(); ++it) {
+      graph_type::local_vertex_type other = (*it).source();
+      if (keeps_neighbor(vertex, other)) {
+        vid_set.vid_vec.push_back(other.global_id());
+      }
+    }
+    local_edge_list_type out_edges = vertex.out_edges();
+    for (local_edge_list_type::iterator it = out_edges.begin();
+         it != out_edges.end(); ++it) {
+      graph_type::local_vertex_type other = (*it).target();
+      if (keeps_neighbor(vertex, other)) {
+        vid_set.vid_vec.push_back(other.global_id());
+      }
+    }
+  }
+  graph.synchronize_mirrors_to_master(append_neighbor_set);
+}
 
 
 /*
  * This class implements the triangle counting algorithm as described in
- * the header. On gather, we accumulate a set of all adjacent vertices.
- * If per_vertex output is not necessary, we can use the optimization
- * where each vertex only accumulates neighbors with greater vertex IDs.
+ * the header.  The neighbor sets are collected by build_neighbor_sets,
+ * which must run before the engine.  If per_vertex output is not
+ * necessary, each edge is only kept in the neighbor set of one of its
+ * end points.
  */
 class triangle_count :
       public graphlab::ivertex_program<graph_type,
-                                      set_union_gather>,
+                                      graphlab::empty>,
       /* I have no data. Just force it to POD */
       public graphlab::IS_POD_TYPE  {
 public:
   bool do_not_scatter;
 
-  // Gather on all edges
+  // No gather: the neighbor sets are already on the master
   edge_dir_type gather_edges(icontext_type& context,
                              const vertex_type& vertex) const {
-    return graphlab::ALL_EDGES;
+    return graphlab::NO_EDGES;
   } 
 
   /*
-   * For each edge, figure out the ID of the "other" vertex
-   * and accumulate a set of the neighborhood vertex IDs.
-   */
-  gather_type gather(icontext_type& context,
-                     const vertex_type& vertex,
-                     edge_type& edge) const {
-    set_union_gather gather;
-    graphlab::vertex_id_type otherid = edge.target().id() == vertex.id() ?
-                                       edge.source().id() : edge.target().id();
-
-    size_t other_nbrs = (edge.target().id() == vertex.id()) ?
-        (edge.source().num_in_edges() + edge.source().num_out_edges()): 
-        (edge.target().num_in_edges() + edge.target().num_out_edges());
-
-    size_t my_nbrs = vertex.num_in_edges() + vertex.num_out_edges();
-
-    if (PER_VERTEX_COUNT || (other_nbrs > my_nbrs) || (other_nbrs == my_nbrs && otherid > vertex.id())) {
-    //if (PER_VERTEX_COUNT || otherid > vertex.id()) {
-     gather.v = otherid;
-    } 
-    return gather;
-  }
-
-  /*
-   * the gather result now contains the vertex IDs in the neighborhood.
-   * store it on the vertex. 
+   * Sorts the neighbor set collected by build_neighbor_sets.
+   * The engine then sends it to the mirrors.
    */
   void apply(icontext_type& context, vertex_type& vertex,
-             const gather_type& neighborhood) {
-   do_not_scatter = false;
-   if (neighborhood.vid_vec.size() == 0) {
-     // neighborhood set may be empty or has only 1 element
-     vertex.data().vid_set.clear();
-     if (neighborhood.v != (graphlab::vertex_id_type(-1))) {
-       vertex.data().vid_set.vid_vec.push_back(neighborhood.v);
-     }
-   }
-   else {
-     vertex.data().vid_set.assign(neighborhood.vid_vec);
-   }
+             const gather_type& unused) {
+   vertex.data().vid_set.finalize(HUB_THRESHOLD);
    do_not_scatter = vertex.data().vid_set.size() == 0;
   } // end of apply
 
@@ -609,8 +324,9 @@ int main(int argc, char** argv) {
                        "Graph input. reads all graphs matching prefix*");
   clopts.attach_option("format", format,
                        "The graph format");
- clopts.attach_option("ht", HASH_THRESHOLD,
-                       "Above this size, hash sets are used");
+ clopts.attach_option("ht", HUB_THRESHOLD,
+                       "From this size on, dense neighbor sets are also "
+                       "stored as bitmaps");
   clopts.attach_option("per_vertex", per_vertex,
                        "If not empty, will count the number of "
                        "triangles each vertex belongs to and "
@@ -647,6 +363,7 @@ int main(int argc, char** argv) {
   
   // create engine to count the number of triangles
   dc.cout() << "Counting Triangles..." << std::endl;
+  build_neighbor_sets(graph);
   engine_type engine(dc, graph, clopts);
   engine.signal_all();
   engine.start();
@@ -259,6 +259,23 @@ struct bp_vertex_program :
       vec belief = vdata.potential + total;
       // Save the best configuration for this vertex.
       belief.maxCoeff(&vdata.best_configuration);
+    } else if (vdata.nvars == 2) {
+      // Pairwise factor.  The potential is laid out as a row major
+      // cards[0] x cards[1] table, so the multipliers of the two
+      // variables are added to its columns and rows.
+      typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                            Eigen::RowMajor> row_major_mat;
+      const int rows = vdata.cards[0], cols = vdata.cards[1];
+      ASSERT_EQ(vdata.potential.size(), rows * cols);
+      ASSERT_EQ(total.size(), rows + cols);
+      row_major_mat belief = 
+        Eigen::Map<const row_major_mat>(vdata.potential.data(), rows, cols);
+      belief.colwise() += total.head(rows);
+      belief.rowwise() += total.tail(cols).transpose();
+      // Save the best configuration for this factor.
+      int best_row = 0, best_col = 0;
+      belief.maxCoeff(&best_row, &best_col);
+      vdata.best_configuration = best_row * cols + best_col;
     } else {
       // General factor.
       vec belief = vdata.potential;
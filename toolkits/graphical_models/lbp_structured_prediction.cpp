@@ -77,8 +77,10 @@
  * ========================
  *
  * This application creates a pair-wise Markov Random Field with
- * Ising-Potts edge factors and then uses residual loopy belief
- * propagation to compute posterior belief estimates for each vertex.
+ * Ising-Potts (or truncated linear and quadratic) edge factors and
+ * then uses residual loopy belief propagation to compute posterior
+ * belief estimates for each vertex.  The messages are computed by the
+ * kernels in message_kernels.hpp in O(L) time for L states.
  *
  *
  *  \author Joseph Gonzalez
@@ -94,6 +96,7 @@
 
 #include <Eigen/Dense>
 #include "eigen_serialization.hpp"
+#include "message_kernels.hpp"
 
 
 
@@ -126,6 +129,44 @@ typedef Eigen::VectorXd factor_type;
  */
 double SMOOTHING = 2;
 
+/**
+ * \brief The form of the edge factor {potts, linear, quadratic}.
+ * The linear and quadratic edge factors penalize the distance between
+ * the assignments:
+ *
+ * \code
+ * edge_factor(xi, xj) = 
+ *   exp( -SMOOTHING * edge_weight * min(|xi - xj|, TRUNCATION) );
+ * edge_factor(xi, xj) = 
+ *   exp( -SMOOTHING * edge_weight * min((xi - xj)^2, TRUNCATION) );
+ * \endcode
+ *
+ * This parameter is set as a command line argument.
+ */
+std::string POTENTIAL = "potts";
+
+/**
+ * \brief The distance beyond which the linear and quadratic edge
+ * factors stop growing.
+ *
+ * This parameter is set as a command line argument.
+ */
+double TRUNCATION = std::numeric_limits<double>::infinity();
+
+/**
+ * \brief If set the messages compute the max-marginals (max-product)
+ * instead of the marginals (sum-product).
+ *
+ * This parameter is set as a command line argument.
+ */
+bool MAX_PRODUCT = false;
+
+/**
+ * \brief The edge factor with unit edge weight, built from the
+ * parameters above once they are parsed.
+ */
+pairwise_potential EDGE_POTENTIAL;
+
 /**
  * \brief The Damping parameter which helps ensure stable convergence.
  * Larger damping values lead to slower but more stable convergence.
@@ -355,7 +396,7 @@ struct bp_vertex_program :
       edata.old_message(other_vertex.id(), vertex.id());
     ASSERT_EQ(old_in_message.size(), vertex.data().belief.size());
     factor_type cavity = vertex.data().belief - old_in_message;
-    // compute the new message by convolving with the Ising-Potts Edge
+    // compute the new message by convolving with the Edge
     // factor.
     factor_type& new_out_message = 
       edata.message(vertex.id(), other_vertex.id());
@@ -378,8 +419,8 @@ struct bp_vertex_program :
 private:
 
   /**
-   * \brief Compute the convolution of the cavity with the Ising-Potts
-   * edge potential and store the result in the message
+   * \brief Compute the convolution of the cavity with the edge
+   * potential and store the result in the message
    *
    * \param cavity the belief minus the in-bound message
    * \param weight the edge weight used to scale the smoothing parameter
@@ -388,16 +429,16 @@ private:
    */
   inline void convolve(const factor_type& cavity, const double& weight, 
                        factor_type& message) const {
-    for(int i = 0; i < message.size(); ++i) {
-      double sum = 0;
-      for(int j = 0; j < cavity.size(); ++j) {
-        sum += std::exp( cavity(j)  + ( i == j? 0 : -(SMOOTHING*weight) ) ); 
-      }
-      // To try and ensure numerical stability we do not allow
-      // messages to underflow in log-space
-      message(i) = (sum > 0)? std::log(sum) : 
-        std::numeric_limits<double>::min();
-    }
+    // Only rescale the edge potential for weighted edges
+    if(weight == 1) convolve(EDGE_POTENTIAL, cavity, message);
+    else convolve(EDGE_POTENTIAL.scaled(weight), cavity, message);
+  } // end of convolve
+
+  inline void convolve(const pairwise_potential& potential,
+                       const factor_type& cavity, 
+                       factor_type& message) const {
+    if(MAX_PRODUCT) potential.max_product_message(cavity, message);
+    else potential.sum_product_message(cavity, message);
   } // end of convolve
   
   /**
@@ -609,6 +650,13 @@ int main(int argc, char** argv) {
   clopts.add_positional("output");
   clopts.attach_option("smoothing", SMOOTHING,
                        "The amount of smoothing (larger = more)");
+  clopts.attach_option("potential", POTENTIAL,
+                       "The edge potential {potts, linear, quadratic}.");
+  clopts.attach_option("truncation", TRUNCATION,
+                       "The distance at which the linear and quadratic "
+                       "potentials are truncated.");
+  clopts.attach_option("max_product", MAX_PRODUCT,
+                       "Compute max-marginals instead of marginals.");
   clopts.attach_option("damping", DAMPING,
                        "The amount of damping (0 -> no damping and 1 -> no progress)");
   clopts.attach_option("tol", TOLERANCE,
@@ -622,6 +670,16 @@ int main(int argc, char** argv) {
     return clopts.is_set("help")? EXIT_SUCCESS : EXIT_FAILURE;
   }
 
+  pairwise_potential::kind_type potential_kind;
+  if(!pairwise_potential::parse_kind(POTENTIAL, potential_kind) ||
+     TRUNCATION < 0) {
+    logstream(LOG_ERROR) << "Invalid potential: " << POTENTIAL 
+                         << " truncated at " << TRUNCATION << std::endl;
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  EDGE_POTENTIAL = pairwise_potential(potential_kind, SMOOTHING, TRUNCATION);
+
   if(prior_dir.empty()) {
     logstream(LOG_ERROR) << "No prior was provided." << std::endl;
     clopts.print_description();
@@ -0,0 +1,401 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ * Message kernels for pairwise Markov Random Fields in log space
+ */
+
+
+#ifndef TK_MESSAGE_KERNELS
+#define TK_MESSAGE_KERNELS
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+#include <graphlab/logger/assertions.hpp>
+
+
+/**
+ * \brief A pairwise edge potential theta(xi, xj) in log space together
+ * with the precomputed layout used by the message kernels.
+ *
+ * The parametric potentials only depend on the distance d = |xi - xj|
+ * between the states of the two variables:
+ *
+ * \code
+ * potts:     theta(xi, xj) = -lambda * (d > 0 ? 1 : 0)
+ * linear:    theta(xi, xj) = -lambda * min(d, truncation)
+ * quadratic: theta(xi, xj) = -lambda * min(d * d, truncation)
+ * \endcode
+ *
+ * and are evaluated with distance transforms whenever lambda >= 0: the
+ * Potts and linear messages and the quadratic max-product message in
+ * O(L) per message for L states, and the quadratic sum-product message
+ * in O(L * B) where the band B is the number of distances d at which
+ * exp(-lambda * d * d) is not negligible next to the weight of the
+ * truncated states (at most the truncation window and MAX_BAND).
+ * Repulsive potentials (lambda < 0) fall back to the O(L^2)
+ * evaluation.  Any other potential is given as
+ * a table whose rows are indexed by the state of the variable
+ * receiving the message and whose columns by the state of the
+ * variable sending it.
+ */
+class pairwise_potential {
+public:
+  enum kind_type { POTTS, LINEAR, QUADRATIC, TABLE };
+
+  /**
+   * \brief The largest distance at which the quadratic kernel
+   * evaluates the potential explicitly.
+   */
+  static const size_t MAX_BAND = 1 << 16;
+
+  /** \brief A Potts potential with no smoothing */
+  pairwise_potential() : kind_(POTTS), lambda_(0),
+    truncation_(std::numeric_limits<double>::infinity()) { initialize(); }
+
+  /** \brief A parametric potential */
+  pairwise_potential(kind_type kind, double lambda,
+                     double truncation =
+                     std::numeric_limits<double>::infinity()) :
+    kind_(kind), lambda_(lambda), truncation_(truncation) {
+    ASSERT_NE(int(kind), int(TABLE));
+    ASSERT_GE(truncation, 0);
+    initialize();
+  }
+
+  /** \brief A potential given by a table of receiver x sender states */
+  explicit pairwise_potential(const Eigen::MatrixXd& table) :
+    kind_(TABLE), lambda_(1),
+    truncation_(std::numeric_limits<double>::infinity()), table_(table) {
+    initialize();
+  }
+
+  /**
+   * \brief Parses the name of a parametric potential {potts, linear,
+   * quadratic}.  Returns false if the name is unknown.
+   */
+  static bool parse_kind(const std::string& name, kind_type& kind) {
+    if(name == "potts") kind = POTTS;
+    else if(name == "linear") kind = LINEAR;
+    else if(name == "quadratic") kind = QUADRATIC;
+    else return false;
+    return true;
+  }
+
+  kind_type kind() const { return kind_; }
+  double lambda() const { return lambda_; }
+  double truncation() const { return truncation_; }
+
+  /**
+   * \brief Returns the potential multiplied by weight.  Scaling a
+   * table recomputes its exponent in O(L^2).
+   */
+  pairwise_potential scaled(double weight) const {
+    if(kind_ == TABLE) return pairwise_potential(table_ * weight);
+    return pairwise_potential(kind_, lambda_ * weight, truncation_);
+  }
+
+  /** \brief The value of the potential in log space */
+  double operator()(int xi, int xj) const {
+    if(kind_ == TABLE) return table_(xi, xj);
+    const double d = std::abs(double(xi) - double(xj));
+    if(d == 0) return 0;
+    switch(kind_) {
+    case POTTS: return -lambda_;
+    case LINEAR: return -lambda_ * std::min(d, truncation_);
+    default: return -lambda_ * std::min(d * d, truncation_);
+    }
+  } // end of operator()
+
+  /**
+   * \brief Computes the sum-product message
+   *
+   * \code
+   * message(xi) = log sum_xj exp(theta(xi, xj) + cavity(xj))
+   * \endcode
+   *
+   * The cavity is shifted by its maximum before exponentiating so
+   * that only O(L) exponents and logarithms are evaluated, and the
+   * sum over xj is computed by a recursive filter (linear), a band
+   * around the diagonal (quadratic) or a matrix vector product with
+   * the precomputed exp(theta) (table).  This is O(L) for the Potts
+   * and linear potentials, O(L * B) for the quadratic potential with
+   * a band of B distances and O(L^2) for tables.  The messages are
+   * clamped below at max(cavity) + log(DBL_MIN) so that they never
+   * underflow to -inf.  The size of message must be set to the number
+   * of states of the receiving variable.
+   */
+  void sum_product_message(const Eigen::VectorXd& cavity,
+                           Eigen::VectorXd& message) const {
+    ASSERT_GT(cavity.size(), 0); ASSERT_GT(message.size(), 0);
+    if(kind_ != TABLE && kind_ != POTTS && lambda_ < 0) {
+      dense_sum_product(cavity, message);
+      return;
+    }
+    const double shift = cavity.maxCoeff();
+    Eigen::VectorXd sums;
+    if(kind_ == TABLE) {
+      ASSERT_EQ(exp_table_.rows(), message.size());
+      ASSERT_EQ(exp_table_.cols(), cavity.size());
+      const Eigen::VectorXd prob = (cavity.array() - shift).exp().matrix();
+      sums.noalias() = exp_table_ * prob;
+    } else {
+      const int n = int(std::max(cavity.size(), message.size()));
+      Eigen::VectorXd prob = Eigen::VectorXd::Zero(n);
+      prob.head(cavity.size()) = (cavity.array() - shift).exp().matrix();
+      if(kind_ == LINEAR) linear_sum_product(prob, sums);
+      else if(kind_ == QUADRATIC) quadratic_sum_product(prob, sums);
+      else {
+        // Potts: every other state contributes exp(-lambda)
+        sums = (1 - far_weight_) * prob;
+        sums.array() += far_weight_ * prob.sum();
+      }
+    }
+    // Do not allow the messages to underflow in log space
+    const double min_sum = std::numeric_limits<double>::min();
+    for(int i = 0; i < message.size(); ++i)
+      message(i) = shift + std::log(std::max(sums(i), min_sum));
+  } // end of sum_product_message
+
+  /**
+   * \brief Computes the max-product message (min-sum on the negated
+   * potentials)
+   *
+   * \code
+   * message(xi) = max_xj theta(xi, xj) + cavity(xj)
+   * \endcode
+   *
+   * using the distance transforms of Felzenszwalb and Huttenlocher
+   * (Efficient Belief Propagation for Early Vision, IJCV 2006) for
+   * the parametric potentials and a column at a time maximum over the
+   * table otherwise.  The size of message must be set to the number
+   * of states of the receiving variable.
+   */
+  void max_product_message(const Eigen::VectorXd& cavity,
+                           Eigen::VectorXd& message) const {
+    ASSERT_GT(cavity.size(), 0); ASSERT_GT(message.size(), 0);
+    if(kind_ == TABLE) {
+      ASSERT_EQ(table_.rows(), message.size());
+      ASSERT_EQ(table_.cols(), cavity.size());
+      message = (table_.col(0).array() + cavity(0)).matrix();
+      for(int j = 1; j < cavity.size(); ++j)
+        message = message.cwiseMax((table_.col(j).array() +
+                                    cavity(j)).matrix());
+      return;
+    }
+    const int n = int(std::max(cavity.size(), message.size()));
+    Eigen::VectorXd best =
+      Eigen::VectorXd::Constant(n, -std::numeric_limits<double>::infinity());
+    best.head(cavity.size()) = cavity;
+    const double max_value = cavity.maxCoeff();
+    if(lambda_ < 0) {
+      Eigen::VectorXd dense;
+      dense_max_product(best, dense);
+      message = dense.head(message.size());
+      return;
+    }
+    if(kind_ == LINEAR) {
+      for(int i = 1; i < n; ++i)
+        best(i) = std::max(best(i), best(i-1) - lambda_);
+      for(int i = n - 2; i >= 0; --i)
+        best(i) = std::max(best(i), best(i+1) - lambda_);
+    } else if(kind_ == QUADRATIC) {
+      quadratic_max_product(best);
+    }
+    // States further than the truncation all receive the far value
+    message = best.head(message.size()).cwiseMax(
+      Eigen::VectorXd::Constant(message.size(), max_value + far_value_));
+  } // end of max_product_message
+
+private:
+  kind_type kind_;
+  double lambda_;
+  double truncation_;
+  /** The potential between states at or beyond the truncation */
+  double far_value_;
+  /** exp(far_value_) */
+  double far_weight_;
+  /** The largest distance below the truncation */
+  size_t window_;
+  /** exp(theta(d)) - far_weight_ for the quadratic kernel */
+  std::vector<double> band_;
+  Eigen::MatrixXd table_;
+  Eigen::MatrixXd exp_table_;
+
+  void initialize() {
+    const double inf = std::numeric_limits<double>::infinity();
+    band_.clear();
+    if(kind_ == TABLE) {
+      far_value_ = -inf; far_weight_ = 0; window_ = 0;
+      exp_table_ = table_.array().exp().matrix();
+      return;
+    }
+    if(kind_ == POTTS) truncation_ = 1;
+    // the truncation is always reached when there is no smoothing
+    far_value_ = (lambda_ == 0)? 0 :
+      (truncation_ == inf)? -inf : -lambda_ * truncation_;
+    far_weight_ = std::exp(far_value_);
+    const double reach = (kind_ == QUADRATIC)?
+      std::sqrt(truncation_) : truncation_;
+    window_ = (reach >= double(MAX_BAND))? MAX_BAND : size_t(reach);
+    if(kind_ == QUADRATIC && lambda_ >= 0) {
+      // Past the band the remaining weights are too small to change
+      // the sums
+      const double epsilon = std::numeric_limits<double>::epsilon();
+      const double min_weight =
+        std::max(far_weight_ * epsilon, std::numeric_limits<double>::min());
+      for(size_t d = 0; d <= window_; ++d) {
+        const double weight = std::exp(-lambda_ * double(d * d)) - far_weight_;
+        if(weight < min_weight) break;
+        band_.push_back(weight);
+      }
+    }
+  } // end of initialize
+
+  /**
+   * Sums prob(xj) exp(-lambda * min(|xi - xj|, truncation)) with a
+   * forward and a backward recursive filter over the states within the
+   * truncation, and a prefix sum for the states beyond it.
+   */
+  void linear_sum_product(const Eigen::VectorXd& prob,
+                          Eigen::VectorXd& sums) const {
+    const int n = int(prob.size());
+    const double decay = std::exp(-lambda_);
+    const bool truncated = window_ + 1 < size_t(n);
+    const int window = truncated? int(window_) : n - 1;
+    // decay^(window+1) is the weight which leaves the window
+    const double leaving = truncated?
+      std::pow(decay, double(window + 1)) : 0;
+    Eigen::VectorXd forward(n), backward(n);
+    forward(0) = prob(0);
+    for(int i = 1; i < n; ++i) {
+      double value = decay * forward(i-1) + prob(i);
+      if(i > window) value -= leaving * prob(i - window - 1);
+      forward(i) = std::max(value, 0.0);
+    }
+    backward(n-1) = prob(n-1);
+    for(int i = n - 2; i >= 0; --i) {
+      double value = decay * backward(i+1) + prob(i);
+      if(i + window + 1 < n) value -= leaving * prob(i + window + 1);
+      backward(i) = std::max(value, 0.0);
+    }
+    sums = forward + backward - prob;
+    if(truncated && far_weight_ > 0) {
+      std::vector<double> prefix(n + 1, 0);
+      for(int i = 0; i < n; ++i) prefix[i+1] = prefix[i] + prob(i);
+      for(int i = 0; i < n; ++i) {
+        const double near = prefix[std::min(i + window + 1, n)] -
+          prefix[std::max(i - window, 0)];
+        sums(i) += far_weight_ * std::max(prefix[n] - near, 0.0);
+      }
+    }
+  } // end of linear_sum_product
+
+  /**
+   * Adds the shifted copies of prob weighted by the band of the
+   * quadratic potential to the weight of the states beyond the
+   * truncation.
+   */
+  void quadratic_sum_product(const Eigen::VectorXd& prob,
+                             Eigen::VectorXd& sums) const {
+    const int n = int(prob.size());
+    sums = Eigen::VectorXd::Constant(n, far_weight_ * prob.sum());
+    if(band_.empty()) return;
+    sums += band_[0] * prob;
+    const int width = int(std::min(band_.size(), size_t(n)));
+    for(int d = 1; d < width; ++d) {
+      sums.segment(d, n - d) += band_[d] * prob.head(n - d);
+      sums.head(n - d) += band_[d] * prob.segment(d, n - d);
+    }
+  } // end of quadratic_sum_product
+
+  /**
+   * Replaces best by the lower envelope of the parabolas rooted at
+   * every state (the distance transform of Felzenszwalb and
+   * Huttenlocher) of the untruncated quadratic potential.
+   */
+  void quadratic_max_product(Eigen::VectorXd& best) const {
+    const int n = int(best.size());
+    const double inf = std::numeric_limits<double>::infinity();
+    if(lambda_ == 0) { best.setConstant(best.maxCoeff()); return; }
+    // roots[k] is the state of the k-th parabola of the envelope which
+    // is the highest between bounds[k] and bounds[k+1]
+    std::vector<int> roots(n);
+    std::vector<double> bounds(n + 1);
+    int k = -1;
+    for(int q = 0; q < n; ++q) {
+      if(best(q) == -inf) continue;
+      const double fq = -best(q) + lambda_ * double(q) * double(q);
+      double s = -inf;
+      while(k >= 0) {
+        const int v = roots[k];
+        const double fv = -best(v) + lambda_ * double(v) * double(v);
+        s = (fq - fv) / (2 * lambda_ * double(q - v));
+        if(s > bounds[k]) break;
+        --k;
+      }
+      ++k;
+      roots[k] = q;
+      bounds[k] = (k == 0)? -inf : s;
+      bounds[k+1] = inf;
+    }
+    if(k < 0) return;
+    const Eigen::VectorXd values = best;
+    k = 0;
+    for(int i = 0; i < n; ++i) {
+      while(bounds[k+1] < double(i)) ++k;
+      const double d = double(i - roots[k]);
+      best(i) = values(roots[k]) - lambda_ * d * d;
+    }
+  } // end of quadratic_max_product
+
+  /**
+   * The O(L^2) evaluation used when the distance transforms do not
+   * apply (repulsive potentials with a negative lambda).
+   */
+  void dense_sum_product(const Eigen::VectorXd& cavity,
+                         Eigen::VectorXd& message) const {
+    Eigen::VectorXd terms(cavity.size());
+    for(int i = 0; i < message.size(); ++i) {
+      for(int j = 0; j < cavity.size(); ++j)
+        terms(j) = cavity(j) + (*this)(i, j);
+      const double shift = terms.maxCoeff();
+      message(i) = shift + std::log((terms.array() - shift).exp().sum());
+    }
+  } // end of dense_sum_product
+
+  void dense_max_product(const Eigen::VectorXd& best,
+                         Eigen::VectorXd& result) const {
+    const int n = int(best.size());
+    result.setConstant(n, -std::numeric_limits<double>::infinity());
+    for(int i = 0; i < n; ++i)
+      for(int j = 0; j < n; ++j)
+        result(i) = std::max(result(i), best(j) + (*this)(i, j));
+  } // end of dense_max_product
+
+}; // end of pairwise_potential
+
+
+#endif
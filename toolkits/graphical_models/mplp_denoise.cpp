@@ -44,6 +44,7 @@
 #include <graphlab.hpp>
 
 #include "eigen_serialization.hpp"
+#include "message_kernels.hpp"
 
 #include <graphlab/macros_def.hpp>
 
@@ -74,6 +75,9 @@ double MAPrepval = 0;
 // Shared base edge potential
 matrix THETA_ij; 
 
+// The same edge potential in the form used by the message kernels
+pairwise_potential EDGE_POTENTIAL;
+
 // keep track of predictions at each node
 vector PRED_COLOR;
 
@@ -393,14 +397,15 @@ public:
         const vector old_delf_i = vdata.delf_i;
         const vector old_delf_j = vdata.delf_j;
         
+        // The maximizations over the other variable are max-product
+        // messages through the (symmetric) edge potential
+        vector max_i(THETA_ij.rows()), max_j(THETA_ij.cols());
+        EDGE_POTENTIAL.max_product_message(theta_j + sum.delf_j, max_i);
+        EDGE_POTENTIAL.max_product_message(theta_i + sum.delf_i, max_j);
         // Update del fi
-        vdata.delf_i = -(theta_i + sum.delf_i)/2 + 
-        (THETA_ij + (theta_j + sum.delf_j).transpose().replicate(THETA_ij.rows(),1)).
-        rowwise().maxCoeff()/2;
+        vdata.delf_i = -(theta_i + sum.delf_i)/2 + max_i/2;
         // Update del fj
-        vdata.delf_j = -(theta_j + sum.delf_j)/2 + 
-        ((THETA_ij + (theta_i + sum.delf_i).replicate(1,THETA_ij.cols())).
-         colwise().maxCoeff()).transpose()/2;
+        vdata.delf_j = -(theta_j + sum.delf_j)/2 + max_j/2;
         
         ////////////////////////////////////////////
         // Compute contributions to dual, primal and rep primal
@@ -446,13 +451,21 @@ public:
         else
             vdata.pred_color_j = PRED_COLOR[vdata.j];
         
-        // We always own edge i,j
-        matrix thetarep_ij = THETA_ij - (vdata.delf_i.replicate(1,THETA_ij.cols()))
-                            - (vdata.delf_j.transpose().replicate(THETA_ij.rows(),1));
-        
-        vdata.valij = thetarep_ij.maxCoeff(&vdata.maxIJ_i, &vdata.maxIJ_j);
+        // We always own edge i,j.  The maximum of the reparameterized
+        // edge potential 
+        //   THETA_ij(xi, xj) - delf_i(xi) - delf_j(xj) 
+        // is found without forming it by maximizing over xj with a
+        // max-product message and then over xi.
+        vector thetarep_i(THETA_ij.rows());
+        EDGE_POTENTIAL.max_product_message(-vdata.delf_j, thetarep_i);
+        vdata.valij = (thetarep_i - vdata.delf_i).maxCoeff(&vdata.maxIJ_i);
+        vector thetarep_j(THETA_ij.cols());
+        for(int xj = 0; xj < thetarep_j.size(); ++xj) 
+            thetarep_j(xj) = THETA_ij(vdata.maxIJ_i, xj) - vdata.delf_j(xj);
+        thetarep_j.maxCoeff(&vdata.maxIJ_j);
         vdata.pvalij = THETA_ij(vdata.pred_color_i, vdata.pred_color_j);
-        vdata.prvalij = thetarep_ij(vdata.pred_color_i, vdata.pred_color_j);
+        vdata.prvalij = vdata.pvalij - vdata.delf_i[vdata.pred_color_i] 
+            - vdata.delf_j[vdata.pred_color_j];
         
         mutex.lock();
         LPval -= LPremove; MAPval -= MAPremove; MAPrepval -= MAPrepremove;
@@ -828,12 +841,14 @@ void initialize_theta_ij(const std::string& smoothing,
     // Set the smoothing type
     if(smoothing == "laplace") 
     {
+        EDGE_POTENTIAL = pairwise_potential(pairwise_potential::LINEAR, lambda);
         for(int i = 0; i < THETA_ij.rows(); ++i) 
             for(int j = 0; j < THETA_ij.cols(); ++j) 
                 THETA_ij(i,j) = -std::abs(double(i) - double(j)) * lambda;
     } 
     else 
     {   
+        EDGE_POTENTIAL = pairwise_potential(pairwise_potential::POTTS, lambda);
         for(int i = 0; i < THETA_ij.rows(); ++i) 
             for(int j = 0; j < THETA_ij.cols(); ++j) 
                 THETA_ij(i,j) = -(i == j? 0 : lambda);
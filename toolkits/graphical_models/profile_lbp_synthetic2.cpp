@@ -50,6 +50,7 @@
 
 #include <Eigen/Dense>
 #include "eigen_serialization.hpp"
+#include "message_kernels.hpp"
 
 
 
@@ -82,6 +83,32 @@ typedef Eigen::VectorXd factor_type;
  */
 double SMOOTHING = 2;
 
+/**
+ * \brief The form of the edge factor {potts, linear, quadratic}.  The
+ * linear and quadratic edge factors penalize the distance between the
+ * assignments up to TRUNCATION (see message_kernels.hpp).
+ *
+ * This parameter is set as a command line argument.
+ */
+std::string POTENTIAL = "potts";
+
+/**
+ * \brief The distance beyond which the linear and quadratic edge
+ * factors stop growing.
+ */
+double TRUNCATION = std::numeric_limits<double>::infinity();
+
+/**
+ * \brief If set the messages compute the max-marginals (max-product)
+ * instead of the marginals (sum-product).
+ */
+bool MAX_PRODUCT = false;
+
+/**
+ * \brief The edge factor with unit edge weight
+ */
+pairwise_potential EDGE_POTENTIAL;
+
 
 double FIELD = 2;
 size_t NSTATES = 5;
@@ -335,7 +362,7 @@ struct bp_vertex_program :
 private:
 
   /**
-   * \brief Compute the convolution of the cavity with the Ising-Potts
+   * \brief Compute the convolution of the cavity with the
    * edge potential and store the result in the message
    *
    * \param cavity the belief minus the in-bound message
@@ -345,16 +372,16 @@ private:
    */
   inline void convolve(const factor_type& cavity, const double& weight, 
                        factor_type& message) const {
-    for(int i = 0; i < message.size(); ++i) {
-      double sum = 0;
-      for(int j = 0; j < cavity.size(); ++j) {
-        sum += std::exp( cavity(j)  + ( i == j? 0 : -(SMOOTHING*weight) ) ); 
-      }
-      // To try and ensure numerical stability we do not allow
-      // messages to underflow in log-space
-      message(i) = (sum > 0)? std::log(sum) : 
-        std::numeric_limits<double>::min();
-    }
+    // Only rescale the edge potential for weighted edges
+    if(weight == 1) convolve(EDGE_POTENTIAL, cavity, message);
+    else convolve(EDGE_POTENTIAL.scaled(weight), cavity, message);
+  } // end of convolve
+
+  inline void convolve(const pairwise_potential& potential,
+                       const factor_type& cavity, 
+                       factor_type& message) const {
+    if(MAX_PRODUCT) potential.max_product_message(cavity, message);
+    else potential.sum_product_message(cavity, message);
   } // end of convolve
   
   /**
@@ -505,6 +532,13 @@ int main(int argc, char** argv) {
   clopts.add_positional("output");
   clopts.attach_option("smoothing", SMOOTHING,
                        "The amount of smoothing (larger = more)");
+  clopts.attach_option("potential", POTENTIAL,
+                       "The edge potential {potts, linear, quadratic}.");
+  clopts.attach_option("truncation", TRUNCATION,
+                       "The distance at which the linear and quadratic "
+                       "potentials are truncated.");
+  clopts.attach_option("max_product", MAX_PRODUCT,
+                       "Compute max-marginals instead of marginals.");
   clopts.attach_option("damping", DAMPING,
                        "The amount of damping (0 -> no damping and 1 -> no progress)");
   clopts.attach_option("tol", TOLERANCE,
@@ -520,6 +554,15 @@ int main(int argc, char** argv) {
 
   clopts.get_engine_args().set_option("use_cache", USE_CACHE);
 
+  pairwise_potential::kind_type potential_kind;
+  if(!pairwise_potential::parse_kind(POTENTIAL, potential_kind) ||
+     TRUNCATION < 0) {
+    logstream(LOG_ERROR) << "Invalid potential: " << POTENTIAL 
+                         << " truncated at " << TRUNCATION << std::endl;
+    return EXIT_FAILURE;
+  }
+  EDGE_POTENTIAL = pairwise_potential(potential_kind, SMOOTHING, TRUNCATION);
+
   if(graph_dir.empty()) {
     logstream(LOG_ERROR) << "No graph was provided." << std::endl;
     return EXIT_FAILURE;